@@ -10,6 +10,21 @@ layout(binding = 0) uniform Camera {
     mat4 view_projection;
 } camera;
 
+#ifdef PACKED_VERTICES
+
+layout(push_constant) uniform Model {
+    mat4 transform;
+    vec4 bounds_min;
+    vec4 bounds_extent;
+} model;
+
+// input bindings, see PackedVertex
+layout(location = 0) in vec4 packed_position;
+layout(location = 1) in vec4 packed_frame;
+layout(location = 2) in vec2 packed_uv;
+
+#else
+
 layout(push_constant) uniform Model {
     mat4 transform;
 } model;
@@ -22,6 +37,8 @@ layout(location = 2) in vec3 tangent;
 layout(location = 3) in vec3 bitangent;
 layout(location = 4) in vec2 uv;
 
+#endif // PACKED_VERTICES
+
 // output bindings
 layout(location = 0) out vec4 frag_color;
 layout(location = 1) out vec3 frag_normal;
@@ -33,8 +50,43 @@ layout(location = 4) out vec3 frag_sun_dir;
 layout(location = 5) out vec2 frag_uv;
 layout(location = 6) out mat3 frag_tbn;
 
+#ifdef PACKED_VERTICES
+vec3 quat_rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+#endif // PACKED_VERTICES
+
 void main()
 {
+#ifdef PACKED_VERTICES
+    vec3 v = model.bounds_min.xyz + packed_position.xyz * model.bounds_extent.xyz;
+
+    // smallest three, the largest component is reconstructed and inserted at
+    // the index stored in the alpha bits
+    vec3 c = (packed_frame.xyz * 2.0 - 1.0) * 0.70710678;
+    float l = sqrt(max(1.0 - dot(c, c), 0.0));
+
+    int largest = int(packed_frame.w * 3.0 + 0.5);
+    vec4 q;
+    if (largest == 0) {
+        q = vec4(l, c.x, c.y, c.z);
+    } else if (largest == 1) {
+        q = vec4(c.x, l, c.y, c.z);
+    } else if (largest == 2) {
+        q = vec4(c.x, c.y, l, c.z);
+    } else {
+        q = vec4(c.x, c.y, c.z, l);
+    }
+
+    float handedness = packed_position.w > 0.5 ? -1.0 : 1.0;
+
+    vec3 tangent   = quat_rotate(q, vec3(1.0, 0.0, 0.0));
+    vec3 bitangent = quat_rotate(q, vec3(0.0, 1.0, 0.0)) * handedness;
+    vec3 normal    = quat_rotate(q, vec3(0.0, 0.0, 1.0));
+    vec2 uv        = packed_uv;
+#endif // PACKED_VERTICES
+
     mat4 mvp = camera.view_projection * model.transform;
     vec4 pos = model.transform * vec4(v, 1.0);
     gl_Position = mvp * vec4(v, 1.0);
@@ -103,6 +155,14 @@ vec3 sRGB_from_linear(vec3 l)
     return s;
 }
 
+// normal maps are linear and only store x and y, z is reconstructed so that
+// the two channel block compressed formats can be used
+vec3 normal_from_map(vec4 t)
+{
+    vec2 xy = t.xy * 2.0 - 1.0;
+    return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
+
 void main()
 {
     vec3 light_dir = normalize(in_sun_dir);
@@ -114,8 +174,7 @@ void main()
     float ambient_intensity = 0.4;
     vec3 light_color = vec3(1.0, 1.0, 1.0);
 
-    vec3 normal = sRGB_from_linear(texture(tex_nrm, in_uv).xyz);
-    normal = normalize(normal * 2.0f - 1.0f);
+    vec3 normal = normal_from_map(texture(tex_nrm, in_uv));
     normal = normalize(in_tbn * normal);
 
     vec3 ambient = ambient_intensity * light_color * color;
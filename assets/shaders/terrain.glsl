@@ -111,6 +111,14 @@ vec4 sRGB_from_linear(vec4 l)
     return s;
 }
 
+// normal maps are linear and only store x and y, z is reconstructed so that
+// the two channel block compressed formats can be used
+vec3 normal_from_map(vec4 t)
+{
+    vec2 xy = t.xy * 2.0 - 1.0;
+    return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
+
 void main()
 {
     vec3 light_dir = normalize(in_sun_pos - in_pos);
@@ -130,8 +138,7 @@ void main()
         vec3 color = texture(tex0_col, in_uv).rgb;
         ambient = mix(ambient, color, weights.r);
 
-        vec3 normal = sRGB_from_linear(texture(tex0_nrm, in_uv).xyz);
-        normal = normalize(normal * 2.0f - 1.0f);
+        vec3 normal = normal_from_map(texture(tex0_nrm, in_uv));
         normal = normalize(normal);
 
         vec3 reflect_dir = reflect(-light_dir, normal);
@@ -144,8 +151,7 @@ void main()
         vec3 color = texture(tex1_col, in_uv).rgb;
         ambient = mix(ambient, color, weights.g);
 
-        vec3 normal = sRGB_from_linear(texture(tex1_nrm, in_uv).xyz);
-        normal = normalize(normal * 2.0f - 1.0f);
+        vec3 normal = normal_from_map(texture(tex1_nrm, in_uv));
         normal = normalize(normal);
 
         vec3 reflect_dir = reflect(-light_dir, normal);
@@ -0,0 +1,39 @@
+/**
+ * file:    benchmark_audio.cpp
+ * created: 2018-09-25
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+#define AUDIO_SECONDS (10)
+
+// NOTE(jesper): the mixer's share of the decode, ten seconds of 48 kHz stereo
+BENCHMARK_FUNC(decode_adpcm_stereo_10s)
+{
+    i32 num_samples = 48000 * AUDIO_SECONDS;
+    i32 block_count = adpcm_block_count(num_samples);
+    i32 block_size  = adpcm_block_size(2);
+
+    std::vector<i16> pcm(num_samples * 2);
+    std::vector<u8> blocks(block_count * block_size);
+    std::vector<i16> decoded(ADPCM_BLOCK_SAMPLES * 2);
+
+    Random r = create_random(0xdeadbeef);
+    for (auto &s : pcm) {
+        s = (i16)next_u32(&r);
+    }
+
+    encode_adpcm(blocks.data(), pcm.data(), num_samples, 2);
+
+    state->max_iterations = 64;
+    while (keep_running(state)) {
+        start_timing(state);
+        for (i32 i = 0; i < block_count; i++) {
+            decode_adpcm_block(decoded.data(), blocks.data() + i * block_size, 2);
+            DONT_OPTIMIZE(decoded.data());
+        }
+        stop_timing(state);
+    }
+}
+BENCHMARK(decode_adpcm_stereo_10s);
@@ -0,0 +1,116 @@
+/**
+ * file:    benchmark_format.cpp
+ * created: 2018-09-19
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): the typical lines of the debug overlay, formatted with
+// snprintf and with format
+
+BENCHMARK_FUNC(snprintf_overlay_time)
+{
+    Random r = create_random(0xdeadbeef);
+    char buffer[256];
+
+    while (keep_running(state)) {
+        f32 dt_ms = 1.0f + 32.0f * next_f32(&r);
+        MEMORY_BARRIER();
+
+        start_timing(state);
+        snprintf(buffer, sizeof buffer, "cpu time: %.3f ms, %.1f fps",
+                 dt_ms, 1000.0f / dt_ms);
+        DONT_OPTIMIZE(buffer);
+        stop_timing(state);
+    }
+}
+BENCHMARK(snprintf_overlay_time);
+
+BENCHMARK_FUNC(format_overlay_time)
+{
+    Random r = create_random(0xdeadbeef);
+    char buffer[256];
+
+    while (keep_running(state)) {
+        f32 dt_ms = 1.0f + 32.0f * next_f32(&r);
+        MEMORY_BARRIER();
+
+        start_timing(state);
+        format(buffer, sizeof buffer, "cpu time: {.3} ms, {.1} fps",
+               dt_ms, 1000.0f / dt_ms);
+        DONT_OPTIMIZE(buffer);
+        stop_timing(state);
+    }
+}
+BENCHMARK(format_overlay_time);
+
+BENCHMARK_FUNC(snprintf_overlay_position)
+{
+    Random r = create_random(0xdeadbeef);
+    char buffer[256];
+
+    while (keep_running(state)) {
+        Vector3 p = { 1000.0f * next_f32(&r), 100.0f * next_f32(&r), -1000.0f * next_f32(&r) };
+        MEMORY_BARRIER();
+
+        start_timing(state);
+        snprintf(buffer, sizeof buffer, "player: %f, %f, %f", p.x, p.y, p.z);
+        DONT_OPTIMIZE(buffer);
+        stop_timing(state);
+    }
+}
+BENCHMARK(snprintf_overlay_position);
+
+BENCHMARK_FUNC(format_overlay_position)
+{
+    Random r = create_random(0xdeadbeef);
+    char buffer[256];
+
+    while (keep_running(state)) {
+        Vector3 p = { 1000.0f * next_f32(&r), 100.0f * next_f32(&r), -1000.0f * next_f32(&r) };
+        MEMORY_BARRIER();
+
+        start_timing(state);
+        format(buffer, sizeof buffer, "player: {}, {}, {}", p.x, p.y, p.z);
+        DONT_OPTIMIZE(buffer);
+        stop_timing(state);
+    }
+}
+BENCHMARK(format_overlay_position);
+
+BENCHMARK_FUNC(snprintf_overlay_timer)
+{
+    Random r = create_random(0xdeadbeef);
+    char buffer[256];
+
+    while (keep_running(state)) {
+        f64 ms    = 10.0 * (f64)next_f32(&r);
+        u64 calls = (u64)next_i32(&r) & 0xFFFF;
+        MEMORY_BARRIER();
+
+        start_timing(state);
+        snprintf(buffer, sizeof buffer, "%s: %.3f %" PRIu64, "render_entities", ms, calls);
+        DONT_OPTIMIZE(buffer);
+        stop_timing(state);
+    }
+}
+BENCHMARK(snprintf_overlay_timer);
+
+BENCHMARK_FUNC(format_overlay_timer)
+{
+    Random r = create_random(0xdeadbeef);
+    char buffer[256];
+
+    while (keep_running(state)) {
+        f64 ms    = 10.0 * (f64)next_f32(&r);
+        u64 calls = (u64)next_i32(&r) & 0xFFFF;
+        MEMORY_BARRIER();
+
+        start_timing(state);
+        format(buffer, sizeof buffer, "{}: {.3} {}", "render_entities", ms, calls);
+        DONT_OPTIMIZE(buffer);
+        stop_timing(state);
+    }
+}
+BENCHMARK(format_overlay_timer);
@@ -0,0 +1,60 @@
+/**
+ * file:    benchmark_image.cpp
+ * created: 2018-09-23
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+#define IMAGE_SIZE (2048)
+
+BENCHMARK_FUNC(bgra_from_bgr_2048x2048)
+{
+    std::vector<u8> bgr(IMAGE_SIZE * IMAGE_SIZE * 3);
+    std::vector<u8> bgra(IMAGE_SIZE * IMAGE_SIZE * 4);
+
+    Random r = create_random(0xdeadbeef);
+    for (auto &b : bgr) {
+        b = (u8)next_u32(&r);
+    }
+
+    state->max_iterations = 64;
+    while (keep_running(state)) {
+        start_timing(state);
+        for (i32 i = 0; i < IMAGE_SIZE; i++) {
+            bgra_from_bgr(
+                bgra.data() + i * IMAGE_SIZE * 4,
+                bgr.data() + i * IMAGE_SIZE * 3,
+                IMAGE_SIZE);
+        }
+        DONT_OPTIMIZE(bgra.data());
+        stop_timing(state);
+    }
+}
+BENCHMARK(bgra_from_bgr_2048x2048);
+
+BENCHMARK_FUNC(generate_mip_chain_kaiser_srgb_2048x2048)
+{
+    u32 mip_levels = mip_level_count(IMAGE_SIZE, IMAGE_SIZE);
+    std::vector<u8> chain(mip_chain_size(IMAGE_SIZE, IMAGE_SIZE, mip_levels));
+
+    Random r = create_random(0xdeadbeef);
+    for (i32 i = 0; i < IMAGE_SIZE * IMAGE_SIZE * 4; i++) {
+        chain[i] = (u8)next_u32(&r);
+    }
+
+    state->max_iterations = 16;
+    while (keep_running(state)) {
+        start_timing(state);
+        generate_mip_chain(
+            chain.data(),
+            IMAGE_SIZE, IMAGE_SIZE,
+            mip_levels,
+            MipFilter_kaiser,
+            true, false,
+            &g_allocator);
+        DONT_OPTIMIZE(chain.data());
+        stop_timing(state);
+    }
+}
+BENCHMARK(generate_mip_chain_kaiser_srgb_2048x2048);
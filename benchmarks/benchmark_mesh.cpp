@@ -0,0 +1,81 @@
+/**
+ * file:    benchmark_mesh.cpp
+ * created: 2018-09-23
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+#define MESH_GRID_SIZE (224)
+
+// NOTE(jesper): a 224x224 quad grid of a smooth height field, ~100k triangles
+// with every interior vertex shared by 6 of them
+void generate_mesh_grid(i32 n, std::vector<Vector3> *points, std::vector<u32> *indices)
+{
+    i32 side = n + 1;
+    for (i32 y = 0; y < side; y++) {
+        for (i32 x = 0; x < side; x++) {
+            f32 z = 0.5f * sinf(x * 0.1f) * cosf(y * 0.13f);
+            points->push_back({ x * 0.25f, y * 0.25f, z });
+        }
+    }
+
+    for (i32 y = 0; y < n; y++) {
+        for (i32 x = 0; x < n; x++) {
+            u32 a = y * side + x;
+            u32 b = a + 1;
+            u32 c = a + side;
+            u32 d = c + 1;
+
+            u32 quad[] = { a, b, d, a, d, c };
+            indices->insert(indices->end(), quad, quad + 6);
+        }
+    }
+}
+
+BENCHMARK_FUNC(simplify_100k_triangles_to_50k)
+{
+    std::vector<Vector3> points;
+    std::vector<u32> indices;
+    generate_mesh_grid(MESH_GRID_SIZE, &points, &indices);
+
+    std::vector<u32> lod(indices.size());
+
+    state->max_iterations = 16;
+    while (keep_running(state)) {
+        f32 error;
+
+        start_timing(state);
+        i32 count = simplify_mesh(
+            lod.data(),
+            indices.data(), (i32)indices.size(),
+            points.data(), (i32)points.size(),
+            (i32)indices.size() / 2,
+            &error,
+            &g_allocator);
+        DONT_OPTIMIZE(count);
+        stop_timing(state);
+    }
+}
+BENCHMARK(simplify_100k_triangles_to_50k);
+
+BENCHMARK_FUNC(optimize_vertex_cache_100k_triangles)
+{
+    std::vector<Vector3> points;
+    std::vector<u32> indices;
+    generate_mesh_grid(MESH_GRID_SIZE, &points, &indices);
+
+    std::vector<u32> copy(indices.size());
+
+    state->max_iterations = 16;
+    while (keep_running(state)) {
+        copy = indices;
+        MEMORY_BARRIER();
+
+        start_timing(state);
+        optimize_vertex_cache(copy.data(), (i32)copy.size(), (i32)points.size(), &g_allocator);
+        DONT_OPTIMIZE(copy.data());
+        stop_timing(state);
+    }
+}
+BENCHMARK(optimize_vertex_cache_100k_triangles);
@@ -0,0 +1,81 @@
+/**
+ * file:    benchmark_obj.cpp
+ * created: 2018-09-21
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+#define OBJ_GRID_SIZE (224)
+
+// NOTE(jesper): a 224x224 quad grid with positions, uvs and alternating
+// normals, ~100k triangles and ~7 MB of text. Every position is shared by up to
+// 6 triangles so most corners are welded.
+std::vector<char> generate_obj_grid(i32 n)
+{
+    Random r = create_random(0xdeadbeef);
+
+    std::vector<char> obj;
+    char line[256];
+
+    auto add_line = [&obj, &line](i32 length)
+    {
+        obj.insert(obj.end(), line, line + length);
+    };
+
+    i32 side = n + 1;
+    for (i32 y = 0; y < side; y++) {
+        for (i32 x = 0; x < side; x++) {
+            add_line(snprintf(line, sizeof line, "v %f %f %f\n",
+                              x * 0.25f, y * 0.25f, 10.0f * next_f32(&r)));
+        }
+    }
+
+    for (i32 y = 0; y < side; y++) {
+        for (i32 x = 0; x < side; x++) {
+            add_line(snprintf(line, sizeof line, "vt %f %f\n",
+                              x / (f32)n, y / (f32)n));
+        }
+    }
+
+    add_line(snprintf(line, sizeof line, "vn 0.000000 0.000000 1.000000\n"));
+    add_line(snprintf(line, sizeof line, "vn 0.000000 1.000000 0.000000\n"));
+
+    for (i32 y = 0; y < n; y++) {
+        for (i32 x = 0; x < n; x++) {
+            i32 a  = y * side + x + 1;
+            i32 b  = a + 1;
+            i32 c  = a + side;
+            i32 d  = c + 1;
+            i32 vn = 1 + ((x + y) & 1);
+
+            add_line(snprintf(line, sizeof line,
+                              "f %d/%d/%d %d/%d/%d %d/%d/%d\n",
+                              a, a, vn, b, b, vn, d, d, vn));
+            add_line(snprintf(line, sizeof line,
+                              "f %d/%d/%d %d/%d/%d %d/%d/%d\n",
+                              a, a, vn, d, d, vn, c, c, vn));
+        }
+    }
+
+    return obj;
+}
+
+BENCHMARK_FUNC(obj_parse_100k_triangles)
+{
+    std::vector<char> obj = generate_obj_grid(OBJ_GRID_SIZE);
+
+    state->max_iterations = 32;
+    while (keep_running(state)) {
+        start_timing(state);
+        ObjMesh mesh = parse_obj(obj.data(), obj.size(), &g_allocator, &g_allocator);
+        DONT_OPTIMIZE(mesh);
+        stop_timing(state);
+
+        destroy_array(&mesh.points);
+        destroy_array(&mesh.normals);
+        destroy_array(&mesh.uvs);
+        destroy_array(&mesh.indices);
+    }
+}
+BENCHMARK(obj_parse_100k_triangles);
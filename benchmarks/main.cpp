@@ -28,6 +28,7 @@
 #include "core/profiling.cpp"
 #include "core/lexer.cpp"
 #include "core/string.cpp"
+#include "core/format.cpp"
 #include "core/random.cpp"
 #include "core/hash.cpp"
 #include "core/hash_table.cpp"
@@ -35,6 +36,14 @@
 #include "core/array.cpp"
 #include "core/file.cpp"
 #include "core/maths.cpp"
+#include "core/obj.h"
+#include "core/obj.cpp"
+#include "core/mesh_optimize.h"
+#include "core/image.h"
+#include "core/mesh_optimize.cpp"
+#include "core/image.cpp"
+#include "core/adpcm.h"
+#include "core/adpcm.cpp"
 
 #if defined(__clang__)
 #define DONT_OPTIMIZE(value) asm volatile("" : : "g"(value) : "memory")
@@ -130,6 +139,11 @@ void stop_timing(Benchmark *state)
 #include "benchmark_random.cpp"
 #include "benchmark_hashtable.cpp"
 #include "benchmark_maths.cpp"
+#include "benchmark_format.cpp"
+#include "benchmark_obj.cpp"
+#include "benchmark_mesh.cpp"
+#include "benchmark_image.cpp"
+#include "benchmark_audio.cpp"
 
 int main()
 {
@@ -20,4 +20,16 @@
 
 #ifndef LEARY_DEBUG
 #define LEARY_DEBUG 1
-#endif
\ No newline at end of file
+#endif
+
+// NOTE(jesper): store meshes in the 16 byte PackedVertex layout, decoded in
+// mesh.glsl, instead of five separate f32 vertex buffers
+#ifndef LEARY_PACKED_VERTICES
+#define LEARY_PACKED_VERTICES 1
+#endif
+
+// NOTE(jesper): block compress colour and normal maps on load, see
+// texture_format_from_name
+#ifndef LEARY_COMPRESS_TEXTURES
+#define LEARY_COMPRESS_TEXTURES 1
+#endif
@@ -0,0 +1,152 @@
+/**
+ * file:    adpcm.cpp
+ * created: 2018-09-25
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+static const i16 g_adpcm_steps[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const i8 g_adpcm_index_adjust[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+struct AdpcmState {
+    i32 predictor;
+    i32 step_index;
+};
+
+i32 adpcm_block_size(i32 num_channels)
+{
+    return num_channels * (i32)(sizeof(AdpcmChannelHeader) + ADPCM_BLOCK_SAMPLES / 2);
+}
+
+i32 adpcm_block_count(i32 num_samples)
+{
+    return (num_samples + ADPCM_BLOCK_SAMPLES - 1) / ADPCM_BLOCK_SAMPLES;
+}
+
+static inline i32 adpcm_decode_sample(AdpcmState *state, u32 nibble)
+{
+    i32 step = g_adpcm_steps[state->step_index];
+
+    i32 diff = step >> 3;
+    if (nibble & 4) {
+        diff += step;
+    }
+
+    if (nibble & 2) {
+        diff += step >> 1;
+    }
+
+    if (nibble & 1) {
+        diff += step >> 2;
+    }
+
+    i32 predictor = (nibble & 8) ? state->predictor - diff : state->predictor + diff;
+    state->predictor = clamp(predictor, I16_MIN, I16_MAX);
+    state->step_index = clamp(state->step_index + g_adpcm_index_adjust[nibble], 0, 88);
+
+    return state->predictor;
+}
+
+// NOTE(jesper): the encoder steps its state through the decoder so the two
+// never drift apart
+static inline u32 adpcm_encode_sample(AdpcmState *state, i32 sample)
+{
+    i32 step = g_adpcm_steps[state->step_index];
+    i32 diff = sample - state->predictor;
+
+    u32 nibble = 0;
+    if (diff < 0) {
+        nibble = 8;
+        diff   = -diff;
+    }
+
+    if (diff >= step) {
+        nibble |= 4;
+        diff   -= step;
+    }
+
+    step >>= 1;
+    if (diff >= step) {
+        nibble |= 2;
+        diff   -= step;
+    }
+
+    step >>= 1;
+    if (diff >= step) {
+        nibble |= 1;
+    }
+
+    adpcm_decode_sample(state, nibble);
+    return nibble;
+}
+
+void encode_adpcm(u8 *dst, i16 *src, i32 num_samples, i32 num_channels)
+{
+    ASSERT(num_channels > 0 && num_channels <= ADPCM_MAX_CHANNELS);
+
+    AdpcmState states[ADPCM_MAX_CHANNELS] = {};
+
+    i32 block_count = adpcm_block_count(num_samples);
+    for (i32 b = 0; b < block_count; b++) {
+        i32 first = b * ADPCM_BLOCK_SAMPLES;
+
+        AdpcmChannelHeader *headers = (AdpcmChannelHeader*)dst;
+        for (i32 c = 0; c < num_channels; c++) {
+            headers[c].predictor  = (i16)states[c].predictor;
+            headers[c].step_index = (u8)states[c].step_index;
+            headers[c].reserved   = 0;
+        }
+        dst += num_channels * sizeof(AdpcmChannelHeader);
+
+        for (i32 c = 0; c < num_channels; c++) {
+            for (i32 i = 0; i < ADPCM_BLOCK_SAMPLES; i += 2) {
+                i32 s0 = first + i     < num_samples ? src[(first + i) * num_channels + c] : 0;
+                i32 s1 = first + i + 1 < num_samples ? src[(first + i + 1) * num_channels + c] : 0;
+
+                u32 lo = adpcm_encode_sample(&states[c], s0);
+                u32 hi = adpcm_encode_sample(&states[c], s1);
+                *dst++ = (u8)(lo | (hi << 4));
+            }
+        }
+    }
+}
+
+void decode_adpcm_block(i16 *dst, u8 *block, i32 num_channels)
+{
+    ASSERT(num_channels > 0 && num_channels <= ADPCM_MAX_CHANNELS);
+
+    AdpcmChannelHeader *headers = (AdpcmChannelHeader*)block;
+    u8 *data = block + num_channels * sizeof(AdpcmChannelHeader);
+
+    for (i32 c = 0; c < num_channels; c++) {
+        AdpcmState state;
+        state.predictor  = headers[c].predictor;
+        state.step_index = headers[c].step_index > 88 ? 88 : headers[c].step_index;
+
+        i16 *out = dst + c;
+        for (i32 i = 0; i < ADPCM_BLOCK_SAMPLES / 2; i++) {
+            u32 byte = *data++;
+
+            *out = (i16)adpcm_decode_sample(&state, byte & 0xf);
+            out += num_channels;
+
+            *out = (i16)adpcm_decode_sample(&state, byte >> 4);
+            out += num_channels;
+        }
+    }
+}
@@ -0,0 +1,40 @@
+/**
+ * file:    adpcm.h
+ * created: 2018-09-25
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): IMA-ADPCM, 4 bits per 16 bit sample. Sounds are kept in memory
+// in this format and the mixer decodes them a block at a time as it plays
+// them. Every block starts from the predictor state stored in its header, so a
+// block can be decoded without the ones before it, which is what lets a loop
+// wrap or a sound start anywhere without decoding from the start.
+//     for each channel: AdpcmChannelHeader
+//     for each channel: ADPCM_BLOCK_SAMPLES / 2 bytes, low nibble first
+// The last block is padded with silence.
+
+#define ADPCM_BLOCK_SAMPLES (1024)
+#define ADPCM_MAX_CHANNELS  (2)
+
+struct AdpcmChannelHeader {
+    i16 predictor;
+    u8  step_index;
+    u8  reserved;
+};
+
+// NOTE(jesper): size in bytes of one block of num_channels channels
+i32 adpcm_block_size(i32 num_channels);
+
+// NOTE(jesper): number of blocks needed for num_samples frames
+i32 adpcm_block_count(i32 num_samples);
+
+// NOTE(jesper): encodes num_samples frames of interleaved 16 bit samples, dst
+// must hold adpcm_block_count(num_samples) * adpcm_block_size(num_channels)
+// bytes
+void encode_adpcm(u8 *dst, i16 *src, i32 num_samples, i32 num_channels);
+
+// NOTE(jesper): decodes one block into ADPCM_BLOCK_SAMPLES frames of
+// interleaved 16 bit samples
+void decode_adpcm_block(i16 *dst, u8 *block, i32 num_channels);
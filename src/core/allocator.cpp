@@ -381,6 +381,7 @@ void* system_realloc(Allocator *a, void *ptr, isize asize)
 void* alloc(Allocator *a, isize size)
 {
     ASSERT(a->alloc != nullptr);
+    profiler_alloc(a, size);
     return a->alloc(a, size);
 }
 
@@ -393,6 +394,7 @@ void dealloc(Allocator *a, void *ptr)
 void* realloc(Allocator *a, void *ptr, isize size)
 {
     ASSERT(a->realloc != nullptr);
+    profiler_alloc(a, size);
     return a->realloc(a, ptr, size);
 }
 
@@ -6,7 +6,7 @@
  * Copyright (c) 2017-2018 - all rights reserved
  */
 
-#define alloc_array(a, T, count) (T*)alloc(a, sizeof(T) * count)
+#define alloc_array(a, T, count) (T*)alloc(a, sizeof(T) * (count))
 
 struct Allocator {
     void  *mem;
@@ -45,6 +45,10 @@ struct Allocator {
     dealloc_t *dealloc  = nullptr;
     realloc_t *realloc  = nullptr;
     reset_t      *reset = nullptr;
+
+    // NOTE(jesper): index into the profiler's allocator table, -1 if the
+    // allocations aren't being tracked
+    i32 profile_id = -1;
 };
 
 Allocator stack_allocator(void *mem, isize size);
@@ -0,0 +1,331 @@
+/**
+ * file:    asset_pack.cpp
+ * created: 2018-09-20
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+AssetPack g_asset_pack = {};
+
+bool open_asset_pack(FilePathView path)
+{
+    ASSERT(g_asset_pack.data == nullptr);
+
+    usize size;
+    u8 *data = (u8*)map_file(path, &size);
+    if (data == nullptr) {
+        return false;
+    }
+
+    AssetPackHeader *header = (AssetPackHeader*)data;
+    if (size < sizeof *header ||
+        header->magic != ASSET_PACK_MAGIC ||
+        header->version != ASSET_PACK_VERSION)
+    {
+        LOG_ERROR("invalid asset pack: %s", path.absolute.bytes);
+        unmap_file(data, size);
+        return false;
+    }
+
+    usize entries_end = header->entries_offset + header->entry_count * sizeof(AssetPackEntry);
+    usize order_end   = header->order_offset + header->entry_count * sizeof(u32);
+    usize names_end   = header->names_offset + header->names_size;
+    if (entries_end > size || order_end > size || names_end > size) {
+        LOG_ERROR("truncated asset pack: %s", path.absolute.bytes);
+        unmap_file(data, size);
+        return false;
+    }
+
+    // NOTE(jesper): the pointers handed out point straight into the mapping,
+    // so every entry has to be inside of it
+    AssetPackEntry *entries = (AssetPackEntry*)(data + header->entries_offset);
+    u32 *order = (u32*)(data + header->order_offset);
+    char *names = (char*)(data + header->names_offset);
+    for (u32 i = 0; i < header->entry_count; i++) {
+        AssetPackEntry &entry = entries[i];
+        if (entry.offset > size ||
+            entry.size > size - entry.offset ||
+            entry.name_offset >= header->names_size ||
+            entry.name_length >= header->names_size - entry.name_offset ||
+            names[entry.name_offset + entry.name_length] != '\0' ||
+            order[i] >= header->entry_count)
+        {
+            LOG_ERROR("corrupt asset pack, entry %u out of range: %s", i, path.absolute.bytes);
+            unmap_file(data, size);
+            return false;
+        }
+    }
+
+    g_asset_pack.data    = data;
+    g_asset_pack.size    = size;
+    g_asset_pack.header  = header;
+    g_asset_pack.entries = entries;
+    g_asset_pack.order   = order;
+    g_asset_pack.names   = names;
+
+    g_asset_pack.overridden = (bool*)alloc(g_heap, header->entry_count * sizeof(bool));
+    memset(g_asset_pack.overridden, 0, header->entry_count * sizeof(bool));
+
+    LOG_INFO("mounted asset pack: %s, %u assets, %llu bytes",
+             path.absolute.bytes, header->entry_count, (u64)size);
+    return true;
+}
+
+void close_asset_pack()
+{
+    if (g_asset_pack.data == nullptr) {
+        return;
+    }
+
+    dealloc(g_heap, g_asset_pack.overridden);
+    unmap_file(g_asset_pack.data, g_asset_pack.size);
+    g_asset_pack = {};
+}
+
+StringView pack_entry_name(AssetPackEntry *entry)
+{
+    return StringView{ g_asset_pack.names + entry->name_offset, (i32)entry->name_length + 1 };
+}
+
+AssetPackEntry* find_pack_entry(const char *name, i32 length)
+{
+    if (g_asset_pack.data == nullptr) {
+        return nullptr;
+    }
+
+    u64 hash = asset_pack_hash(name, length);
+
+    // NOTE(jesper): lower bound on the hash, then step over any collisions
+    i32 first = 0;
+    i32 count = (i32)g_asset_pack.header->entry_count;
+    while (count > 0) {
+        i32 step = count / 2;
+        if (g_asset_pack.entries[first + step].name_hash < hash) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+
+    for (u32 i = (u32)first; i < g_asset_pack.header->entry_count; i++) {
+        AssetPackEntry *entry = &g_asset_pack.entries[i];
+        if (entry->name_hash != hash) {
+            break;
+        }
+
+        if (entry->name_length != (u32)length) {
+            continue;
+        }
+
+        char *entry_name = g_asset_pack.names + entry->name_offset;
+
+        bool equal = true;
+        for (i32 j = 0; j < length && equal; j++) {
+            char a = entry_name[j] == '\\' ? '/' : entry_name[j];
+            char b = name[j] == '\\' ? '/' : name[j];
+            equal = a == b;
+        }
+
+        if (equal) {
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
+
+AssetPackEntry* find_pack_entry(StringView name)
+{
+    return find_pack_entry(name.bytes, name.size - 1);
+}
+
+// NOTE(jesper): pack entries are named relative to the data folder. The
+// shaders are loaded from their own folder next to the executable, which holds
+// the same files as the data folder's shaders/, so paths in it are looked up
+// under that name. Anything else can't be in the pack.
+AssetPackEntry* find_pack_entry(FilePathView path)
+{
+    if (g_asset_pack.data == nullptr) {
+        return nullptr;
+    }
+
+    struct PackRoot {
+        FolderPathView folder;
+        const char     *prefix;
+    };
+
+    PackRoot roots[] = {
+        { g_paths.data,    "" },
+        { g_paths.shaders, "shaders/" },
+    };
+
+    i32 length = path.absolute.size - 1;
+    for (PackRoot &root : roots) {
+        i32 root_length = root.folder.absolute.size - 1;
+        if (root_length <= 0 ||
+            length <= root_length ||
+            memcmp(path.absolute.bytes, root.folder.absolute.bytes, root_length) != 0)
+        {
+            continue;
+        }
+
+        char name[1024];
+        i32 prefix_length = (i32)strlen(root.prefix);
+        i32 name_length   = prefix_length + length - root_length;
+        if (name_length > (i32)sizeof name) {
+            return nullptr;
+        }
+
+        memcpy(name, root.prefix, (usize)prefix_length);
+        memcpy(name + prefix_length, path.absolute.bytes + root_length, (usize)(length - root_length));
+        return find_pack_entry(name, name_length);
+    }
+
+    return nullptr;
+}
+
+// NOTE(jesper): the packed equivalent of list_files, returns the files inside
+// folder and its sub-folders sorted by path, the order they were packed in
+Array<FilePath> list_pack_files(FolderPathView folder, Allocator *a)
+{
+    Array<FilePath> files = create_array<FilePath>(a);
+    if (g_asset_pack.data == nullptr) {
+        return files;
+    }
+
+    i32 root_length   = g_paths.data.absolute.size - 1;
+    i32 folder_length = folder.absolute.size - 1;
+    if (folder_length < root_length ||
+        memcmp(folder.absolute.bytes, g_paths.data.absolute.bytes, root_length) != 0)
+    {
+        return files;
+    }
+
+    const char *relative = folder.absolute.bytes + root_length;
+    i32 relative_length  = folder_length - root_length;
+    bool trailing_sep    = relative_length > 0 &&
+                           (relative[relative_length-1] == '/' ||
+                            relative[relative_length-1] == '\\');
+
+    for (u32 i = 0; i < g_asset_pack.header->entry_count; i++) {
+        AssetPackEntry *entry = &g_asset_pack.entries[g_asset_pack.order[i]];
+        char *name = g_asset_pack.names + entry->name_offset;
+        i32 length = (i32)entry->name_length;
+
+        i32 start = relative_length;
+        if (relative_length > 0 && !trailing_sep) {
+            start++;
+        }
+
+        if (length <= start) {
+            continue;
+        }
+
+        bool match = true;
+        for (i32 j = 0; j < relative_length && match; j++) {
+            char c0 = relative[j] == '\\' ? '/' : relative[j];
+            match = c0 == name[j];
+        }
+
+        if (!match || (start > relative_length && name[relative_length] != '/')) {
+            continue;
+        }
+
+        array_add(&files, resolve_file_path(GamePath_data, pack_entry_name(entry), a));
+    }
+
+    return files;
+}
+
+// NOTE(jesper): the files in folder and its sub-folders, the packed ones
+// first in the order they were packed, followed by any loose files that were
+// added after the pack was built. A file that's in both is listed once.
+Array<FilePath> list_asset_files(FolderPath folder, Allocator *a)
+{
+    if (g_asset_pack.data == nullptr) {
+        return list_files(folder, a);
+    }
+
+    Array<FilePath> files = list_pack_files(folder, a);
+    if (!file_exists(FilePathView(folder.absolute.bytes))) {
+        return files;
+    }
+
+    Array<FilePath> loose = list_files(folder, a);
+    defer { destroy_array(&loose); };
+
+    for (FilePath &path : loose) {
+        if (find_pack_entry(path) == nullptr) {
+            array_add(&files, create_file_path(a, path.absolute));
+        }
+    }
+
+    return files;
+}
+
+// NOTE(jesper): returns a read-only view into the mapped pack if the asset is
+// in it, otherwise falls back to reading the file into memory from a. The
+// result must be released with release_asset instead of dealloc.
+char* read_asset(FilePathView path, usize *size, Allocator *a)
+{
+    AssetPackEntry *entry = find_pack_entry(path);
+    if (entry != nullptr && !g_asset_pack.overridden[entry - g_asset_pack.entries]) {
+        *size = (usize)entry->size;
+        return (char*)(g_asset_pack.data + entry->offset);
+    }
+
+    return read_file(path, size, a);
+}
+
+void release_asset(char *data, Allocator *a)
+{
+    if (data == nullptr) {
+        return;
+    }
+
+    u8 *ptr = (u8*)data;
+    if (ptr >= g_asset_pack.data && ptr < g_asset_pack.data + g_asset_pack.size) {
+        return;
+    }
+
+    dealloc(a, data);
+}
+
+// NOTE(jesper): like read_asset, but maps a loose file instead of reading it,
+// for data that's kept around as is. The result must be released with
+// unmap_asset.
+char* map_asset(FilePathView path, usize *size)
+{
+    AssetPackEntry *entry = find_pack_entry(path);
+    if (entry != nullptr && !g_asset_pack.overridden[entry - g_asset_pack.entries]) {
+        *size = (usize)entry->size;
+        return (char*)(g_asset_pack.data + entry->offset);
+    }
+
+    return (char*)map_file(path, size);
+}
+
+bool is_packed_asset(char *data)
+{
+    u8 *ptr = (u8*)data;
+    return ptr >= g_asset_pack.data && ptr < g_asset_pack.data + g_asset_pack.size;
+}
+
+void unmap_asset(char *data, usize size)
+{
+    if (data == nullptr || is_packed_asset(data)) {
+        return;
+    }
+
+    unmap_file(data, size);
+}
+
+void override_pack_asset(FilePathView path)
+{
+    AssetPackEntry *entry = find_pack_entry(path);
+    if (entry != nullptr) {
+        g_asset_pack.overridden[entry - g_asset_pack.entries] = true;
+    }
+}
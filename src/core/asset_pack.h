@@ -0,0 +1,97 @@
+/**
+ * file:    asset_pack.h
+ * created: 2018-09-20
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): an asset pack is a single file with every asset in the data
+// folder, built by tools/asset_packer.cpp. The runtime maps the whole file and
+// hands out pointers straight into the mapping, so there's no open/stat/read
+// or copy per asset. Layout:
+//     AssetPackHeader
+//     payloads, each aligned to ASSET_PACK_ALIGNMENT
+//     AssetPackEntry[entry_count], sorted by name_hash
+//     u32 order[entry_count], indices into the entries in listing order
+//     names, null-terminated and relative to the data folder, e.g.
+//     "textures/cobble_col.bmp"
+//
+// The format is shared with the packer, which only includes the part above
+// ASSET_PACK_FORMAT_ONLY and must not depend on more than core/types.h.
+
+#define ASSET_PACK_MAGIC     (0x4b41504c) // NOTE(jesper): "LPAK"
+#define ASSET_PACK_VERSION   (1)
+#define ASSET_PACK_ALIGNMENT (64)
+
+struct AssetPackHeader {
+    u32 magic;
+    u32 version;
+    u32 entry_count;
+    u32 names_size;
+    u64 entries_offset;
+    u64 order_offset;
+    u64 names_offset;
+};
+
+struct AssetPackEntry {
+    u64 name_hash;
+    u32 name_offset;
+    u32 name_length;
+    u64 offset;
+    u64 size;
+};
+
+// NOTE(jesper): FNV-1a, with '\\' hashed as '/' so that the lookup doesn't
+// depend on the platform's path separator
+inline u64 asset_pack_hash(const char *str, i32 length)
+{
+    u64 hash = 0xcbf29ce484222325ull;
+    for (i32 i = 0; i < length; i++) {
+        u8 c = str[i] == '\\' ? '/' : (u8)str[i];
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+#if !defined(ASSET_PACK_FORMAT_ONLY)
+
+struct AssetPack {
+    u8              *data;
+    usize           size;
+
+    AssetPackHeader *header;
+    AssetPackEntry  *entries;
+    u32             *order;
+    char            *names;
+
+    // NOTE(jesper): set on the main thread by start_catalog_reloads when the
+    // loose file has been modified, before its reload is handed to the load
+    // threads. From then on the file on disk is used instead of the packed one
+    bool            *overridden;
+};
+
+extern AssetPack g_asset_pack;
+
+bool open_asset_pack(FilePathView path);
+void close_asset_pack();
+
+AssetPackEntry* find_pack_entry(StringView name);
+StringView pack_entry_name(AssetPackEntry *entry);
+
+Array<FilePath> list_pack_files(FolderPathView folder, Allocator *a);
+Array<FilePath> list_asset_files(FolderPath folder, Allocator *a);
+
+char* read_asset(FilePathView path, usize *size, Allocator *a);
+void release_asset(char *data, Allocator *a);
+
+char* map_asset(FilePathView path, usize *size);
+void unmap_asset(char *data, usize size);
+
+// NOTE(jesper): true if data points into the asset pack, which stays mapped
+// and unchanged for as long as the game runs, unlike a loose file
+bool is_packed_asset(char *data);
+void override_pack_asset(FilePathView path);
+
+#endif // ASSET_PACK_FORMAT_ONLY
@@ -6,23 +6,17 @@
  * Copyright (c) 2017-2018 - all rights reserved
  */
 
-struct Vertex {
-    Vector3 p;
-    Vector3 n;
-    Vector2 uv;
-};
-
-bool operator == (Vertex &lhs, Vertex &rhs)
-{
-    return memcmp(&lhs, &rhs, sizeof(Vertex)) == 0;
-}
-
-
 Array<TextureAsset> g_textures;
 Array<Mesh>    g_meshes;
 Array<Entity>  g_entities;
 Catalog        g_catalog;
 
+CatalogLoadQueue g_catalog_loads;
+
+// NOTE(jesper): the queue of the hot reload batch in flight, see
+// process_catalog_system
+CatalogLoadQueue g_catalog_reloads;
+
 // NOTE(jesper): only Microsoft BMP version 3 is supported
 PACKED(struct BitmapFileHeader {
     u16 type;
@@ -46,83 +40,208 @@ PACKED(struct BitmapHeader {
     u32 colors_important;
 });
 
-PACKED(struct WAVHeader {
-       char chunk_id[4];
-       u32  chunk_size;
-       char format[4];
-       char subchunk1_id[4];
-       u32  subchunk1_size;
+PACKED(struct RiffChunk {
+       char id[4];
+       u32  size;
+});
+
+PACKED(struct WAVFormat {
        u16  audio_format;
        u16  num_channels;
        u32  sample_rate;
        u32  byte_rate;
        u16  block_align;
        u16  bits_per_sample;
-       char subchunk2_id[4];
-       u32  subchunk2_size;
 });
 
-SoundData load_sound_wav(FilePathView path, Allocator *allocator)
+#define WAV_FORMAT_PCM (1)
+
+// NOTE(jesper): parses the wav already read into file. The samples of the
+// result point into file, nothing is copied.
+SoundData load_sound_wav(FilePathView path, char *file, usize size)
 {
-    SoundData sound = {};
+    if (size < 12 ||
+        memcmp(file, "RIFF", 4) != 0 ||
+        memcmp(file + 8, "WAVE", 4) != 0)
+    {
+        LOG("invalid wav file: %s", path.filename.bytes);
+        return {};
+    }
 
-    usize size;
-    char *file = read_file(path, &size, g_frame);
+    WAVFormat *format = nullptr;
+    char *data        = nullptr;
+    u32 data_size     = 0;
+
+    usize offset = 12;
+    while (offset + sizeof(RiffChunk) <= size) {
+        RiffChunk *chunk = (RiffChunk*)(file + offset);
+        offset += sizeof *chunk;
 
-    WAVHeader *header = (WAVHeader*)file;
+        usize chunk_size = chunk->size < size - offset ? chunk->size : size - offset;
+        if (memcmp(chunk->id, "fmt ", 4) == 0 && chunk_size >= sizeof *format) {
+            format = (WAVFormat*)(file + offset);
+        } else if (memcmp(chunk->id, "data", 4) == 0) {
+            data      = file + offset;
+            data_size = (u32)chunk_size;
+        }
+
+        // NOTE(jesper): chunks are padded to an even size
+        offset += chunk_size + (chunk_size & 1);
+    }
+
+    if (format == nullptr || data == nullptr) {
+        LOG("wav file missing format or data: %s", path.filename.bytes);
+        return {};
+    }
+
+    if (format->audio_format != WAV_FORMAT_PCM) {
+        LOG("unsupported wav format (%s): %d", path.filename.bytes, format->audio_format);
+        return {};
+    }
 
-    sound.sample_rate = header->sample_rate;
-    sound.num_channels = header->num_channels;
-    sound.bits_per_sample = header->bits_per_sample;
-    sound.samples = (i16*)alloc(allocator, header->subchunk2_size);
-    sound.num_samples = header->subchunk2_size / ((sound.num_channels * sound.bits_per_sample) / 8);
-    memcpy(sound.samples, file + sizeof *header, header->subchunk2_size);
+    // TODO(jesper): support run-time resampling or do it in asset stage?
+    if (format->sample_rate != 48000) {
+        LOG("unsupported sample rate (%s): %d", path.filename.bytes, format->sample_rate);
+        return {};
+    }
 
-    if (sound.sample_rate != 48000) {
-        LOG("unsupported sample rate: %d", sound.sample_rate);
+    if (format->bits_per_sample != 16) {
+        LOG("unsupported bits per sample (%s): %d", path.filename.bytes, format->bits_per_sample);
         return {};
     }
 
-    if (sound.bits_per_sample != 16) {
-        LOG("unsupported bits per sample: %d", sound.bits_per_sample);
+    if (format->num_channels < 1 || format->num_channels > ADPCM_MAX_CHANNELS) {
+        LOG("unsupported number of channels (%s): %d", path.filename.bytes, format->num_channels);
         return {};
     }
 
+    SoundData sound = {};
+    sound.sample_rate     = format->sample_rate;
+    sound.num_channels    = format->num_channels;
+    sound.bits_per_sample = format->bits_per_sample;
+    sound.num_samples     = data_size / (sound.num_channels * sizeof(i16));
+    sound.samples         = (i16*)data;
     return sound;
 }
 
-TextureData load_texture_bmp(FilePathView path, Allocator *allocator)
-{
-    // TODO(jesper): make this path work with String struct
-    TextureData texture = {};
+// NOTE(jesper): derived data layout of a cooked sound, followed by
+// block_count IMA-ADPCM blocks
+struct CookedSoundHeader {
+    i32 sample_rate;
+    i32 num_channels;
+    i32 num_samples;
+    i32 block_count;
+};
 
+// NOTE(jesper): loads a sound compressed to IMA-ADPCM, from the derived data
+// cache if it's been cooked before. Only the compressed blocks are allocated
+// from a, a quarter of the PCM size.
+SoundData load_cooked_sound(FilePathView path, Allocator *a)
+{
     usize size;
-    char *file = read_file(path, &size, g_heap);
-    defer { dealloc(g_heap, file); };
-
+    char *file = read_asset(path, &size, g_heap);
     if (file == nullptr) {
-        LOG("unable to read file: %s", path.absolute.bytes);
-        return texture;
+        LOG_ERROR("unable to read file: %s", path.absolute.bytes);
+        return {};
+    }
+    defer { release_asset(file, g_heap); };
+
+    u64 key = derived_data_key(hash64(file, size), path.filename, SOUND_COOK_VERSION);
+
+    usize cached_size;
+    void *cached = map_derived_data(key, &cached_size);
+    if (cached != nullptr) {
+        defer { unmap_derived_data(cached, cached_size); };
+
+        DerivedDataReader reader  = derived_data_reader(cached, cached_size);
+        CookedSoundHeader *header = derived_data_read<CookedSoundHeader>(&reader);
+
+        if (header != nullptr &&
+            header->num_channels > 0 &&
+            header->num_channels <= ADPCM_MAX_CHANNELS &&
+            header->block_count == adpcm_block_count(header->num_samples))
+        {
+            i32 block_size = adpcm_block_size(header->num_channels);
+            usize blocks_size = (usize)header->block_count * block_size;
+
+            u8 *blocks = derived_data_read<u8>(&reader, blocks_size);
+            if (blocks != nullptr) {
+                SoundData sound = {};
+                sound.sample_rate     = header->sample_rate;
+                sound.num_channels    = header->num_channels;
+                sound.bits_per_sample = 16;
+                sound.num_samples     = header->num_samples;
+                sound.block_size      = block_size;
+                sound.blocks          = (u8*)alloc(a, blocks_size);
+                memcpy(sound.blocks, blocks, blocks_size);
+                return sound;
+            }
+        }
     }
 
-    LOG("Loading bmp: %s", path.absolute.bytes);
-    LOG("-- file size: %llu bytes", size);
+    SoundData pcm = load_sound_wav(path, file, size);
+    if (pcm.num_samples == 0) {
+        return {};
+    }
 
+    CookedSoundHeader header = {};
+    header.sample_rate  = pcm.sample_rate;
+    header.num_channels = pcm.num_channels;
+    header.num_samples  = pcm.num_samples;
+    header.block_count  = adpcm_block_count(pcm.num_samples);
 
-    ASSERT(file[0] == 'B' && file[1] == 'M');
+    SoundData sound = {};
+    sound.sample_rate     = pcm.sample_rate;
+    sound.num_channels    = pcm.num_channels;
+    sound.bits_per_sample = pcm.bits_per_sample;
+    sound.num_samples     = pcm.num_samples;
+    sound.block_size      = adpcm_block_size(pcm.num_channels);
 
-    char *ptr = file;
-    BitmapFileHeader *fh = (BitmapFileHeader*)ptr;
+    usize blocks_size = (usize)header.block_count * sound.block_size;
+    sound.blocks = (u8*)alloc(a, blocks_size);
+    encode_adpcm(sound.blocks, pcm.samples, pcm.num_samples, pcm.num_channels);
 
-    if (fh->type != 0x4d42) {
-        // TODO(jesper): support other bmp versions
-        LOG_UNIMPLEMENTED();
+    write_derived_data(key, {
+        DerivedDataChunk{ &header,      sizeof header },
+        DerivedDataChunk{ sound.blocks, blocks_size } });
+
+    return sound;
+}
+
+// NOTE(jesper): decodes the bmp already read into file, path is only used for
+// logging
+TextureData load_texture_bmp(
+    FilePathView path,
+    char *file, usize size,
+    Allocator *allocator)
+{
+    // TODO(jesper): make this path work with String struct
+    TextureData texture = {};
+
+    LOG_DEFERRED("Loading bmp: %s", path.absolute.bytes);
+    LOG_DEFERRED("-- file size: %llu bytes", size);
+
+
+    // NOTE(jesper): the file comes from disk or a hot-reload, a truncated or
+    // foreign file is an error rather than an assert
+    if (size < sizeof(BitmapFileHeader) + sizeof(BitmapHeader)) {
+        LOG_ERROR_DEFERRED("bmp file too small: %s", path.absolute.bytes);
+        return {};
+    }
+
+    if (file[0] != 'B' || file[1] != 'M') {
+        LOG_ERROR_DEFERRED("not a bmp file: %s", path.absolute.bytes);
         return {};
     }
 
+    char *ptr = file;
+    BitmapFileHeader *fh = (BitmapFileHeader*)ptr;
     ptr += sizeof(BitmapFileHeader);
 
-    BitmapHeader *h = (BitmapHeader*)ptr;
+    // NOTE(jesper): the file may be a read-only view into the asset pack, the
+    // header is copied so that the missing fields can be filled in
+    BitmapHeader header = *(BitmapHeader*)ptr;
+    BitmapHeader *h = &header;
 
     if (h->header_size != 40) {
         // TODO(jesper): support other bmp versions
@@ -131,7 +250,7 @@ TextureData load_texture_bmp(FilePathView path, Allocator *allocator)
     }
 
     if (h->header_size == 40) {
-        LOG("-- version 3");
+        LOG_DEFERRED("-- version 3");
     }
 
     ASSERT(h->header_size == 40);
@@ -144,7 +263,7 @@ TextureData load_texture_bmp(FilePathView path, Allocator *allocator)
     }
 
     if (h->compression == 0) {
-        LOG("-- uncompressed");
+        LOG_DEFERRED("-- uncompressed");
     }
 
 
@@ -156,6 +275,11 @@ TextureData load_texture_bmp(FilePathView path, Allocator *allocator)
         h->colors_important = h->colors_used;
     }
 
+    if (h->width <= 0 || h->height == 0 || h->height < -I32_MAX) {
+        LOG_ERROR_DEFERRED("invalid bmp dimensions: %s", path.absolute.bytes);
+        return {};
+    }
+
     bool flip = true;
     if (h->height < 0) {
         flip = false;
@@ -163,7 +287,7 @@ TextureData load_texture_bmp(FilePathView path, Allocator *allocator)
     }
 
     if (flip) {
-        LOG("-- bottom-up");
+        LOG_DEFERRED("-- bottom-up");
     }
 
     // NOTE(jesper): bmp's with bbp > 16 doesn't have a color palette
@@ -176,277 +300,428 @@ TextureData load_texture_bmp(FilePathView path, Allocator *allocator)
 
     u8 channels = 4;
 
-    texture.format = VK_FORMAT_B8G8R8A8_SRGB;
-    texture.width  = h->width;
-    texture.height = h->height;
-    texture.size   = h->width * h->height * channels;
-    texture.pixels = alloc(allocator, texture.size);
+    // NOTE(jesper): rows are padded to a multiple of 4 bytes
+    usize src_stride = ((usize)h->width * 3 + 3) & ~(usize)3;
+    usize dst_stride = (usize)h->width * channels;
+
+    if (fh->offset > size || src_stride * h->height > size - fh->offset) {
+        LOG_ERROR_DEFERRED("bmp pixel data out of bounds: %s", path.absolute.bytes);
+        return {};
+    }
 
-    bool alpha = false;
+    texture.format     = VK_FORMAT_B8G8R8A8_SRGB;
+    texture.width      = h->width;
+    texture.height     = h->height;
+    texture.size       = h->width * h->height * channels;
+    texture.pixels     = alloc(allocator, texture.size);
+    texture.mip_levels = 1;
 
-    u8 *src = (u8*)ptr;
+    // NOTE(jesper): bottom-up rows are written straight to their flipped
+    // position while expanding
+    u8 *src = (u8*)file + fh->offset;
     u8 *dst = (u8*)texture.pixels;
 
     for (i32 i = 0; i < h->height; i++) {
-        for (i32 j = 0; j < h->width; j++) {
-            *dst++ = *src++;
-            *dst++ = *src++;
-            *dst++ = *src++;
-
-            if (alpha) {
-                *dst++ = *src++;
-            } else {
-                *dst++ = 255;
-            }
-        }
-    }
-
-    // NOTE(jesper): flip bottom-up textures
-    if (flip) {
-        dst = (u8*)texture.pixels;
-        for (i32 i = 0; i < h->height >> 1; i++) {
-            u8 *p1 = &dst[i * h->width * channels];
-            u8 *p2 = &dst[(h->height - 1 - i) * h->width * channels];
-            for (i32 j = 0; j < h->width * channels; j++) {
-                u8 tmp = p1[j];
-                p1[j] = p2[j];
-                p2[j] = tmp;
-            }
-        }
+        i32 row = flip ? h->height - 1 - i : i;
+        bgra_from_bgr(dst + row * dst_stride, src + i * src_stride, h->width);
     }
 
     return texture;
 }
 
-void add_vertex(Array<f32> *vertices, Vector3 p, Vector3 n, Vector2 uv)
+TextureData load_texture_bmp(FilePathView path, Allocator *allocator)
 {
-    array_add(vertices, p.x);
-    array_add(vertices, p.y);
-    array_add(vertices, p.z);
+    usize size;
+    char *file = read_asset(path, &size, g_heap);
+    defer { release_asset(file, g_heap); };
 
-    array_add(vertices, n.x);
-    array_add(vertices, n.y);
-    array_add(vertices, n.z);
+    if (file == nullptr) {
+        LOG("unable to read file: %s", path.absolute.bytes);
+        return {};
+    }
 
-    array_add(vertices, uv.x);
-    array_add(vertices, uv.y);
+    return load_texture_bmp(path, file, size, allocator);
 }
 
-void add_vertex(Array<f32> *vertices, Vector3 p)
+struct TextureCookSettings {
+    VkFormat  format;
+    MipFilter filter;
+    bool      srgb;
+    bool      normal_map;
+};
+
+// NOTE(jesper): picks how a BGRA texture is cooked from its name. Normal maps,
+// *_nrm, are linear and only need x and y. Colour maps, *_col, are block
+// compressed when LEARY_COMPRESS_TEXTURES is enabled. Both get the sharper
+// Kaiser filtered mips. Anything else, e.g. height and splat maps, keeps its
+// format and gets box filtered mips that never overshoot.
+TextureCookSettings texture_cook_settings(StringView filename, TextureData *t)
 {
-    array_add(vertices, p.x);
-    array_add(vertices, p.y);
-    array_add(vertices, p.z);
+    TextureCookSettings settings = {};
+    settings.format = t->format;
+    settings.filter = MipFilter_box;
+    settings.srgb   = t->format == VK_FORMAT_B8G8R8A8_SRGB;
+
+    if (strstr(filename.bytes, "_nrm.") != nullptr) {
+        settings.filter     = MipFilter_kaiser;
+        settings.srgb       = false;
+        settings.normal_map = true;
+#if LEARY_COMPRESS_TEXTURES
+        settings.format = VK_FORMAT_BC5_UNORM_BLOCK;
+#else
+        settings.format = VK_FORMAT_B8G8R8A8_UNORM;
+#endif
+    } else if (strstr(filename.bytes, "_col.") != nullptr) {
+        settings.filter = MipFilter_kaiser;
+#if LEARY_COMPRESS_TEXTURES
+        settings.format = VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+
+        u8 *pixels = (u8*)t->pixels;
+        for (i32 i = 0; i < t->width * t->height; i++) {
+            if (pixels[i * 4 + 3] != 255) {
+                settings.format = VK_FORMAT_BC3_SRGB_BLOCK;
+                break;
+            }
+        }
+#endif
+    }
+
+    return settings;
 }
 
-Mesh load_mesh_obj(FilePathView path)
+// NOTE(jesper): converts a decoded BGRA texture to what's uploaded to the GPU,
+// the full mip chain in the final format, so that the upload is a straight
+// copy
+void cook_texture(TextureData *t, StringView filename, Allocator *a)
 {
-    Mesh mesh = {};
+    if (t->pixels == nullptr) {
+        return;
+    }
 
-    usize size;
-    char *file = read_file(path, &size, g_frame);
-    if (file == nullptr) {
-        LOG("unable to read file: %s", path.absolute.bytes);
-        return mesh;
+    TextureCookSettings settings = texture_cook_settings(filename, t);
+
+    u32 mip_levels = mip_level_count(t->width, t->height);
+    isize size     = mip_chain_size(t->width, t->height, mip_levels);
+
+    u8 *chain = (u8*)alloc(a, size);
+    memcpy(chain, t->pixels, t->size);
+    dealloc(a, t->pixels);
+
+    generate_mip_chain(
+        chain,
+        t->width, t->height,
+        mip_levels,
+        settings.filter,
+        settings.srgb,
+        settings.normal_map,
+        a);
+
+    t->format     = settings.format;
+    t->pixels     = chain;
+    t->size       = size;
+    t->mip_levels = mip_levels;
+
+    if (bc_block_size(settings.format) == 0) {
+        return;
     }
 
-    char *end  = file + size;
+    isize compressed_size = 0;
+    i32 width  = t->width;
+    i32 height = t->height;
+    for (u32 i = 0; i < mip_levels; i++) {
+        compressed_size += bc_image_size(settings.format, width, height);
+        width  = width  > 1 ? width  / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
 
-    LOG(" loading mesh: %.*s", path.filename.size, path.filename.bytes);
-    LOG("-- file size: %llu bytes", size);
+    u8 *compressed = (u8*)alloc(a, compressed_size);
 
-    i32 num_faces   = 0;
+    u8 *src = chain;
+    u8 *dst = compressed;
 
-    auto vectors = create_array<Vector3>(g_heap);
-    auto normals = create_array<Vector3>(g_frame);
-    auto uvs     = create_array<Vector2>(g_frame);
+    width  = t->width;
+    height = t->height;
+    for (u32 i = 0; i < mip_levels; i++) {
+        compress_image_bc(dst, settings.format, src, width, height);
 
-    char *ptr = file;
-    while (ptr < end) {
-        // texture coordinates
-        if (ptr[0] == 'v' && ptr[1] == 't') {
-            ptr += 3;
+        src   += (isize)width * height * 4;
+        dst   += bc_image_size(settings.format, width, height);
+        width  = width  > 1 ? width  / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
 
-            Vector2 uv;
-            sscanf(ptr, "%f %f", &uv.x, &uv.y);
-            uv *= 2.0f;
-            array_add(&uvs, uv);
-        // normals
-        } else if (ptr[0] == 'v' && ptr[1] == 'n') {
-            ptr += 3;
-
-            Vector3 n;
-            sscanf(ptr, "%f %f %f", &n.x, &n.y, &n.z);
-            array_add(&normals, n);
-        // vertices
-        } else if (ptr[0] == 'v') {
-            ptr += 2;
-
-            Vector3 v;
-            sscanf(ptr, "%f %f %f", &v.x, &v.y, &v.z);
-            array_add(&vectors, v);
-        // faces
-        } else if (ptr[0] == 'f') {
-            do ptr++;
-            while (ptr[0] == ' ');
-
-            i32 num_dividers = 0;
-            char *face = ptr;
-            do {
-                if (*face++ == '/') {
-                    num_dividers++;
-                }
-            } while (face < end && face[0] != '\n' && face[0] != '\r');
+    dealloc(a, chain);
+
+    t->pixels = compressed;
+    t->size   = compressed_size;
+}
+
+// NOTE(jesper): derived data layout of a cooked texture, followed by size
+// bytes of pixels
+struct CookedTextureHeader {
+    i32      width;
+    i32      height;
+    VkFormat format;
+    u32      mip_levels;
+    u64      size;
+};
 
-            int expected = 0;
-            if (normals.count > 0) expected += 3;
-            if (uvs.count     > 0) expected += 3;
+// NOTE(jesper): loads the cooked texture from the derived data cache, or
+// decodes and cooks the source and stores the result in the cache.
+// source_hash, if given, is set to the hash of the source content.
+TextureData load_cooked_texture(
+    FilePathView path,
+    Allocator *a,
+    u64 *source_hash)
+{
+    usize size;
+    char *file = read_asset(path, &size, g_heap);
+    defer { release_asset(file, g_heap); };
 
+    if (file == nullptr) {
+        LOG_ERROR_DEFERRED("unable to read file: %s", path.absolute.bytes);
+        return {};
+    }
 
-            // NOTE(jesper): only supporting triangulated meshes
-            ASSERT(num_dividers == expected);
-            num_faces++;
+    u64 hash = hash64(file, size);
+    if (source_hash != nullptr) {
+        *source_hash = hash;
+    }
+
+    u64 key = derived_data_key(
+        hash,
+        path.filename,
+        TEXTURE_COOK_VERSION,
+        LEARY_COMPRESS_TEXTURES);
+
+    usize cached_size;
+    void *cached = map_derived_data(key, &cached_size);
+    if (cached != nullptr) {
+        defer { unmap_derived_data(cached, cached_size); };
+
+        DerivedDataReader reader = derived_data_reader(cached, cached_size);
+        CookedTextureHeader *header = derived_data_read<CookedTextureHeader>(&reader);
+        u8 *pixels = header ? derived_data_read<u8>(&reader, header->size) : nullptr;
+
+        if (pixels != nullptr) {
+            TextureData t = {};
+            t.width      = header->width;
+            t.height     = header->height;
+            t.format     = header->format;
+            t.mip_levels = header->mip_levels;
+            t.size       = (isize)header->size;
+            t.pixels     = alloc(a, t.size);
+            memcpy(t.pixels, pixels, t.size);
+            return t;
         }
+    }
+
+    TextureData t = load_texture_bmp(path, file, size, a);
+    cook_texture(&t, path.filename, a);
 
-        do ptr++;
-        while (ptr < end && !is_newline(ptr[0]));
+    if (t.pixels != nullptr) {
+        CookedTextureHeader header = {};
+        header.width      = t.width;
+        header.height     = t.height;
+        header.format     = t.format;
+        header.mip_levels = t.mip_levels;
+        header.size       = (u64)t.size;
 
-        do ptr++;
-        while (ptr < end && is_newline(ptr[0]));
+        write_derived_data(key, {
+            DerivedDataChunk{ &header, sizeof header },
+            DerivedDataChunk{ t.pixels, (usize)t.size } });
     }
 
-    ASSERT(vectors.count > 0);
-    ASSERT(num_faces> 0);
+    return t;
+}
 
-    LOG("-- vectors : %d", vectors.count);
-    LOG("-- normals : %d", normals.count);
-    LOG("-- uvs     : %d", uvs.count);
-    LOG("-- faces   : %d", num_faces);
+i32 mesh_vertex_streams(Mesh *mesh, VertexStream *streams)
+{
+    i32 count = 0;
+    streams[count++] = VertexStream{ mesh->points.data, sizeof mesh->points[0] };
 
-    bool has_normals = normals.count > 0;
-    bool has_uvs     = uvs.count > 0;
+    if (mesh->normals.count > 0) {
+        streams[count++] = VertexStream{ mesh->normals.data, sizeof mesh->normals[0] };
+    }
 
-    auto vertices = create_array<f32>(g_frame);
+    if (mesh->tangents.count > 0) {
+        streams[count++] = VertexStream{ mesh->tangents.data, sizeof mesh->tangents[0] };
+    }
 
-    ptr = file;
+    if (mesh->bitangents.count > 0) {
+        streams[count++] = VertexStream{ mesh->bitangents.data, sizeof mesh->bitangents[0] };
+    }
 
-    if (has_normals && has_uvs) {
-        while (ptr < end) {
-            if (ptr[0] == 'f') {
-                do ptr++;
-                while (ptr[0] == ' ');
+    if (mesh->uvs.count > 0) {
+        streams[count++] = VertexStream{ mesh->uvs.data, sizeof mesh->uvs[0] };
+    }
 
-                u32 iv0, iv1, iv2;
-                u32 it0, it1, it2;
-                u32 in0, in1, in2;
+    return count;
+}
 
-                sscanf(ptr, "%u/%u/%u %u/%u/%u %u/%u/%u",
-                       &iv0, &it0, &in0, &iv1, &it1, &in1, &iv2, &it2, &in2);
+void set_mesh_vertex_count(Mesh *mesh, i32 count)
+{
+    mesh->points.count     = count;
+    mesh->normals.count    = mesh->normals.count > 0 ? count : 0;
+    mesh->tangents.count   = mesh->tangents.count > 0 ? count : 0;
+    mesh->bitangents.count = mesh->bitangents.count > 0 ? count : 0;
+    mesh->uvs.count        = mesh->uvs.count > 0 ? count : 0;
+}
 
-                // NOTE(jesper): objs are 1 indexed
-                iv0--; iv1--; iv2--;
-                it0--; it1--; it2--;
-                in0--; in1--; in2--;
+// NOTE(jesper): welds identical vertices of a mesh without an index buffer and
+// creates one
+void index_mesh(Mesh *mesh, Allocator *scratch)
+{
+    ASSERT(mesh->indices.count == 0);
 
-                add_vertex(&vertices, vectors[iv0], normals[in0], uvs[it0]);
-                add_vertex(&vertices, vectors[iv1], normals[in1], uvs[it1]);
-                add_vertex(&vertices, vectors[iv2], normals[in2], uvs[it2]);
-            }
+    VertexStream streams[5];
+    i32 stream_count = mesh_vertex_streams(mesh, streams);
+    i32 vertex_count = mesh->points.count;
 
-            do ptr++;
-            while (ptr < end && !is_newline(ptr[0]));
+    u32 *remap = alloc_array(scratch, u32, vertex_count);
+    i32 unique = generate_vertex_remap(remap, streams, stream_count, vertex_count, scratch);
 
-            do ptr++;
-            while (ptr < end && is_newline(ptr[0]));
-        }
-    } else {
-        while (ptr < end) {
-            if (ptr[0] == 'f') {
-                do ptr++;
-                while (ptr[0] == ' ');
+    init_array(&mesh->indices, g_heap, vertex_count);
+    for (i32 i = 0; i < vertex_count; i++) {
+        array_add(&mesh->indices, remap[i]);
+    }
 
-                u32 iv0, iv1, iv2;
-                sscanf(ptr, "%u %u %u", &iv0, &iv1, &iv2);
+    for (i32 i = 0; i < stream_count; i++) {
+        remap_vertex_stream(streams[i], vertex_count, remap, scratch);
+    }
 
-                // NOTE(jesper): objs are 1 indexed
-                iv0--; iv1--; iv2--;
+    set_mesh_vertex_count(mesh, unique);
+    dealloc(scratch, remap);
+}
 
-                add_vertex(&vertices, vectors[iv0]);
-                add_vertex(&vertices, vectors[iv1]);
-                add_vertex(&vertices, vectors[iv2]);
-            }
+// NOTE(jesper): appends each LOD's indices to the mesh's index buffer, they're
+// optimised for the vertex cache and overdraw the same as the full mesh
+void generate_mesh_lods(Mesh *mesh, Allocator *scratch)
+{
+    i32 vertex_count = mesh->points.count;
+
+    mesh->lods[0]   = MeshLod{ 0, (u32)mesh->indices.count, 0.0f };
+    mesh->lod_count = 1;
+
+    u32 *lod = alloc_array(scratch, u32, mesh->indices.count);
+    while (mesh->lod_count < MESH_MAX_LODS) {
+        MeshLod prev = mesh->lods[mesh->lod_count - 1];
+        i32 target   = (i32)(prev.index_count / 3 * MESH_LOD_REDUCTION) * 3;
+
+        f32 error;
+        i32 count = simplify_mesh(
+            lod,
+            mesh->indices.data + prev.index_offset, (i32)prev.index_count,
+            mesh->points.data, vertex_count,
+            target,
+            &error,
+            scratch);
+
+        // NOTE(jesper): most of what's left is locked on borders or seams,
+        // a LOD this close to the previous one isn't worth the memory
+        if (count == 0 || (u32)count > prev.index_count / 10 * 9) {
+            break;
+        }
 
-            do ptr++;
-            while (ptr < end && !is_newline(ptr[0]));
+        optimize_vertex_cache(lod, count, vertex_count, scratch);
+        optimize_overdraw(lod, count, mesh->points.data, vertex_count, scratch);
 
-            do ptr++;
-            while (ptr < end && is_newline(ptr[0]));
+        MeshLod next = { (u32)mesh->indices.count, (u32)count, prev.error + error };
+        for (i32 i = 0; i < count; i++) {
+            array_add(&mesh->indices, lod[i]);
         }
+
+        mesh->lods[mesh->lod_count++] = next;
+        LOG_DEFERRED("-- lod %d    : %d triangles, error %f",
+                     mesh->lod_count - 1, count / 3, next.error);
     }
 
-    init_array(&mesh.indices, g_heap);
-    init_array(&mesh.points, g_heap);
+    dealloc(scratch, lod);
+}
 
-    if (has_normals) {
-        init_array(&mesh.normals, g_heap);
+// NOTE(jesper): reorders the triangles for the post-transform vertex cache and
+// overdraw, generates the LODs, then reorders the vertices in the order they're
+// fetched
+void optimize_mesh(Mesh *mesh, Allocator *scratch)
+{
+    i32 vertex_count = mesh->points.count;
+    i32 index_count  = mesh->indices.count;
+    if (index_count == 0) {
+        return;
     }
 
-    if (has_uvs) {
-        init_array(&mesh.uvs, g_heap);
+    f32 acmr_before = compute_acmr(
+        mesh->indices.data, index_count,
+        vertex_count,
+        VERTEX_CACHE_FIFO_SIZE,
+        scratch);
+
+    optimize_vertex_cache(mesh->indices.data, index_count, vertex_count, scratch);
+    optimize_overdraw(
+        mesh->indices.data, index_count,
+        mesh->points.data, vertex_count,
+        scratch);
+
+    generate_mesh_lods(mesh, scratch);
+
+    VertexStream streams[5];
+    i32 stream_count = mesh_vertex_streams(mesh, streams);
+
+    // NOTE(jesper): the LODs only reference vertices of the full mesh, so the
+    // fetch order is decided by the full mesh
+    u32 *remap = alloc_array(scratch, u32, vertex_count);
+    i32 used   = optimize_vertex_fetch(
+        remap,
+        mesh->indices.data, mesh->indices.count,
+        vertex_count);
+
+    for (i32 i = 0; i < stream_count; i++) {
+        remap_vertex_stream(streams[i], vertex_count, remap, scratch);
     }
 
+    set_mesh_vertex_count(mesh, used);
+    dealloc(scratch, remap);
 
-    if (has_normals && has_uvs) {
-        u32 index = 0;
-        for (i32 i = 0; i < vertices.count; i += 8) {
-            Vector3 point  = { vertices[i], vertices[i+1], vertices[i+2] };
-            Vector3 normal = { vertices[i+3], vertices[i+4], vertices[i+5] };
-            Vector2 uv     = { vertices[i+6], vertices[i+7] };
+    f32 acmr_after = compute_acmr(
+        mesh->indices.data, index_count,
+        used,
+        VERTEX_CACHE_FIFO_SIZE,
+        scratch);
 
-            for (i32 j = 0; j < mesh.points.count; j++) {
-                if (mesh.points[j].x == point.x &&
-                    mesh.points[j].y == point.y &&
-                    mesh.points[j].z == point.z &&
-                    mesh.normals[j].x == normal.x &&
-                    mesh.normals[j].y == normal.y &&
-                    mesh.normals[j].z == normal.z &&
-                    mesh.uvs[j].u == uv.u &&
-                    mesh.uvs[j].v == uv.v)
-                {
-                    array_add(&mesh.indices, (u32)j);
-                    goto merged0;
-                }
-            }
+    LOG_DEFERRED("-- acmr     : %.3f -> %.3f", acmr_before, acmr_after);
+}
 
-            array_add(&mesh.indices, index++);
-            array_add(&mesh.points, point);
-            array_add(&mesh.normals, normal);
-            array_add(&mesh.uvs, uv);
-merged0:
-            continue;
-        }
-    } else {
-        u32 index = 0;
-        for (i32 i = 0; i < vertices.count; i += 3) {
-            Vector3 point  = { vertices[i], vertices[i+1], vertices[i+2] };
-
-            for (i32 j = 0; j < mesh.points.count; j++) {
-                if (mesh.points[j].x == point.x &&
-                    mesh.points[j].y == point.y &&
-                    mesh.points[j].z == point.z)
-                {
-                    array_add(&mesh.indices, (u32)j);
-                    goto merged1;
-                }
-            }
+Mesh load_mesh_obj(FilePathView path, char *file, usize size, Allocator *scratch)
+{
+    Mesh mesh = {};
 
-            array_add(&mesh.indices, index++);
-            array_add(&mesh.points, point);
-merged1:
-            continue;
-        }
+    LOG_DEFERRED(" loading mesh: %s", path.filename.bytes);
+    LOG_DEFERRED("-- file size: %llu bytes", size);
+
+    // NOTE(jesper): this runs on the load threads and on hot reload, where a
+    // file caught half written is expected, so a mesh without any triangles
+    // is reported and skipped rather than asserted on
+    ObjMesh obj = parse_obj(file, size, g_heap, scratch);
+    if (obj.points.count == 0 || obj.indices.count == 0) {
+        LOG_ERROR("-- Mesh (%s) contains no triangles", path.filename.bytes);
+        destroy_array(&obj.indices);
+        destroy_array(&obj.uvs);
+        destroy_array(&obj.normals);
+        destroy_array(&obj.points);
+        return {};
     }
 
+    LOG_DEFERRED("-- vertices : %d", obj.points.count);
+    LOG_DEFERRED("-- normals  : %s", obj.normals.count > 0 ? "yes" : "no");
+    LOG_DEFERRED("-- uvs      : %s", obj.uvs.count > 0 ? "yes" : "no");
+    LOG_DEFERRED("-- triangles: %d", obj.indices.count / 3);
+
+    mesh.points  = obj.points;
+    mesh.normals = obj.normals;
+    mesh.uvs     = obj.uvs;
+    mesh.indices = obj.indices;
+
+    optimize_mesh(&mesh, scratch);
     return mesh;
 }
 
@@ -478,57 +753,123 @@ TextureAsset* add_texture(
     return &g_textures[texture_id];
 }
 
-void update_mesh(MeshID id, Mesh mesh)
+void create_mesh_vbos(Mesh *mesh)
 {
-    (void)id;
-    (void)mesh;
-#if 0
-    Mesh *existing = find_mesh(id);
-    ASSERT(existing != nullptr);
+#if LEARY_PACKED_VERTICES
+    if (mesh->packed_vertices != nullptr) {
+        mesh->vbo.packed = create_vbo(
+            mesh->packed_vertices,
+            mesh->points.count * sizeof(PackedVertex));
+        return;
+    }
 
-    gfx_update_buffer(
-        &existing->vbo,
-        mesh.vertices.data,
-        mesh.vertices.count * sizeof mesh.vertices[0]);
-
-    if (mesh.indices.count > 0) {
-        usize indices_size = mesh.indices.count  * sizeof mesh.indices[0];
-        if (existing->indices.count > 0) {
-            gfx_update_buffer(
-                &existing->vbo,
-                mesh.vertices.data,
-                indices_size);
-        } else {
-            existing->ibo = create_ibo(mesh.indices.data, indices_size);
+    PackedVertex *packed = alloc_array(g_heap, PackedVertex, mesh->points.count);
+    defer { dealloc(g_heap, packed); };
+
+    pack_vertices(
+        packed,
+        mesh->points.count,
+        mesh->points.data,
+        mesh->normals.count > 0 ? mesh->normals.data : nullptr,
+        mesh->tangents.count > 0 ? mesh->tangents.data : nullptr,
+        mesh->bitangents.count > 0 ? mesh->bitangents.data : nullptr,
+        mesh->uvs.count > 0 ? mesh->uvs.data : nullptr,
+        mesh->bounds_min,
+        mesh->bounds_extent);
+
+    mesh->vbo.packed = create_vbo(packed, mesh->points.count * sizeof packed[0]);
+#else
+    mesh->vbo.points = create_vbo(mesh->points.data, mesh->points.count * sizeof mesh->points[0]);
+    mesh->vbo.normals = create_vbo(mesh->normals.data, mesh->normals.count * sizeof mesh->normals[0]);
+    mesh->vbo.tangents = create_vbo(mesh->tangents.data, mesh->tangents.count * sizeof mesh->tangents[0]);
+    mesh->vbo.bitangents = create_vbo(mesh->bitangents.data, mesh->bitangents.count * sizeof mesh->bitangents[0]);
+    mesh->vbo.uvs = create_vbo(mesh->uvs.data, mesh->uvs.count * sizeof mesh->uvs[0]);
+#endif
+}
+
+// NOTE(jesper): the bounds are needed to pack the vertices, so they're
+// computed when the mesh is cooked and stored with it
+void compute_mesh_bounds(Mesh *mesh)
+{
+    Vector3 min = {  F32_MAX,  F32_MAX,  F32_MAX };
+    Vector3 max = { -F32_MAX, -F32_MAX, -F32_MAX };
+
+    mesh->radius = 0.0f;
+    for (i32 i = 0; i < mesh->points.count; i++) {
+        Vector3 p = mesh->points[i];
+        for (i32 j = 0; j < 3; j++) {
+            min.data[j] = p.data[j] < min.data[j] ? p.data[j] : min.data[j];
+            max.data[j] = p.data[j] > max.data[j] ? p.data[j] : max.data[j];
         }
 
-        existing->element_count = mesh.indices.count;
-    } else {
-        existing->element_count = mesh.vertices.count;
+        f32 r = length(p);
+        mesh->radius = r > mesh->radius ? r : mesh->radius;
+    }
+
+    if (mesh->points.count > 0) {
+        mesh->bounds_min    = min;
+        mesh->bounds_extent = max - min;
     }
-#endif
 }
 
-i32 add_mesh(Mesh mesh, StringView name)
+void create_mesh_buffers(Mesh *mesh)
 {
-    if (mesh.indices.count > 0) {
-        mesh.element_count = mesh.indices.count;
-        mesh.ibo = create_ibo(mesh.indices.data, mesh.indices.count * sizeof mesh.indices[0]);
+    if (mesh->indices.count > 0) {
+        if (mesh->lod_count == 0) {
+            mesh->lods[0]   = MeshLod{ 0, (u32)mesh->indices.count, 0.0f };
+            mesh->lod_count = 1;
+        }
 
-        mesh.vbo.points = create_vbo(mesh.points.data, mesh.points.count * sizeof mesh.points[0]);
-        mesh.vbo.normals = create_vbo(mesh.normals.data, mesh.normals.count * sizeof mesh.normals[0]);
-        mesh.vbo.tangents = create_vbo(mesh.tangents.data, mesh.tangents.count * sizeof mesh.tangents[0]);
-        mesh.vbo.bitangents = create_vbo(mesh.bitangents.data, mesh.bitangents.count * sizeof mesh.bitangents[0]);
-        mesh.vbo.uvs = create_vbo(mesh.uvs.data, mesh.uvs.count * sizeof mesh.uvs[0]);
+        mesh->element_count = mesh->lods[0].index_count;
+        mesh->ibo = create_ibo(mesh->indices.data, mesh->indices.count * sizeof mesh->indices[0]);
     } else {
-        mesh.element_count = mesh.points.count;
+        mesh->element_count = mesh->points.count;
+    }
 
-        mesh.vbo.points = create_vbo(mesh.points.data, mesh.points.count * sizeof mesh.points[0]);
-        mesh.vbo.normals = create_vbo(mesh.normals.data, mesh.normals.count * sizeof mesh.normals[0]);
-        mesh.vbo.tangents = create_vbo(mesh.tangents.data, mesh.tangents.count * sizeof mesh.tangents[0]);
-        mesh.vbo.bitangents = create_vbo(mesh.bitangents.data, mesh.bitangents.count * sizeof mesh.bitangents[0]);
-        mesh.vbo.uvs = create_vbo(mesh.uvs.data, mesh.uvs.count * sizeof mesh.uvs[0]);
+    create_mesh_vbos(mesh);
+}
+
+void destroy_mesh_buffers(Mesh *mesh)
+{
+    VulkanBuffer *buffers[] = {
+        &mesh->ibo,
+        &mesh->vbo.points,
+        &mesh->vbo.normals,
+        &mesh->vbo.tangents,
+        &mesh->vbo.bitangents,
+        &mesh->vbo.uvs,
+        &mesh->vbo.packed
+    };
+
+    for (VulkanBuffer *buffer : buffers) {
+        if (buffer->handle != VK_NULL_HANDLE) {
+            destroy_buffer(*buffer);
+            *buffer = {};
+        }
     }
+}
+
+// NOTE(jesper): replaces the data and buffers of an existing mesh in place,
+// so the MeshID held by entities stays valid
+void update_mesh(MeshID id, Mesh mesh)
+{
+    Mesh *existing = find_mesh(id);
+    ASSERT(existing != nullptr);
+
+    // NOTE(jesper): the old buffers may still be used by a frame in flight
+    gfx_flush_and_wait(GFX_QUEUE_GRAPHICS);
+
+    destroy_mesh_buffers(existing);
+    destroy_mesh_data(existing);
+
+    create_mesh_buffers(&mesh);
+    mesh.asset_id = existing->asset_id;
+    *existing = mesh;
+}
+
+i32 add_mesh(Mesh mesh, StringView name)
+{
+    create_mesh_buffers(&mesh);
 
     mesh.asset_id = g_catalog.next_asset_id++;
     MeshID mesh_id = (MeshID)array_add(&g_meshes, mesh);
@@ -540,15 +881,76 @@ i32 add_mesh(Mesh mesh, StringView name)
 }
 
 
-Mesh* add_mesh_obj(FilePath path)
+void add_asset_dependent(AssetID dependency, AssetID id)
 {
-    Mesh m = load_mesh_obj(path);
-    if (m.points.count == 0) {
-        return nullptr;
+    Array<AssetID> *dependents = map_find(&g_catalog.dependents, dependency);
+    if (dependents == nullptr) {
+        map_add(&g_catalog.dependents, dependency, create_array<AssetID>(g_heap));
+        dependents = map_find(&g_catalog.dependents, dependency);
     }
 
-    i32 mesh_id = add_mesh(m, path.filename);
-    return &g_meshes[mesh_id];
+    for (AssetID d : *dependents) {
+        if (d == id) {
+            return;
+        }
+    }
+
+    array_add(dependents, id);
+}
+
+void remove_asset_dependent(AssetID dependency, AssetID id)
+{
+    Array<AssetID> *dependents = map_find(&g_catalog.dependents, dependency);
+    if (dependents == nullptr) {
+        return;
+    }
+
+    for (i32 i = 0; i < dependents->count; i++) {
+        if ((*dependents)[i] == id) {
+            array_remove_ordered(dependents, i);
+            return;
+        }
+    }
+}
+
+Array<AssetID>* find_asset_dependencies(AssetID id)
+{
+    Array<AssetID> *dependencies = map_find(&g_catalog.dependencies, id);
+    if (dependencies == nullptr) {
+        map_add(&g_catalog.dependencies, id, create_array<AssetID>(g_heap));
+        dependencies = map_find(&g_catalog.dependencies, id);
+    }
+
+    return dependencies;
+}
+
+// NOTE(jesper): replaces the edges from id with the given dependencies, in
+// the order the asset uses them
+void set_asset_dependencies(AssetID id, AssetID *dependencies, i32 count)
+{
+    Array<AssetID> *existing = find_asset_dependencies(id);
+    for (AssetID d : *existing) {
+        remove_asset_dependent(d, id);
+    }
+
+    existing->count = 0;
+    for (i32 i = 0; i < count; i++) {
+        array_add(existing, dependencies[i]);
+        add_asset_dependent(dependencies[i], id);
+    }
+}
+
+void add_asset_dependency(AssetID id, AssetID dependency)
+{
+    Array<AssetID> *existing = find_asset_dependencies(id);
+    for (AssetID d : *existing) {
+        if (d == dependency) {
+            return;
+        }
+    }
+
+    array_add(existing, dependency);
+    add_asset_dependent(dependency, id);
 }
 
 AssetID find_asset_id(StringView name)
@@ -715,7 +1117,7 @@ Vector4 parse_vector4(FilePathView path, Lexer *lexer)
 EntityData parse_entity_data(FilePath p)
 {
     usize size;
-    char *fp = read_file(p.absolute.bytes, &size, g_frame);
+    char *fp = read_asset(p, &size, g_frame);
 
     if (fp == nullptr) {
         LOG_ERROR("unable to read entity file: %s", p.absolute.bytes);
@@ -842,172 +1244,311 @@ EntityID find_entity_id(StringView name)
     return *entity_id;
 }
 
-void process_catalog_system()
+void process_texture(FilePath path, TextureData t)
 {
-    PROFILE_FUNCTION();
+    profiler_tag_frame("texture upload");
 
-    lock_mutex(&g_catalog.mutex);
-    // TODO(jesper): we could potentially make this multi-threaded if we ensure
-    // that we have thread safe versions of update_vk_texture, currently that'd
-    // mean handling multi-threaded command buffer creation and submission
-    for (i32 i = 0; i < g_catalog.process_queue.count; i++) {
-        FilePath &p = g_catalog.process_queue[i];
-
-        catalog_process_t **func = map_find(&g_catalog.processes, p.extension);
-        if (func == nullptr) {
-            LOG_ERROR("could not find process function for extension: %.*s",
-                      p.extension.size,
-                      p.extension.bytes);
-            continue;
-        }
+    if (t.pixels == nullptr) {
+        return;
+    }
 
-        (*func)(p);
+    u32 mip_levels = t.mip_levels;
+
+    AssetID id = find_asset_id(path.filename.bytes);
+    if (id == ASSET_INVALID_ID) {
+        TextureAsset ta = {};
+        ta.asset_id = g_catalog.next_asset_id++;
+        ta.gfx_texture = gfx_create_texture(
+            t.width,
+            t.height,
+            mip_levels,
+            t.format,
+            VkComponentMapping{},
+            t.pixels);
+
+        TextureID texture_id = (TextureID)array_add(&g_textures, ta);
+
+        map_add(&g_catalog.assets,   path.filename, ta.asset_id);
+        map_add(&g_catalog.textures, ta.asset_id,   texture_id);
+    } else {
+        TextureAsset *ta = find_texture(id);
+        ASSERT(ta != nullptr);
+
+        GfxTexture texture = gfx_create_texture(
+            t.width,
+            t.height,
+            mip_levels,
+            t.format,
+            VkComponentMapping{},
+            t.pixels);
+
+        if (texture.width == ta->gfx_texture.width &&
+            texture.height == ta->gfx_texture.height &&
+            texture.mip_levels == ta->gfx_texture.mip_levels &&
+            texture.vk_format == ta->gfx_texture.vk_format)
+        {
+            gfx_copy_texture(&ta->gfx_texture, &texture);
+            gfx_destroy_texture(texture);
+        } else {
+            // NOTE(jesper): the entities using the texture are rebound to the
+            // new one as its dependents, the old one is destroyed at the end
+            // of the reload batch, see commit_catalog_reloads
+            array_add(&g_catalog.retired_textures, ta->gfx_texture);
+            ta->gfx_texture = texture;
+
+            Array<CatalogTextureBinding> *bindings =
+                map_find(&g_catalog.texture_bindings, ta->asset_id);
+            if (bindings != nullptr) {
+                for (CatalogTextureBinding b : *bindings) {
+                    gfx_set_texture(b.pipeline, b.descriptor, b.binding, texture);
+                }
+            }
+        }
     }
+}
 
-    array_clear(&g_catalog.process_queue);
+CATALOG_PROCESS_FUNC(catalog_process_bmp)
+{
+    TextureData t = load_cooked_texture(path, g_heap);
+    defer { dealloc(g_heap, t.pixels); };
 
-    g_catalog.process_queue.count = 0;
-    unlock_mutex(&g_catalog.mutex);
+    process_texture(path, t);
 }
 
-CATALOG_CALLBACK(catalog_thread_proc)
+// NOTE(jesper): binds a texture to a descriptor set that isn't owned by an
+// entity, and records it so that it's rebound if a reload replaces the texture
+void catalog_bind_texture(
+    TextureAsset *texture,
+    PipelineID pipeline,
+    GfxDescriptorSet descriptor,
+    i32 binding)
 {
-    AssetID *id = map_find(&g_catalog.assets, path.filename);
-    if (id == nullptr || *id == ASSET_INVALID_ID) {
-        LOG("asset not found in catalogue system: %s\n",
-            path.filename.bytes);
-        return;
+    gfx_set_texture(pipeline, descriptor, binding, texture->gfx_texture);
+
+    Array<CatalogTextureBinding> *bindings =
+        map_find(&g_catalog.texture_bindings, texture->asset_id);
+    if (bindings == nullptr) {
+        map_add(
+            &g_catalog.texture_bindings,
+            texture->asset_id,
+            create_array<CatalogTextureBinding>(g_heap));
+        bindings = map_find(&g_catalog.texture_bindings, texture->asset_id);
     }
 
-    lock_mutex(&g_catalog.mutex);
-    defer { unlock_mutex(&g_catalog.mutex); };
-
-    for (auto p : g_catalog.process_queue) {
-        if (p == path) {
+    for (CatalogTextureBinding &b : *bindings) {
+        if (b.descriptor.id == descriptor.id && b.binding == binding) {
+            b.pipeline = pipeline;
             return;
         }
     }
 
-    array_add(&g_catalog.process_queue, path);
+    array_add(bindings, CatalogTextureBinding{ pipeline, descriptor, binding });
 }
 
-CATALOG_PROCESS_FUNC(catalog_process_bmp)
+// NOTE(jesper): binds the mesh and textures an entity depends on, the
+// textures bound in the order the entity file listed them
+void bind_entity_assets(Entity *entity, AssetID asset_id)
 {
-    AssetID id = find_asset_id(path.filename.bytes);
-    if (id == ASSET_INVALID_ID) {
-        TextureData t = load_texture_bmp(path, g_heap);
-        defer { dealloc(g_heap, t.pixels); };
-
-        if (t.pixels != nullptr) {
-            u32 mip_levels = (u32)floor(log2(max(t.width, t.height))) + 1;
-
-            TextureAsset ta = {};
-            ta.asset_id = g_catalog.next_asset_id++;
-            ta.gfx_texture = gfx_create_texture(
-                t.width,
-                t.height,
-                mip_levels,
-                t.format,
-                VkComponentMapping{},
-                t.pixels);
-
-            TextureID texture_id = (TextureID)array_add(&g_textures, ta);
-
-            map_add(&g_catalog.assets,   path.filename, ta.asset_id);
-            map_add(&g_catalog.textures, ta.asset_id,   texture_id);
+    Array<AssetID> *dependencies = map_find(&g_catalog.dependencies, asset_id);
+    if (dependencies == nullptr) {
+        return;
+    }
+
+    i32 binding = 0;
+    for (AssetID dependency : *dependencies) {
+        MeshID *mesh_id = map_find(&g_catalog.meshes, dependency);
+        if (mesh_id != nullptr) {
+            entity->mesh_id = *mesh_id;
+            continue;
         }
-    } else {
-        TextureAsset *t = find_texture(id);
-        ASSERT(t != nullptr);
-
-        TextureData n = load_texture_bmp(path, g_frame);
-
-        if (n.pixels != nullptr) {
-            u32 mip_levels = (u32)floor(log2(max(n.width, n.height))) + 1;
-
-            GfxTexture texture = gfx_create_texture(
-                n.width,
-                n.height,
-                mip_levels,
-                n.format,
-                VkComponentMapping{},
-                n.pixels);
-            gfx_copy_texture(&t->gfx_texture, &texture);
-            gfx_destroy_texture(texture);
+
+        TextureAsset *texture = find_texture(dependency);
+        if (texture != nullptr) {
+            gfx_set_texture(
+                Pipeline_mesh,
+                entity->descriptor_set, binding++,
+                texture->gfx_texture);
         }
     }
 }
 
-void set_entity_data(Entity *entity, EntityData data)
+// NOTE(jesper): the mesh and textures are resolved by name once, here, and
+// recorded as the entity's dependencies
+void set_entity_data(Entity *entity, AssetID asset_id, EntityData data)
 {
     entity->position = data.position;
     entity->scale    = data.scale;
     entity->rotation = data.rotation;
     entity->mesh_id  = data.mesh_id;
 
-    i32 binding = 0;
+    Array<AssetID> dependencies = create_array<AssetID>(g_heap, data.textures.count + 1);
+    defer { destroy_array(&dependencies); };
+
+    if (data.mesh.size > 0) {
+        array_add(&dependencies, find_asset_id(data.mesh));
+    }
+
     for (i32 i = 0; i < data.textures.count; i++) {
-        TextureAsset *texture = find_texture(data.textures[i]);
-        if (texture != nullptr) {
-            gfx_set_texture(
-                Pipeline_mesh,
-                entity->descriptor_set, binding++,
-                texture->gfx_texture);
+        AssetID id = find_asset_id(data.textures[i]);
+        if (id == ASSET_INVALID_ID || map_find(&g_catalog.textures, id) == nullptr) {
+            LOG_ERROR("unable to find texture with name: %s", data.textures[i].bytes);
+            continue;
         }
+
+        array_add(&dependencies, id);
     }
+
+    set_asset_dependencies(asset_id, dependencies.data, dependencies.count);
+    bind_entity_assets(entity, asset_id);
 }
 
 CATALOG_PROCESS_FUNC(catalog_process_entity)
 {
-    AssetID id = find_asset_id(path.filename.bytes);
-    if (id == ASSET_INVALID_ID) {
-        EntityData data = parse_entity_data(path);
+    profiler_tag_frame("entity reload");
 
-        if (data.valid == false) {
-            LOG_ERROR("failed parsing entity data");
-            return;
+    EntityData data = parse_entity_data(path);
+    defer {
+        if (data.textures.allocator != nullptr) {
+            destroy_array(&data.textures);
         }
+    };
 
+    if (data.valid == false) {
+        LOG_ERROR("failed parsing entity data");
+        return;
+    }
+
+    AssetID id = find_asset_id(path.filename.bytes);
+    if (id == ASSET_INVALID_ID) {
         Entity e = {};
         e.id = (i32)g_entities.count;
         e.descriptor_set = gfx_create_descriptor(
             VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
             g_vulkan->pipelines[Pipeline_mesh].set_layouts[1]);
 
-        set_entity_data(&e, data);
-        array_add(&g_entities, e);
-
         AssetID asset_id = g_catalog.next_asset_id++;
+        set_entity_data(&e, asset_id, data);
+        array_add(&g_entities, e);
 
         map_add(&g_catalog.assets, path.filename, asset_id);
         map_add(&g_catalog.entities, asset_id, e.id);
     } else {
         EntityID *eid = map_find(&g_catalog.entities, id);
         if (eid && *eid != ASSET_INVALID_ID) {
-            EntityData data = parse_entity_data(path);
-            if (data.valid == false) {
-                LOG_ERROR("failed parsing entity data");
-                return;
-            }
-
-            set_entity_data(&g_entities[*eid], data);
+            set_entity_data(&g_entities[*eid], id, data);
         }
     }
 }
 
-CATALOG_PROCESS_FUNC(catalog_process_obj)
+void process_mesh(FilePath path, Mesh mesh)
 {
+    profiler_tag_frame("mesh reload");
+
+    if (mesh.points.count == 0) {
+        return;
+    }
+
     AssetID id = find_asset_id(path.filename.bytes);
     if (id == ASSET_INVALID_ID) {
-        add_mesh_obj(path);
-        return;
+        add_mesh(mesh, path.filename);
+    } else {
+        MeshID *mesh_id = map_find(&g_catalog.meshes, id);
+        ASSERT(mesh_id != nullptr);
+        update_mesh(*mesh_id, mesh);
     }
+}
 
-    ASSERT(false && "hot reloading changed meshes not supported");
+CATALOG_PROCESS_FUNC(catalog_process_obj)
+{
+    Mesh mesh = load_cooked_mesh(path, g_frame);
+    process_mesh(path, mesh);
 }
 
+// NOTE(jesper): derived data layout of an fbx conversion, one per .msh file
+// it wrote, each followed by name_size bytes of file name and size bytes of
+// file content
+struct ConvertedFbxFile {
+    u32 name_size;
+    u32 reserved;
+    u64 size;
+};
+
+// NOTE(jesper): writes the files of a cached conversion that are missing from
+// the models folder, returns false if the entry is invalid
+bool restore_fbx_conversion(void *data, usize size)
+{
+    DerivedDataReader reader = derived_data_reader(data, size);
+    u32 *count = derived_data_read<u32>(&reader);
+
+    for (u32 i = 0; count != nullptr && i < *count; i++) {
+        ConvertedFbxFile *f = derived_data_read<ConvertedFbxFile>(&reader);
+        char *name = f ? derived_data_read<char>(&reader, f->name_size) : nullptr;
+        u8 *content = name ? derived_data_read<u8>(&reader, f->size) : nullptr;
+        if (content == nullptr) {
+            return false;
+        }
+
+        FilePath p = resolve_file_path(GamePath_models, StringView{ name, (i32)f->name_size }, g_frame);
+        if (file_exists(p)) {
+            continue;
+        }
+
+        LOG_DEFERRED("restoring converted mesh: %s", p.absolute.bytes);
+        if (!create_file(p, true)) {
+            return false;
+        }
+
+        void *file = open_file(p, FileAccess_write);
+        if (file == nullptr) {
+            return false;
+        }
+
+        write_file(file, content, f->size);
+        close_file(file);
+    }
+
+    return reader.valid;
+}
+
+// NOTE(jesper): the converter writes a .msh file per mesh in the fbx to the
+// models folder, named after the fbx. The conversion is skipped when the
+// derived data cache has an entry for the fbx's content, and the cached .msh
+// files are written back if they've been removed.
+// TODO(jesper): the outputs are found by their prefix, which also matches the
+// outputs of an fbx whose name starts with this one's followed by a '_', see
+// find_fbx_source
 CATALOG_PROCESS_FUNC(catalog_process_fbx)
 {
+    profiler_tag_frame("mesh reload");
+
+    usize size;
+    char *file = read_asset(path, &size, g_heap);
+    if (file == nullptr) {
+        LOG_ERROR("unable to read file: %s", path.absolute.bytes);
+        return;
+    }
+
+    u64 key = derived_data_key(hash64(file, size), path.filename, FBX_CONVERT_VERSION);
+    release_asset(file, g_heap);
+
+    // NOTE(jesper): the fbx is registered so that its reloads reach the
+    // converter, and the .msh files it writes record it as their dependency
+    if (find_asset_id(path.filename.bytes) == ASSET_INVALID_ID) {
+        AssetID asset_id = g_catalog.next_asset_id++;
+        map_add(&g_catalog.assets, path.filename, asset_id);
+    }
+
+    usize cached_size;
+    void *cached = map_derived_data(key, &cached_size);
+    if (cached != nullptr) {
+        bool restored = restore_fbx_conversion(cached, cached_size);
+        unmap_derived_data(cached, cached_size);
+
+        if (restored) {
+            return;
+        }
+    }
+
     String prefix = create_string(
         g_frame,
         { StringView(path.filename.bytes, path.filename.size - path.extension.size),
@@ -1015,240 +1556,1034 @@ CATALOG_PROCESS_FUNC(catalog_process_fbx)
     FilePath output = resolve_file_path(GamePath_models, "", g_frame);
     AlcResult result = alc_convert_fbx(path.absolute.bytes, output.absolute.bytes, prefix.bytes);
     ASSERT(result == ALC_RESULT_SUCCESS);
+
+    FolderPath models = resolve_folder_path(GamePath_models, "", g_frame);
+    Array<FilePath> files = list_files(models, g_heap);
+    defer { destroy_array(&files); };
+
+    u32 count = 0;
+    Array<ConvertedFbxFile> headers = create_array<ConvertedFbxFile>(g_heap, files.count);
+    Array<DerivedDataChunk> chunks  = create_array<DerivedDataChunk>(g_heap, files.count * 3 + 1);
+    defer {
+        for (i32 i = 3; i < chunks.count; i += 3) {
+            dealloc(g_heap, chunks[i].data);
+        }
+        destroy_array(&headers);
+        destroy_array(&chunks);
+    };
+
+    array_add(&chunks, DerivedDataChunk{ &count, sizeof count });
+
+    // NOTE(jesper): headers has the capacity for every file so that the chunks
+    // can point into it, and the sizes of the names include the '\0'
+    for (auto &f : files) {
+        if (!(f.extension == "msh") ||
+            f.filename.size < prefix.size ||
+            memcmp(f.filename.bytes, prefix.bytes, prefix.size - 1) != 0)
+        {
+            continue;
+        }
+
+        usize content_size;
+        char *content = read_file(f, &content_size, g_heap);
+        if (content == nullptr) {
+            continue;
+        }
+
+        ConvertedFbxFile header = {};
+        header.name_size = (u32)f.filename.size;
+        header.size      = content_size;
+
+        i32 index = array_add(&headers, header);
+        array_add(&chunks, DerivedDataChunk{ &headers[index], sizeof header });
+        array_add(&chunks, DerivedDataChunk{ (void*)f.filename.bytes, (usize)f.filename.size });
+        array_add(&chunks, DerivedDataChunk{ content, content_size });
+        count++;
+    }
+
+    write_derived_data(key, chunks.data, (i32)chunks.count);
 }
 
-CATALOG_PROCESS_FUNC(catalog_process_msh)
+// NOTE(jesper): the msh v1 and v2 vertices are stored per triangle corner, so
+// the tangents are calculated per triangle and written to its three corners
+void calc_triangle_tangents(Mesh *mesh)
 {
-    AssetID id = find_asset_id(path.filename.bytes);
-    LOG("loading mesh: %s", path.filename.bytes);
+    i32 count = mesh->points.count;
+    mesh->tangents.count   = count;
+    mesh->bitangents.count = count;
 
-    usize size;
-    char *file = read_file(path, &size, g_frame);
-    if (file == nullptr) {
-        LOG("unable to read file: %s", path.absolute.bytes);
-        return;
+    for (i32 i = 0; i + 2 < count; i += 3) {
+        Vector3 p0 = mesh->points[i];
+        Vector3 p1 = mesh->points[i+1];
+        Vector3 p2 = mesh->points[i+2];
+
+        Vector2 uv0 = mesh->uvs[i];
+        Vector2 uv1 = mesh->uvs[i+1];
+        Vector2 uv2 = mesh->uvs[i+2];
+
+        Vector3 t, b;
+        calc_tangent_and_bitangent(
+            &t, &b,
+            p1 - p0, p2 - p0,
+            uv1 - uv0, uv2 - uv0);
+
+        mesh->tangents[i]   = mesh->tangents[i+1]   = mesh->tangents[i+2]   = t;
+        mesh->bitangents[i] = mesh->bitangents[i+1] = mesh->bitangents[i+2] = b;
     }
+}
+
+// NOTE(jesper): copies a v2 stream of count triangle corners, swapping the
+// first and last corner of every triangle to counter-clockwise winding
+template<typename T>
+void copy_msh_stream(Array<T> *dst, char *src, i32 count)
+{
+    T *in  = (T*)src;
+    T *out = dst->data;
 
-    LOG("-- file size: %llu bytes", size);
+    i32 i = 0;
+    for (; i + 2 < count; i += 3) {
+        out[i]   = in[i+2];
+        out[i+1] = in[i+1];
+        out[i+2] = in[i];
+    }
+
+    for (; i < count; i++) {
+        out[i] = in[i];
+    }
+
+    dst->count = count;
+}
+
+// NOTE(jesper): decodes the alchemy msh versions, 1 and 2. Version 3 is
+// mapped as is by mesh_from_msh instead.
+Mesh load_mesh_msh(FilePathView path, char *file, usize size, Allocator *scratch)
+{
+    LOG_DEFERRED("loading mesh: %s", path.filename.bytes);
+    LOG_DEFERRED("-- file size: %llu bytes", size);
 
     AlcMeshHeader *amesh = (AlcMeshHeader*)file;
-    if (amesh->identifier != ALC_MESH_IDENTIFIER) {
+    if (size < sizeof *amesh || amesh->identifier != ALC_MESH_IDENTIFIER) {
         LOG("-- invalid Alchemy Mesh (%s) identifier: %d",
             path.filename.bytes,
-            amesh->identifier);
-        return;
+            size < sizeof *amesh ? 0 : amesh->identifier);
+        return {};
+    }
+
+    if (amesh->version > 2) {
+        LOG("-- invalid Mesh (%s) version %u", path.filename.bytes, amesh->version);
+        return {};
     }
 
     if (amesh->num_vertices == 0) {
         LOG("-- Mesh (%s) contains no vertices", path.filename.bytes);
-        return;
+        return {};
     }
 
     // TODO(jesper): support meshes without uvs?
     if ((amesh->flags & ALC_MESH_FLAG_NORMAL_BIT) == 0) {
         LOG("-- Mesh (%s) contains no normals", path.filename.bytes);
-        return;
+        return {};
     }
 
     // TODO(jesper): support meshes without normals?
     if ((amesh->flags & ALC_MESH_FLAG_UV_BIT) == 0) {
         LOG("-- Mesh (%s) contains no uvs", path.filename.bytes);
-        return;
+        return {};
     }
 
-    LOG(" -- num vertices: %d", amesh->num_vertices);
-    LOG(" -- num indices: %d", amesh->num_vertices);
-    LOG(" -- normals: %s", amesh->flags & ALC_MESH_FLAG_NORMAL_BIT ? "yes" : "no");
-    LOG(" -- uvs: %s", amesh->flags & ALC_MESH_FLAG_UV_BIT ? "yes" : "no");
-
-    Mesh mesh = {};
-    init_array(&mesh.points, g_heap, amesh->num_vertices);
+    i32 num_vertices = (i32)amesh->num_vertices;
+    usize points_size  = num_vertices * sizeof(Vector3);
+    usize normals_size = num_vertices * sizeof(Vector3);
+    usize uvs_size     = num_vertices * sizeof(Vector2);
 
-    if (amesh->flags & ALC_MESH_FLAG_NORMAL_BIT) {
-        init_array(&mesh.normals, g_heap, amesh->num_vertices);
+    if (size - sizeof *amesh < points_size + normals_size + uvs_size) {
+        LOG("-- Mesh (%s) is truncated", path.filename.bytes);
+        return {};
     }
 
-    if (amesh->flags & ALC_MESH_FLAG_UV_BIT) {
-        init_array(&mesh.uvs, g_heap, amesh->num_vertices);
-        init_array(&mesh.tangents, g_heap, amesh->num_vertices);
-        init_array(&mesh.bitangents, g_heap, amesh->num_vertices);
-    }
+    LOG_DEFERRED(" -- num vertices: %d", num_vertices);
+    LOG_DEFERRED(" -- normals: %s", amesh->flags & ALC_MESH_FLAG_NORMAL_BIT ? "yes" : "no");
+    LOG_DEFERRED(" -- uvs: %s", amesh->flags & ALC_MESH_FLAG_UV_BIT ? "yes" : "no");
+
+    Mesh mesh = {};
+    init_array(&mesh.points,     g_heap, num_vertices);
+    init_array(&mesh.normals,    g_heap, num_vertices);
+    init_array(&mesh.uvs,        g_heap, num_vertices);
+    init_array(&mesh.tangents,   g_heap, num_vertices);
+    init_array(&mesh.bitangents, g_heap, num_vertices);
 
     if (amesh->version < 2) {
         f32 *vertices = (f32*)(file + sizeof *amesh);
-        for (u32 i = 0; i < amesh->num_vertices; i++) {
+        for (i32 i = 0; i < num_vertices; i++) {
             Vector3 point;
             point.x = *vertices++;
             point.y = *vertices++;
             point.z = *vertices++;
 
-            array_add(&mesh.points, point);
+            Vector3 normal;
+            normal.x = *vertices++;
+            normal.y = *vertices++;
+            normal.z = *vertices++;
 
-            if (amesh->flags & ALC_MESH_FLAG_NORMAL_BIT) {
-                Vector3 normal;
-                normal.x = *vertices++;
-                normal.y = *vertices++;
-                normal.z = *vertices++;
+            Vector2 uv;
+            uv.u = *vertices++;
+            uv.v = *vertices++;
 
-                array_add(&mesh.normals, normal);
-            }
+            mesh.points.data[i]  = point;
+            mesh.normals.data[i] = normal;
+            mesh.uvs.data[i]     = uv;
+        }
 
-            if (amesh->flags & ALC_MESH_FLAG_UV_BIT) {
-                Vector2 uv;
-                uv.u = *vertices++;
-                uv.v = *vertices++;
+        mesh.points.count  = num_vertices;
+        mesh.normals.count = num_vertices;
+        mesh.uvs.count     = num_vertices;
+    } else {
+        char *ptr = file + sizeof *amesh;
 
-                array_add(&mesh.uvs, uv);
-            }
+        copy_msh_stream(&mesh.points, ptr, num_vertices);
+        ptr += points_size;
+
+        copy_msh_stream(&mesh.normals, ptr, num_vertices);
+        ptr += normals_size;
+
+        copy_msh_stream(&mesh.uvs, ptr, num_vertices);
+    }
+
+    calc_triangle_tangents(&mesh);
+
+    // NOTE(jesper): the msh vertices are stored per triangle corner, so every
+    // shared corner is duplicated.
+    // TODO(jesper): the tangents are calculated per triangle, which keeps
+    // corners of triangles with different tangents from being welded. Average
+    // them per welded vertex instead?
+    index_mesh(&mesh, scratch);
+    LOG_DEFERRED(" -- welded vertices: %d", mesh.points.count);
+
+    optimize_mesh(&mesh, scratch);
+    return mesh;
+}
+
+// NOTE(jesper): frees the vertex and index data of a mesh, arrays that were
+// never initialised are skipped. A mesh that's a view into a mapped .msh
+// unmaps it instead.
+void destroy_mesh_data(Mesh *mesh)
+{
+    if (mesh->mapping != nullptr) {
+        if (mesh->mapping_is_copy) {
+            dealloc(g_heap, mesh->mapping);
+        } else if (mesh->mapping_is_derived_data) {
+            unmap_derived_data(mesh->mapping, mesh->mapping_size);
+        } else {
+            unmap_asset((char*)mesh->mapping, mesh->mapping_size);
         }
 
-        if (amesh->flags & ALC_MESH_FLAG_UV_BIT) {
-            for (i32 i = 0; i < mesh.points.count; i += 3) {
-                Vector3 p0 = mesh.points[i];
-                Vector3 p1 = mesh.points[i+1];
-                Vector3 p2 = mesh.points[i+2];
-
-                Vector2 uv0 = mesh.uvs[i];
-                Vector2 uv1 = mesh.uvs[i+1];
-                Vector2 uv2 = mesh.uvs[i+2];
-
-                Vector3 t, b;
-                calc_tangent_and_bitangent(
-                    &t, &b,
-                    p1 - p0, p2 - p0,
-                    uv1 - uv0, uv2 - uv0);
-
-                array_add(&mesh.tangents, t);
-                array_add(&mesh.tangents, t);
-                array_add(&mesh.tangents, t);
-
-                array_add(&mesh.bitangents, b);
-                array_add(&mesh.bitangents, b);
-                array_add(&mesh.bitangents, b);
-            }
+        mesh->mapping         = nullptr;
+        mesh->packed_vertices = nullptr;
+        mesh->indices    = {};
+        mesh->points     = {};
+        mesh->normals    = {};
+        mesh->tangents   = {};
+        mesh->bitangents = {};
+        mesh->uvs        = {};
+        return;
+    }
+
+    if (mesh->indices.allocator != nullptr) {
+        destroy_array(&mesh->indices);
+    }
+
+    if (mesh->points.allocator != nullptr) {
+        destroy_array(&mesh->points);
+    }
+
+    if (mesh->normals.allocator != nullptr) {
+        destroy_array(&mesh->normals);
+    }
+
+    if (mesh->tangents.allocator != nullptr) {
+        destroy_array(&mesh->tangents);
+    }
+
+    if (mesh->bitangents.allocator != nullptr) {
+        destroy_array(&mesh->bitangents);
+    }
+
+    if (mesh->uvs.allocator != nullptr) {
+        destroy_array(&mesh->uvs);
+    }
+
+    if (mesh->packed_vertices != nullptr) {
+        dealloc(g_heap, mesh->packed_vertices);
+        mesh->packed_vertices = nullptr;
+    }
+}
+
+// NOTE(jesper): points arr at a stream of a mapped .msh v3, the array has no
+// allocator and must not be grown or destroyed
+template<typename T>
+bool msh_stream_view(Array<T> *arr, char *data, usize size, MshStreamRange range, i32 count)
+{
+    if (range.size == 0) {
+        *arr = {};
+        return true;
+    }
+
+    if (range.offset % MSH_STREAM_ALIGNMENT != 0 ||
+        range.offset > size ||
+        range.size > size - range.offset ||
+        range.size != (u64)count * sizeof(T))
+    {
+        return false;
+    }
+
+    *arr = {};
+    arr->data     = (T*)(data + range.offset);
+    arr->count    = count;
+    arr->capacity = count;
+    return true;
+}
+
+// NOTE(jesper): makes mesh a view into a .msh v3 image, returns false if data
+// isn't one or is malformed. Nothing is copied, data must stay valid for as
+// long as the mesh is alive.
+bool mesh_from_msh(Mesh *mesh, void *data, usize size)
+{
+    MshHeader *header = (MshHeader*)data;
+    if (size < sizeof *header ||
+        header->alc.identifier != ALC_MESH_IDENTIFIER ||
+        header->alc.version != MSH_VERSION ||
+        header->lod_count < 1 ||
+        header->lod_count > MESH_MAX_LODS ||
+        header->alc.num_vertices > I32_MAX ||
+        header->index_count > I32_MAX)
+    {
+        return false;
+    }
+
+    i32 vertex_count = (i32)header->alc.num_vertices;
+    i32 index_count  = (i32)header->index_count;
+
+    for (i32 i = 0; i < header->lod_count; i++) {
+        MeshLod lod = header->lods[i];
+        if (lod.index_offset > header->index_count ||
+            lod.index_count > header->index_count - lod.index_offset)
+        {
+            return false;
         }
-    } else {
-        isize offset = sizeof *amesh;
-
-        usize points_size  = amesh->num_vertices * sizeof(f32) * 3;
-        usize normals_size = amesh->num_vertices * sizeof(f32) * 3;
-        usize uvs_size     = amesh->num_vertices * sizeof(f32) * 2;
-
-        f32 *points  = (f32*)(file + offset);
-        memcpy(mesh.points.data, points, points_size);
-        mesh.points.count = amesh->num_vertices;
-        offset += points_size;
-        
-        // NOTE(jesper): swap to counter-clockwise-winding
-        for (i32 i = 0; i < mesh.points.count; i+=3) {
-            Vector3 tmp = mesh.points[i];
-            mesh.points[i] = mesh.points[i+2];
-            mesh.points[i+2] = tmp;
+    }
+
+    char *file = (char*)data;
+    MshStreamRange *streams = header->streams;
+
+    Mesh result = {};
+    if (!msh_stream_view(&result.indices,    file, size, streams[MshStream_indices],    index_count) ||
+        !msh_stream_view(&result.points,     file, size, streams[MshStream_points],     vertex_count) ||
+        !msh_stream_view(&result.normals,    file, size, streams[MshStream_normals],    vertex_count) ||
+        !msh_stream_view(&result.tangents,   file, size, streams[MshStream_tangents],   vertex_count) ||
+        !msh_stream_view(&result.bitangents, file, size, streams[MshStream_bitangents], vertex_count) ||
+        !msh_stream_view(&result.uvs,        file, size, streams[MshStream_uvs],        vertex_count))
+    {
+        return false;
+    }
+
+    Array<PackedVertex> packed;
+    if (!msh_stream_view(&packed, file, size, streams[MshStream_packed], vertex_count) ||
+        result.points.count != vertex_count ||
+        packed.count != vertex_count)
+    {
+        return false;
+    }
+
+    result.lod_count = header->lod_count;
+    memcpy(result.lods, header->lods, sizeof result.lods);
+
+    result.bounds_min      = header->bounds_min;
+    result.bounds_extent   = header->bounds_extent;
+    result.radius          = header->radius;
+    result.packed_vertices = packed.data;
+
+    result.mapping      = data;
+    result.mapping_size = size;
+
+    *mesh = result;
+    return true;
+}
+
+u8 g_msh_padding[MSH_STREAM_ALIGNMENT] = {};
+
+// NOTE(jesper): fills in the .msh v3 header of a cooked mesh and the chunks to
+// write the image from, returns the number of chunks. chunks must have room for
+// 1 + 2 * MshStream_count, header and packed must stay alive until written.
+i32 msh_chunks(
+    MshHeader *header,
+    Mesh *mesh,
+    PackedVertex *packed,
+    DerivedDataChunk *chunks)
+{
+    *header = {};
+    header->alc.identifier   = ALC_MESH_IDENTIFIER;
+    header->alc.version      = MSH_VERSION;
+    header->alc.num_vertices = (u32)mesh->points.count;
+    header->alc.flags        = ALC_MESH_FLAG_POINT_BIT;
+
+    if (mesh->normals.count > 0) {
+        header->alc.flags |= ALC_MESH_FLAG_NORMAL_BIT;
+    }
+
+    if (mesh->uvs.count > 0) {
+        header->alc.flags |= ALC_MESH_FLAG_UV_BIT;
+    }
+
+    header->index_count = (u32)mesh->indices.count;
+    header->lod_count   = mesh->lod_count;
+    memcpy(header->lods, mesh->lods, sizeof header->lods);
+
+    header->bounds_min    = mesh->bounds_min;
+    header->bounds_extent = mesh->bounds_extent;
+    header->radius        = mesh->radius;
+
+    DerivedDataChunk streams[MshStream_count];
+    streams[MshStream_indices]    = { mesh->indices.data,    mesh->indices.count    * sizeof mesh->indices[0] };
+    streams[MshStream_points]     = { mesh->points.data,     mesh->points.count     * sizeof mesh->points[0] };
+    streams[MshStream_normals]    = { mesh->normals.data,    mesh->normals.count    * sizeof mesh->normals[0] };
+    streams[MshStream_tangents]   = { mesh->tangents.data,   mesh->tangents.count   * sizeof mesh->tangents[0] };
+    streams[MshStream_bitangents] = { mesh->bitangents.data, mesh->bitangents.count * sizeof mesh->bitangents[0] };
+    streams[MshStream_uvs]        = { mesh->uvs.data,        mesh->uvs.count        * sizeof mesh->uvs[0] };
+    streams[MshStream_packed]     = { packed,                mesh->points.count     * sizeof packed[0] };
+
+    i32 count = 0;
+    chunks[count++] = DerivedDataChunk{ header, sizeof *header };
+
+    u64 offset = sizeof *header;
+    for (i32 i = 0; i < MshStream_count; i++) {
+        if (streams[i].size == 0) {
+            continue;
         }
-        
-        if (amesh->flags & ALC_MESH_FLAG_NORMAL_BIT) {
-            f32 *normals  = (f32*)(file + offset);
-            memcpy(mesh.normals.data, normals, normals_size);
-            mesh.normals.count = amesh->num_vertices;
-            offset += normals_size;
-            
-            // NOTE(jesper): swap to counter-clockwise-winding
-            for (i32 i = 0; i < mesh.normals.count; i+=3) {
-                Vector3 tmp = mesh.normals[i];
-                mesh.normals[i] = mesh.normals[i+2];
-                mesh.normals[i+2] = tmp;
-            }
+
+        u64 aligned = (offset + MSH_STREAM_ALIGNMENT - 1) & ~(u64)(MSH_STREAM_ALIGNMENT - 1);
+        if (aligned != offset) {
+            chunks[count++] = DerivedDataChunk{ g_msh_padding, (usize)(aligned - offset) };
         }
 
-        if (amesh->flags & ALC_MESH_FLAG_UV_BIT) {
-            f32 *uvs  = (f32*)(file + offset);
-            memcpy(mesh.uvs.data, uvs, uvs_size);
-            mesh.uvs.count = amesh->num_vertices;
-            offset += uvs_size;
-            
-            // NOTE(jesper): swap to counter-clockwise-winding
-            for (i32 i = 0; i < mesh.uvs.count; i+=3) {
-                Vector2 tmp = mesh.uvs[i];
-                mesh.uvs[i] = mesh.uvs[i+2];
-                mesh.uvs[i+2] = tmp;
-            }
+        header->streams[i] = MshStreamRange{ aligned, streams[i].size };
+        chunks[count++]    = streams[i];
+        offset = aligned + streams[i].size;
+    }
 
-            for (i32 i = 0; i < mesh.points.count; i += 3) {
-                Vector3 p0 = mesh.points[i];
-                Vector3 p1 = mesh.points[i+1];
-                Vector3 p2 = mesh.points[i+2];
+    return count;
+}
 
-                Vector2 uv0 = mesh.uvs[i];
-                Vector2 uv1 = mesh.uvs[i+1];
-                Vector2 uv2 = mesh.uvs[i+2];
+// NOTE(jesper): loads a mesh ready for upload. A .msh v3 source is used as is,
+// mapped from the asset pack or copied if it's a loose file. Anything else is
+// decoded, welded and optimised once and stored in the derived data cache as a
+// .msh v3 image, which later loads map the same way. source_hash, if given, is
+// set to the hash of the source content.
+Mesh load_cooked_mesh(
+    FilePathView path,
+    Allocator *scratch,
+    u64 *source_hash)
+{
+    usize size;
+    char *file = map_asset(path, &size);
+    if (file == nullptr) {
+        LOG_ERROR_DEFERRED("unable to read file: %s", path.absolute.bytes);
+        return {};
+    }
 
-                Vector3 t, b;
-                calc_tangent_and_bitangent(
-                    &t, &b,
-                    p1 - p0, p2 - p0,
-                    uv1 - uv0, uv2 - uv0);
+    u64 hash = hash64(file, size);
+    if (source_hash != nullptr) {
+        *source_hash = hash;
+    }
 
-                array_add(&mesh.tangents, t);
-                array_add(&mesh.tangents, t);
-                array_add(&mesh.tangents, t);
+    Mesh mesh = {};
+    if (path.extension == "msh" && mesh_from_msh(&mesh, file, size)) {
+        if (is_packed_asset(file)) {
+            LOG_DEFERRED("mapped mesh: %s", path.filename.bytes);
+            return mesh;
+        }
 
-                array_add(&mesh.bitangents, b);
-                array_add(&mesh.bitangents, b);
-                array_add(&mesh.bitangents, b);
-            }
+        // NOTE(jesper): a loose file can't stay mapped, the exporter can't
+        // overwrite it on Windows and truncating it turns any later access
+        // into a SIGBUS on Linux
+        void *copy = alloc(g_heap, (isize)size);
+        memcpy(copy, file, size);
+        unmap_asset(file, size);
+
+        mesh_from_msh(&mesh, copy, size);
+        mesh.mapping_is_copy = true;
+        return mesh;
+    }
+
+    defer { unmap_asset(file, size); };
+
+    u64 key = derived_data_key(hash, path.filename, MESH_COOK_VERSION);
+
+    usize cached_size;
+    void *cached = map_derived_data(key, &cached_size);
+    if (cached != nullptr) {
+        if (mesh_from_msh(&mesh, cached, cached_size)) {
+            mesh.mapping_is_derived_data = true;
+            return mesh;
+        }
+
+        unmap_derived_data(cached, cached_size);
+    }
+
+    if (path.extension == "msh") {
+        mesh = load_mesh_msh(path, file, size, scratch);
+    } else if (path.extension == "obj") {
+        mesh = load_mesh_obj(path, file, size, scratch);
+    }
+
+    if (mesh.points.count > 0) {
+        if (mesh.lod_count == 0) {
+            mesh.lods[0]   = MeshLod{ 0, (u32)mesh.indices.count, 0.0f };
+            mesh.lod_count = 1;
         }
+
+        compute_mesh_bounds(&mesh);
+
+        PackedVertex *packed = alloc_array(g_heap, PackedVertex, mesh.points.count);
+        pack_vertices(
+            packed,
+            mesh.points.count,
+            mesh.points.data,
+            mesh.normals.count > 0 ? mesh.normals.data : nullptr,
+            mesh.tangents.count > 0 ? mesh.tangents.data : nullptr,
+            mesh.bitangents.count > 0 ? mesh.bitangents.data : nullptr,
+            mesh.uvs.count > 0 ? mesh.uvs.data : nullptr,
+            mesh.bounds_min,
+            mesh.bounds_extent);
+
+        MshHeader header;
+        DerivedDataChunk chunks[1 + 2 * MshStream_count];
+        i32 chunk_count = msh_chunks(&header, &mesh, packed, chunks);
+        write_derived_data(key, chunks, chunk_count);
+
+#if LEARY_PACKED_VERTICES
+        mesh.packed_vertices = packed;
+#else
+        dealloc(g_heap, packed);
+#endif
     }
 
+    return mesh;
+}
+
+// NOTE(jesper): the .msh files written by the fbx converter are named after
+// the fbx followed by a '_', see catalog_process_fbx. The longest matching
+// name wins.
+AssetID find_fbx_source(StringView filename)
+{
+    AssetID source = ASSET_INVALID_ID;
+    for (i32 i = 1; i < filename.size - 1; i++) {
+        if (filename[i] != '_') {
+            continue;
+        }
+
+        String name = create_string(g_frame, { StringView{ filename.bytes, i + 1 }, ".fbx" });
+        AssetID id = find_asset_id(name);
+        if (id != ASSET_INVALID_ID) {
+            source = id;
+        }
+    }
+
+    return source;
+}
+
+void process_mesh_msh(FilePath path, Mesh mesh)
+{
+    process_mesh(path, mesh);
+
+    AssetID id = find_asset_id(path.filename.bytes);
     if (id == ASSET_INVALID_ID) {
-        add_mesh(mesh, path.filename);
-    } else {
-        MeshID *mesh_id = map_find(&g_catalog.meshes, id);
-        ASSERT(mesh_id != nullptr);
-        update_mesh(*mesh_id, mesh);
+        return;
+    }
+
+    AssetID source = find_fbx_source(path.filename);
+    if (source != ASSET_INVALID_ID) {
+        add_asset_dependency(id, source);
     }
 }
 
+CATALOG_PROCESS_FUNC(catalog_process_msh)
+{
+    Mesh mesh = load_cooked_mesh(path, g_frame);
+    process_mesh_msh(path, mesh);
+}
+
 CATALOG_PROCESS_FUNC(catalog_process_glsl)
 {
-    AssetID id = find_asset_id(path.filename.bytes);
-    LOG("loading shader: %s", path.filename.bytes);
+    profiler_tag_frame("shader rebuild");
 
-    usize size;
-    char *file = read_file(path, &size, g_frame);
-    if (file == nullptr) {
-        LOG("unable to read file: %s", path.absolute.bytes);
+    LOG_DEFERRED("loading shader: %s", path.filename.bytes);
+
+    // NOTE(jesper): a changed shader has nothing to rebuild itself, the
+    // pipelines built from it are rebuilt as its dependents
+    if (find_asset_id(path.filename.bytes) != ASSET_INVALID_ID) {
         return;
     }
 
-    LOG("-- file size: %llu bytes", size);
-
-    PipelineID pipeline;
-    if (path.filename == "mesh.glsl") {
-        pipeline = Pipeline_mesh;
-    } else if (path.filename == "font.glsl") {
-        pipeline = Pipeline_font;
-    } else if (path.filename == "basic2d.glsl") {
-        pipeline = Pipeline_basic2d;
-    } else if (path.filename == "gui_basic.glsl") {
-        pipeline = Pipeline_gui_basic;
-    } else if (path.filename == "terrain.glsl") {
-        pipeline = Pipeline_terrain;
-    } else if (path.filename == "line.glsl") {
-        pipeline = Pipeline_line;
-    } else if (path.filename == "wireframe.glsl") {
-        pipeline = Pipeline_wireframe;
-    } else if (path.filename == "wireframe_lines.glsl") {
-        pipeline = Pipeline_wireframe_lines;
+    AssetID asset_id = g_catalog.next_asset_id++;
+    map_add(&g_catalog.assets, path.filename, asset_id);
+
+    for (i32 i = 0; i < Pipeline_count; i++) {
+        PipelineID pipeline = (PipelineID)i;
+        if (!(pipeline_shader_name(pipeline) == path.filename)) {
+            continue;
+        }
+
+        AssetID pipeline_id = g_catalog.next_asset_id++;
+        map_add(&g_catalog.pipelines, pipeline_id, pipeline);
+        add_asset_dependency(pipeline_id, asset_id);
+
+        create_pipeline(pipeline);
+    }
+}
+
+CATALOG_LOAD_FUNC(catalog_load_bmp)
+{
+    (void)scratch;
+    load->texture = load_cooked_texture(load->path, g_heap, &load->source_hash);
+}
+
+CATALOG_COMMIT_FUNC(catalog_commit_bmp)
+{
+    process_texture(load->path, load->texture);
+    dealloc(g_heap, load->texture.pixels);
+}
+
+CATALOG_LOAD_FUNC(catalog_load_obj)
+{
+    load->mesh = load_cooked_mesh(load->path, scratch, &load->source_hash);
+}
+
+CATALOG_COMMIT_FUNC(catalog_commit_obj)
+{
+    process_mesh(load->path, load->mesh);
+}
+
+CATALOG_LOAD_FUNC(catalog_load_msh)
+{
+    load->mesh = load_cooked_mesh(load->path, scratch, &load->source_hash);
+}
+
+CATALOG_COMMIT_FUNC(catalog_commit_msh)
+{
+    process_mesh_msh(load->path, load->mesh);
+}
+
+// NOTE(jesper): claims the next load in the queue and runs it, returns false
+// when every load has been claimed
+bool catalog_run_load(CatalogLoadQueue *queue, Allocator *scratch)
+{
+    u32 i = atomic_add(&queue->next, 1);
+    if (i >= queue->count) {
+        return false;
+    }
+
+    CatalogLoad *load = &queue->loads[i];
+
+    // NOTE(jesper): editors tend to save files that haven't changed, a reload
+    // is only done when the content differs from what was last loaded
+    if (load->path.absolute.size == 0) {
+        load->unchanged = true;
+    } else if (load->previous_hash != 0) {
+        usize size;
+        char *file = map_asset(load->path, &size);
+        if (file != nullptr) {
+            load->unchanged = hash64(file, size) == load->previous_hash;
+            unmap_asset(file, size);
+        }
+    }
+
+    if (load->unchanged) {
+        load->source_hash = load->previous_hash;
+    } else if (load->loader != nullptr) {
+        load->loader->load(load, scratch);
     } else {
-        LOG_ERROR("unknown shader pipeline: %s", path.filename.bytes);
+        // NOTE(jesper): assets without a loader are processed on the main
+        // thread, only their source hash is needed from here. They're hashed
+        // straight from the mapping, an fbx can be larger than the scratch.
+        usize size;
+        char *file = map_asset(load->path, &size);
+        if (file != nullptr) {
+            load->source_hash = hash64(file, size);
+            unmap_asset(file, size);
+        } else {
+            load->source_hash = 0;
+        }
+    }
+    reset(scratch, nullptr);
+
+    atomic_store(&load->done, 1);
+    if (queue->signal_done) {
+        signal_semaphore(&queue->done);
+    }
+    return true;
+}
+
+// NOTE(jesper): reprocesses an asset whose own content is unchanged after an
+// asset it depends on changed
+void catalog_refresh_asset(AssetID id)
+{
+    EntityID *entity_id = map_find(&g_catalog.entities, id);
+    if (entity_id != nullptr) {
+        bind_entity_assets(&g_entities[*entity_id], id);
         return;
     }
 
-    create_pipeline(pipeline);
-    if (id == ASSET_INVALID_ID) {
-        AssetID asset_id = g_catalog.next_asset_id++;
-        map_add(&g_catalog.assets, path.filename, asset_id);
+    PipelineID *pipeline = map_find(&g_catalog.pipelines, id);
+    if (pipeline != nullptr) {
+        create_pipeline(*pipeline);
+        return;
+    }
+}
+
+// NOTE(jesper): the main thread half of a load, registers or updates the asset
+void catalog_commit_load(CatalogLoad *load)
+{
+    if (load->unchanged) {
+        if (load->dirty) {
+            catalog_refresh_asset(load->asset_id);
+        }
+        return;
+    }
+
+    if (load->loader != nullptr) {
+        load->loader->commit(load);
+    } else {
+        catalog_process_t **func = map_find(&g_catalog.processes, load->path.extension);
+        (*func)(load->path);
+    }
+
+    u64 *hash = map_find(&g_catalog.source_hashes, load->path.filename);
+    if (hash != nullptr) {
+        *hash = load->source_hash;
+    } else {
+        map_add(&g_catalog.source_hashes, load->path.filename, load->source_hash);
+    }
+
+    AssetID id = find_asset_id(load->path.filename);
+    if (id != ASSET_INVALID_ID && map_find(&g_catalog.paths, id) == nullptr) {
+        map_add(&g_catalog.paths, id, create_file_path(g_heap, load->path.absolute));
+    }
+}
+
+THREAD_PROC(catalog_load_thread_proc)
+{
+    Allocator *scratch = (Allocator*)data;
+
+    while (catalog_run_load(&g_catalog_loads, scratch));
+
+    // NOTE(jesper): a thread can take more than one of the signals of a wave
+    // if it finishes its share early, the queue is empty for it by then, so
+    // load_threads only reaches 0 once every signal has been taken and every
+    // taker is done with the queue
+    while (true) {
+        wait_semaphore(&g_catalog.reload_wave);
+        while (catalog_run_load(&g_catalog_reloads, scratch));
+        atomic_add(&g_catalog.load_threads, (u32)-1);
+    }
+}
+
+Allocator* create_load_scratch()
+{
+    Allocator *scratch = ialloc<Allocator>(g_heap);
+
+    void *mem = alloc(g_system_alloc, CATALOG_LOAD_SCRATCH_SIZE);
+    *scratch = linear_allocator(mem, CATALOG_LOAD_SCRATCH_SIZE);
+    return scratch;
+}
+
+// NOTE(jesper): the threads work through the initial loads and then wait for
+// the reload waves, see catalog_load_thread_proc
+void create_load_threads(i32 count)
+{
+    for (i32 i = 0; i < count; i++) {
+        create_thread(catalog_load_thread_proc, create_load_scratch());
+    }
+    g_catalog.load_thread_count = count;
+}
+
+// NOTE(jesper): starts the loads of the next depth of the batch in flight
+void start_reload_wave()
+{
+    i32 first = g_catalog.reloads_started;
+    i32 end   = first + 1;
+    while (end < g_catalog.reloads.count &&
+           g_catalog.reloads[end].depth == g_catalog.reloads[first].depth)
+    {
+        end++;
+    }
+
+    g_catalog_reloads.loads = &g_catalog.reloads[first];
+    g_catalog_reloads.count = (u32)(end - first);
+    g_catalog_reloads.next  = 0;
+    g_catalog.reloads_started = end;
+
+    i32 num_threads = min(g_catalog.load_thread_count, end - first);
+    atomic_store(&g_catalog.load_threads, (u32)num_threads);
+    for (i32 i = 0; i < num_threads; i++) {
+        signal_semaphore(&g_catalog.reload_wave);
+    }
+}
+
+// NOTE(jesper): commits the reloads of the batch in flight that are done, in
+// the order they were queued, without waiting for the rest. The dependents of
+// an asset that changed are marked dirty as it's committed, everything else
+// in the batch is left alone if its own content didn't change.
+// TODO(jesper): the commits could be spread over the workers as well if we
+// ensure that we have thread safe versions of update_vk_texture, currently
+// that'd mean handling multi-threaded command buffer creation and submission
+void commit_catalog_reloads()
+{
+    while (g_catalog.reloads_committed < g_catalog.reloads.count) {
+        if (g_catalog.reloads_committed == g_catalog.reloads_started) {
+            // NOTE(jesper): the next depth is started once the threads are
+            // done with the previous one, they share the queue
+            if (atomic_load(&g_catalog.load_threads) > 0) {
+                return;
+            }
+
+            start_reload_wave();
+        }
+
+        CatalogLoad *load = &g_catalog.reloads[g_catalog.reloads_committed];
+        if (atomic_load(&load->done) == 0) {
+            return;
+        }
+
+        catalog_commit_load(load);
+
+        Array<AssetID> *dependents = map_find(&g_catalog.dependents, load->asset_id);
+        if (dependents != nullptr && (!load->unchanged || load->dirty)) {
+            for (AssetID d : *dependents) {
+                for (i32 i = g_catalog.reloads_committed + 1; i < g_catalog.reloads.count; i++) {
+                    if (g_catalog.reloads[i].asset_id == d) {
+                        g_catalog.reloads[i].dirty = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (load->path.absolute.bytes != nullptr) {
+            dealloc(g_system_alloc, load->path.absolute.bytes);
+        }
+        g_catalog.reloads_committed++;
+    }
+
+    g_catalog.reloads.count     = 0;
+    g_catalog.reloads_committed = 0;
+    g_catalog.reloads_started   = 0;
+
+    // NOTE(jesper): everything using the replaced textures has been rebound by
+    // now, but frames recorded before that may still be in flight
+    if (g_catalog.retired_textures.count > 0) {
+        gfx_flush_and_wait(GFX_QUEUE_GRAPHICS);
+
+        for (GfxTexture texture : g_catalog.retired_textures) {
+            gfx_destroy_texture(texture);
+        }
+        g_catalog.retired_textures.count = 0;
+    }
+}
+
+// NOTE(jesper): depth first over the dependents, appending in post-order, so
+// that the reverse of order is a topological order of everything reachable
+// from id
+void collect_asset_dependents(
+    AssetID id,
+    RHHashMap<AssetID, i32> *depths,
+    Array<AssetID> *order)
+{
+    if (map_find(depths, id) != nullptr) {
+        return;
+    }
+
+    map_add(depths, id, 0);
+
+    Array<AssetID> *dependents = map_find(&g_catalog.dependents, id);
+    if (dependents != nullptr) {
+        for (AssetID d : *dependents) {
+            collect_asset_dependents(d, depths, order);
+        }
+    }
+
+    array_add(order, id);
+}
+
+CatalogLoad create_reload(AssetID id, FilePath path)
+{
+    CatalogLoad load = {};
+    load.asset_id = id;
+    load.path     = path;
+
+    if (path.absolute.size > 0) {
+        load.loader = map_find(&g_catalog.loaders, path.extension);
+
+        u64 *hash = map_find(&g_catalog.source_hashes, path.filename);
+        load.previous_hash = hash != nullptr ? *hash : 0;
+    }
+
+    return load;
+}
+
+// NOTE(jesper): the batch is made of the changed files and everything that
+// depends on them, ordered by depth so that an asset is loaded and committed
+// after the assets it depends on, e.g. an fbx is converted before the .msh
+// files it writes are loaded, and a texture is uploaded before the entities
+// using it are rebound
+void start_catalog_reloads(Array<CatalogEvent> events)
+{
+    Array<CatalogLoad> changed = create_array<CatalogLoad>(g_heap, events.count);
+    defer { destroy_array(&changed); };
+
+    for (auto &e : events) {
+        if (map_find(&g_catalog.processes, e.path.extension) == nullptr) {
+            LOG_ERROR("could not find process function for extension: %.*s",
+                      e.path.extension.size,
+                      e.path.extension.bytes);
+            dealloc(g_system_alloc, e.path.absolute.bytes);
+            continue;
+        }
+
+        AssetID id = find_asset_id(e.path.filename.bytes);
+        if (id == ASSET_INVALID_ID) {
+            LOG("asset not found in catalogue system: %s", e.path.filename.bytes);
+            dealloc(g_system_alloc, e.path.absolute.bytes);
+            continue;
+        }
+
+        bool queued = false;
+        for (auto &load : changed) {
+            queued = queued || load.asset_id == id;
+        }
+
+        if (queued) {
+            dealloc(g_system_alloc, e.path.absolute.bytes);
+            continue;
+        }
+
+        // NOTE(jesper): the modified loose file takes precedence over the
+        // packed one from now on
+        override_pack_asset(e.path);
+
+        array_add(&changed, create_reload(id, e.path));
+    }
+
+    if (changed.count == 0) {
+        return;
+    }
+
+    RHHashMap<AssetID, i32> depths;
+    init_map(&depths, g_heap);
+    defer { destroy_map(&depths); };
+
+    Array<AssetID> order = create_array<AssetID>(g_heap);
+    defer { destroy_array(&order); };
+
+    for (auto &load : changed) {
+        collect_asset_dependents(load.asset_id, &depths, &order);
+    }
+
+    // NOTE(jesper): the depth of an asset is the longest chain of
+    // dependencies leading to it from a changed file
+    i32 max_depth = 0;
+    for (i32 i = order.count - 1; i >= 0; i--) {
+        i32 depth = *map_find(&depths, order[i]);
+        max_depth = max(max_depth, depth);
+
+        Array<AssetID> *dependents = map_find(&g_catalog.dependents, order[i]);
+        if (dependents == nullptr) {
+            continue;
+        }
+
+        for (AssetID d : *dependents) {
+            i32 *dependent_depth = map_find(&depths, d);
+            *dependent_depth = max(*dependent_depth, depth + 1);
+        }
+    }
+
+    for (i32 depth = 0; depth <= max_depth; depth++) {
+        for (i32 i = order.count - 1; i >= 0; i--) {
+            AssetID id = order[i];
+            if (*map_find(&depths, id) != depth) {
+                continue;
+            }
+
+            CatalogLoad load = {};
+
+            i32 j = 0;
+            while (j < changed.count && changed[j].asset_id != id) {
+                j++;
+            }
+
+            if (j < changed.count) {
+                load = changed[j];
+            } else {
+                FilePath *path = map_find(&g_catalog.paths, id);
+                load = create_reload(
+                    id,
+                    path != nullptr ? create_file_path(g_system_alloc, path->absolute) : FilePath{});
+            }
+
+            load.depth = depth;
+            array_add(&g_catalog.reloads, load);
+        }
     }
+
+    start_reload_wave();
+}
+
+void process_catalog_system()
+{
+    PROFILE_FUNCTION();
+
+    commit_catalog_reloads();
+    if (g_catalog.reloads.count > 0 || atomic_load(&g_catalog.load_threads) > 0) {
+        return;
+    }
+
+    u64 now      = platform_clock_ticks();
+    u64 debounce = platform_clock_frequency() * CATALOG_RELOAD_DEBOUNCE_MS / 1000;
+
+    // NOTE(jesper): the queue is swapped out under the lock and processed
+    // without it, so the catalog thread is never blocked on a reload
+    Array<CatalogEvent> events = {};
+
+    lock_mutex(&g_catalog.mutex);
+    if (g_catalog.process_queue.count > 0 && now - g_catalog.last_event >= debounce) {
+        events = g_catalog.process_queue;
+        init_array(&g_catalog.process_queue, g_heap);
+    }
+    unlock_mutex(&g_catalog.mutex);
+
+    if (events.count > 0) {
+        profiler_tag_frame("catalog process_queue");
+        start_catalog_reloads(events);
+        destroy_array(&events);
+    }
+}
+
+CATALOG_CALLBACK(catalog_thread_proc)
+{
+    u64 path_hash = hash64((void*)path.absolute.bytes, path.absolute.size);
+    u64 now       = platform_clock_ticks();
+
+    lock_mutex(&g_catalog.mutex);
+    defer { unlock_mutex(&g_catalog.mutex); };
+
+    g_catalog.last_event = now;
+    for (auto &e : g_catalog.process_queue) {
+        if (e.path_hash == path_hash && e.path == path) {
+            dealloc(g_system_alloc, path.absolute.bytes);
+            return;
+        }
+    }
+
+    array_add(&g_catalog.process_queue, CatalogEvent{ path_hash, path });
 }
 
 void init_catalog_system()
@@ -1260,9 +2595,20 @@ void init_catalog_system()
     init_map(&g_catalog.textures,        g_heap);
     init_map(&g_catalog.meshes,          g_heap);
     init_map(&g_catalog.entities,        g_heap);
+    init_map(&g_catalog.pipelines,       g_heap);
+
+    init_map(&g_catalog.dependencies,    g_heap);
+    init_map(&g_catalog.dependents,      g_heap);
+    init_map(&g_catalog.paths,           g_heap);
+
+    init_map(&g_catalog.source_hashes,   g_heap);
 
     init_map(&g_catalog.processes,       g_heap);
     init_array(&g_catalog.process_queue, g_heap);
+    init_array(&g_catalog.reloads,       g_heap);
+
+    init_map(&g_catalog.texture_bindings,   g_heap);
+    init_array(&g_catalog.retired_textures, g_heap);
 
     init_mutex(&g_catalog.mutex);
 
@@ -1278,11 +2624,24 @@ void init_catalog_system()
     map_add(&g_catalog.processes, "msh", catalog_process_msh);
     map_add(&g_catalog.processes, "glsl", catalog_process_glsl);
 
+    init_map(&g_catalog.loaders, g_heap);
+    map_add(&g_catalog.loaders, "bmp", CatalogLoader{ catalog_load_bmp, catalog_commit_bmp });
+    map_add(&g_catalog.loaders, "obj", CatalogLoader{ catalog_load_obj, catalog_commit_obj });
+    map_add(&g_catalog.loaders, "msh", CatalogLoader{ catalog_load_msh, catalog_commit_msh });
+
     init_array(&g_textures, g_heap);
     init_array(&g_meshes,   g_heap);
 
+    // NOTE(jesper): the decoding and parsing of assets with a loader is spread
+    // out over worker threads, everything is committed on this thread in the
+    // order the assets were listed. Entities are listed after the textures and
+    // meshes they reference, and assets without a loader are processed at
+    // their position in the list as before.
+    Array<CatalogLoad> loads = create_array<CatalogLoad>(g_heap);
+    defer { destroy_array(&loads); };
+
     for (i32 i = 0; i < g_catalog.folders.count; i++) {
-        Array<FilePath> files = list_files(g_catalog.folders[i], g_heap);
+        Array<FilePath> files = list_asset_files(g_catalog.folders[i], g_heap);
 
         for (auto &p : files) {
             catalog_process_t **func = map_find(
@@ -1296,8 +2655,44 @@ void init_catalog_system()
                 continue;
             }
 
-            (*func)(p);
+            CatalogLoad load = {};
+            load.path   = p;
+            load.loader = map_find(&g_catalog.loaders, p.extension);
+            array_add(&loads, load);
+        }
+    }
+
+    g_catalog_loads = {};
+    g_catalog_loads.loads       = loads.data;
+    g_catalog_loads.count       = (u32)loads.count;
+    g_catalog_loads.signal_done = true;
+    init_semaphore(&g_catalog_loads.done);
+
+    g_catalog_reloads = {};
+    init_semaphore(&g_catalog.reload_wave);
+
+    // NOTE(jesper): the main thread helps out with the initial load, but the
+    // reloads are left to the threads, so there's always at least one
+    i32 num_threads = min(hardware_thread_count() - 1, CATALOG_MAX_LOAD_THREADS);
+    create_load_threads(max(num_threads, 1));
+
+    Allocator *scratch = create_load_scratch();
+    defer {
+        dealloc(g_system_alloc, scratch->mem);
+        dealloc(g_heap, scratch);
+    };
+
+    for (i32 i = 0; i < loads.count; i++) {
+        CatalogLoad *load = &loads[i];
+
+        // NOTE(jesper): help out with the remaining loads while waiting
+        while (atomic_load(&load->done) == 0) {
+            if (!catalog_run_load(&g_catalog_loads, scratch)) {
+                wait_semaphore(&g_catalog_loads.done);
+            }
         }
+
+        catalog_commit_load(load);
     }
 
     create_catalog_thread(g_catalog.folders, &catalog_thread_proc);
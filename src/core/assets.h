@@ -59,6 +59,27 @@ DEFINE_ID_TYPE(TextureID, i32);
 DEFINE_ID_TYPE(EntityID,  i32);
 DEFINE_ID_TYPE(MeshID,    i32);
 
+#define MESH_MAX_LODS (4)
+
+// NOTE(jesper): LODs are generated at import by simplifying the previous level
+// to half the triangles, stopping early if the mesh can't be simplified
+// further. They share the vertex buffers of the full mesh.
+#define MESH_LOD_REDUCTION (0.5f)
+
+// NOTE(jesper): a LOD is used when its error projects to less than this many
+// pixels
+#define MESH_LOD_PIXEL_ERROR (1.0f)
+
+// NOTE(jesper): range of the mesh's index buffer, lods[0] is the full mesh
+struct MeshLod {
+    u32 index_offset;
+    u32 index_count;
+
+    // NOTE(jesper): estimated object space distance between the LOD's surface
+    // and the full mesh
+    f32 error;
+};
+
 struct Mesh {
     AssetID asset_id = ASSET_INVALID_ID;
 
@@ -75,10 +96,84 @@ struct Mesh {
         VulkanBuffer tangents;
         VulkanBuffer bitangents;
         VulkanBuffer uvs;
+
+        // NOTE(jesper): every attribute interleaved as PackedVertex, replaces
+        // the separate buffers when LEARY_PACKED_VERTICES is enabled
+        VulkanBuffer packed;
     } vbo;
 
     VulkanBuffer ibo;
     u32 element_count;
+
+    MeshLod lods[MESH_MAX_LODS];
+    i32     lod_count;
+
+    // NOTE(jesper): object space distance from the origin to the farthest
+    // point
+    f32     radius;
+
+    // NOTE(jesper): object space bounding box, the packed positions are
+    // quantised to it
+    Vector3 bounds_min;
+    Vector3 bounds_extent;
+
+    // NOTE(jesper): set when the mesh is a view into a .msh v3 image, the
+    // arrays then point into it and have no allocator. The image is mapped
+    // from the asset pack or the derived data cache, or a copy on g_heap of a
+    // loose file, which has to stay writable by the exporter. See
+    // mesh_from_msh and destroy_mesh_data.
+    void  *mapping;
+    usize mapping_size;
+    bool  mapping_is_derived_data;
+    bool  mapping_is_copy;
+
+    // NOTE(jesper): the vertices as PackedVertex, uploaded as is by
+    // create_mesh_vbos when set
+    void  *packed_vertices;
+};
+
+// NOTE(jesper): .msh version 3, the layout the engine cooks every mesh into.
+// Versions 1 and 2 from alchemy store raw triangle soup that needs welding,
+// tangents and a winding swap on every load, version 3 is stored the way it's
+// used: indexed, optimised, with LODs, tangents and bounds baked in and the
+// winding counter-clockwise. Every stream starts at an aligned offset from the
+// start of the file, so loading it is mapping the file and pointing the mesh
+// and the vertex buffer upload at it.
+//     MshHeader
+//     streams, in MshStream order, empty streams have size 0
+#define MSH_VERSION          (3)
+#define MSH_STREAM_ALIGNMENT (64)
+
+enum MshStream {
+    MshStream_indices,    // u32
+    MshStream_points,     // Vector3
+    MshStream_normals,    // Vector3
+    MshStream_tangents,   // Vector3
+    MshStream_bitangents, // Vector3
+    MshStream_uvs,        // Vector2
+    MshStream_packed,     // PackedVertex, always present
+    MshStream_count
+};
+
+struct MshStreamRange {
+    u64 offset;
+    u64 size;
+};
+
+struct MshHeader {
+    // NOTE(jesper): identical to the header of the earlier versions, the
+    // version tells them apart
+    AlcMeshHeader  alc;
+
+    u32            index_count;
+    i32            lod_count;
+    MeshLod        lods[MESH_MAX_LODS];
+
+    Vector3        bounds_min;
+    Vector3        bounds_extent;
+    f32            radius;
+
+    MshStreamRange streams[MshStream_count];
 };
 
 struct TextureData {
@@ -87,6 +182,10 @@ struct TextureData {
     VkFormat format;
     isize    size;
     void     *pixels;
+
+    // NOTE(jesper): number of mip levels stored in pixels, back to back from
+    // the largest, see cook_texture
+    u32      mip_levels;
 };
 
 struct SoundSample {
@@ -99,8 +198,17 @@ struct SoundData {
     i32 sample_rate;
     i32 num_channels;
     i32 bits_per_sample;
+
+    // NOTE(jesper): number of frames, i.e. samples per channel
     i32 num_samples;
+
+    // NOTE(jesper): interleaved PCM, nullptr when the sound is compressed
     i16 *samples;
+
+    // NOTE(jesper): IMA-ADPCM blocks of a compressed sound, decoded by the
+    // mixer as it plays, see adpcm.h
+    u8  *blocks;
+    i32 block_size;
 };
 
 struct TextureAsset {
@@ -136,23 +244,169 @@ struct EntityData {
     Array<String> textures;
 };
 
+#define CATALOG_MAX_LOAD_THREADS  (8)
+#define CATALOG_LOAD_SCRATCH_SIZE (64 * 1024 * 1024)
+
+struct CatalogLoad;
+
+#define CATALOG_LOAD_FUNC(fname) void fname(CatalogLoad *load, Allocator *scratch)
+typedef CATALOG_LOAD_FUNC(catalog_load_t);
+
+#define CATALOG_COMMIT_FUNC(fname) void fname(CatalogLoad *load)
+typedef CATALOG_COMMIT_FUNC(catalog_commit_t);
+
+// NOTE(jesper): load runs on any thread and may only decode into the
+// CatalogLoad, commit runs on the main thread and does the GPU uploads and
+// catalog registration
+struct CatalogLoader {
+    catalog_load_t   *load;
+    catalog_commit_t *commit;
+};
+
+struct CatalogLoad {
+    FilePath      path;
+    CatalogLoader *loader;
+    u32           done;
+
+    // NOTE(jesper): hash of the source content, to skip hot-reloads that
+    // don't change it
+    u64           source_hash;
+
+    // NOTE(jesper): hash of the content a reloaded asset was last loaded
+    // from, the load is skipped and unchanged set if it still matches
+    u64           previous_hash;
+    bool          unchanged;
+
+    // NOTE(jesper): set during a reload batch. The asset is reprocessed from
+    // the catalog when dirty, i.e. when an asset it depends on changed, even
+    // if its own content didn't. Assets without a source file, like the
+    // pipelines, are always unchanged. depth is the longest chain of
+    // dependencies from a changed file, see start_catalog_reloads.
+    AssetID       asset_id = ASSET_INVALID_ID;
+    i32           depth;
+    bool          dirty;
+
+    TextureData texture;
+    Mesh        mesh;
+};
+
+// NOTE(jesper): done is signalled for every finished load when signal_done is
+// set, for the initial load which waits on it. The reload batches poll the
+// loads from the main thread instead.
+struct CatalogLoadQueue {
+    CatalogLoad *loads;
+    u32         count;
+    u32         next;
+    bool        signal_done;
+    Semaphore   done;
+};
+
+// NOTE(jesper): a modified file reported by the catalog thread. Events for
+// the same path are coalesced by the hash of the path.
+struct CatalogEvent {
+    u64      path_hash;
+    FilePath path;
+};
+
+// NOTE(jesper): hot reloads wait until the catalog thread has been quiet for
+// this long, so that an editor writing a burst of files, or the same file
+// several times, turns into a single batch
+#define CATALOG_RELOAD_DEBOUNCE_MS (150)
+
+struct CatalogTextureBinding {
+    PipelineID       pipeline;
+    GfxDescriptorSet descriptor;
+    i32              binding;
+};
+
 struct Catalog {
     Array<FolderPath> folders;
 
     AssetID next_asset_id = 0;
     RHHashMap<StringView, catalog_process_t*> processes;
+    RHHashMap<StringView, CatalogLoader>      loaders;
 
     RHHashMap<StringView, AssetID> assets;
     RHHashMap<AssetID, TextureID>  textures;
     RHHashMap<AssetID, EntityID>   entities;
     RHHashMap<AssetID, MeshID>     meshes;
+    RHHashMap<AssetID, PipelineID> pipelines;
+
+    // NOTE(jesper): the asset dependency graph. dependencies are the assets an
+    // asset is built from, in the order it uses them, e.g. an entity's mesh
+    // and textures, a pipeline's shader, or the fbx a .msh was converted
+    // from. dependents are the reverse edges, which a reload follows to
+    // reprocess everything affected by a change and nothing else.
+    RHHashMap<AssetID, Array<AssetID>> dependencies;
+    RHHashMap<AssetID, Array<AssetID>> dependents;
 
+    // NOTE(jesper): source file of every asset that has one, for reprocessing
+    // it as a dependent
+    RHHashMap<AssetID, FilePath> paths;
+
+    // NOTE(jesper): content hash of every loaded source file, only touched
+    // by the catalog thread once the initial load is done
+    RHHashMap<StringView, u64> source_hashes;
+
+    // NOTE(jesper): written by the catalog thread, swapped out by
+    // process_catalog_system. last_event is in platform_clock_ticks.
     Mutex mutex;
-    Array<FilePath> process_queue;
+    Array<CatalogEvent> process_queue;
+    u64   last_event;
+
+    // NOTE(jesper): the batch of reloads in flight, in topological order,
+    // loaded by worker threads and committed in order by the main thread as
+    // they finish. The loads are started a depth at a time, so an asset is
+    // loaded only after the ones it depends on have been committed.
+    Array<CatalogLoad> reloads;
+    i32 reloads_committed;
+    i32 reloads_started;
+
+    // NOTE(jesper): the load threads stay around once the initial load is
+    // done and wait on reload_wave, which start_reload_wave signals once for
+    // each thread it needs. load_threads is the number of them still working
+    // on the wave, the next one isn't started until they're all done with the
+    // queue they share.
+    i32       load_thread_count;
+    Semaphore reload_wave;
+    u32       load_threads;
+
+    // NOTE(jesper): textures bound to descriptor sets outside of the entities,
+    // e.g. the terrain and font materials, rebound by the catalog when a
+    // reload replaces the texture. The replaced textures are destroyed once
+    // the batch is committed and everything using them has been rebound.
+    RHHashMap<AssetID, Array<CatalogTextureBinding>> texture_bindings;
+    Array<GfxTexture> retired_textures;
 };
 
+void catalog_bind_texture(
+    TextureAsset *texture,
+    PipelineID pipeline,
+    GfxDescriptorSet descriptor,
+    i32 binding);
+
 Mesh* find_mesh(MeshID mesh_id);
 Mesh* find_mesh(StringView name);
+void destroy_mesh_data(Mesh *mesh);
+
+// NOTE(jesper): versions of the processors' output in the derived data cache,
+// bump when the output changes for the same source
+#define TEXTURE_COOK_VERSION (1)
+#define MESH_COOK_VERSION    (2)
+#define FBX_CONVERT_VERSION  (1)
+#define SOUND_COOK_VERSION   (1)
+
+TextureData load_cooked_texture(
+    FilePathView path,
+    Allocator *a,
+    u64 *source_hash = nullptr);
+
+SoundData load_cooked_sound(FilePathView path, Allocator *a);
+
+Mesh load_cooked_mesh(
+    FilePathView path,
+    Allocator *scratch,
+    u64 *source_hash = nullptr);
 
 #define CATALOG_CALLBACK(fname)  void fname(FilePath path)
 typedef CATALOG_CALLBACK(catalog_callback_t);
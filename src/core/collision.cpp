@@ -67,7 +67,12 @@ void init_collision()
         Mesh *mesh = find_mesh("unit_sphere.obj");
         ASSERT(mesh != nullptr);
 
-        g_debug_collision.sphere.vbo = mesh->vbo.points;
+        // NOTE(jesper): the wireframe pipeline reads tightly packed f32
+        // positions, which the mesh's own vertex buffer doesn't have when
+        // LEARY_PACKED_VERTICES is enabled
+        g_debug_collision.sphere.vbo = create_vbo(
+            mesh->points.data,
+            mesh->points.count * sizeof mesh->points[0]);
         g_debug_collision.sphere.ibo = mesh->ibo;
         g_debug_collision.sphere.vertex_count = mesh->element_count;
     }
@@ -96,6 +101,8 @@ void init_collision()
 
 void process_collision()
 {
+    PROFILE_FUNCTION_COUNTERS();
+
     for (auto &c : g_collision.aabbs) {
         c.colliding = false;
     }
@@ -0,0 +1,146 @@
+/**
+ * file:    derived_data.cpp
+ * created: 2018-09-24
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): makes the temporary file names unique between threads writing
+// entries at the same time
+u32 g_derived_data_writes = 0;
+
+u64 derived_data_key(
+    u64 source_hash,
+    StringView name,
+    u32 version,
+    u32 options)
+{
+    struct {
+        u64 source;
+        u64 name;
+        u32 version;
+        u32 options;
+    } key;
+
+    key.source  = source_hash;
+    key.name    = hash64((void*)name.bytes, name.size > 0 ? name.size - 1 : 0);
+    key.version = version;
+    key.options = options;
+
+    return hash64(&key, sizeof key);
+}
+
+FilePath derived_data_path(u64 key, const char *extension, Allocator *a)
+{
+    char name[64];
+    snprintf(name, sizeof name, "cache/%016llx.%s", (unsigned long long)key, extension);
+    return resolve_file_path(GamePath_preferences, name, a);
+}
+
+void* map_derived_data(u64 key, usize *size)
+{
+    FilePath path = derived_data_path(key, "ddc", g_heap);
+    defer { dealloc(g_heap, path.absolute.bytes); };
+
+    usize file_size;
+    u8 *file = (u8*)map_file(path, &file_size);
+    if (file == nullptr) {
+        return nullptr;
+    }
+
+    DerivedDataHeader *header = (DerivedDataHeader*)file;
+    if (file_size < sizeof *header ||
+        header->magic != DERIVED_DATA_MAGIC ||
+        header->version != DERIVED_DATA_VERSION ||
+        header->key != key ||
+        header->size != file_size - sizeof *header)
+    {
+        LOG_ERROR_DEFERRED("invalid derived data: %s", path.absolute.bytes);
+        unmap_file(file, file_size);
+        return nullptr;
+    }
+
+    *size = (usize)header->size;
+    return file + sizeof *header;
+}
+
+void unmap_derived_data(void *data, usize size)
+{
+    unmap_file((u8*)data - sizeof(DerivedDataHeader), size + sizeof(DerivedDataHeader));
+}
+
+void write_derived_data(u64 key, DerivedDataChunk *chunks, i32 count)
+{
+    DerivedDataHeader header = {};
+    header.magic   = DERIVED_DATA_MAGIC;
+    header.version = DERIVED_DATA_VERSION;
+    header.key     = key;
+
+    for (i32 i = 0; i < count; i++) {
+        header.size += chunks[i].size;
+    }
+
+    char extension[16];
+    snprintf(extension, sizeof extension, "tmp%u", atomic_add(&g_derived_data_writes, 1));
+
+    FilePath tmp  = derived_data_path(key, extension, g_heap);
+    FilePath path = derived_data_path(key, "ddc", g_heap);
+    defer {
+        dealloc(g_heap, tmp.absolute.bytes);
+        dealloc(g_heap, path.absolute.bytes);
+    };
+
+    // NOTE(jesper): a temporary file left behind by a crash would otherwise
+    // keep its old tail when opened for writing
+    remove_file(tmp);
+    if (!create_file(tmp, true)) {
+        LOG_ERROR_DEFERRED("couldn't create derived data: %s", tmp.absolute.bytes);
+        return;
+    }
+
+    void *file = open_file(tmp, FileAccess_write);
+    if (file == nullptr) {
+        LOG_ERROR_DEFERRED("couldn't open derived data: %s", tmp.absolute.bytes);
+        return;
+    }
+
+    write_file(file, &header, sizeof header);
+    for (i32 i = 0; i < count; i++) {
+        if (chunks[i].size > 0) {
+            write_file(file, chunks[i].data, chunks[i].size);
+        }
+    }
+    close_file(file);
+
+    if (!rename_file(tmp, path)) {
+        LOG_ERROR_DEFERRED("couldn't rename derived data: %s", tmp.absolute.bytes);
+        remove_file(tmp);
+    }
+}
+
+void write_derived_data(u64 key, std::initializer_list<DerivedDataChunk> chunks)
+{
+    write_derived_data(key, (DerivedDataChunk*)chunks.begin(), (i32)chunks.size());
+}
+
+DerivedDataReader derived_data_reader(void *data, usize size)
+{
+    DerivedDataReader reader;
+    reader.ptr   = (u8*)data;
+    reader.end   = (u8*)data + size;
+    reader.valid = data != nullptr;
+    return reader;
+}
+
+void* derived_data_read(DerivedDataReader *reader, usize size)
+{
+    if (!reader->valid || size > (usize)(reader->end - reader->ptr)) {
+        reader->valid = false;
+        return nullptr;
+    }
+
+    void *result = reader->ptr;
+    reader->ptr += size;
+    return result;
+}
@@ -0,0 +1,102 @@
+/**
+ * file:    derived_data.h
+ * created: 2018-09-24
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): on-disk cache of what the asset processors derive from their
+// sources: cooked textures with their mip chains, welded and optimised meshes,
+// compiled shaders. Entries are stored in the cache/ folder under the
+// preferences folder, one file per entry named after its key.
+//
+// The key is a hash of the source content, the asset's name and the version
+// of the processor, so editing a source or changing a processor misses the
+// old entry instead of invalidating it. Bump a processor's version whenever
+// its output changes for the same input. Nothing is evicted, deleting the
+// folder is always safe.
+
+#define DERIVED_DATA_MAGIC   (0x4344444c) // NOTE(jesper): "LDDC"
+#define DERIVED_DATA_VERSION (2)
+
+// NOTE(jesper): padded so that the payload starts at the same alignment as
+// the assets in a pack, entries that are used straight from the mapping rely
+// on it
+struct DerivedDataHeader {
+    u32 magic;
+    u32 version;
+    u64 key;
+    u64 size;
+    u8  reserved[40];
+};
+
+static_assert(sizeof(DerivedDataHeader) == 64, "payload must stay aligned");
+
+// NOTE(jesper): one contiguous piece of an entry's payload, an entry is
+// written from several of them so that the caller doesn't need to assemble it
+// in memory first
+struct DerivedDataChunk {
+    void  *data;
+    usize size;
+};
+
+// NOTE(jesper): options is for build configuration that changes the output,
+// e.g. LEARY_COMPRESS_TEXTURES for the texture cooker
+u64 derived_data_key(
+    u64 source_hash,
+    StringView name,
+    u32 version,
+    u32 options = 0);
+
+// NOTE(jesper): maps the payload of an entry, returns nullptr if there's no
+// valid entry for the key. Unmap with unmap_derived_data.
+void* map_derived_data(u64 key, usize *size);
+void unmap_derived_data(void *data, usize size);
+
+// NOTE(jesper): safe to call from any thread. The entry is written to a
+// temporary file and renamed in place, so a reader never sees half an entry.
+void write_derived_data(u64 key, DerivedDataChunk *chunks, i32 count);
+void write_derived_data(u64 key, std::initializer_list<DerivedDataChunk> chunks);
+
+// NOTE(jesper): helper for reading the fields of a mapped payload in the order
+// they were written, every read fails once one has run past the end
+struct DerivedDataReader {
+    u8   *ptr;
+    u8   *end;
+    bool valid;
+};
+
+DerivedDataReader derived_data_reader(void *data, usize size);
+void* derived_data_read(DerivedDataReader *reader, usize size);
+
+template<typename T>
+T* derived_data_read(DerivedDataReader *reader, usize count = 1)
+{
+    return (T*)derived_data_read(reader, count * sizeof(T));
+}
+
+// NOTE(jesper): copies count elements from the payload into a new array
+// allocated from a
+template<typename T>
+bool derived_data_read_array(
+    DerivedDataReader *reader,
+    Array<T> *arr,
+    i32 count,
+    Allocator *a)
+{
+    T *data = derived_data_read<T>(reader, (usize)count);
+    if (data == nullptr) {
+        return false;
+    }
+
+    if (count == 0) {
+        init_array(arr, a);
+        return true;
+    }
+
+    init_array(arr, a, count);
+    memcpy(arr->data, data, count * sizeof(T));
+    arr->count = count;
+    return true;
+}
@@ -43,3 +43,65 @@ void resolve_filename_ext(
         };
     }
 }
+
+int cmp_file_path(const void *lhs, const void *rhs)
+{
+    return strcmp(((FilePath*)lhs)->absolute.bytes, ((FilePath*)rhs)->absolute.bytes);
+}
+
+Array<FilePath> create_file_list(
+    StringView folder,
+    char *names,
+    i32 *offsets,
+    i32 count,
+    Allocator *a)
+{
+    Array<FilePath> list = create_array<FilePath>(a);
+    if (count == 0) {
+        return list;
+    }
+
+    i32 folder_length = folder.size - 1;
+    bool eslash = folder_length > 0 &&
+                  (folder.bytes[folder_length-1] == '/' ||
+                   folder.bytes[folder_length-1] == '\\');
+
+    usize strings_size = 0;
+    for (i32 i = 0; i < count; i++) {
+        strings_size += folder_length + (eslash ? 0 : 1) + strlen(names + offsets[i]) + 1;
+    }
+
+    FilePath *files = (FilePath*)alloc(a, count * sizeof(FilePath) + strings_size);
+    char *ptr = (char*)(files + count);
+
+    for (i32 i = 0; i < count; i++) {
+        char *name = names + offsets[i];
+        i32 name_length = (i32)strlen(name);
+
+        FilePath p = {};
+        p.absolute.bytes = ptr;
+
+        memcpy(ptr, folder.bytes, folder_length);
+        ptr += folder_length;
+
+        if (!eslash) {
+            *ptr++ = FILE_SEP[0];
+        }
+
+        memcpy(ptr, name, name_length + 1);
+        ptr += name_length + 1;
+
+        p.absolute.size     = (i32)(ptr - p.absolute.bytes);
+        p.absolute.capacity = p.absolute.size;
+        resolve_filename_ext(p.absolute, &p.filename, &p.extension);
+
+        files[i] = p;
+    }
+
+    qsort(files, (usize)count, sizeof files[0], cmp_file_path);
+
+    list.data     = files;
+    list.count    = count;
+    list.capacity = count;
+    return list;
+}
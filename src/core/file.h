@@ -180,3 +180,19 @@ FilePath resolve_file_path(GamePath rp, const char (&str)[N], Allocator *a)
 {
     return resolve_file_path(rp, StringView{str}, a);
 }
+
+// NOTE(jesper): platform specific implementation. Lists every file in folder
+// and its sub-folders, sorted by path so that the listing is deterministic.
+// The list and its paths are allocated from a as a single block, so
+// destroy_array frees all of it, and it must not be grown.
+Array<FilePath> list_files(FolderPath folder, Allocator *a);
+
+// NOTE(jesper): the platform independent half of list_files, builds the list
+// from count paths relative to folder. The paths are null-terminated and
+// stored in names, starting at offsets.
+Array<FilePath> create_file_list(
+    StringView folder,
+    char *names,
+    i32 *offsets,
+    i32 count,
+    Allocator *a);
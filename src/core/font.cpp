@@ -17,7 +17,7 @@ void init_fonts()
         return;
     }
 
-    u8 *font_data = (u8*)read_file(font_path, &font_size, g_frame);
+    u8 *font_data = (u8*)read_asset(font_path, &font_size, g_frame);
 
     u8 *bitmap = alloc_array(g_frame, u8, 1024*1024);
     stbtt_BakeFontBitmap(font_data, 0, 20.0f, bitmap,
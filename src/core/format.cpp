@@ -0,0 +1,793 @@
+/**
+ * file:    format.cpp
+ * created: 2018-09-19
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+static const char g_format_digits[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const u32 g_format_pow10_u32[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+// NOTE(jesper): normalized 64 bit approximations of 10^k, k = -348, -340, ..., 340
+static const u64 g_format_pow10_f[] = {
+    0xFA8FD5A0081C0288ULL, 0xBAAEE17FA23EBF76ULL, 0x8B16FB203055AC76ULL,
+    0xCF42894A5DCE35EAULL, 0x9A6BB0AA55653B2DULL, 0xE61ACF033D1A45DFULL,
+    0xAB70FE17C79AC6CAULL, 0xFF77B1FCBEBCDC4FULL, 0xBE5691EF416BD60CULL,
+    0x8DD01FAD907FFC3CULL, 0xD3515C2831559A83ULL, 0x9D71AC8FADA6C9B5ULL,
+    0xEA9C227723EE8BCBULL, 0xAECC49914078536DULL, 0x823C12795DB6CE57ULL,
+    0xC21094364DFB5637ULL, 0x9096EA6F3848984FULL, 0xD77485CB25823AC7ULL,
+    0xA086CFCD97BF97F4ULL, 0xEF340A98172AACE5ULL, 0xB23867FB2A35B28EULL,
+    0x84C8D4DFD2C63F3BULL, 0xC5DD44271AD3CDBAULL, 0x936B9FCEBB25C996ULL,
+    0xDBAC6C247D62A584ULL, 0xA3AB66580D5FDAF6ULL, 0xF3E2F893DEC3F126ULL,
+    0xB5B5ADA8AAFF80B8ULL, 0x87625F056C7C4A8BULL, 0xC9BCFF6034C13053ULL,
+    0x964E858C91BA2655ULL, 0xDFF9772470297EBDULL, 0xA6DFBD9FB8E5B88FULL,
+    0xF8A95FCF88747D94ULL, 0xB94470938FA89BCFULL, 0x8A08F0F8BF0F156BULL,
+    0xCDB02555653131B6ULL, 0x993FE2C6D07B7FACULL, 0xE45C10C42A2B3B06ULL,
+    0xAA242499697392D3ULL, 0xFD87B5F28300CA0EULL, 0xBCE5086492111AEBULL,
+    0x8CBCCC096F5088CCULL, 0xD1B71758E219652CULL, 0x9C40000000000000ULL,
+    0xE8D4A51000000000ULL, 0xAD78EBC5AC620000ULL, 0x813F3978F8940984ULL,
+    0xC097CE7BC90715B3ULL, 0x8F7E32CE7BEA5C70ULL, 0xD5D238A4ABE98068ULL,
+    0x9F4F2726179A2245ULL, 0xED63A231D4C4FB27ULL, 0xB0DE65388CC8ADA8ULL,
+    0x83C7088E1AAB65DBULL, 0xC45D1DF942711D9AULL, 0x924D692CA61BE758ULL,
+    0xDA01EE641A708DEAULL, 0xA26DA3999AEF774AULL, 0xF209787BB47D6B85ULL,
+    0xB454E4A179DD1877ULL, 0x865B86925B9BC5C2ULL, 0xC83553C5C8965D3DULL,
+    0x952AB45CFA97A0B3ULL, 0xDE469FBD99A05FE3ULL, 0xA59BC234DB398C25ULL,
+    0xF6C69A72A3989F5CULL, 0xB7DCBF5354E9BECEULL, 0x88FCF317F22241E2ULL,
+    0xCC20CE9BD35C78A5ULL, 0x98165AF37B2153DFULL, 0xE2A0B5DC971F303AULL,
+    0xA8D9D1535CE3B396ULL, 0xFB9B7CD9A4A7443CULL, 0xBB764C4CA7A44410ULL,
+    0x8BAB8EEFB6409C1AULL, 0xD01FEF10A657842CULL, 0x9B10A4E5E9913129ULL,
+    0xE7109BFBA19C0C9DULL, 0xAC2820D9623BF429ULL, 0x80444B5E7AA7CF85ULL,
+    0xBF21E44003ACDD2DULL, 0x8E679C2F5E44FF8FULL, 0xD433179D9C8CB841ULL,
+    0x9E19DB92B4E31BA9ULL, 0xEB96BF6EBADF77D9ULL, 0xAF87023B9BF0EE6BULL,
+};
+
+static const i16 g_format_pow10_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+void format_append(FormatBuffer *out, const char *str, i32 length)
+{
+    i32 bytes = min(length, out->capacity - out->size);
+    if (bytes > 0) {
+        memcpy(out->bytes + out->size, str, (usize)bytes);
+        out->size += bytes;
+    }
+}
+
+void format_fill(FormatBuffer *out, char c, i32 count)
+{
+    i32 bytes = min(count, out->capacity - out->size);
+    if (bytes > 0) {
+        memset(out->bytes + out->size, c, (usize)bytes);
+        out->size += bytes;
+    }
+}
+
+// NOTE(jesper): pads a formatted number to spec.width. Zero padding goes
+// between the sign and the digits
+void format_number(
+    FormatBuffer *out,
+    FormatSpec spec,
+    bool negative,
+    const char *digits,
+    i32 length)
+{
+    i32 padding = max(spec.width - length - (negative ? 1 : 0), 0);
+
+    if (!spec.left && !spec.zero) {
+        format_fill(out, ' ', padding);
+    }
+
+    if (negative) {
+        format_append(out, "-", 1);
+    }
+
+    if (!spec.left && spec.zero) {
+        format_fill(out, '0', padding);
+    }
+
+    format_append(out, digits, length);
+
+    if (spec.left) {
+        format_fill(out, ' ', padding);
+    }
+}
+
+bool format_next(FormatBuffer *out, const char **fmt, FormatSpec *spec)
+{
+    const char *p = *fmt;
+
+    while (*p != '\0') {
+        const char *start = p;
+        while (*p != '\0' && *p != '{' && *p != '}') {
+            p++;
+        }
+        format_append(out, start, (i32)(p - start));
+
+        if (*p == '\0') {
+            break;
+        }
+
+        if (p[0] == p[1]) {
+            format_append(out, p, 1);
+            p += 2;
+            continue;
+        }
+
+        if (*p == '}') {
+            // NOTE(jesper): unmatched }, print it as is
+            format_append(out, p++, 1);
+            continue;
+        }
+
+        p++;
+        *spec = {};
+
+        if (*p == '-') {
+            spec->left = true;
+            p++;
+        }
+
+        if (*p == '0') {
+            spec->zero = true;
+            p++;
+        }
+
+        while (*p >= '0' && *p <= '9') {
+            spec->width = spec->width * 10 + (*p++ - '0');
+        }
+
+        if (*p == '.') {
+            p++;
+            spec->precision = 0;
+            while (*p >= '0' && *p <= '9') {
+                spec->precision = spec->precision * 10 + (*p++ - '0');
+            }
+        }
+
+        if (*p == 'x' || *p == 'X') {
+            spec->hex   = true;
+            spec->upper = *p == 'X';
+            p++;
+        }
+
+        while (*p != '\0' && *p != '}') {
+            p++;
+        }
+
+        if (*p == '}') {
+            p++;
+        }
+
+        *fmt = p;
+        return true;
+    }
+
+    *fmt = p;
+    return false;
+}
+
+void format_tail(FormatBuffer *out, const char *fmt)
+{
+    FormatSpec spec;
+    while (format_next(out, &fmt, &spec)) {
+        format_append(out, "<missing>", 9);
+    }
+}
+
+i32 format_digits_u64(char *end, u64 value)
+{
+    char *p = end;
+
+    while (value >= 100) {
+        u64 i = (value % 100) * 2;
+        value /= 100;
+
+        p -= 2;
+        p[0] = g_format_digits[i];
+        p[1] = g_format_digits[i + 1];
+    }
+
+    if (value >= 10) {
+        u64 i = value * 2;
+        p -= 2;
+        p[0] = g_format_digits[i];
+        p[1] = g_format_digits[i + 1];
+    } else {
+        *--p = (char)('0' + value);
+    }
+
+    return (i32)(end - p);
+}
+
+void format_u64(FormatBuffer *out, FormatSpec spec, u64 value, bool negative)
+{
+    char buffer[24];
+    char *end = buffer + sizeof buffer;
+    i32 length;
+
+    if (spec.hex) {
+        const char *hex = spec.upper ? "0123456789ABCDEF" : "0123456789abcdef";
+
+        char *p = end;
+        do {
+            *--p = hex[value & 0xF];
+            value >>= 4;
+        } while (value != 0);
+
+        length = (i32)(end - p);
+    } else {
+        length = format_digits_u64(end, value);
+    }
+
+    format_number(out, spec, negative, end - length, length);
+}
+
+void format_string(FormatBuffer *out, FormatSpec spec, const char *str, i32 length)
+{
+    if (spec.precision >= 0) {
+        length = min(length, spec.precision);
+    }
+
+    i32 padding = max(spec.width - length, 0);
+
+    if (!spec.left) {
+        format_fill(out, ' ', padding);
+    }
+
+    format_append(out, str, length);
+
+    if (spec.left) {
+        format_fill(out, ' ', padding);
+    }
+}
+
+void format_pointer(FormatBuffer *out, FormatSpec spec, uptr value)
+{
+    char buffer[24];
+    FormatBuffer tmp = { buffer, 2, sizeof buffer };
+    buffer[0] = '0';
+    buffer[1] = 'x';
+
+    FormatSpec hex = {};
+    hex.hex = true;
+    format_u64(&tmp, hex, (u64)value, false);
+
+    format_string(out, spec, buffer, tmp.size);
+}
+
+// NOTE(jesper): Grisu2 by Florian Loitsch, "Printing Floating-Point Numbers
+// Quickly and Accurately with Integers". Produces the shortest digits that
+// round-trip for all but a tiny fraction of inputs, where it produces one
+// digit too many but is still correct
+struct FormatFp {
+    u64 f;
+    i32 e;
+};
+
+FormatFp format_fp_mul(FormatFp a, FormatFp b)
+{
+    const u64 M32 = 0xFFFFFFFF;
+
+    u64 a_hi = a.f >> 32, a_lo = a.f & M32;
+    u64 b_hi = b.f >> 32, b_lo = b.f & M32;
+
+    u64 hh = a_hi * b_hi;
+    u64 lh = a_lo * b_hi;
+    u64 hl = a_hi * b_lo;
+    u64 ll = a_lo * b_lo;
+
+    u64 tmp = (ll >> 32) + (hl & M32) + (lh & M32);
+    tmp += 1u << 31;
+
+    return FormatFp{ hh + (hl >> 32) + (lh >> 32) + (tmp >> 32), a.e + b.e + 64 };
+}
+
+FormatFp format_fp_normalize(FormatFp fp)
+{
+    while ((fp.f & (1ull << 63)) == 0) {
+        fp.f <<= 1;
+        fp.e--;
+    }
+
+    return fp;
+}
+
+void format_grisu_round(
+    char *digits,
+    i32 length,
+    u64 delta,
+    u64 rest,
+    u64 ten_kappa,
+    u64 wp_w)
+{
+    while (rest < wp_w &&
+           delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+    {
+        digits[length - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+i32 format_grisu_digits(FormatFp w, FormatFp mp, u64 delta, char *digits, i32 *k)
+{
+    FormatFp one = { 1ull << -mp.e, mp.e };
+    u64 wp_w = mp.f - w.f;
+
+    u32 p1 = (u32)(mp.f >> -one.e);
+    u64 p2 = mp.f & (one.f - 1);
+
+    i32 kappa = 1;
+    while (kappa < 10 && p1 >= g_format_pow10_u32[kappa]) {
+        kappa++;
+    }
+
+    i32 length = 0;
+    while (kappa > 0) {
+        u32 pow10 = g_format_pow10_u32[kappa - 1];
+        u32 d = p1 / pow10;
+        p1 %= pow10;
+
+        if (d != 0 || length != 0) {
+            digits[length++] = (char)('0' + d);
+        }
+
+        kappa--;
+
+        u64 rest = ((u64)p1 << -one.e) + p2;
+        if (rest <= delta) {
+            *k += kappa;
+            format_grisu_round(
+                digits, length, delta, rest,
+                (u64)g_format_pow10_u32[kappa] << -one.e,
+                wp_w);
+            return length;
+        }
+    }
+
+    for (;;) {
+        p2    *= 10;
+        delta *= 10;
+
+        char d = (char)(p2 >> -one.e);
+        if (d != 0 || length != 0) {
+            digits[length++] = (char)('0' + d);
+        }
+
+        p2 &= one.f - 1;
+        kappa--;
+
+        if (p2 < delta) {
+            *k += kappa;
+            u64 scale = -kappa < 10 ? g_format_pow10_u32[-kappa] : 0;
+            format_grisu_round(digits, length, delta, p2, one.f, wp_w * scale);
+            return length;
+        }
+    }
+}
+
+// NOTE(jesper): significand and exponent of the value, and the boundaries
+// halfway to its neighbours, for a float with significand_bits explicit bits
+i32 format_grisu(
+    u64 significand,
+    i32 exponent,
+    i32 significand_bits,
+    i32 exponent_bias,
+    char *digits,
+    i32 *k)
+{
+    u64 hidden_bit = 1ull << significand_bits;
+
+    FormatFp v;
+    if (exponent != 0) {
+        v.f = significand | hidden_bit;
+        v.e = exponent - exponent_bias;
+    } else {
+        v.f = significand;
+        v.e = 1 - exponent_bias;
+    }
+
+    FormatFp plus = format_fp_normalize(FormatFp{ (v.f << 1) + 1, v.e - 1 });
+
+    FormatFp minus;
+    if (v.f == hidden_bit) {
+        minus = FormatFp{ (v.f << 2) - 1, v.e - 2 };
+    } else {
+        minus = FormatFp{ (v.f << 1) - 1, v.e - 1 };
+    }
+    minus.f <<= minus.e - plus.e;
+    minus.e   = plus.e;
+
+    // NOTE(jesper): find a cached power of ten that brings the exponent of
+    // the scaled boundary into [-60, -32]
+    f64 dk = (-61 - plus.e) * 0.30102999566398114 + 347;
+    i32 ik = (i32)dk;
+    if (dk - ik > 0.0) {
+        ik++;
+    }
+
+    i32 index = (ik >> 3) + 1;
+    *k = -(-348 + index * 8);
+
+    FormatFp c_mk = { g_format_pow10_f[index], g_format_pow10_e[index] };
+
+    FormatFp w  = format_fp_mul(format_fp_normalize(v), c_mk);
+    FormatFp wp = format_fp_mul(plus, c_mk);
+    FormatFp wm = format_fp_mul(minus, c_mk);
+
+    wm.f++;
+    wp.f--;
+
+    return format_grisu_digits(w, wp, wp.f - wm.f, digits, k);
+}
+
+// NOTE(jesper): little-endian base 2^32 integer, large enough for the largest
+// f64 scaled by 10^64. Only what the exact fixed notation needs.
+#define FORMAT_BIG_LIMBS (48)
+
+struct FormatBig {
+    u32 limbs[FORMAT_BIG_LIMBS];
+    i32 count;
+};
+
+void format_big_mul(FormatBig *b, u32 m)
+{
+    u64 carry = 0;
+    for (i32 i = 0; i < b->count; i++) {
+        u64 v = (u64)b->limbs[i] * m + carry;
+        b->limbs[i] = (u32)v;
+        carry = v >> 32;
+    }
+
+    if (carry != 0) {
+        ASSERT(b->count < FORMAT_BIG_LIMBS);
+        b->limbs[b->count++] = (u32)carry;
+    }
+}
+
+void format_big_shl(FormatBig *b, i32 shift)
+{
+    i32 words = shift / 32;
+    i32 bits  = shift % 32;
+    ASSERT(b->count + words + 1 <= FORMAT_BIG_LIMBS);
+
+    b->limbs[b->count] = 0;
+    for (i32 i = b->count; i >= 0; i--) {
+        u32 lo = bits != 0 && i > 0 ? b->limbs[i-1] >> (32 - bits) : 0;
+        b->limbs[i + words] = (b->limbs[i] << bits) | lo;
+    }
+
+    for (i32 i = 0; i < words; i++) {
+        b->limbs[i] = 0;
+    }
+
+    b->count += words + 1;
+    while (b->count > 0 && b->limbs[b->count-1] == 0) {
+        b->count--;
+    }
+}
+
+bool format_big_bit(FormatBig *b, i32 bit)
+{
+    i32 word = bit / 32;
+    return word < b->count && ((b->limbs[word] >> (bit % 32)) & 1) != 0;
+}
+
+// NOTE(jesper): shifts right and returns how the bits shifted out compare to
+// half of the last bit kept, -1 below, 0 exactly half, 1 above
+i32 format_big_shr(FormatBig *b, i32 shift)
+{
+    bool half   = format_big_bit(b, shift - 1);
+    bool sticky = false;
+
+    i32 below = shift - 1;
+    for (i32 i = 0; i < below / 32 && i < b->count; i++) {
+        sticky = sticky || b->limbs[i] != 0;
+    }
+
+    if (below % 32 != 0 && below / 32 < b->count) {
+        sticky = sticky || (b->limbs[below / 32] & ((1u << (below % 32)) - 1)) != 0;
+    }
+
+    i32 words = shift / 32;
+    i32 bits  = shift % 32;
+    i32 count = max(b->count - words, 0);
+    for (i32 i = 0; i < count; i++) {
+        u32 hi = bits != 0 && i + words + 1 < b->count ? b->limbs[i + words + 1] << (32 - bits) : 0;
+        b->limbs[i] = (b->limbs[i + words] >> bits) | hi;
+    }
+
+    b->count = count;
+    while (b->count > 0 && b->limbs[b->count-1] == 0) {
+        b->count--;
+    }
+
+    if (!half) {
+        return -1;
+    }
+    return sticky ? 1 : 0;
+}
+
+u32 format_big_divmod(FormatBig *b, u32 d)
+{
+    u64 rem = 0;
+    for (i32 i = b->count - 1; i >= 0; i--) {
+        u64 v = (rem << 32) | b->limbs[i];
+        b->limbs[i] = (u32)(v / d);
+        rem = v % d;
+    }
+
+    while (b->count > 0 && b->limbs[b->count-1] == 0) {
+        b->count--;
+    }
+
+    return (u32)rem;
+}
+
+// NOTE(jesper): writes f * 2^e with precision decimals in fixed notation. The
+// shortest digits can't be used for this, rounding them again would round
+// twice, so the value is scaled by 10^precision exactly and rounded once, to
+// nearest with ties to even like printf does.
+i32 format_fixed(char *out, u64 f, i32 e, i32 precision)
+{
+    FormatBig b = {};
+    b.limbs[0] = (u32)f;
+    b.limbs[1] = (u32)(f >> 32);
+    b.count    = b.limbs[1] != 0 ? 2 : (b.limbs[0] != 0 ? 1 : 0);
+
+    for (i32 i = 0; i < precision; i += 9) {
+        format_big_mul(&b, g_format_pow10_u32[min(precision - i, 9)]);
+    }
+
+    if (e > 0) {
+        format_big_shl(&b, e);
+    } else if (e < 0) {
+        i32 rest = format_big_shr(&b, -e);
+        if (rest > 0 || (rest == 0 && format_big_bit(&b, 0))) {
+            u64 carry = 1;
+            for (i32 i = 0; i < b.count && carry != 0; i++) {
+                u64 v = (u64)b.limbs[i] + carry;
+                b.limbs[i] = (u32)v;
+                carry = v >> 32;
+            }
+
+            if (carry != 0) {
+                b.limbs[b.count++] = (u32)carry;
+            }
+        }
+    }
+
+    // NOTE(jesper): digits of the scaled value, least significant first, 9 at
+    // a time, padded so that there's at least one digit before the point
+    char digits[400];
+    i32 length = 0;
+    do {
+        u32 chunk = format_big_divmod(&b, 1000000000);
+        for (i32 i = 0; i < 9; i++) {
+            digits[length++] = (char)('0' + chunk % 10);
+            chunk /= 10;
+        }
+    } while (b.count > 0);
+
+    while (length > precision + 1 && digits[length-1] == '0') {
+        length--;
+    }
+
+    while (length < precision + 1) {
+        digits[length++] = '0';
+    }
+
+    char *p = out;
+    for (i32 i = length - 1; i >= 0; i--) {
+        *p++ = digits[i];
+        if (i == precision && precision > 0) {
+            *p++ = '.';
+        }
+    }
+
+    return (i32)(p - out);
+}
+
+// NOTE(jesper): shortest notation for the digits, plain decimal for
+// exponents in [-6, 21) and scientific notation otherwise
+i32 format_shortest(char *out, char *digits, i32 length, i32 point)
+{
+    char *p = out;
+
+    if (point > 0 && point <= 21) {
+        for (i32 i = 0; i < point; i++) {
+            *p++ = i < length ? digits[i] : '0';
+        }
+
+        if (length > point) {
+            *p++ = '.';
+            memcpy(p, digits + point, (usize)(length - point));
+            p += length - point;
+        }
+    } else if (point <= 0 && point > -6) {
+        *p++ = '0';
+        *p++ = '.';
+        for (i32 i = point; i < 0; i++) {
+            *p++ = '0';
+        }
+
+        memcpy(p, digits, (usize)length);
+        p += length;
+    } else {
+        *p++ = digits[0];
+        if (length > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, (usize)(length - 1));
+            p += length - 1;
+        }
+
+        i32 exponent = point - 1;
+        *p++ = 'e';
+        if (exponent < 0) {
+            *p++ = '-';
+            exponent = -exponent;
+        }
+
+        char buffer[8];
+        i32 n = format_digits_u64(buffer + sizeof buffer, (u64)exponent);
+        memcpy(p, buffer + sizeof buffer - n, (usize)n);
+        p += n;
+    }
+
+    return (i32)(p - out);
+}
+
+void format_float(
+    FormatBuffer *out,
+    FormatSpec spec,
+    bool negative,
+    u64 significand,
+    i32 exponent,
+    i32 significand_bits,
+    i32 exponent_bias,
+    i32 max_exponent)
+{
+    if (exponent == max_exponent) {
+        const char *str = significand != 0 ? "nan" : "inf";
+        spec.zero = false;
+        format_number(out, spec, negative && significand == 0, str, 3);
+        return;
+    }
+
+    // NOTE(jesper): up to 309 digits before the point and the requested
+    // decimals in fixed notation
+    char digits[32];
+    char buffer[512];
+
+    if (spec.precision >= 0) {
+        u64 f = significand;
+        i32 e = 1 - exponent_bias;
+        if (exponent != 0) {
+            f |= 1ull << significand_bits;
+            e = exponent - exponent_bias;
+        }
+
+        i32 bytes = format_fixed(buffer, f, e, min(spec.precision, 64));
+        format_number(out, spec, negative, buffer, bytes);
+        return;
+    }
+
+    i32 length, k = 0;
+    if (significand == 0 && exponent == 0) {
+        digits[0] = '0';
+        length = 1;
+    } else {
+        length = format_grisu(
+            significand, exponent,
+            significand_bits, exponent_bias,
+            digits, &k);
+    }
+
+    i32 point = length + k;
+    i32 bytes = format_shortest(buffer, digits, length, point);
+
+    format_number(out, spec, negative, buffer, bytes);
+}
+
+void format_f64(FormatBuffer *out, FormatSpec spec, f64 value)
+{
+    u64 bits;
+    memcpy(&bits, &value, sizeof bits);
+
+    format_float(
+        out, spec,
+        (bits >> 63) != 0,
+        bits & ((1ull << 52) - 1),
+        (i32)((bits >> 52) & 0x7FF),
+        52, 1075, 0x7FF);
+}
+
+void format_f32(FormatBuffer *out, FormatSpec spec, f32 value)
+{
+    u32 bits;
+    memcpy(&bits, &value, sizeof bits);
+
+    format_float(
+        out, spec,
+        (bits >> 31) != 0,
+        bits & ((1u << 23) - 1),
+        (i32)((bits >> 23) & 0xFF),
+        23, 150, 0xFF);
+}
+
+void format_arg(FormatBuffer *out, FormatSpec spec, bool value)
+{
+    if (value) {
+        format_string(out, spec, "true", 4);
+    } else {
+        format_string(out, spec, "false", 5);
+    }
+}
+
+void format_arg(FormatBuffer *out, FormatSpec spec, char value)
+{
+    format_string(out, spec, &value, 1);
+}
+
+void format_arg(FormatBuffer *out, FormatSpec spec, f32 value)
+{
+    format_f32(out, spec, value);
+}
+
+void format_arg(FormatBuffer *out, FormatSpec spec, f64 value)
+{
+    format_f64(out, spec, value);
+}
+
+void format_arg(FormatBuffer *out, FormatSpec spec, const char *value)
+{
+    if (value == nullptr) {
+        value = "(null)";
+    }
+
+    format_string(out, spec, value, (i32)strlen(value));
+}
+
+void format_arg(FormatBuffer *out, FormatSpec spec, char *value)
+{
+    format_arg(out, spec, (const char*)value);
+}
+
+void format_arg(FormatBuffer *out, FormatSpec spec, StringView value)
+{
+    // NOTE(jesper): size may include the terminating '\0'
+    i32 length = value.size;
+    if (length > 0 && value.bytes[length-1] == '\0') {
+        length--;
+    }
+
+    format_string(out, spec, value.bytes, length);
+}
+
+void format_arg(FormatBuffer *out, FormatSpec spec, String value)
+{
+    format_arg(out, spec, StringView(value));
+}
@@ -0,0 +1,102 @@
+/**
+ * file:    format.h
+ * created: 2018-09-19
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): type-safe replacement for snprintf. Arguments are substituted
+// for {} in the format string, the type of the argument decides how it's
+// printed so there's no need for length modifiers or PRIu64. An optional spec
+// goes between the braces:
+//     {-8}   left-align, width 8
+//     {08}   zero-pad, width 8
+//     {.3}   3 decimals for floating point
+//     {6.2}  width 6, 2 decimals
+//     {x}    hex for integers, {X} for upper-case hex
+// Floating point without a precision is printed with the shortest digits that
+// round-trip to the same f32/f64, with a precision it's rounded the same way
+// as %.Nf. Nothing is allocated and the output doesn't depend on the locale.
+// {{ and }} print a single brace.
+//
+// The output is always null-terminated and truncated to fit, format returns
+// the number of characters written excluding the terminating '\0'.
+
+struct FormatSpec {
+    i32  width     = 0;
+    i32  precision = -1;
+    bool left      = false;
+    bool zero      = false;
+    bool hex       = false;
+    bool upper     = false;
+};
+
+struct FormatBuffer {
+    char *bytes;
+    i32  size;
+    i32  capacity;
+};
+
+bool format_next(FormatBuffer *out, const char **fmt, FormatSpec *spec);
+void format_tail(FormatBuffer *out, const char *fmt);
+
+void format_u64(FormatBuffer *out, FormatSpec spec, u64 value, bool negative);
+void format_f64(FormatBuffer *out, FormatSpec spec, f64 value);
+void format_f32(FormatBuffer *out, FormatSpec spec, f32 value);
+void format_string(FormatBuffer *out, FormatSpec spec, const char *str, i32 length);
+void format_pointer(FormatBuffer *out, FormatSpec spec, uptr value);
+
+void format_arg(FormatBuffer *out, FormatSpec spec, bool value);
+void format_arg(FormatBuffer *out, FormatSpec spec, char value);
+void format_arg(FormatBuffer *out, FormatSpec spec, f32 value);
+void format_arg(FormatBuffer *out, FormatSpec spec, f64 value);
+void format_arg(FormatBuffer *out, FormatSpec spec, const char *value);
+void format_arg(FormatBuffer *out, FormatSpec spec, char *value);
+void format_arg(FormatBuffer *out, FormatSpec spec, StringView value);
+void format_arg(FormatBuffer *out, FormatSpec spec, String value);
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+format_arg(FormatBuffer *out, FormatSpec spec, T value)
+{
+    if ((std::is_signed<T>::value || std::is_enum<T>::value) && (i64)value < 0) {
+        format_u64(out, spec, 0 - (u64)(i64)value, true);
+    } else {
+        format_u64(out, spec, (u64)value, false);
+    }
+}
+
+template<typename T>
+typename std::enable_if<std::is_pointer<T>::value>::type
+format_arg(FormatBuffer *out, FormatSpec spec, T value)
+{
+    format_pointer(out, spec, (uptr)value);
+}
+
+inline void format_args(FormatBuffer *, const char **)
+{
+}
+
+template<typename T, typename... Args>
+void format_args(FormatBuffer *out, const char **fmt, T first, Args... rest)
+{
+    FormatSpec spec;
+    if (format_next(out, fmt, &spec)) {
+        format_arg(out, spec, first);
+        format_args(out, fmt, rest...);
+    }
+}
+
+template<typename... Args>
+i32 format(char *buffer, i32 size, const char *fmt, Args... args)
+{
+    ASSERT(size > 0);
+
+    FormatBuffer out = { buffer, 0, size - 1 };
+    format_args(&out, &fmt, args...);
+    format_tail(&out, fmt);
+
+    buffer[out.size] = '\0';
+    return out.size;
+}
@@ -14,6 +14,8 @@ Array<VulkanBuffer> g_buffers;
 
 extern Settings g_settings;
 
+u32 g_gfx_frame_site = profiler_register_site("gpu_frame", __FILE__, __LINE__);
+
 static const char*
 spv_binary_name(EShLanguage stage)
 {
@@ -163,7 +165,8 @@ debug_callback_func(VkFlags flags,
         break;
     }
 
-    LOG(channel,
+    LOG_DEFERRED(
+        channel,
         "[Vulkan:%s] [%s:%d] - %s",
         layer,
         object_str,
@@ -777,6 +780,10 @@ bool load_shader(char *src, i32 size, glslang::TShader *shader)
         return false;
     }
 
+#if LEARY_PACKED_VERTICES
+    preamble += "#define PACKED_VERTICES\n";
+#endif
+
     shader->setStringsWithLengths(&src, &size, 1);
     shader->setPreamble(preamble.c_str());
     shader->setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, 100);
@@ -795,64 +802,45 @@ bool load_shader(char *src, i32 size, glslang::TShader *shader)
     return shader->parse(&resources, 100, false, (EShMessages)0xffffff);
 }
 
-void create_pipeline(PipelineID id)
-{
-    void *sp = g_stack->sp;
-    defer { reset(g_stack, sp); };
+// NOTE(jesper): bump when compile_shader's output changes for the same source
+#define SHADER_COMPILE_VERSION (1)
 
-    VkResult result;
-
-    VulkanPipeline pipeline = g_vulkan->pipelines[id];
-    pipeline.id = id;
-
-    StringView shader_name;
-    switch (id) {
-    case Pipeline_font:
-        shader_name = "font.glsl";
-        break;
-    case Pipeline_basic2d:
-        shader_name = "basic2d.glsl";
-        break;
-    case Pipeline_gui_basic:
-        shader_name = "gui_basic.glsl";
-        break;
-    case Pipeline_terrain:
-        shader_name = "terrain.glsl";
-        break;
-    case Pipeline_mesh:
-        shader_name = "mesh.glsl";
-        break;
-    case Pipeline_line:
-        shader_name = "line.glsl";
-        break;
-    case Pipeline_wireframe:
-    case Pipeline_wireframe_lines:
-        shader_name = "wireframe.glsl";
-        break;
-    default: break;
-    }
-
-    FilePath shader_path = resolve_file_path(GamePath_shaders, shader_name, g_frame);
+// NOTE(jesper): the SPIR-V and reflected descriptor layout of a pipeline's
+// shaders, everything create_pipeline needs from glslang
+struct ShaderBinary {
+    Array<u32>                          spirv[ShaderStage_max];
+    Array<VkDescriptorSetLayoutBinding> sampler_bindings;
+    Array<VkDescriptorSetLayoutBinding> uniform_bindings;
+    Array<VkPushConstantRange>          push_constants;
+};
 
-    usize size;
-    char *src = read_file(shader_path, &size, g_frame);
+// NOTE(jesper): derived data layout of a ShaderBinary, followed by the arrays
+// in the order they're declared
+struct CompiledShaderHeader {
+    i32 spirv_count[ShaderStage_max];
+    i32 sampler_binding_count;
+    i32 uniform_binding_count;
+    i32 push_constant_count;
+};
 
+bool compile_shader(ShaderBinary *binary, char *src, i32 size, Allocator *a)
+{
     glslang::TProgram program;
     glslang::TShader vtx(EShLangVertex);
     glslang::TShader frag(EShLangFragment);
 
-    if (load_shader(src, (i32)size, &vtx) == false) {
+    if (load_shader(src, size, &vtx) == false) {
         LOG_ERROR("failed parsing glsl vertex shader: %s, %s",
                   vtx.getInfoLog(),
                   vtx.getInfoDebugLog());
-        return;
+        return false;
     }
 
-    if (load_shader(src, (i32)size, &frag) == false) {
+    if (load_shader(src, size, &frag) == false) {
         LOG_ERROR("failed parsing glsl fragment shader: %s, %s",
-                  vtx.getInfoLog(),
-                  vtx.getInfoDebugLog());
-        return;
+                  frag.getInfoLog(),
+                  frag.getInfoDebugLog());
+        return false;
     }
 
     program.addShader(&vtx);
@@ -862,6 +850,7 @@ void create_pipeline(PipelineID id)
         const char* info_log = program.getInfoLog();
         const char* debug_info_log = program.getInfoDebugLog();
         LOG_ERROR("failed linking glsl %s, %s", info_log, debug_info_log);
+        return false;
     }
 
     glslang::SpvOptions spvOptions;
@@ -886,136 +875,256 @@ void create_pipeline(PipelineID id)
 
             glslang::OutputSpvBin(spirv, ext);
 
-            VulkanShader shader = {};
-
+            Array<u32> *dst = nullptr;
             switch (stage) {
             case EShLangVertex:
-                shader.stage = VK_SHADER_STAGE_VERTEX_BIT;
+                dst = &binary->spirv[ShaderStage_vertex];
                 break;
             case EShLangFragment:
-                shader.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+                dst = &binary->spirv[ShaderStage_fragment];
                 break;
             }
 
-            VkShaderModuleCreateInfo info = {};
-            info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-            info.codeSize = spirv.size() * sizeof spirv[0];
-            info.pCode    = spirv.data();
-
-            result = vkCreateShaderModule(
-                g_vulkan->handle, &info,
-                nullptr,
-                &shader.module);
-            ASSERT(result == VK_SUCCESS);
-
-            switch (stage) {
-            case EShLangVertex:
-                pipeline.shaders[ShaderStage_vertex] = shader;
-                break;
-            case EShLangFragment:
-                pipeline.shaders[ShaderStage_fragment] = shader;
-                break;
+            if (dst != nullptr) {
+                init_array(dst, a, (i32)spirv.size());
+                memcpy(dst->data, spirv.data(), spirv.size() * sizeof spirv[0]);
+                dst->count = (i32)spirv.size();
             }
         }
     }
 
-    if (pipeline.handle == VK_NULL_HANDLE) {
-        Array<VkDescriptorSetLayoutBinding> sampler_bindings;
-        Array<VkDescriptorSetLayoutBinding> uniform_bindings;
-        Array<VkPushConstantRange> push_constants;
+    init_array(&binary->sampler_bindings, a);
+    init_array(&binary->uniform_bindings, a);
+    init_array(&binary->push_constants, a);
 
-        init_array(&sampler_bindings, g_stack);
-        init_array(&uniform_bindings, g_stack);
-        init_array(&push_constants, g_stack);
+    program.buildReflection();
+    i32 num_uniforms = program.getNumLiveUniformVariables();
+    i32 num_uniform_blocks = program.getNumLiveUniformBlocks();
 
-        program.buildReflection();
-        i32 num_uniforms = program.getNumLiveUniformVariables();
-        i32 num_uniform_blocks = program.getNumLiveUniformBlocks();
+    i32 sampler_binding = 1;
+    i32 uniform_binding = 0;
 
-        i32 sampler_binding = 1;
-        i32 uniform_binding = 0;
+    for (i32  i = 0; i < num_uniforms; i++) {
+        const char *name = program.getUniformName(i);
+        const glslang::TType *type = program.getUniformTType(i);
 
-        for (i32  i = 0; i < num_uniforms; i++) {
-            const char *name = program.getUniformName(i);
-            const glslang::TType *type = program.getUniformTType(i);
+        EShLanguageMask stages = program.getUniformStages(i);
+        VkShaderStageFlags vk_stages = 0;
 
-            EShLanguageMask stages = program.getUniformStages(i);
-            VkShaderStageFlags vk_stages = 0;
+        if (stages & EShLangVertexMask) {
+            vk_stages |= VK_SHADER_STAGE_VERTEX_BIT;
+        }
 
-            if (stages & EShLangVertexMask) {
-                vk_stages |= VK_SHADER_STAGE_VERTEX_BIT;
-            }
+        if (stages & EShLangFragmentMask) {
+            vk_stages |= VK_SHADER_STAGE_FRAGMENT_BIT;
+        }
+
+        const glslang::TQualifier &qualifier = type->getQualifier();
+
+        switch (type->getBasicType()) {
+        case glslang::EbtSampler: {
+            VkDescriptorSetLayoutBinding binding = {};
+            binding.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            binding.descriptorCount = 1;
+            binding.stageFlags      = vk_stages;
 
-            if (stages & EShLangFragmentMask) {
-                vk_stages |= VK_SHADER_STAGE_FRAGMENT_BIT;
+            if (qualifier.hasBinding()) {
+                binding.binding = qualifier.layoutBinding;
+                sampler_binding = binding.binding + 1;
+            } else {
+                binding.binding = sampler_binding++;
             }
 
-            const glslang::TQualifier &qualifier = type->getQualifier();
+            array_add(&binary->sampler_bindings, binding);
+        } break;
+        default: break;
+        }
+
+        LOG_INFO_DEFERRED("uniform: %s", name);
+    }
+
+    for (i32  i = 0; i < num_uniform_blocks; i++) {
+        const glslang::TType *type = program.getUniformBlockTType(i);
 
-            switch (type->getBasicType()) {
-            case glslang::EbtSampler: {
+        EShLanguageMask stages = program.getUniformStages(i);
+        VkShaderStageFlags vk_stages = 0;
+
+        if (stages & EShLangVertexMask) {
+            vk_stages |= VK_SHADER_STAGE_VERTEX_BIT;
+        }
+
+        if (stages & EShLangFragmentMask) {
+            vk_stages |= VK_SHADER_STAGE_FRAGMENT_BIT;
+        }
+
+        const glslang::TQualifier &qualifier = type->getQualifier();
+        if (qualifier.storage == glslang::EvqUniform) {
+            if (qualifier.layoutPushConstant == false) {
                 VkDescriptorSetLayoutBinding binding = {};
-                binding.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                binding.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
                 binding.descriptorCount = 1;
                 binding.stageFlags      = vk_stages;
 
                 if (qualifier.hasBinding()) {
                     binding.binding = qualifier.layoutBinding;
-                    sampler_binding = binding.binding + 1;
+                    uniform_binding = binding.binding + 1;
                 } else {
-                    binding.binding = sampler_binding++;
+                    binding.binding = uniform_binding++;
                 }
 
-                array_add(&sampler_bindings, binding);
-            } break;
-            default: break;
+                array_add(&binary->uniform_bindings, binding);
+            } else {
+                VkPushConstantRange pc = {};
+                pc.stageFlags = vk_stages;
+                // TODO(jesper): can we have several push constants with
+                // offsets?
+                pc.offset     = 0;
+                pc.size       = program.getUniformBlockSize(i);
+                array_add(&binary->push_constants, pc);
             }
+        }
+    }
 
-            LOG_INFO("uniform: %s", name);
+    return true;
+}
+
+// NOTE(jesper): loads the compiled shader from the derived data cache, or
+// compiles it with glslang and stores the result in the cache. The preamble
+// depends on LEARY_PACKED_VERTICES, so it's part of the key.
+bool load_shader_binary(ShaderBinary *binary, StringView shader_name, Allocator *a)
+{
+    FilePath shader_path = resolve_file_path(GamePath_shaders, shader_name, g_frame);
+
+    usize size;
+    char *src = read_asset(shader_path, &size, g_frame);
+    if (src == nullptr) {
+        LOG_ERROR("unable to read file: %s", shader_path.absolute.bytes);
+        return false;
+    }
+
+    u64 key = derived_data_key(
+        hash64(src, size),
+        shader_name,
+        SHADER_COMPILE_VERSION,
+        LEARY_PACKED_VERTICES);
+
+    usize cached_size;
+    void *cached = map_derived_data(key, &cached_size);
+    if (cached != nullptr) {
+        defer { unmap_derived_data(cached, cached_size); };
+
+        DerivedDataReader reader = derived_data_reader(cached, cached_size);
+        CompiledShaderHeader *header = derived_data_read<CompiledShaderHeader>(&reader);
+
+        if (header != nullptr &&
+            derived_data_read_array(&reader, &binary->spirv[ShaderStage_vertex],   header->spirv_count[ShaderStage_vertex],   a) &&
+            derived_data_read_array(&reader, &binary->spirv[ShaderStage_fragment], header->spirv_count[ShaderStage_fragment], a) &&
+            derived_data_read_array(&reader, &binary->sampler_bindings, header->sampler_binding_count, a) &&
+            derived_data_read_array(&reader, &binary->uniform_bindings, header->uniform_binding_count, a) &&
+            derived_data_read_array(&reader, &binary->push_constants,   header->push_constant_count,   a))
+        {
+            return true;
         }
 
-        for (i32  i = 0; i < num_uniform_blocks; i++) {
-            const glslang::TType *type = program.getUniformBlockTType(i);
+        *binary = {};
+    }
 
-            EShLanguageMask stages = program.getUniformStages(i);
-            VkShaderStageFlags vk_stages = 0;
+    if (!compile_shader(binary, src, (i32)size, a)) {
+        return false;
+    }
 
-            if (stages & EShLangVertexMask) {
-                vk_stages |= VK_SHADER_STAGE_VERTEX_BIT;
-            }
+    CompiledShaderHeader header = {};
+    header.spirv_count[ShaderStage_vertex]   = binary->spirv[ShaderStage_vertex].count;
+    header.spirv_count[ShaderStage_fragment] = binary->spirv[ShaderStage_fragment].count;
+    header.sampler_binding_count = binary->sampler_bindings.count;
+    header.uniform_binding_count = binary->uniform_bindings.count;
+    header.push_constant_count   = binary->push_constants.count;
+
+    Array<u32> &vertex   = binary->spirv[ShaderStage_vertex];
+    Array<u32> &fragment = binary->spirv[ShaderStage_fragment];
+
+    write_derived_data(key, {
+        DerivedDataChunk{ &header,        sizeof header },
+        DerivedDataChunk{ vertex.data,   vertex.count   * sizeof vertex[0] },
+        DerivedDataChunk{ fragment.data, fragment.count * sizeof fragment[0] },
+        DerivedDataChunk{ binary->sampler_bindings.data, binary->sampler_bindings.count * sizeof binary->sampler_bindings[0] },
+        DerivedDataChunk{ binary->uniform_bindings.data, binary->uniform_bindings.count * sizeof binary->uniform_bindings[0] },
+        DerivedDataChunk{ binary->push_constants.data,   binary->push_constants.count   * sizeof binary->push_constants[0] } });
+
+    return true;
+}
 
-            if (stages & EShLangFragmentMask) {
-                vk_stages |= VK_SHADER_STAGE_FRAGMENT_BIT;
-            }
+StringView pipeline_shader_name(PipelineID id)
+{
+    switch (id) {
+    case Pipeline_font:
+        return "font.glsl";
+    case Pipeline_basic2d:
+        return "basic2d.glsl";
+    case Pipeline_gui_basic:
+        return "gui_basic.glsl";
+    case Pipeline_terrain:
+        return "terrain.glsl";
+    case Pipeline_mesh:
+        return "mesh.glsl";
+    case Pipeline_line:
+        return "line.glsl";
+    case Pipeline_wireframe:
+    case Pipeline_wireframe_lines:
+        return "wireframe.glsl";
+    default:
+        return {};
+    }
+}
 
-            const glslang::TQualifier &qualifier = type->getQualifier();
-            if (qualifier.storage == glslang::EvqUniform) {
-                if (qualifier.layoutPushConstant == false) {
-                    VkDescriptorSetLayoutBinding binding = {};
-                    binding.descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-                    binding.descriptorCount = 1;
-                    binding.stageFlags      = vk_stages;
-
-                    if (qualifier.hasBinding()) {
-                        binding.binding = qualifier.layoutBinding;
-                        uniform_binding = binding.binding + 1;
-                    } else {
-                        binding.binding = uniform_binding++;
-                    }
-
-                    array_add(&uniform_bindings, binding);
-                } else {
-                    VkPushConstantRange pc = {};
-                    pc.stageFlags = vk_stages;
-                    // TODO(jesper): can we have several push constants with
-                    // offsets?
-                    pc.offset     = 0;
-                    pc.size       = program.getUniformBlockSize(i);
-                    array_add(&push_constants, pc);
-                }
-            }
+void create_pipeline(PipelineID id)
+{
+    void *sp = g_stack->sp;
+    defer { reset(g_stack, sp); };
+
+    VkResult result;
+
+    VulkanPipeline pipeline = g_vulkan->pipelines[id];
+    pipeline.id = id;
+
+    StringView shader_name = pipeline_shader_name(id);
+
+    ShaderBinary binary = {};
+    if (load_shader_binary(&binary, shader_name, g_stack) == false) {
+        return;
+    }
+
+    for (i32 stage = 0; stage < ShaderStage_max; stage++) {
+        VulkanShader shader = {};
+
+        switch (stage) {
+        case ShaderStage_vertex:
+            shader.stage = VK_SHADER_STAGE_VERTEX_BIT;
+            break;
+        case ShaderStage_fragment:
+            shader.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+            break;
         }
 
+        VkShaderModuleCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        info.codeSize = binary.spirv[stage].count * sizeof binary.spirv[stage][0];
+        info.pCode    = binary.spirv[stage].data;
+
+        result = vkCreateShaderModule(
+            g_vulkan->handle, &info,
+            nullptr,
+            &shader.module);
+        ASSERT(result == VK_SUCCESS);
+
+        pipeline.shaders[stage] = shader;
+    }
+
+    if (pipeline.handle == VK_NULL_HANDLE) {
+        Array<VkDescriptorSetLayoutBinding> sampler_bindings = binary.sampler_bindings;
+        Array<VkDescriptorSetLayoutBinding> uniform_bindings = binary.uniform_bindings;
+        Array<VkPushConstantRange> push_constants = binary.push_constants;
+
         // NOTE(jesper): the only thing stopping us from creating these from the
         // reflection data is the LOD bias and max mip level
         switch (id) {
@@ -1219,6 +1328,13 @@ void create_pipeline(PipelineID id)
         array_add(&vdescs, { 1, 0, VK_FORMAT_R32G32_SFLOAT, sizeof(f32) * 2 });
         break;
     case Pipeline_mesh:
+#if LEARY_PACKED_VERTICES
+        array_add(&vbinds, { 0, sizeof(PackedVertex), VK_VERTEX_INPUT_RATE_VERTEX });
+
+        array_add(&vdescs, { 0, 0, VK_FORMAT_R16G16B16A16_UNORM,       offsetof(PackedVertex, position) });
+        array_add(&vdescs, { 1, 0, VK_FORMAT_A2B10G10R10_UNORM_PACK32, offsetof(PackedVertex, tangent_frame) });
+        array_add(&vdescs, { 2, 0, VK_FORMAT_R16G16_SFLOAT,            offsetof(PackedVertex, uv) });
+#else
         array_add(&vbinds, { 0, sizeof(f32) * 3, VK_VERTEX_INPUT_RATE_VERTEX });
         array_add(&vbinds, { 1, sizeof(f32) * 3, VK_VERTEX_INPUT_RATE_VERTEX });
         array_add(&vbinds, { 2, sizeof(f32) * 3, VK_VERTEX_INPUT_RATE_VERTEX });
@@ -1230,6 +1346,7 @@ void create_pipeline(PipelineID id)
         array_add(&vdescs, { 2, 2, VK_FORMAT_R32G32B32_SFLOAT, 0 });
         array_add(&vdescs, { 3, 3, VK_FORMAT_R32G32B32_SFLOAT, 0 });
         array_add(&vdescs, { 4, 4, VK_FORMAT_R32G32_SFLOAT,    0 });
+#endif
         break;
     case Pipeline_terrain:
         array_add(&vbinds, { 0, sizeof(f32) * 3, VK_VERTEX_INPUT_RATE_VERTEX });
@@ -1528,6 +1645,24 @@ void gfx_create_command_pools(GfxQueue *queue)
     init_array(&queue->commands_queued, g_heap);
 }
 
+VkQueryPool gfx_create_timestamp_pool(i32 count)
+{
+    VkQueryPoolCreateInfo query_info = {};
+    query_info.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_info.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+    query_info.queryCount = (u32)count;
+
+    VkQueryPool pool;
+    VkResult result = vkCreateQueryPool(
+        g_vulkan->handle,
+        &query_info,
+        nullptr,
+        &pool);
+    ASSERT(result == VK_SUCCESS);
+
+    return pool;
+}
+
 void init_vulkan()
 {
     // NOTE(jesper): initialise glslang compiler/linker
@@ -2091,17 +2226,9 @@ void init_vulkan()
         result = vkCreateFence(g_vulkan->handle, &fence_info, nullptr, &frame.fence);
         ASSERT(result == VK_SUCCESS);
 
-        VkQueryPoolCreateInfo query_info = {};
-        query_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
-        query_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
-        query_info.queryCount = GFX_NUM_TIMESTAMP_QUERIES;
-
-        result = vkCreateQueryPool(
-            g_vulkan->handle,
-            &query_info,
-            nullptr,
-            &frame.timestamps);
-        ASSERT(result == VK_SUCCESS);
+        frame.timestamps = gfx_create_timestamp_pool(GFX_INITIAL_TIMESTAMP_QUERIES);
+        frame.timestamps_capacity = GFX_INITIAL_TIMESTAMP_QUERIES;
+        init_array(&frame.timestamp_sites, g_heap);
     }
 }
 
@@ -2210,6 +2337,7 @@ void destroy_vulkan()
         vkDestroySemaphore(g_vulkan->handle, frame.available, nullptr);
         vkDestroySemaphore(g_vulkan->handle, frame.complete, nullptr);
         vkDestroyQueryPool(g_vulkan->handle, frame.timestamps, nullptr);
+        destroy_array(&frame.timestamp_sites);
     }
 
 
@@ -2645,6 +2773,83 @@ void gfx_bind_descriptor(
         0, nullptr);
 }
 
+void gfx_profile_timestamp(VkCommandBuffer cmd, u32 site_id, bool end)
+{
+    GfxFrame &frame = g_vulkan->frames[g_vulkan->current_frame];
+    ASSERT(cmd == frame.cmd);
+
+    GfxTimestamp timestamp;
+    timestamp.site_id = site_id;
+    timestamp.end     = end;
+
+    // NOTE(jesper): keep recording the sites when we've run out of queries so
+    // that the pool can be resized to the demand when the frame comes around
+    i32 query = array_add(&frame.timestamp_sites, timestamp);
+    if (query < frame.timestamps_capacity) {
+        vkCmdWriteTimestamp(
+            cmd,
+            end ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            frame.timestamps,
+            (u32)query);
+    }
+}
+
+void gfx_read_timestamps(GfxFrame *frame)
+{
+    i32 count = frame->timestamp_sites.count;
+
+    if (count > frame->timestamps_capacity) {
+        // NOTE(jesper): this frame's results are incomplete, drop them and grow
+        // the pool for the next time around
+        i32 capacity = frame->timestamps_capacity;
+        while (capacity < count) capacity *= 2;
+
+        vkDestroyQueryPool(g_vulkan->handle, frame->timestamps, nullptr);
+        frame->timestamps = gfx_create_timestamp_pool(capacity);
+        frame->timestamps_capacity = capacity;
+        return;
+    }
+
+    // NOTE(jesper): we've already waited on the frame's fence, so the results
+    // should be available. If they aren't we skip the frame rather than
+    // stalling on VK_QUERY_RESULT_WAIT_BIT
+    u64 *timestamps = alloc_array(g_frame, u64, count);
+    VkResult result = vkGetQueryPoolResults(
+        g_vulkan->handle,
+        frame->timestamps,
+        0, (u32)count,
+        (usize)count * sizeof timestamps[0],
+        timestamps,
+        sizeof timestamps[0],
+        VK_QUERY_RESULT_64_BIT);
+
+    if (result == VK_NOT_READY) {
+        return;
+    }
+    ASSERT(result == VK_SUCCESS);
+
+    f64 period = (f64)g_vulkan->physical_device.properties.limits.timestampPeriod;
+
+    u64 start = timestamps[0];
+    u64 end   = timestamps[count-1];
+    g_vulkan->gpu_time = (f32)((f64)(end - start) * period / 1000000.0);
+
+    // NOTE(jesper): we don't have a calibrated GPU<->CPU clock, so the first
+    // timestamp is anchored at the CPU tick the frame was submitted at. The
+    // GPU can't have started earlier, so this is a lower bound.
+    for (i32 i = 0; i < count; i++) {
+        GfxTimestamp site = frame->timestamp_sites[i];
+
+        f64 ms = (f64)(timestamps[i] - start) * period / 1000000.0;
+        u64 ticks = frame->submit_ticks + cpu_ticks_from_ms(ms);
+
+        profiler_gpu_event(
+            site.site_id,
+            site.end ? ProfileEvent_end : ProfileEvent_start,
+            ticks);
+    }
+}
+
 GfxFrame gfx_begin_frame()
 {
     VkResult result;
@@ -2662,25 +2867,10 @@ GfxFrame gfx_begin_frame()
         frame.submitted = false;
     }
 
-    if (frame.current_timestamp > 0) {
-        u64 timestamps[GFX_NUM_TIMESTAMP_QUERIES];
-        result = vkGetQueryPoolResults(
-            g_vulkan->handle,
-            frame.timestamps,
-            0, frame.current_timestamp,
-            sizeof timestamps,
-            &timestamps[0],
-            sizeof timestamps[0],
-            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
-        ASSERT(result == VK_SUCCESS);
-
-        u64 start = timestamps[0];
-        u64 end   = timestamps[1];
-
-        f32 tick = (1000 * 1000 * 1000) / g_vulkan->physical_device.properties.limits.timestampPeriod;
-        g_vulkan->gpu_time = ((end - start) * 1000) / tick;
-
-        frame.current_timestamp = 0;
+    if (frame.timestamp_sites.count > 0) {
+        PROFILE_SCOPE(vk_read_timestamps);
+        gfx_read_timestamps(&frame);
+        frame.timestamp_sites.count = 0;
     }
 
     {
@@ -2702,11 +2892,8 @@ GfxFrame gfx_begin_frame()
     result = vkBeginCommandBuffer(frame.cmd, &begin_info);
     ASSERT(result == VK_SUCCESS);
 
-    vkCmdWriteTimestamp(
-        frame.cmd,
-        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-        frame.timestamps,
-        frame.current_timestamp++);
+    vkCmdResetQueryPool(frame.cmd, frame.timestamps, 0, (u32)frame.timestamps_capacity);
+    gfx_profile_timestamp(frame.cmd, g_gfx_frame_site, false);
 
     VkClearValue clear_values[2];
     clear_values[0].color        = {{ 1.0f, 0.0f, 0.0f, 0.0f }};
@@ -2733,11 +2920,7 @@ void gfx_end_frame()
 
     vkCmdEndRenderPass(frame.cmd);
 
-    vkCmdWriteTimestamp(
-        frame.cmd,
-        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-        frame.timestamps,
-        frame.current_timestamp++);
+    gfx_profile_timestamp(frame.cmd, g_gfx_frame_site, true);
 
     result = vkEndCommandBuffer(frame.cmd);
     ASSERT(result == VK_SUCCESS);
@@ -2760,6 +2943,7 @@ void gfx_end_frame()
     sinfo.signalSemaphoreCount = (u32)g_vulkan->semaphores_submit_signal.count;
     sinfo.pSignalSemaphores    = g_vulkan->semaphores_submit_signal.data;
 
+    frame.submit_ticks = cpu_ticks();
     vkQueueSubmit(g_vulkan->queues[GFX_QUEUE_GRAPHICS].vk_queue, 1, &sinfo, frame.fence);
 
     present_semaphore(frame.complete);
@@ -2852,6 +3036,7 @@ GfxTexture gfx_create_texture(
     GfxTexture texture = {};
     texture.width      = width;
     texture.height     = height;
+    texture.mip_levels = mip_levels;
     texture.vk_format  = format;
 
     gfx_create_image(
@@ -2895,6 +3080,15 @@ GfxTexture gfx_create_texture(
     i32 bytes_per_channel;
 
     switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        // NOTE(jesper): sized per block below
+        num_channels      = 0;
+        bytes_per_channel = 0;
+        break;
     case VK_FORMAT_R8_UNORM:
     case VK_FORMAT_R8_UINT:
         num_channels      = 1;
@@ -2935,7 +3129,26 @@ GfxTexture gfx_create_texture(
         break;
     }
 
-    VkDeviceSize size = width * height * num_channels * bytes_per_channel;
+    auto level_size = [format, num_channels, bytes_per_channel](u32 w, u32 h) -> VkDeviceSize
+    {
+        if (bc_block_size(format) > 0) {
+            return bc_image_size(format, w, h);
+        }
+
+        return w * h * num_channels * bytes_per_channel;
+    };
+
+    // NOTE(jesper): pixels contains every mip level, back to back from the
+    // largest
+    VkDeviceSize size = 0;
+    u32 level_width   = width;
+    u32 level_height  = height;
+    for (u32 i = 0; i < mip_levels; i++) {
+        size += level_size(level_width, level_height);
+
+        level_width  = level_width  > 1 ? level_width  / 2 : 1;
+        level_height = level_height > 1 ? level_height / 2 : 1;
+    }
 
     VulkanBuffer staging = create_buffer(
         size,
@@ -2967,133 +3180,43 @@ GfxTexture gfx_create_texture(
 
     GfxCommandBuffer command = gfx_begin_command(GFX_QUEUE_TRANSFER);
 
-    VkBufferImageCopy region = {};
-    region.bufferOffset                    = 0;
-    region.bufferRowLength                 = 0;
-    region.bufferImageHeight               = 0;
-    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel       = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount     = 1;
-    region.imageOffset                     = { 0, 0, 0 };
-    region.imageExtent                     = { width, height, 1 };
-
-    vkCmdCopyBufferToImage(
-        command.handle,
-        staging.handle,
-        texture.vk_image,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        1,
-        &region);
-
-    gfx_end_command(command);
-    gfx_flush_and_wait(GFX_QUEUE_TRANSFER);
+    VkDeviceSize offset = 0;
+    level_width         = width;
+    level_height        = height;
+
+    for (u32 i = 0; i < mip_levels; i++) {
+        VkBufferImageCopy region = {};
+        region.bufferOffset                    = offset;
+        region.bufferRowLength                 = 0;
+        region.bufferImageHeight               = 0;
+        region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel       = i;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount     = 1;
+        region.imageOffset                     = { 0, 0, 0 };
+        region.imageExtent                     = { level_width, level_height, 1 };
+
+        vkCmdCopyBufferToImage(
+            command.handle,
+            staging.handle,
+            texture.vk_image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1,
+            &region);
 
-    if (mip_levels > 1) {
-        VkImageMemoryBarrier barrier = {};
-        barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image                           = texture.vk_image;
-        barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel   = 0;
-        barrier.subresourceRange.levelCount     = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount     = 1;
-
-        command = gfx_begin_command(GFX_QUEUE_GRAPHICS);
-
-        i32 mip_width  = width;
-        i32 mip_height = height;
-
-        for (u32 i = 1; i < mip_levels; i++) {
-            barrier.subresourceRange.baseMipLevel = i - 1;
-            barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-            vkCmdPipelineBarrier(
-                command.handle,
-                VK_PIPELINE_STAGE_TRANSFER_BIT,
-                VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-                0, nullptr,
-                0, nullptr,
-                1, &barrier);
-
-            VkImageBlit blit = {};
-            blit.srcOffsets[0]                 = { 0, 0, 0 };
-            blit.srcOffsets[1]                 = { mip_width, mip_height, 1 };
-            blit.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.srcSubresource.mipLevel       = i - 1;
-            blit.srcSubresource.baseArrayLayer = 0;
-            blit.srcSubresource.layerCount     = 1;
-            blit.dstOffsets[0]                 = { 0, 0, 0 };
-
-            blit.dstOffsets[1] = {
-                mip_width > 1 ? mip_width / 2 : 1,
-                mip_height> 1 ? mip_height / 2 : 1,
-                1
-            };
-
-            blit.dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.dstSubresource.mipLevel       = i;
-            blit.dstSubresource.baseArrayLayer = 0;
-            blit.dstSubresource.layerCount     = 1;
-
-            // TODO(jesper) look into filter options here
-            vkCmdBlitImage(
-                command.handle,
-                texture.vk_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                texture.vk_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                1, &blit,
-                VK_FILTER_LINEAR);
-
-            barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            vkCmdPipelineBarrier(
-                command.handle,
-                VK_PIPELINE_STAGE_TRANSFER_BIT,
-                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-                0, nullptr,
-                0, nullptr,
-                1, &barrier);
-
-            if (mip_width > 1) {
-                mip_width /= 2;
-            }
+        offset += level_size(level_width, level_height);
 
-            if (mip_height > 1) {
-                mip_height /= 2;
-            }
-        }
-
-        barrier.subresourceRange.baseMipLevel = mip_levels - 1;
-        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        level_width  = level_width  > 1 ? level_width  / 2 : 1;
+        level_height = level_height > 1 ? level_height / 2 : 1;
+    }
 
-        vkCmdPipelineBarrier(
-            command.handle,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier);
+    gfx_end_command(command);
+    gfx_flush_and_wait(GFX_QUEUE_TRANSFER);
 
-        gfx_end_command(command);
-        gfx_flush_and_wait(GFX_QUEUE_GRAPHICS);
-    } else {
-        gfx_transition_immediate(
-            &texture,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
-    }
+    gfx_transition_immediate(
+        &texture,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
 
     destroy_buffer(staging);
 
@@ -3102,6 +3225,7 @@ GfxTexture gfx_create_texture(
 
 void gfx_destroy_texture(GfxTexture texture)
 {
+    vkDestroyImageView(g_vulkan->handle, texture.vk_view, nullptr);
     vkFreeMemory(g_vulkan->handle, texture.vk_memory, nullptr);
     vkDestroyImage(g_vulkan->handle, texture.vk_image, nullptr);
 }
@@ -114,19 +114,28 @@ struct VulkanPhysicalDevice {
     VkPhysicalDeviceFeatures         features;
 };
 
+// NOTE(jesper): one per vkCmdWriteTimestamp, the query index is the index into
+// GfxFrame::timestamp_sites
+struct GfxTimestamp {
+    u32  site_id;
+    bool end;
+};
+
 struct GfxFrame {
-    VkCommandBuffer cmd;
-    VkFence         fence;
-    VkSemaphore     available;
-    VkSemaphore     complete;
-    VkQueryPool     timestamps;
-    i32             current_timestamp;
-    bool            submitted;
-    u32             swapchain_index;
+    VkCommandBuffer     cmd;
+    VkFence             fence;
+    VkSemaphore         available;
+    VkSemaphore         complete;
+    VkQueryPool         timestamps;
+    i32                 timestamps_capacity;
+    Array<GfxTimestamp> timestamp_sites;
+    u64                 submit_ticks;
+    bool                submitted;
+    u32                 swapchain_index;
 };
 
 #define GFX_NUM_FRAMES (2)
-#define GFX_NUM_TIMESTAMP_QUERIES (2)
+#define GFX_INITIAL_TIMESTAMP_QUERIES (32)
 
 enum GfxQueueId {
     GFX_QUEUE_GRAPHICS,
@@ -161,8 +170,6 @@ struct VulkanDevice {
     GfxFrame frames[GFX_NUM_FRAMES];
     i32      current_frame = 0;
 
-    VkQueryPool timestamp_queries;
-
     VkInstance               instance;
     VkDebugReportCallbackEXT debug_callback;
 
@@ -279,5 +286,8 @@ void gfx_set_texture(
 Vector2 camera_from_screen(Vector2 v);
 Vector3 camera_from_screen(Vector3 v);
 
+// NOTE(jesper): the shader a pipeline is built from, several pipelines can
+// share one
+StringView pipeline_shader_name(PipelineID id);
 void create_pipeline(PipelineID id);
 void gfx_flush_and_wait(GfxQueueId queue_id);
@@ -44,6 +44,50 @@ u32 hash32(void *key, i32 length)
     return h;
 }
 
+// NOTE(jesper): MurmurHash64A, used where a 32 bit hash collides too easily,
+// e.g. for identifying file content
+u64 hash64(void *key, isize length)
+{
+    u8 *data = (u8*)key;
+
+    u64 m = 0xc6a4a7935bd1e995ull;
+    i32 r = 47;
+
+    u64 h = MURMUR_SEED ^ ((u64)length * m);
+
+    while (length >= 8) {
+        u64 k;
+        memcpy(&k, data, sizeof k);
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+
+        data   += 8;
+        length -= 8;
+    }
+
+    switch (length) {
+    case 7: h ^= (u64)data[6] << 48;
+    case 6: h ^= (u64)data[5] << 40;
+    case 5: h ^= (u64)data[4] << 32;
+    case 4: h ^= (u64)data[3] << 24;
+    case 3: h ^= (u64)data[2] << 16;
+    case 2: h ^= (u64)data[1] << 8;
+    case 1: h ^= (u64)data[0];
+            h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+}
+
 u32 hash32(const char *str)
 {
     return hash32((u8*)str, strlen(str));
@@ -252,43 +252,91 @@ void init_map(
 template<typename K, typename V>
 void destroy_map(RHHashMap<K, V> *map)
 {
-    for (i32 i = 0; i < map->count; i++) {
+    for (i32 i = 0; i < map->capacity; i++) {
+        if (map->entries[i].distance == -1) {
+            continue;
+        }
+
         map->entries[i].value.~V();
     }
 
-    map->allocator->dealloc(map->entries);
+    dealloc(map->allocator, map->entries);
     *map = {};
 }
 
 template<typename V>
 void destroy_map(RHHashMap<StringView, V> *map)
 {
-    for (i32 i = 0; i < map->count; i++) {
+    for (i32 i = 0; i < map->capacity; i++) {
+        if (map->entries[i].distance == -1) {
+            continue;
+        }
+
         map->entries[i].value.~V();
-        map->allocator->dealloc(map->entries[i].key);
+        dealloc(map->allocator, (void*)map->entries[i].key.bytes);
     }
 
-    map->allocator->dealloc(map->entries);
+    dealloc(map->allocator, map->entries);
     *map = {};
 }
 
 template<typename K, typename V>
-void map_add(RHHashMap<K, V> *map, K key, V value)
+void map_insert_entry(
+    RHHashMap<K, V> *map,
+    u32 index,
+    typename RHHashMap<K, V>::Entry e)
+{
+    for (i32 i = (i32)index; ; i = (i + 1) & map->mask) {
+        if (map->entries[i].distance == -1) {
+            map->entries[i] = std::move(e);
+            return;
+        }
+
+        if (map->entries[i].distance < e.distance) {
+            std::swap(e, map->entries[i]);
+        }
+
+        e.distance++;
+    }
+}
+
+// NOTE(jesper): doubles the capacity and re-inserts every entry, the keys
+// already owned by the map are moved rather than copied
+template<typename K, typename V>
+void map_grow(RHHashMap<K, V> *map)
 {
     using Entry = typename RHHashMap<K, V>::Entry;
 
-    if (++map->count >= map->resize_threshold) {
-        auto a = map->allocator;
+    Entry *entries  = map->entries;
+    i32 capacity    = map->capacity;
+
+    map->capacity = capacity * 2;
+    map->mask     = map->capacity - 1;
+    map->entries  = ialloc_array<Entry>(map->allocator, map->capacity);
+    map->resize_threshold = (map->capacity * RH_LOAD_FACTOR) / 100;
+
+    for (i32 i = 0; i < capacity; i++) {
+        if (entries[i].distance == -1) {
+            continue;
+        }
+
+        Entry e    = std::move(entries[i]);
+        e.distance = 0;
+
+        u32 index = hash32(&e.key) & map->mask;
+        map_insert_entry(map, index, std::move(e));
+    }
 
-        i32 capacity = map->capacity * 2;
-        Entry *entries = ialloc_array<Entry>(a, capacity);
-        std::memcpy(entries, map->entries, map->capacity);
-        dealloc(a, map->entries);
+    dealloc(map->allocator, entries);
+}
 
-        map->capacity = capacity;
-        map->mask     = map->capacity - 1;
-        map->entries  = entries;
-        map->resize_threshold = (map->capacity * RH_LOAD_FACTOR) / 100;
+template<typename K, typename V>
+void map_add(RHHashMap<K, V> *map, K key, V value)
+{
+    using Entry = typename RHHashMap<K, V>::Entry;
+
+    if (++map->count >= map->resize_threshold) {
+        map_grow(map);
     }
 
     u32 hash = hash32(&key);
@@ -300,18 +348,7 @@ void map_add(RHHashMap<K, V> *map, K key, V value)
         0
     };
 
-    for (i32 i = (i32)index; ; i = (i + 1) & map->mask) {
-        if (map->entries[i].distance == -1) {
-            map->entries[i] = std::move(e);
-            return;
-        }
-
-        if (map->entries[i].distance < e.distance) {
-            std::swap(e, map->entries[i]);
-        }
-
-        e.distance++;
-    }
+    map_insert_entry(map, index, std::move(e));
 }
 
 template<typename V>
@@ -320,17 +357,7 @@ void map_add(RHHashMap<StringView, V> *map, StringView key, V value)
     using Entry = typename RHHashMap<StringView, V>::Entry;
 
     if (++map->count >= map->resize_threshold) {
-        auto a = map->allocator;
-
-        i32 capacity = map->capacity * 2;
-        Entry *entries = ialloc_array<Entry>(a, capacity);
-        std::memcpy(entries, map->entries, map->capacity);
-        dealloc(a, map->entries);
-
-        map->capacity = capacity;
-        map->mask     = map->capacity - 1;
-        map->entries  = entries;
-        map->resize_threshold = (map->capacity * RH_LOAD_FACTOR) / 100;
+        map_grow(map);
     }
 
     u32 hash  = hash32(&key);
@@ -341,18 +368,7 @@ void map_add(RHHashMap<StringView, V> *map, StringView key, V value)
     e.value    = std::move(value);
     e.distance = 0;
 
-    for (i32 i = (i32)index; ; i = (i + 1) & map->mask) {
-        if (map->entries[i].distance == -1) {
-            map->entries[i] = std::move(e);
-            return;
-        }
-
-        if (map->entries[i].distance < e.distance) {
-            std::swap(e, map->entries[i]);
-        }
-
-        e.distance++;
-    }
+    map_insert_entry(map, index, std::move(e));
 }
 
 template<typename K, typename V>
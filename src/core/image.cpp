@@ -0,0 +1,354 @@
+/**
+ * file:    image.cpp
+ * created: 2018-09-23
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): the builds don't enable anything above SSE2, the SSSE3 paths
+// are compiled for it per function and picked at runtime
+#if defined(_MSC_VER)
+    #define TARGET_SSSE3
+#else
+    #define TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+
+bool cpu_has_ssse3()
+{
+#if defined(_WIN32)
+    int registers[4];
+    __cpuid(registers, 1);
+    return (registers[2] & (1 << 9)) != 0;
+#else
+    u32 eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) {
+        return false;
+    }
+
+    return (ecx & (1 << 9)) != 0;
+#endif
+}
+
+void bgra_from_bgr_scalar(u8 *dst, u8 *src, i32 pixel_count)
+{
+    for (i32 i = 0; i < pixel_count; i++) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = 255;
+
+        dst += 4;
+        src += 3;
+    }
+}
+
+// NOTE(jesper): 16 pixels per iteration, the 48 source bytes are loaded as
+// three registers and realigned so that each group of 4 pixels starts at
+// byte 0 before being spread out with the same shuffle
+TARGET_SSSE3
+void bgra_from_bgr_ssse3(u8 *dst, u8 *src, i32 pixel_count)
+{
+    __m128i shuffle = _mm_setr_epi8(
+        0, 1, 2, -1,
+        3, 4, 5, -1,
+        6, 7, 8, -1,
+        9, 10, 11, -1);
+
+    __m128i alpha = _mm_set1_epi32((i32)0xFF000000);
+
+    i32 i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        __m128i in0 = _mm_loadu_si128((__m128i*)(src + 0));
+        __m128i in1 = _mm_loadu_si128((__m128i*)(src + 16));
+        __m128i in2 = _mm_loadu_si128((__m128i*)(src + 32));
+
+        __m128i p0 = in0;
+        __m128i p1 = _mm_alignr_epi8(in1, in0, 12);
+        __m128i p2 = _mm_alignr_epi8(in2, in1, 8);
+        __m128i p3 = _mm_srli_si128(in2, 4);
+
+        p0 = _mm_or_si128(_mm_shuffle_epi8(p0, shuffle), alpha);
+        p1 = _mm_or_si128(_mm_shuffle_epi8(p1, shuffle), alpha);
+        p2 = _mm_or_si128(_mm_shuffle_epi8(p2, shuffle), alpha);
+        p3 = _mm_or_si128(_mm_shuffle_epi8(p3, shuffle), alpha);
+
+        _mm_storeu_si128((__m128i*)(dst + 0),  p0);
+        _mm_storeu_si128((__m128i*)(dst + 16), p1);
+        _mm_storeu_si128((__m128i*)(dst + 32), p2);
+        _mm_storeu_si128((__m128i*)(dst + 48), p3);
+
+        src += 48;
+        dst += 64;
+    }
+
+    bgra_from_bgr_scalar(dst, src, pixel_count - i);
+}
+
+void bgra_from_bgr(u8 *dst, u8 *src, i32 pixel_count)
+{
+    static bool ssse3 = cpu_has_ssse3();
+
+    if (ssse3) {
+        bgra_from_bgr_ssse3(dst, src, pixel_count);
+    } else {
+        bgra_from_bgr_scalar(dst, src, pixel_count);
+    }
+}
+
+u32 mip_level_count(i32 width, i32 height)
+{
+    u32 levels = 1;
+    i32 size   = width > height ? width : height;
+    while (size > 1) {
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+isize mip_chain_size(i32 width, i32 height, u32 mip_levels)
+{
+    isize size = 0;
+    for (u32 i = 0; i < mip_levels; i++) {
+        size  += (isize)width * height * 4;
+        width  = width  > 1 ? width  / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return size;
+}
+
+#define MIP_FILTER_MAX_TAPS (6)
+#define MIP_KAISER_ALPHA    (4.0f)
+#define MIP_KAISER_RADIUS   (3.0f)
+
+// NOTE(jesper): weights of the source samples that make up a destination
+// sample. Destination sample x is centered between source samples 2x and
+// 2x+1, the first tap is source sample 2x + offset.
+struct MipFilterTaps {
+    i32 count;
+    i32 offset;
+    f32 weights[MIP_FILTER_MAX_TAPS];
+};
+
+// NOTE(jesper): tables to convert between the 8 bit sRGB and linear values,
+// the linear values are quantised to 12 bits for the conversion back, which
+// is below the 8 bit sRGB step everywhere
+#define SRGB_TABLE_SIZE (4096)
+
+struct SrgbTables {
+    f32 linear[256];
+    u8  srgb[SRGB_TABLE_SIZE];
+};
+
+f32 bessel_i0(f32 x)
+{
+    f32 sum  = 1.0f;
+    f32 term = 1.0f;
+    for (i32 i = 1; i < 32; i++) {
+        term *= (x * 0.5f / i) * (x * 0.5f / i);
+        sum  += term;
+    }
+    return sum;
+}
+
+MipFilterTaps create_mip_filter_taps(MipFilter filter)
+{
+    MipFilterTaps taps = {};
+
+    switch (filter) {
+    case MipFilter_box:
+        taps.count      = 2;
+        taps.offset     = 0;
+        taps.weights[0] = 0.5f;
+        taps.weights[1] = 0.5f;
+        break;
+    case MipFilter_kaiser: {
+        // NOTE(jesper): sinc cut off at the destination nyquist frequency,
+        // windowed to MIP_KAISER_RADIUS source samples
+        taps.count  = 6;
+        taps.offset = -2;
+
+        f32 sum = 0.0f;
+        for (i32 i = 0; i < taps.count; i++) {
+            f32 d    = (f32)i - 2.5f;
+            f32 x    = PI * d * 0.5f;
+            f32 sinc = sinf(x) / x;
+
+            f32 r      = d / MIP_KAISER_RADIUS;
+            f32 window = bessel_i0(MIP_KAISER_ALPHA * sqrtf(1.0f - r * r)) / bessel_i0(MIP_KAISER_ALPHA);
+
+            taps.weights[i] = sinc * window;
+            sum += taps.weights[i];
+        }
+
+        for (i32 i = 0; i < taps.count; i++) {
+            taps.weights[i] /= sum;
+        }
+        } break;
+    }
+
+    return taps;
+}
+
+SrgbTables create_srgb_tables()
+{
+    SrgbTables tables;
+    for (i32 i = 0; i < 256; i++) {
+        tables.linear[i] = linear_from_sRGB(i / 255.0f);
+    }
+
+    for (i32 i = 0; i < SRGB_TABLE_SIZE; i++) {
+        f32 s = sRGB_from_linear(i / (f32)(SRGB_TABLE_SIZE - 1));
+        tables.srgb[i] = (u8)(s * 255.0f + 0.5f);
+    }
+
+    return tables;
+}
+
+__m128 load_mip_pixel(u8 *p, SrgbTables *srgb)
+{
+    if (srgb != nullptr) {
+        return _mm_setr_ps(
+            srgb->linear[p[0]],
+            srgb->linear[p[1]],
+            srgb->linear[p[2]],
+            p[3] * (1.0f / 255.0f));
+    }
+
+    i32 bgra;
+    memcpy(&bgra, p, sizeof bgra);
+
+    __m128i zero = _mm_setzero_si128();
+    __m128i v    = _mm_cvtsi32_si128(bgra);
+    v = _mm_unpacklo_epi8(v, zero);
+    v = _mm_unpacklo_epi16(v, zero);
+    return _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(1.0f / 255.0f));
+}
+
+// NOTE(jesper): xyz is stored in rgb as n * 0.5 + 0.5, i.e. bgr is zyx
+__m128 renormalize_mip_pixel(__m128 v)
+{
+    __m128 alpha = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+
+    __m128 n  = _mm_sub_ps(_mm_mul_ps(v, _mm_set1_ps(2.0f)), _mm_set1_ps(1.0f));
+    __m128 n2 = _mm_andnot_ps(alpha, _mm_mul_ps(n, n));
+
+    __m128 length2 = _mm_add_ps(n2, _mm_shuffle_ps(n2, n2, _MM_SHUFFLE(2, 3, 0, 1)));
+    length2 = _mm_add_ps(length2, _mm_shuffle_ps(length2, length2, _MM_SHUFFLE(1, 0, 3, 2)));
+
+    if (_mm_cvtss_f32(length2) < 0.000001f) {
+        return _mm_or_ps(_mm_andnot_ps(alpha, _mm_setr_ps(1.0f, 0.5f, 0.5f, 0.0f)), _mm_and_ps(alpha, v));
+    }
+
+    n = _mm_div_ps(n, _mm_sqrt_ps(length2));
+    n = _mm_add_ps(_mm_mul_ps(n, _mm_set1_ps(0.5f)), _mm_set1_ps(0.5f));
+    return _mm_or_ps(_mm_andnot_ps(alpha, n), _mm_and_ps(alpha, v));
+}
+
+void store_mip_pixel(u8 *dst, __m128 v, SrgbTables *srgb)
+{
+    v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+    if (srgb != nullptr) {
+        f32 f[4];
+        _mm_storeu_ps(f, v);
+
+        dst[0] = srgb->srgb[(i32)(f[0] * (SRGB_TABLE_SIZE - 1) + 0.5f)];
+        dst[1] = srgb->srgb[(i32)(f[1] * (SRGB_TABLE_SIZE - 1) + 0.5f)];
+        dst[2] = srgb->srgb[(i32)(f[2] * (SRGB_TABLE_SIZE - 1) + 0.5f)];
+        dst[3] = (u8)(f[3] * 255.0f + 0.5f);
+        return;
+    }
+
+    __m128i i = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(255.0f)));
+    i = _mm_packs_epi32(i, i);
+    i = _mm_packus_epi16(i, i);
+
+    i32 bgra = _mm_cvtsi128_si32(i);
+    memcpy(dst, &bgra, sizeof bgra);
+}
+
+// NOTE(jesper): the filter is separable, each destination row is made by
+// filtering the source rows vertically into a row of linear floats and then
+// filtering that horizontally. Every pixel is one register with its four
+// channels.
+void generate_mip(
+    u8 *dst,
+    u8 *src,
+    i32 width, i32 height,
+    MipFilter filter,
+    bool srgb,
+    bool normal_map,
+    Allocator *scratch)
+{
+    static MipFilterTaps box_taps    = create_mip_filter_taps(MipFilter_box);
+    static MipFilterTaps kaiser_taps = create_mip_filter_taps(MipFilter_kaiser);
+    static SrgbTables    srgb_tables = create_srgb_tables();
+
+    MipFilterTaps *taps   = filter == MipFilter_kaiser ? &kaiser_taps : &box_taps;
+    SrgbTables    *tables = srgb ? &srgb_tables : nullptr;
+
+    i32 dst_width  = width  > 1 ? width  / 2 : 1;
+    i32 dst_height = height > 1 ? height / 2 : 1;
+
+    f32 *row = alloc_array(scratch, f32, width * 4);
+
+    for (i32 y = 0; y < dst_height; y++) {
+        memset(row, 0, width * 4 * sizeof(f32));
+
+        for (i32 k = 0; k < taps->count; k++) {
+            i32 sy = 2 * y + taps->offset + k;
+            sy = sy < 0 ? 0 : sy >= height ? height - 1 : sy;
+
+            __m128 w  = _mm_set1_ps(taps->weights[k]);
+            u8 *src_row = src + (isize)sy * width * 4;
+
+            for (i32 x = 0; x < width; x++) {
+                __m128 acc = _mm_loadu_ps(row + x * 4);
+                acc = _mm_add_ps(acc, _mm_mul_ps(w, load_mip_pixel(src_row + x * 4, tables)));
+                _mm_storeu_ps(row + x * 4, acc);
+            }
+        }
+
+        for (i32 x = 0; x < dst_width; x++) {
+            __m128 acc = _mm_setzero_ps();
+
+            for (i32 k = 0; k < taps->count; k++) {
+                i32 sx = 2 * x + taps->offset + k;
+                sx = sx < 0 ? 0 : sx >= width ? width - 1 : sx;
+
+                __m128 w = _mm_set1_ps(taps->weights[k]);
+                acc = _mm_add_ps(acc, _mm_mul_ps(w, _mm_loadu_ps(row + sx * 4)));
+            }
+
+            if (normal_map) {
+                acc = renormalize_mip_pixel(acc);
+            }
+
+            store_mip_pixel(dst + ((isize)y * dst_width + x) * 4, acc, tables);
+        }
+    }
+
+    dealloc(scratch, row);
+}
+
+void generate_mip_chain(
+    u8 *chain,
+    i32 width, i32 height,
+    u32 mip_levels,
+    MipFilter filter,
+    bool srgb,
+    bool normal_map,
+    Allocator *scratch)
+{
+    u8 *level = chain;
+    for (u32 i = 1; i < mip_levels; i++) {
+        u8 *next = level + (isize)width * height * 4;
+        generate_mip(next, level, width, height, filter, srgb, normal_map, scratch);
+
+        level  = next;
+        width  = width  > 1 ? width  / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+}
@@ -0,0 +1,51 @@
+/**
+ * file:    image.h
+ * created: 2018-09-23
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): expands pixel_count tightly packed 24 bit BGR pixels to 32 bit
+// BGRA with an opaque alpha. Uses SSSE3 when the cpu supports it, dst and src
+// must not overlap.
+void bgra_from_bgr(u8 *dst, u8 *src, i32 pixel_count);
+
+// NOTE(jesper): number of levels in a full mip chain down to 1x1
+u32 mip_level_count(i32 width, i32 height);
+
+enum MipFilter {
+    MipFilter_box,
+    MipFilter_kaiser
+};
+
+// NOTE(jesper): size in bytes of mip_levels BGRA levels stored back to back,
+// starting with a width x height level
+isize mip_chain_size(i32 width, i32 height, u32 mip_levels);
+
+// NOTE(jesper): halves a BGRA image into dst, which must hold
+// max(width/2, 1) * max(height/2, 1) pixels.
+//     MipFilter_box:    2x2 average
+//     MipFilter_kaiser: 6x6 Kaiser windowed sinc, sharper than the box with
+//                       less aliasing, at the cost of some ringing on edges
+// With srgb the colour channels are filtered in linear space, alpha is always
+// linear. With normal_map the filtered xyz is renormalised.
+void generate_mip(
+    u8 *dst,
+    u8 *src,
+    i32 width, i32 height,
+    MipFilter filter,
+    bool srgb,
+    bool normal_map,
+    Allocator *scratch);
+
+// NOTE(jesper): fills the levels after the first in a buffer of
+// mip_chain_size(width, height, mip_levels) bytes with level 0 at the start
+void generate_mip_chain(
+    u8 *chain,
+    i32 width, i32 height,
+    u32 mip_levels,
+    MipFilter filter,
+    bool srgb,
+    bool normal_map,
+    Allocator *scratch);
@@ -111,6 +111,135 @@ u64 read_u64(Token token)
     return result;
 }
 
+const f64 g_scan_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// NOTE(jesper): scans a decimal floating point number starting at *at and
+// advances *at past it, *at is left untouched if there's no number. The
+// significant digits are accumulated in a u64 and scaled by an exact power of
+// ten in f64, which is correctly rounded for anything with less than 16
+// significant digits. inf, nan and hex floats aren't supported.
+f32 scan_f32(const char **at, const char *end)
+{
+    const char *p = *at;
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    u64 mantissa = 0;
+    i32 exponent = 0;
+    i32 digits   = 0;
+    bool valid   = false;
+
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (u64)(*p - '0');
+            digits  += mantissa != 0;
+        } else {
+            exponent++;
+        }
+
+        valid = true;
+        p++;
+    }
+
+    if (p < end && *p == '.') {
+        p++;
+
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (u64)(*p - '0');
+                digits  += mantissa != 0;
+                exponent--;
+            }
+
+            valid = true;
+            p++;
+        }
+    }
+
+    if (!valid) {
+        return 0.0f;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+
+        bool negative_exponent = false;
+        if (e < end && (*e == '-' || *e == '+')) {
+            negative_exponent = *e == '-';
+            e++;
+        }
+
+        if (e < end && *e >= '0' && *e <= '9') {
+            i32 value = 0;
+            while (e < end && *e >= '0' && *e <= '9') {
+                if (value < 10000) {
+                    value = value * 10 + (*e - '0');
+                }
+                e++;
+            }
+
+            exponent += negative_exponent ? -value : value;
+            p = e;
+        }
+    }
+
+    *at = p;
+
+    f64 result = (f64)mantissa;
+    if (mantissa != 0) {
+        while (exponent < -22) {
+            result   /= 1e22;
+            exponent += 22;
+        }
+
+        while (exponent > 22) {
+            result   *= 1e22;
+            exponent -= 22;
+        }
+
+        if (exponent < 0) {
+            result /= g_scan_pow10[-exponent];
+        } else {
+            result *= g_scan_pow10[exponent];
+        }
+    }
+
+    return (f32)(negative ? -result : result);
+}
+
+// NOTE(jesper): scans an optionally signed decimal integer starting at *at and
+// advances *at past it
+i32 scan_i32(const char **at, const char *end)
+{
+    const char *p = *at;
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    if (p >= end || *p < '0' || *p > '9') {
+        return 0;
+    }
+
+    i32 result = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        result = result * 10 + (*p - '0');
+        p++;
+    }
+
+    *at = p;
+    return negative ? -result : result;
+}
+
 f32 read_f32(Token t)
 {
     f32 result = 0.0f;
@@ -6,7 +6,75 @@
  * Copyright (c) 2018 - all rights reserved
  */
 
-#define LOG_BUFFER_SIZE 2048
+#define LOG_BUFFER_SIZE   (2048)
+#define LOG_RING_SIZE     (1024)
+#define LOG_RECORD_SIZE   (1024)
+#define LOG_MAX_SITES     (4096)
+#define LOG_FILE_MAX_SIZE (4 * 1024 * 1024)
+#define LOG_FILE_COUNT    (3)
+
+// NOTE(jesper): formatted messages are pushed by any thread and written out by
+// the log thread. Writers reserve a record by bumping write and publish it by
+// storing write+1 into its sequence. Messages are dropped rather than blocking
+// when the ring is full, and truncated to LOG_RECORD_SIZE. Deferred records
+// hold the raw arguments of site_id instead of text.
+struct LogRecord {
+    u32     sequence;
+    u32     site_id;
+    LogType type;
+    i32     length;
+    char    text[LOG_RECORD_SIZE];
+};
+
+static_assert(LOG_DEFERRED_ARGS_SIZE < LOG_RECORD_SIZE, "deferred arguments don't fit in a log record");
+
+struct LogSite {
+    const char *src_file;
+    u32        src_line;
+    const char *src_function;
+    const char *msg_format;
+};
+
+struct LogArgReader {
+    u8  *data;
+    i32 size;
+    i32 offset;
+};
+
+struct LogRing {
+    LogRecord records[LOG_RING_SIZE];
+    u32 write;
+    u32 read;
+    u32 dropped;
+};
+
+struct Logger {
+    bool active;
+
+    Semaphore semaphore;
+
+    // NOTE(jesper): held while draining, the ring only supports one reader at a
+    // time and log_flush can be called from any thread
+    Mutex consumer;
+
+    // NOTE(jesper): paths[0] is the current log file, the rest are the
+    // previous ones in order of age
+    FilePath paths[LOG_FILE_COUNT];
+    void     *file;
+    isize    file_size;
+
+    u32 dropped_reported;
+};
+
+LogRing g_log_ring;
+Logger  g_logger;
+
+// NOTE(jesper): set on the log thread, which may already hold the consumer
+// lock when it logs, e.g. on an assert while writing a record
+thread_local bool g_log_thread = false;
+
+LogSite g_log_sites[LOG_MAX_SITES];
+u32     g_log_sites_count = 0;
 
 StringView string_from_log_type(LogType type)
 {
@@ -22,30 +90,497 @@ StringView string_from_log_type(LogType type)
     }
 }
 
-void log(
+bool log_ring_push(
+    LogRing *ring,
+    u32 site_id,
+    LogType type,
+    const char *text,
+    i32 length)
+{
+    u32 write;
+    do {
+        write = atomic_load(&ring->write);
+        if (write - atomic_load(&ring->read) >= LOG_RING_SIZE) {
+            atomic_add(&ring->dropped, 1);
+            return false;
+        }
+    } while (!atomic_cas(&ring->write, write, write + 1));
+
+    LogRecord *record = &ring->records[write % LOG_RING_SIZE];
+    record->site_id = site_id;
+    record->type    = type;
+    record->length  = min(length, LOG_RECORD_SIZE - 1);
+
+    memcpy(record->text, text, (usize)record->length);
+
+    // NOTE(jesper): keep the line ending of a truncated message, or the next
+    // one ends up on the same line
+    if (site_id == LOG_SITE_UNREGISTERED && length > record->length) {
+        record->text[record->length - 1] = '\n';
+    }
+    record->text[record->length] = '\0';
+
+    atomic_store(&record->sequence, write + 1);
+    return true;
+}
+
+LogRecord* log_ring_peek(LogRing *ring)
+{
+    u32 read = ring->read;
+
+    LogRecord *record = &ring->records[read % LOG_RING_SIZE];
+    if (atomic_load(&record->sequence) != read + 1) {
+        return nullptr;
+    }
+
+    return record;
+}
+
+void log_ring_pop(LogRing *ring)
+{
+    atomic_store(&ring->read, ring->read + 1);
+}
+
+void log_open_file()
+{
+    // NOTE(jesper): shift the previous logs down, dropping the oldest
+    for (i32 i = LOG_FILE_COUNT - 1; i > 0; i--) {
+        if (file_exists(g_logger.paths[i-1])) {
+            rename_file(g_logger.paths[i-1], g_logger.paths[i]);
+        }
+    }
+
+    g_logger.file      = nullptr;
+    g_logger.file_size = 0;
+
+    if (create_file(g_logger.paths[0], true)) {
+        g_logger.file = open_file(g_logger.paths[0], FileAccess_write);
+    }
+
+    if (g_logger.file == nullptr) {
+        char buffer[LOG_BUFFER_SIZE];
+        snprintf(buffer, sizeof buffer, "unable to open log file: %s" FILE_EOL,
+                 g_logger.paths[0].absolute.bytes);
+        platform_output_debug_string(buffer);
+    }
+}
+
+void log_write(const char *text, i32 length)
+{
+    platform_output_debug_string(text);
+
+    if (g_logger.file != nullptr) {
+        write_file(g_logger.file, (void*)text, (usize)length);
+        g_logger.file_size += length;
+
+        if (g_logger.file_size >= LOG_FILE_MAX_SIZE) {
+            close_file(g_logger.file);
+            log_open_file();
+        }
+    }
+}
+
+u32 log_register_site(
+    const char *src_file,
+    u32 src_line,
+    const char *src_function,
+    const char *msg_format)
+{
+    u32 id = atomic_add(&g_log_sites_count, 1);
+    if (id >= LOG_MAX_SITES) {
+        return LOG_MAX_SITES;
+    }
+
+    g_log_sites[id].src_file     = src_file;
+    g_log_sites[id].src_line     = src_line;
+    g_log_sites[id].src_function = src_function;
+    g_log_sites[id].msg_format   = msg_format;
+
+    return id;
+}
+
+void log_arg_value(LogArgWriter *w, LogArgType type, u64 value)
+{
+    if (w->size + 1 + (i32)sizeof value > w->capacity) {
+        return;
+    }
+
+    w->data[w->size++] = type;
+    memcpy(&w->data[w->size], &value, sizeof value);
+    w->size += sizeof value;
+}
+
+void log_arg_string(LogArgWriter *w, const char *str, i32 length)
+{
+    if (w->size + 1 + (i32)sizeof(u16) > w->capacity) {
+        return;
+    }
+
+    u16 bytes = (u16)min(length, w->capacity - w->size - 1 - (i32)sizeof(u16));
+
+    w->data[w->size++] = LogArg_string;
+    memcpy(&w->data[w->size], &bytes, sizeof bytes);
+    w->size += sizeof bytes;
+
+    memcpy(&w->data[w->size], str, bytes);
+    w->size += bytes;
+}
+
+void log_arg(LogArgWriter *w, const char *value)
+{
+    if (value == nullptr) {
+        value = "(null)";
+    }
+
+    log_arg_string(w, value, (i32)strlen(value));
+}
+
+void log_arg(LogArgWriter *w, char *value)
+{
+    log_arg(w, (const char*)value);
+}
+
+void log_arg(LogArgWriter *w, StringView value)
+{
+    // NOTE(jesper): size may include the terminating '\0'
+    i32 length = value.size;
+    if (length > 0 && value.bytes[length-1] == '\0') {
+        length--;
+    }
+
+    log_arg_string(w, value.bytes, length);
+}
+
+bool log_read_arg(LogArgReader *r, LogArgType *type, u64 *value, char **str)
+{
+    if (r->offset + 1 > r->size) {
+        return false;
+    }
+
+    *type = (LogArgType)r->data[r->offset++];
+
+    if (*type == LogArg_string) {
+        u16 bytes;
+        memcpy(&bytes, &r->data[r->offset], sizeof bytes);
+        r->offset += sizeof bytes;
+
+        *str   = (char*)&r->data[r->offset];
+        *value = bytes;
+        r->offset += bytes;
+    } else {
+        memcpy(value, &r->data[r->offset], sizeof *value);
+        r->offset += sizeof *value;
+    }
+
+    return true;
+}
+
+// NOTE(jesper): walks the format string one conversion at a time, formatting
+// each with snprintf and the matching captured argument. Length modifiers are
+// replaced since integers are always captured as 64 bit.
+i32 log_format_args(
+    const char *format,
+    LogArgReader *r,
+    char *out,
+    i32 capacity)
+{
+    i32 length = 0;
+
+    auto append = [&](i32 written)
+    {
+        if (written > 0) {
+            length = min(length + written, capacity - 1);
+        }
+    };
+
+    const char *p = format;
+    while (*p != '\0' && length < capacity - 1) {
+        if (*p != '%') {
+            out[length++] = *p++;
+            continue;
+        }
+
+        if (p[1] == '%') {
+            out[length++] = '%';
+            p += 2;
+            continue;
+        }
+
+        char spec[32];
+        i32 s = 0;
+        spec[s++] = *p++;
+
+        LogArgType type;
+        u64 value;
+        char *str;
+
+        while (*p != '\0' && strchr("-+ #0", *p) != nullptr && s < 8) {
+            spec[s++] = *p++;
+        }
+
+        for (i32 i = 0; i < 2; i++) {
+            if (*p == '*') {
+                p++;
+                if (!log_read_arg(r, &type, &value, &str) || type == LogArg_string) {
+                    value = 0;
+                }
+                s += snprintf(spec + s, sizeof spec - (usize)s, "%d", (i32)value);
+            } else {
+                while (*p >= '0' && *p <= '9' && s < 20) {
+                    spec[s++] = *p++;
+                }
+            }
+
+            if (i == 0 && *p == '.') {
+                spec[s++] = *p++;
+            } else {
+                break;
+            }
+        }
+
+        while (*p != '\0' && strchr("hlLqjzt", *p) != nullptr) {
+            p++;
+        }
+
+        char conversion = *p;
+        if (conversion == '\0') {
+            break;
+        }
+        p++;
+
+        if (!log_read_arg(r, &type, &value, &str)) {
+            append(snprintf(out + length, (usize)(capacity - length), "<missing>"));
+            continue;
+        }
+
+        switch (conversion) {
+        case 'd':
+        case 'i':
+            spec[s++] = 'l';
+            spec[s++] = 'l';
+            spec[s++] = 'd';
+            spec[s] = '\0';
+            if (type == LogArg_string || type == LogArg_f64) {
+                goto bad_arg;
+            }
+            append(snprintf(out + length, (usize)(capacity - length), spec, (long long)value));
+            break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            spec[s++] = 'l';
+            spec[s++] = 'l';
+            spec[s++] = conversion;
+            spec[s] = '\0';
+            if (type == LogArg_string || type == LogArg_f64) {
+                goto bad_arg;
+            }
+            append(snprintf(out + length, (usize)(capacity - length), spec, (unsigned long long)value));
+            break;
+        case 'c':
+            spec[s++] = 'c';
+            spec[s] = '\0';
+            if (type != LogArg_signed && type != LogArg_unsigned) {
+                goto bad_arg;
+            }
+            append(snprintf(out + length, (usize)(capacity - length), spec, (int)value));
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A': {
+            spec[s++] = conversion;
+            spec[s] = '\0';
+            if (type != LogArg_f64) {
+                goto bad_arg;
+            }
+
+            f64 f;
+            memcpy(&f, &value, sizeof f);
+            append(snprintf(out + length, (usize)(capacity - length), spec, f));
+        } break;
+        case 's': {
+            spec[s++] = 's';
+            spec[s] = '\0';
+            if (type != LogArg_string) {
+                goto bad_arg;
+            }
+
+            char tmp[LOG_DEFERRED_ARGS_SIZE];
+            memcpy(tmp, str, (usize)value);
+            tmp[value] = '\0';
+            append(snprintf(out + length, (usize)(capacity - length), spec, tmp));
+        } break;
+        case 'p':
+            spec[s++] = 'p';
+            spec[s] = '\0';
+            if (type == LogArg_string || type == LogArg_f64) {
+                goto bad_arg;
+            }
+            append(snprintf(out + length, (usize)(capacity - length), spec, (void*)(uptr)value));
+            break;
+        default:
+        bad_arg:
+            append(snprintf(out + length, (usize)(capacity - length), "<bad arg>"));
+            break;
+        }
+    }
+
+    out[length] = '\0';
+    return length;
+}
+
+i32 log_format_deferred(
+    u32 site_id,
+    LogType type,
+    u8 *args,
+    i32 size,
+    char *out,
+    i32 capacity)
+{
+    StringView type_str = string_from_log_type(type);
+
+    if (site_id >= LOG_MAX_SITES) {
+        return snprintf(out, (usize)capacity, "log: deferred log site table full\n");
+    }
+
+    LogSite &site = g_log_sites[site_id];
+
+    i32 length = snprintf(
+        out, (usize)capacity,
+        "%s:%d: %s: [%s] ",
+        site.src_file,
+        site.src_line,
+        type_str.bytes,
+        site.src_function);
+    length = min(length, capacity - 2);
+
+    LogArgReader r = { args, size, 0 };
+    length += log_format_args(site.msg_format, &r, out + length, capacity - length - 1);
+
+    out[length++] = '\n';
+    out[length]   = '\0';
+    return length;
+}
+
+void log_deferred_push(u32 site_id, LogType type, LogArgWriter *args)
+{
+    if (!g_logger.active) {
+        // NOTE(jesper): no log thread yet, format it here instead
+        char buffer[LOG_BUFFER_SIZE];
+        log_format_deferred(
+            site_id, type,
+            args->data, args->size,
+            buffer, LOG_BUFFER_SIZE);
+
+        platform_output_debug_string(buffer);
+        return;
+    }
+
+    if (log_ring_push(&g_log_ring, site_id, type, (char*)args->data, args->size)) {
+        signal_semaphore(&g_logger.semaphore);
+    }
+}
+
+void log_drain()
+{
+    lock_mutex(&g_logger.consumer);
+    defer { unlock_mutex(&g_logger.consumer); };
+
+    LogRecord *record;
+    while ((record = log_ring_peek(&g_log_ring)) != nullptr) {
+        if (record->site_id == LOG_SITE_UNREGISTERED) {
+            log_write(record->text, record->length);
+        } else {
+            char buffer[LOG_BUFFER_SIZE];
+            i32 length = log_format_deferred(
+                record->site_id, record->type,
+                (u8*)record->text, record->length,
+                buffer, LOG_BUFFER_SIZE);
+
+            log_write(buffer, length);
+        }
+
+        log_ring_pop(&g_log_ring);
+    }
+
+    u32 dropped = atomic_load(&g_log_ring.dropped);
+    if (dropped != g_logger.dropped_reported) {
+        char buffer[128];
+        i32 length = snprintf(
+            buffer, sizeof buffer,
+            "log: dropped %u messages, ring buffer full" FILE_EOL,
+            dropped - g_logger.dropped_reported);
+
+        log_write(buffer, length);
+        g_logger.dropped_reported = dropped;
+    }
+}
+
+THREAD_PROC(log_thread_proc)
+{
+    (void)data;
+    g_log_thread = true;
+
+    while (true) {
+        wait_semaphore(&g_logger.semaphore);
+        log_drain();
+    }
+}
+
+void init_log()
+{
+    ASSERT(!g_logger.active);
+
+    g_logger.paths[0] = resolve_file_path(GamePath_preferences, "leary.log", g_persistent);
+    for (i32 i = 1; i < LOG_FILE_COUNT; i++) {
+        char name[32];
+        snprintf(name, sizeof name, "leary.%d.log", i);
+        g_logger.paths[i] = resolve_file_path(GamePath_preferences, name, g_persistent);
+    }
+
+    log_open_file();
+
+    init_mutex(&g_logger.consumer);
+    init_semaphore(&g_logger.semaphore);
+
+    create_thread(&log_thread_proc, nullptr);
+    g_logger.active = true;
+}
+
+void log_flush()
+{
+    if (g_logger.active && !g_log_thread) {
+        log_drain();
+    }
+}
+
+void log_va(
     const char *src_file,
     u32 src_line,
     const char *src_function,
     LogType type,
     const char *msg_format,
-    ...)
+    va_list args)
 {
     // TODO(jesper): src_file now contains the full absolute path. We should
     // format that a little bit better, at least for the console output - might
     // be useful to keep the full path, or at least longer path, in the file
-    // logging when we get to that
+    // logging
 
     StringView type_str = string_from_log_type(type);
 
     // TODO(jesper): look into more performant and type safe alternatives to
     // vsnprintf
-    va_list args;
     char message[LOG_BUFFER_SIZE];
     char buffer[LOG_BUFFER_SIZE];
 
-    va_start(args, msg_format);
     i32 length = vsnprintf(message, LOG_BUFFER_SIZE, msg_format, args);
-    va_end(args);
     ASSERT(length < LOG_BUFFER_SIZE);
 
     length = snprintf(
@@ -59,47 +594,47 @@ void log(
         message);
     ASSERT(length < LOG_BUFFER_SIZE);
 
-    // TODO(jesper): output to log file
-    platform_output_debug_string(buffer);
+    // NOTE(jesper): the log thread can't flush the ring without deadlocking on
+    // the consumer lock, so its asserts are written out directly
+    if (!g_logger.active || (g_log_thread && type == LOG_TYPE_ASSERT)) {
+        platform_output_debug_string(buffer);
+        return;
+    }
+
+    if (log_ring_push(&g_log_ring, LOG_SITE_UNREGISTERED, type, buffer, length)) {
+        signal_semaphore(&g_logger.semaphore);
+    }
+
+    // NOTE(jesper): make sure the message is out before we break into the
+    // debugger
+    if (type == LOG_TYPE_ASSERT) {
+        log_flush();
+    }
 }
 
 void log(
     const char *src_file,
     u32 src_line,
     const char *src_function,
+    LogType type,
     const char *msg_format,
     ...)
 {
-    // TODO(jesper): src_file now contains the full absolute path. We should
-    // format that a little bit better, at least for the console output - might
-    // be useful to keep the full path, or at least longer path, in the file
-    // logging when we get to that
-
-    StringView type_str = string_from_log_type(LOG_TYPE_DEFAULT);
-
-    // TODO(jesper): look into more performant and type safe alternatives to
-    // vsnprintf
     va_list args;
-    char message[LOG_BUFFER_SIZE];
-    char buffer[LOG_BUFFER_SIZE];
-
     va_start(args, msg_format);
-    i32 length = vsnprintf(message, LOG_BUFFER_SIZE, msg_format, args);
+    log_va(src_file, src_line, src_function, type, msg_format, args);
     va_end(args);
-    ASSERT(length < LOG_BUFFER_SIZE);
-
-    length = snprintf(
-        buffer,
-        LOG_BUFFER_SIZE,
-        "%s:%d: %s: [%s] %s\n",
-        src_file,
-        src_line,
-        type_str.bytes,
-        src_function,
-        message);
-    ASSERT(length < LOG_BUFFER_SIZE);
-
-    // TODO(jesper): output to log file
-    platform_output_debug_string(buffer);
 }
 
+void log(
+    const char *src_file,
+    u32 src_line,
+    const char *src_function,
+    const char *msg_format,
+    ...)
+{
+    va_list args;
+    va_start(args, msg_format);
+    log_va(src_file, src_line, src_function, LOG_TYPE_DEFAULT, msg_format, args);
+    va_end(args);
+}
@@ -29,6 +29,16 @@ enum LogType {
 // TODO(jesper): support arguments
 #define LOG_UNIMPLEMENTED() log(__FILE__, __LINE__, __FUNCTION__, LOG_TYPE_UNIMPLEMENTED, "fixme: stub!")
 
+#define LOG_DEFERRED(...)\
+    do {\
+        static u32 log_site = LOG_SITE_UNREGISTERED;\
+        log_deferred(&log_site, __FILE__, __LINE__, __FUNCTION__, __VA_ARGS__);\
+    } while (0)
+
+#define LOG_INFO_DEFERRED(...)    LOG_DEFERRED(LOG_TYPE_INFO, __VA_ARGS__)
+#define LOG_WARNING_DEFERRED(...) LOG_DEFERRED(LOG_TYPE_WARNING, __VA_ARGS__)
+#define LOG_ERROR_DEFERRED(...)   LOG_DEFERRED(LOG_TYPE_ERROR, __VA_ARGS__)
+
 #else
 
 #define LOG(...)            do {} while(0)
@@ -38,8 +48,21 @@ enum LogType {
 #define LOG_UNIMPLEMENTED() do {} while(0)
 #define LOG_ASSERT(...)     do {} while(0)
 
+#define LOG_DEFERRED(...)         do {} while(0)
+#define LOG_INFO_DEFERRED(...)    do {} while(0)
+#define LOG_WARNING_DEFERRED(...) do {} while(0)
+#define LOG_ERROR_DEFERRED(...)   do {} while(0)
+
 #endif // LEARY_ENABLE_LOGGING
 
+// NOTE(jesper): until init_log has been called messages are written
+// synchronously on the calling thread. After that they're queued and written to
+// stdout and the log file by the log thread, log_flush writes out anything
+// that's still queued on the calling thread. log_flush does nothing when called
+// on the log thread itself.
+void init_log();
+void log_flush();
+
 void log(
     const char *src_file,
     u32 src_line,
@@ -54,3 +77,120 @@ void log(
     const char *src_function,
     const char *msg_format,
     ...);
+
+// NOTE(jesper): deferred logging. The format string is registered once per
+// call site and each call only captures the site id and the raw argument
+// values, formatting happens on the log thread. Strings are copied, so they
+// must be null-terminated or passed as a StringView. The arguments are
+// truncated to LOG_DEFERRED_ARGS_SIZE bytes, missing arguments are printed as
+// <missing>.
+#define LOG_SITE_UNREGISTERED  (0xFFFFFFFF)
+#define LOG_DEFERRED_ARGS_SIZE (1000)
+
+enum LogArgType : u8 {
+    LogArg_signed,
+    LogArg_unsigned,
+    LogArg_f64,
+    LogArg_pointer,
+    LogArg_string,
+};
+
+struct LogArgWriter {
+    u8  *data;
+    i32 size;
+    i32 capacity;
+};
+
+struct StringView;
+
+u32  log_register_site(
+    const char *src_file,
+    u32 src_line,
+    const char *src_function,
+    const char *msg_format);
+void log_deferred_push(u32 site_id, LogType type, LogArgWriter *args);
+
+void log_arg_value(LogArgWriter *w, LogArgType type, u64 value);
+void log_arg_string(LogArgWriter *w, const char *str, i32 length);
+
+void log_arg(LogArgWriter *w, const char *value);
+void log_arg(LogArgWriter *w, char *value);
+void log_arg(LogArgWriter *w, StringView value);
+
+template<typename T>
+typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+log_arg(LogArgWriter *w, T value)
+{
+    if (std::is_signed<T>::value || std::is_enum<T>::value) {
+        log_arg_value(w, LogArg_signed, (u64)(i64)value);
+    } else {
+        log_arg_value(w, LogArg_unsigned, (u64)value);
+    }
+}
+
+template<typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type
+log_arg(LogArgWriter *w, T value)
+{
+    f64 v = (f64)value;
+
+    u64 bits;
+    memcpy(&bits, &v, sizeof bits);
+    log_arg_value(w, LogArg_f64, bits);
+}
+
+template<typename T>
+typename std::enable_if<std::is_pointer<T>::value>::type
+log_arg(LogArgWriter *w, T value)
+{
+    log_arg_value(w, LogArg_pointer, (u64)(uptr)value);
+}
+
+inline void log_args(LogArgWriter *)
+{
+}
+
+template<typename T, typename... Args>
+void log_args(LogArgWriter *w, T first, Args... rest)
+{
+    log_arg(w, first);
+    log_args(w, rest...);
+}
+
+template<typename... Args>
+void log_deferred(
+    u32 *site_id,
+    const char *src_file,
+    u32 src_line,
+    const char *src_function,
+    LogType type,
+    const char *msg_format,
+    Args... args)
+{
+    if (*site_id == LOG_SITE_UNREGISTERED) {
+        *site_id = log_register_site(src_file, src_line, src_function, msg_format);
+    }
+
+    u8 buffer[LOG_DEFERRED_ARGS_SIZE];
+    LogArgWriter w = { buffer, 0, LOG_DEFERRED_ARGS_SIZE };
+
+    log_args(&w, args...);
+    log_deferred_push(*site_id, type, &w);
+}
+
+template<typename... Args>
+void log_deferred(
+    u32 *site_id,
+    const char *src_file,
+    u32 src_line,
+    const char *src_function,
+    const char *msg_format,
+    Args... args)
+{
+    log_deferred(
+        site_id,
+        src_file, src_line, src_function,
+        LOG_TYPE_DEFAULT,
+        msg_format,
+        args...);
+}
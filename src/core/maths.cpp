@@ -50,7 +50,7 @@ inline f32 length_sq(Vector3 vec)
 
 inline f32 dot(Vector3 lhs, Vector3 rhs)
 {
-    return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * lhs.z;
+    return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
 }
 
 inline Vector3 cross(Vector3 lhs, Vector3 rhs)
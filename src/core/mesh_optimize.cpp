@@ -0,0 +1,1069 @@
+/**
+ * file:    mesh_optimize.cpp
+ * created: 2018-09-22
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+#define VERTEX_REMAP_EMPTY (0xFFFFFFFF)
+
+// NOTE(jesper): the valence score tables are clamped to this many triangles,
+// anything with more remaining triangles scores the same
+#define FORSYTH_VALENCE_SIZE (32)
+
+// NOTE(jesper): clusters are sorted by their key quantised to this many bits
+#define OVERDRAW_SORT_BITS (11)
+
+f32 compute_acmr(
+    u32 *indices, i32 index_count,
+    i32 vertex_count,
+    i32 cache_size,
+    Allocator *scratch)
+{
+    if (index_count == 0) {
+        return 0.0f;
+    }
+
+    // NOTE(jesper): a vertex is in the cache if it was added less than
+    // cache_size misses ago
+    u32 *timestamps = alloc_array(scratch, u32, vertex_count);
+    memset(timestamps, 0, vertex_count * sizeof(u32));
+
+    u32 misses = 0;
+    u32 time   = (u32)cache_size + 1;
+    for (i32 i = 0; i < index_count; i++) {
+        u32 v = indices[i];
+        if (time - timestamps[v] > (u32)cache_size) {
+            timestamps[v] = time++;
+            misses++;
+        }
+    }
+
+    dealloc(scratch, timestamps);
+    return (f32)misses / (f32)(index_count / 3);
+}
+
+struct ForsythScores {
+    f32 cache[VERTEX_CACHE_SIZE];
+    f32 valence[FORSYTH_VALENCE_SIZE];
+};
+
+ForsythScores forsyth_scores()
+{
+    ForsythScores scores;
+
+    // NOTE(jesper): the three vertices of the last triangle get a fixed score,
+    // slightly lower than the rest, so that the next triangle doesn't just
+    // share an edge with the last one and create a long strip
+    for (i32 i = 0; i < VERTEX_CACHE_SIZE; i++) {
+        if (i < 3) {
+            scores.cache[i] = 0.75f;
+        } else {
+            f32 s = 1.0f - (f32)(i - 3) / (f32)(VERTEX_CACHE_SIZE - 3);
+            scores.cache[i] = powf(s, 1.5f);
+        }
+    }
+
+    // NOTE(jesper): boost vertices with few triangles left so that they get
+    // finished off instead of left behind
+    scores.valence[0] = 0.0f;
+    for (i32 i = 1; i < FORSYTH_VALENCE_SIZE; i++) {
+        scores.valence[i] = 2.0f / sqrtf((f32)i);
+    }
+
+    return scores;
+}
+
+f32 forsyth_vertex_score(ForsythScores *scores, i32 cache_position, u32 valence)
+{
+    if (valence == 0) {
+        return -1.0f;
+    }
+
+    f32 score = cache_position >= 0 ? scores->cache[cache_position] : 0.0f;
+    return score + scores->valence[MIN(valence, FORSYTH_VALENCE_SIZE - 1)];
+}
+
+void optimize_vertex_cache(
+    u32 *indices, i32 index_count,
+    i32 vertex_count,
+    Allocator *scratch)
+{
+    i32 triangle_count = index_count / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    ForsythScores scores = forsyth_scores();
+
+    u32 *valence   = alloc_array(scratch, u32, vertex_count);
+    u32 *offsets   = alloc_array(scratch, u32, vertex_count);
+    u32 *adjacency = alloc_array(scratch, u32, index_count);
+    f32 *v_scores  = alloc_array(scratch, f32, vertex_count);
+    bool *emitted  = alloc_array(scratch, bool, triangle_count);
+    u32 *output    = alloc_array(scratch, u32, index_count);
+
+    memset(valence, 0, vertex_count * sizeof(u32));
+    memset(emitted, 0, triangle_count * sizeof(bool));
+
+    for (i32 i = 0; i < index_count; i++) {
+        valence[indices[i]]++;
+    }
+
+    u32 offset = 0;
+    for (i32 i = 0; i < vertex_count; i++) {
+        offsets[i] = offset;
+        offset    += valence[i];
+        valence[i] = 0;
+    }
+
+    // NOTE(jesper): valence doubles as the number of remaining triangles in
+    // each vertex's adjacency list, emitted triangles are swapped to the end
+    for (i32 i = 0; i < triangle_count; i++) {
+        for (i32 j = 0; j < 3; j++) {
+            u32 v = indices[i*3 + j];
+            adjacency[offsets[v] + valence[v]++] = (u32)i;
+        }
+    }
+
+    for (i32 i = 0; i < vertex_count; i++) {
+        v_scores[i] = forsyth_vertex_score(&scores, -1, valence[i]);
+    }
+
+    i32 best       = -1;
+    f32 best_score = -1.0f;
+    for (i32 i = 0; i < triangle_count; i++) {
+        u32 *t    = &indices[i*3];
+        f32 score = v_scores[t[0]] + v_scores[t[1]] + v_scores[t[2]];
+
+        if (score > best_score) {
+            best       = i;
+            best_score = score;
+        }
+    }
+
+    u32 cache[VERTEX_CACHE_SIZE + 3];
+    u32 new_cache[VERTEX_CACHE_SIZE + 3];
+    i32 cache_count = 0;
+
+    i32 cursor = 0;
+    for (i32 out = 0; out < triangle_count; out++) {
+        // NOTE(jesper): none of the triangles touching the cache are left,
+        // continue with the next remaining triangle in input order instead of
+        // searching the whole mesh
+        if (best == -1) {
+            while (emitted[cursor]) {
+                cursor++;
+            }
+            best = cursor;
+        }
+
+        u32 *t = &indices[best*3];
+        output[out*3 + 0] = t[0];
+        output[out*3 + 1] = t[1];
+        output[out*3 + 2] = t[2];
+        emitted[best] = true;
+
+        for (i32 j = 0; j < 3; j++) {
+            u32 v = t[j];
+
+            u32 *list = &adjacency[offsets[v]];
+            for (u32 k = 0; k < valence[v]; k++) {
+                if (list[k] == (u32)best) {
+                    list[k] = list[valence[v] - 1];
+                    break;
+                }
+            }
+
+            valence[v]--;
+        }
+
+        i32 new_count = 0;
+        new_cache[new_count++] = t[0];
+        new_cache[new_count++] = t[1];
+        new_cache[new_count++] = t[2];
+
+        for (i32 i = 0; i < cache_count; i++) {
+            u32 v = cache[i];
+            if (v != t[0] && v != t[1] && v != t[2]) {
+                new_cache[new_count++] = v;
+            }
+        }
+
+        // NOTE(jesper): the vertices pushed out of the cache still need their
+        // triangles rescored, they're only dropped after that
+        for (i32 i = 0; i < new_count; i++) {
+            u32 v = new_cache[i];
+            i32 pos = i < VERTEX_CACHE_SIZE ? i : -1;
+
+            cache[i]    = v;
+            v_scores[v] = forsyth_vertex_score(&scores, pos, valence[v]);
+        }
+
+        best       = -1;
+        best_score = -1.0f;
+        for (i32 i = 0; i < new_count; i++) {
+            u32 v = cache[i];
+
+            u32 *list = &adjacency[offsets[v]];
+            for (u32 k = 0; k < valence[v]; k++) {
+                u32 tri   = list[k];
+                u32 *tv   = &indices[tri*3];
+                f32 score = v_scores[tv[0]] + v_scores[tv[1]] + v_scores[tv[2]];
+
+                if (score > best_score) {
+                    best       = (i32)tri;
+                    best_score = score;
+                }
+            }
+        }
+
+        cache_count = MIN(new_count, VERTEX_CACHE_SIZE);
+    }
+
+    memcpy(indices, output, index_count * sizeof(u32));
+
+    dealloc(scratch, output);
+    dealloc(scratch, emitted);
+    dealloc(scratch, v_scores);
+    dealloc(scratch, adjacency);
+    dealloc(scratch, offsets);
+    dealloc(scratch, valence);
+}
+
+void optimize_overdraw(
+    u32 *indices, i32 index_count,
+    Vector3 *points, i32 vertex_count,
+    Allocator *scratch)
+{
+    i32 triangle_count = index_count / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    // NOTE(jesper): a cluster starts at every triangle where all three
+    // vertices miss the FIFO cache. Only the hits on vertices left in the cache
+    // by the previous cluster can be lost when the clusters are reordered.
+    u32 *clusters   = alloc_array(scratch, u32, triangle_count + 1);
+    u32 *timestamps = alloc_array(scratch, u32, vertex_count);
+    memset(timestamps, 0, vertex_count * sizeof(u32));
+
+    i32 cluster_count = 0;
+    u32 time          = VERTEX_CACHE_FIFO_SIZE + 1;
+    for (i32 i = 0; i < triangle_count; i++) {
+        i32 misses = 0;
+        for (i32 j = 0; j < 3; j++) {
+            u32 v = indices[i*3 + j];
+            if (time - timestamps[v] > VERTEX_CACHE_FIFO_SIZE) {
+                timestamps[v] = time++;
+                misses++;
+            }
+        }
+
+        if (i == 0 || misses == 3) {
+            clusters[cluster_count++] = (u32)i;
+        }
+    }
+    clusters[cluster_count] = (u32)triangle_count;
+
+    dealloc(scratch, timestamps);
+
+    f32 *keys = alloc_array(scratch, f32, cluster_count);
+    Vector3 *centroids = alloc_array(scratch, Vector3, cluster_count);
+    Vector3 *normals   = alloc_array(scratch, Vector3, cluster_count);
+
+    // NOTE(jesper): area weighted centroid and normal of every cluster, the
+    // normal is left unnormalised as the cross products already carry the
+    // area
+    Vector3 mesh_centroid = {};
+    f32 mesh_area         = 0.0f;
+    for (i32 c = 0; c < cluster_count; c++) {
+        Vector3 centroid = {};
+        Vector3 normal   = {};
+        f32 area         = 0.0f;
+
+        for (u32 i = clusters[c]; i < clusters[c+1]; i++) {
+            Vector3 p0 = points[indices[i*3 + 0]];
+            Vector3 p1 = points[indices[i*3 + 1]];
+            Vector3 p2 = points[indices[i*3 + 2]];
+
+            Vector3 n = cross(p1 - p0, p2 - p0);
+            f32 a     = length(n);
+
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal   += n;
+            area     += a;
+        }
+
+        if (area > 0.0f) {
+            centroid = centroid / area;
+        }
+
+        centroids[c]   = centroid;
+        normals[c]     = normal;
+        mesh_centroid += centroid * area;
+        mesh_area     += area;
+    }
+
+    if (mesh_area > 0.0f) {
+        mesh_centroid = mesh_centroid / mesh_area;
+    }
+
+    // NOTE(jesper): clusters far out along their own normal are more likely to
+    // occlude the rest of the mesh, so they're drawn first
+    f32 key_min = F32_MAX;
+    f32 key_max = -F32_MAX;
+    for (i32 c = 0; c < cluster_count; c++) {
+        f32 n_length = length(normals[c]);
+        Vector3 n    = n_length > 0.0f ? normals[c] / n_length : Vector3{};
+
+        keys[c] = dot(centroids[c] - mesh_centroid, n);
+        key_min = MIN(key_min, keys[c]);
+        key_max = MAX(key_max, keys[c]);
+    }
+
+    dealloc(scratch, normals);
+    dealloc(scratch, centroids);
+
+    // NOTE(jesper): counting sort on the quantised keys, descending, which is
+    // stable so that clusters with similar keys keep their cache order
+    const i32 bucket_count = 1 << OVERDRAW_SORT_BITS;
+    u32 *buckets = alloc_array(scratch, u32, bucket_count + 1);
+    u32 *order   = alloc_array(scratch, u32, cluster_count);
+    u32 *quantised = (u32*)keys;
+    memset(buckets, 0, (bucket_count + 1) * sizeof(u32));
+
+    f32 key_scale = key_max > key_min ? (bucket_count - 1) / (key_max - key_min) : 0.0f;
+    for (i32 c = 0; c < cluster_count; c++) {
+        i32 q = (i32)((key_max - keys[c]) * key_scale + 0.5f);
+        q = q < 0 ? 0 : q;
+        q = q > bucket_count - 1 ? bucket_count - 1 : q;
+
+        quantised[c] = (u32)q;
+        buckets[quantised[c] + 1]++;
+    }
+
+    for (i32 i = 0; i < bucket_count; i++) {
+        buckets[i+1] += buckets[i];
+    }
+
+    for (i32 c = 0; c < cluster_count; c++) {
+        order[buckets[quantised[c]]++] = (u32)c;
+    }
+
+    u32 *output = alloc_array(scratch, u32, index_count);
+
+    i32 out = 0;
+    for (i32 i = 0; i < cluster_count; i++) {
+        u32 c     = order[i];
+        u32 first = clusters[c] * 3;
+        u32 count = (clusters[c+1] - clusters[c]) * 3;
+
+        memcpy(&output[out], &indices[first], count * sizeof(u32));
+        out += count;
+    }
+    ASSERT(out == index_count);
+
+    memcpy(indices, output, index_count * sizeof(u32));
+
+    dealloc(scratch, output);
+    dealloc(scratch, order);
+    dealloc(scratch, buckets);
+    dealloc(scratch, keys);
+    dealloc(scratch, clusters);
+}
+
+i32 optimize_vertex_fetch(
+    u32 *remap,
+    u32 *indices, i32 index_count,
+    i32 vertex_count)
+{
+    memset(remap, 0xFF, vertex_count * sizeof(u32));
+
+    u32 next = 0;
+    for (i32 i = 0; i < index_count; i++) {
+        u32 v = indices[i];
+        if (remap[v] == VERTEX_REMAP_EMPTY) {
+            remap[v] = next++;
+        }
+
+        indices[i] = remap[v];
+    }
+
+    return (i32)next;
+}
+
+u32 vertex_streams_hash(VertexStream *streams, i32 stream_count, u32 index)
+{
+    u32 h = 0x811c9dc5;
+    for (i32 i = 0; i < stream_count; i++) {
+        u8 *data = (u8*)streams[i].data + index * streams[i].stride;
+        for (usize j = 0; j < streams[i].stride; j++) {
+            h ^= data[j];
+            h *= 0x01000193;
+        }
+    }
+
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+bool vertex_streams_equal(VertexStream *streams, i32 stream_count, u32 lhs, u32 rhs)
+{
+    for (i32 i = 0; i < stream_count; i++) {
+        usize stride = streams[i].stride;
+        u8 *data     = (u8*)streams[i].data;
+        if (memcmp(data + lhs * stride, data + rhs * stride, stride) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+i32 generate_vertex_remap(
+    u32 *remap,
+    VertexStream *streams, i32 stream_count,
+    i32 vertex_count,
+    Allocator *scratch)
+{
+    // NOTE(jesper): open addressed table of vertex indices at a load factor of
+    // at most 1/2
+    u32 capacity = 1;
+    while (capacity < (u32)vertex_count * 2) {
+        capacity *= 2;
+    }
+
+    u32 mask   = capacity - 1;
+    u32 *table = alloc_array(scratch, u32, capacity);
+    memset(table, 0xFF, capacity * sizeof(u32));
+
+    u32 next = 0;
+    for (i32 i = 0; i < vertex_count; i++) {
+        u32 slot = vertex_streams_hash(streams, stream_count, (u32)i) & mask;
+        while (table[slot] != VERTEX_REMAP_EMPTY &&
+               !vertex_streams_equal(streams, stream_count, table[slot], (u32)i))
+        {
+            slot = (slot + 1) & mask;
+        }
+
+        if (table[slot] == VERTEX_REMAP_EMPTY) {
+            table[slot] = (u32)i;
+            remap[i]    = next++;
+        } else {
+            remap[i] = remap[table[slot]];
+        }
+    }
+
+    dealloc(scratch, table);
+    return (i32)next;
+}
+
+void remap_vertex_stream(
+    VertexStream stream,
+    i32 vertex_count,
+    u32 *remap,
+    Allocator *scratch)
+{
+    usize size = vertex_count * stream.stride;
+    u8 *copy   = (u8*)alloc(scratch, size);
+    memcpy(copy, stream.data, size);
+
+    u8 *data = (u8*)stream.data;
+    for (i32 i = 0; i < vertex_count; i++) {
+        if (remap[i] != VERTEX_REMAP_EMPTY) {
+            memcpy(data + remap[i] * stream.stride, copy + i * stream.stride, stream.stride);
+        }
+    }
+
+    dealloc(scratch, copy);
+}
+
+// NOTE(jesper): symmetric 4x4 matrix of the summed plane equations, and the
+// summed triangle area they were weighted by so that the error can be turned
+// back into a squared distance
+struct Quadric {
+    f32 a00, a11, a22;
+    f32 a01, a02, a12;
+    f32 b0, b1, b2;
+    f32 c;
+    f32 w;
+};
+
+struct SimplifyCollapse {
+    u32 v0;
+    u32 v1;
+    f32 error;
+};
+
+void quadric_add(Quadric *q, Quadric other)
+{
+    q->a00 += other.a00;
+    q->a11 += other.a11;
+    q->a22 += other.a22;
+    q->a01 += other.a01;
+    q->a02 += other.a02;
+    q->a12 += other.a12;
+    q->b0  += other.b0;
+    q->b1  += other.b1;
+    q->b2  += other.b2;
+    q->c   += other.c;
+    q->w   += other.w;
+}
+
+Quadric quadric_from_triangle(Vector3 p0, Vector3 p1, Vector3 p2)
+{
+    Vector3 n = cross(p1 - p0, p2 - p0);
+    f32 area  = length(n);
+
+    Quadric q = {};
+    if (area == 0.0f) {
+        return q;
+    }
+
+    n = n / area;
+    f32 d = -dot(n, p0);
+
+    q.a00 = area * n.x * n.x;
+    q.a11 = area * n.y * n.y;
+    q.a22 = area * n.z * n.z;
+    q.a01 = area * n.x * n.y;
+    q.a02 = area * n.x * n.z;
+    q.a12 = area * n.y * n.z;
+    q.b0  = area * n.x * d;
+    q.b1  = area * n.y * d;
+    q.b2  = area * n.z * d;
+    q.c   = area * d * d;
+    q.w   = area;
+    return q;
+}
+
+f32 quadric_error(Quadric *q, Vector3 p)
+{
+    f32 rx = q->a00 * p.x + q->a01 * p.y + q->a02 * p.z + q->b0;
+    f32 ry = q->a01 * p.x + q->a11 * p.y + q->a12 * p.z + q->b1;
+    f32 rz = q->a02 * p.x + q->a12 * p.y + q->a22 * p.z + q->b2;
+
+    f32 e = p.x * rx + p.y * ry + p.z * rz;
+    e += q->b0 * p.x + q->b1 * p.y + q->b2 * p.z + q->c;
+
+    e = q->w > 0.0f ? e / q->w : 0.0f;
+    return e > 0.0f ? e : 0.0f;
+}
+
+u32 simplify_edge_hash(u64 key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return (u32)key;
+}
+
+// NOTE(jesper): open addressed set of the directed edges between unique
+// positions, used to find the border edges that don't have a twin
+struct SimplifyEdgeSet {
+    u64 *keys;
+    u32 mask;
+};
+
+void simplify_edge_insert(SimplifyEdgeSet *set, u32 a, u32 b)
+{
+    u64 key  = ((u64)a << 32) | b;
+    u32 slot = simplify_edge_hash(key) & set->mask;
+    while (set->keys[slot] != U64_MAX && set->keys[slot] != key) {
+        slot = (slot + 1) & set->mask;
+    }
+    set->keys[slot] = key;
+}
+
+bool simplify_edge_exists(SimplifyEdgeSet *set, u32 a, u32 b)
+{
+    u64 key  = ((u64)a << 32) | b;
+    u32 slot = simplify_edge_hash(key) & set->mask;
+    while (set->keys[slot] != U64_MAX) {
+        if (set->keys[slot] == key) {
+            return true;
+        }
+        slot = (slot + 1) & set->mask;
+    }
+    return false;
+}
+
+// NOTE(jesper): LSD radix sort of the collapses by error, 11 bits per pass.
+// The errors are never negative so their bits sort the same as the floats.
+void simplify_sort_collapses(
+    u32 *order,
+    SimplifyCollapse *collapses, i32 count,
+    Allocator *scratch)
+{
+    u32 *keys = alloc_array(scratch, u32, count);
+    u32 *tmp  = alloc_array(scratch, u32, count);
+
+    for (i32 i = 0; i < count; i++) {
+        memcpy(&keys[i], &collapses[i].error, sizeof(u32));
+        order[i] = (u32)i;
+    }
+
+    for (i32 shift = 0; shift < 32; shift += 11) {
+        u32 histogram[2048] = {};
+        for (i32 i = 0; i < count; i++) {
+            histogram[(keys[order[i]] >> shift) & 2047]++;
+        }
+
+        u32 sum = 0;
+        for (i32 i = 0; i < 2048; i++) {
+            u32 c = histogram[i];
+            histogram[i] = sum;
+            sum += c;
+        }
+
+        for (i32 i = 0; i < count; i++) {
+            u32 k = order[i];
+            tmp[histogram[(keys[k] >> shift) & 2047]++] = k;
+        }
+
+        memcpy(order, tmp, count * sizeof(u32));
+    }
+
+    dealloc(scratch, tmp);
+    dealloc(scratch, keys);
+}
+
+// NOTE(jesper): true if moving v0 onto v1 flips any of the triangles around v0
+// that aren't removed by the collapse
+bool simplify_collapse_flips(
+    u32 v0, u32 v1,
+    u32 *indices,
+    u32 *adjacency, u32 *offsets, u32 *counts,
+    Vector3 *points)
+{
+    Vector3 p1 = points[v1];
+
+    u32 *list = &adjacency[offsets[v0]];
+    for (u32 i = 0; i < counts[v0]; i++) {
+        u32 *t = &indices[list[i] * 3];
+        if (t[0] == v1 || t[1] == v1 || t[2] == v1) {
+            continue;
+        }
+
+        Vector3 a = points[t[0]];
+        Vector3 b = points[t[1]];
+        Vector3 c = points[t[2]];
+        Vector3 before = cross(b - a, c - a);
+
+        a = t[0] == v0 ? p1 : a;
+        b = t[1] == v0 ? p1 : b;
+        c = t[2] == v0 ? p1 : c;
+        Vector3 after = cross(b - a, c - a);
+
+        // NOTE(jesper): also reject the collapses that turn a triangle more
+        // than ~75 degrees, those are almost always slivers about to fold
+        if (dot(before, after) <= 0.25f * length(before) * length(after)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+i32 simplify_mesh(
+    u32 *dst,
+    u32 *indices, i32 index_count,
+    Vector3 *points, i32 vertex_count,
+    i32 target_index_count,
+    f32 *error,
+    Allocator *scratch)
+{
+    *error = 0.0f;
+    memcpy(dst, indices, index_count * sizeof(u32));
+
+    // NOTE(jesper): every vertex is mapped to the first vertex with the same
+    // position, vertices that share their position with another are on an
+    // attribute seam
+    u32 *remap    = alloc_array(scratch, u32, vertex_count);
+    u32 *position = alloc_array(scratch, u32, vertex_count);
+    bool *locked  = alloc_array(scratch, bool, vertex_count);
+
+    VertexStream stream = { points, sizeof *points };
+    i32 unique = generate_vertex_remap(remap, &stream, 1, vertex_count, scratch);
+
+    u32 *first = alloc_array(scratch, u32, unique);
+    memset(first, 0xFF, unique * sizeof(u32));
+
+    for (i32 i = 0; i < vertex_count; i++) {
+        if (first[remap[i]] == VERTEX_REMAP_EMPTY) {
+            first[remap[i]] = (u32)i;
+            locked[i] = false;
+        } else {
+            locked[i] = true;
+            locked[first[remap[i]]] = true;
+        }
+        position[i] = first[remap[i]];
+    }
+
+    u32 edge_capacity = 1;
+    while (edge_capacity < (u32)index_count * 2) {
+        edge_capacity *= 2;
+    }
+
+    SimplifyEdgeSet edges;
+    edges.mask = edge_capacity - 1;
+    edges.keys = alloc_array(scratch, u64, edge_capacity);
+    memset(edges.keys, 0xFF, edge_capacity * sizeof(u64));
+
+    for (i32 i = 0; i < index_count; i += 3) {
+        for (i32 j = 0; j < 3; j++) {
+            u32 a = position[dst[i + j]];
+            u32 b = position[dst[i + (j + 1) % 3]];
+            simplify_edge_insert(&edges, a, b);
+        }
+    }
+
+    for (i32 i = 0; i < index_count; i += 3) {
+        for (i32 j = 0; j < 3; j++) {
+            u32 a = position[dst[i + j]];
+            u32 b = position[dst[i + (j + 1) % 3]];
+            if (!simplify_edge_exists(&edges, b, a)) {
+                locked[dst[i + j]] = true;
+                locked[dst[i + (j + 1) % 3]] = true;
+            }
+        }
+    }
+
+    Quadric *quadrics = alloc_array(scratch, Quadric, vertex_count);
+    memset(quadrics, 0, vertex_count * sizeof(Quadric));
+
+    for (i32 i = 0; i < index_count; i += 3) {
+        Quadric q = quadric_from_triangle(
+            points[dst[i + 0]],
+            points[dst[i + 1]],
+            points[dst[i + 2]]);
+
+        quadric_add(&quadrics[position[dst[i + 0]]], q);
+        quadric_add(&quadrics[position[dst[i + 1]]], q);
+        quadric_add(&quadrics[position[dst[i + 2]]], q);
+    }
+
+    u32 *counts    = alloc_array(scratch, u32, vertex_count);
+    u32 *offsets   = alloc_array(scratch, u32, vertex_count);
+    u32 *adjacency = alloc_array(scratch, u32, index_count);
+    u32 *collapse_remap = alloc_array(scratch, u32, vertex_count);
+    bool *collapse_locked = alloc_array(scratch, bool, vertex_count);
+    SimplifyCollapse *collapses = alloc_array(scratch, SimplifyCollapse, index_count * 2);
+    u32 *order = alloc_array(scratch, u32, index_count * 2);
+
+    f32 max_error = 0.0f;
+
+    i32 count = index_count;
+    while (count > target_index_count) {
+        memset(counts, 0, vertex_count * sizeof(u32));
+        for (i32 i = 0; i < count; i++) {
+            counts[dst[i]]++;
+        }
+
+        u32 offset = 0;
+        for (i32 i = 0; i < vertex_count; i++) {
+            offsets[i] = offset;
+            offset    += counts[i];
+            counts[i]  = 0;
+        }
+
+        for (i32 i = 0; i < count; i++) {
+            adjacency[offsets[dst[i]] + counts[dst[i]]++] = (u32)(i / 3);
+        }
+
+        i32 collapse_count = 0;
+        for (i32 i = 0; i < count; i += 3) {
+            for (i32 j = 0; j < 3; j++) {
+                u32 v0 = dst[i + j];
+                u32 v1 = dst[i + (j + 1) % 3];
+
+                // NOTE(jesper): edges with an unlocked vertex aren't on the
+                // border, so they're seen once in each direction from the two
+                // triangles sharing them
+                if (position[v0] > position[v1]) {
+                    continue;
+                }
+
+                if (!locked[v0]) {
+                    Quadric q = quadrics[v0];
+                    quadric_add(&q, quadrics[position[v1]]);
+                    collapses[collapse_count++] = { v0, v1, quadric_error(&q, points[v1]) };
+                }
+
+                if (!locked[v1]) {
+                    Quadric q = quadrics[v1];
+                    quadric_add(&q, quadrics[position[v0]]);
+                    collapses[collapse_count++] = { v1, v0, quadric_error(&q, points[v0]) };
+                }
+            }
+        }
+
+        if (collapse_count == 0) {
+            break;
+        }
+
+        simplify_sort_collapses(order, collapses, collapse_count, scratch);
+
+        for (i32 i = 0; i < vertex_count; i++) {
+            collapse_remap[i] = (u32)i;
+        }
+        memset(collapse_locked, 0, vertex_count * sizeof(bool));
+
+        // NOTE(jesper): an interior collapse removes two triangles. Only half
+        // of what's left to remove is collapsed per pass, as the errors of the
+        // later collapses go stale once their neighbours have moved.
+        i32 goal = (count - target_index_count) / 3 / 2;
+        goal = goal > 0 ? goal : 1;
+
+        i32 collapsed = 0;
+        for (i32 i = 0; i < collapse_count && collapsed < goal; i++) {
+            SimplifyCollapse c = collapses[order[i]];
+            if (collapse_locked[c.v0] || collapse_locked[c.v1]) {
+                continue;
+            }
+
+            if (simplify_collapse_flips(c.v0, c.v1, dst, adjacency, offsets, counts, points)) {
+                continue;
+            }
+
+            // NOTE(jesper): nothing around v0 may move for the rest of the
+            // pass, otherwise the flip checks of later collapses would be
+            // made against stale triangles
+            u32 *list = &adjacency[offsets[c.v0]];
+            for (u32 j = 0; j < counts[c.v0]; j++) {
+                u32 *t = &dst[list[j] * 3];
+                collapse_locked[t[0]] = true;
+                collapse_locked[t[1]] = true;
+                collapse_locked[t[2]] = true;
+            }
+
+            collapse_remap[c.v0] = c.v1;
+
+            quadric_add(&quadrics[position[c.v1]], quadrics[c.v0]);
+            max_error = max_error > c.error ? max_error : c.error;
+            collapsed++;
+        }
+
+        if (collapsed == 0) {
+            break;
+        }
+
+        i32 write = 0;
+        for (i32 i = 0; i < count; i += 3) {
+            u32 a = collapse_remap[dst[i + 0]];
+            u32 b = collapse_remap[dst[i + 1]];
+            u32 c = collapse_remap[dst[i + 2]];
+
+            if (position[a] != position[b] &&
+                position[a] != position[c] &&
+                position[b] != position[c])
+            {
+                dst[write++] = a;
+                dst[write++] = b;
+                dst[write++] = c;
+            }
+        }
+
+        count = write;
+    }
+
+    dealloc(scratch, order);
+    dealloc(scratch, collapses);
+    dealloc(scratch, collapse_locked);
+    dealloc(scratch, collapse_remap);
+    dealloc(scratch, adjacency);
+    dealloc(scratch, offsets);
+    dealloc(scratch, counts);
+    dealloc(scratch, quadrics);
+    dealloc(scratch, edges.keys);
+    dealloc(scratch, first);
+    dealloc(scratch, locked);
+    dealloc(scratch, position);
+    dealloc(scratch, remap);
+
+    *error = sqrtf(max_error);
+    return count;
+}
+
+// NOTE(jesper): round to nearest even, values out of range become infinity and
+// values too small for a denormal become zero
+u16 f16_from_f32(f32 f)
+{
+    u32 x;
+    memcpy(&x, &f, sizeof x);
+
+    u32 sign = (x >> 16) & 0x8000;
+    u32 magnitude = x & 0x7FFFFFFF;
+    u32 mantissa = x & 0x007FFFFF;
+    i32 exponent = (i32)((x >> 23) & 0xFF) - 127 + 15;
+
+    if (magnitude > 0x7F800000) {
+        return (u16)(sign | 0x7E00);
+    }
+
+    if (exponent >= 31) {
+        return (u16)(sign | 0x7C00);
+    }
+
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return (u16)sign;
+        }
+
+        mantissa |= 0x00800000;
+
+        u32 shift = (u32)(14 - exponent);
+        u32 h     = mantissa >> shift;
+        u32 rest  = mantissa & ((1u << shift) - 1);
+        u32 half  = 1u << (shift - 1);
+        if (rest > half || (rest == half && (h & 1))) {
+            h++;
+        }
+
+        return (u16)(sign | h);
+    }
+
+    // NOTE(jesper): rounding up may carry into the exponent, which is still
+    // the correctly rounded result
+    u32 h    = ((u32)exponent << 10) | (mantissa >> 13);
+    u32 rest = mantissa & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (h & 1))) {
+        h++;
+    }
+
+    return (u16)(sign | h);
+}
+
+// NOTE(jesper): the three smallest components of a unit quaternion are within
+// +-1/sqrt(2)
+#define QUATERNION_COMPONENT_MAX (0.70710678f)
+
+u32 pack_unorm10(f32 f)
+{
+    f = f < -1.0f ? -1.0f : f;
+    f = f > 1.0f ? 1.0f : f;
+    return (u32)((f * 0.5f + 0.5f) * 1023.0f + 0.5f);
+}
+
+u32 pack_tangent_frame(Vector3 normal, Vector3 tangent, Vector3 bitangent, bool *flipped)
+{
+    Vector3 n = normal;
+    f32 n_length = length(n);
+    n = n_length > 0.0f ? n / n_length : Vector3{ 0.0f, 0.0f, 1.0f };
+
+    // NOTE(jesper): Gram-Schmidt, the per triangle tangents aren't orthogonal
+    // to the per vertex normals
+    Vector3 t = tangent - n * dot(n, tangent);
+    f32 t_length = length(t);
+    if (t_length < 0.0001f) {
+        Vector3 axis = n.x * n.x < 0.81f ? Vector3{ 1.0f, 0.0f, 0.0f } : Vector3{ 0.0f, 1.0f, 0.0f };
+        t = cross(n, axis);
+        t_length = length(t);
+    }
+    t = t / t_length;
+
+    Vector3 b = cross(n, t);
+    *flipped = dot(b, bitangent) < 0.0f;
+
+    // NOTE(jesper): quaternion of the rotation matrix with the columns t, b, n
+    f32 q[4];
+    f32 trace = t.x + b.y + n.z;
+    if (trace > 0.0f) {
+        f32 s = sqrtf(trace + 1.0f) * 2.0f;
+        q[3] = 0.25f * s;
+        q[0] = (b.z - n.y) / s;
+        q[1] = (n.x - t.z) / s;
+        q[2] = (t.y - b.x) / s;
+    } else if (t.x > b.y && t.x > n.z) {
+        f32 s = sqrtf(1.0f + t.x - b.y - n.z) * 2.0f;
+        q[3] = (b.z - n.y) / s;
+        q[0] = 0.25f * s;
+        q[1] = (b.x + t.y) / s;
+        q[2] = (n.x + t.z) / s;
+    } else if (b.y > n.z) {
+        f32 s = sqrtf(1.0f + b.y - t.x - n.z) * 2.0f;
+        q[3] = (n.x - t.z) / s;
+        q[0] = (b.x + t.y) / s;
+        q[1] = 0.25f * s;
+        q[2] = (n.y + b.z) / s;
+    } else {
+        f32 s = sqrtf(1.0f + n.z - t.x - b.y) * 2.0f;
+        q[3] = (t.y - b.x) / s;
+        q[0] = (n.x + t.z) / s;
+        q[1] = (n.y + b.z) / s;
+        q[2] = 0.25f * s;
+    }
+
+    // NOTE(jesper): smallest three encoding. The largest component is dropped
+    // and reconstructed from the others, q and -q being the same rotation it's
+    // made positive. Reconstructing a component close to 0 instead would be
+    // far too sensitive to the quantisation of the others.
+    i32 largest = 0;
+    for (i32 i = 1; i < 4; i++) {
+        if (q[i] * q[i] > q[largest] * q[largest]) {
+            largest = i;
+        }
+    }
+
+    f32 sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+
+    u32 packed = (u32)largest << 30;
+    for (i32 i = 0, j = 0; i < 4; i++) {
+        if (i != largest) {
+            packed |= pack_unorm10(sign * q[i] / QUATERNION_COMPONENT_MAX) << (10 * j++);
+        }
+    }
+
+    return packed;
+}
+
+void pack_vertices(
+    PackedVertex *dst,
+    i32 vertex_count,
+    Vector3 *points,
+    Vector3 *normals,
+    Vector3 *tangents,
+    Vector3 *bitangents,
+    Vector2 *uvs,
+    Vector3 bounds_min,
+    Vector3 bounds_extent)
+{
+    Vector3 scale;
+    for (i32 i = 0; i < 3; i++) {
+        scale.data[i] = bounds_extent.data[i] > 0.0f ? 65535.0f / bounds_extent.data[i] : 0.0f;
+    }
+
+    for (i32 i = 0; i < vertex_count; i++) {
+        PackedVertex v = {};
+
+        for (i32 j = 0; j < 3; j++) {
+            f32 p = (points[i].data[j] - bounds_min.data[j]) * scale.data[j] + 0.5f;
+            p = p < 0.0f ? 0.0f : p;
+            p = p > 65535.0f ? 65535.0f : p;
+            v.position[j] = (u16)p;
+        }
+
+        Vector3 n = normals != nullptr ? normals[i] : Vector3{ 0.0f, 0.0f, 1.0f };
+        Vector3 t = tangents != nullptr ? tangents[i] : Vector3{};
+        Vector3 b = bitangents != nullptr ? bitangents[i] : cross(n, t);
+
+        bool flipped;
+        v.tangent_frame = pack_tangent_frame(n, t, b, &flipped);
+        v.position[3]   = flipped ? 0xFFFF : 0;
+
+        if (uvs != nullptr) {
+            v.uv[0] = f16_from_f32(uvs[i].x);
+            v.uv[1] = f16_from_f32(uvs[i].y);
+        }
+
+        dst[i] = v;
+    }
+}
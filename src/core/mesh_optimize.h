@@ -0,0 +1,127 @@
+/**
+ * file:    mesh_optimize.h
+ * created: 2018-09-22
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): size of the LRU cache modelled by optimize_vertex_cache, and of
+// the FIFO cache used to measure the result. Post-transform caches on current
+// hardware behave closer to a small FIFO than the 32 entry LRU Forsyth's
+// algorithm assumes, the larger LRU still gives the better ordering.
+#define VERTEX_CACHE_SIZE      (32)
+#define VERTEX_CACHE_FIFO_SIZE (16)
+
+// NOTE(jesper): one attribute array of a mesh with a separate buffer per
+// attribute, e.g. Mesh::points
+struct VertexStream {
+    void  *data;
+    usize stride;
+};
+
+// NOTE(jesper): average number of cache misses per triangle when the indices
+// are run through a FIFO cache of cache_size entries. 3.0 is no reuse at all,
+// 0.5 is the lower limit for a large regular grid.
+f32 compute_acmr(
+    u32 *indices, i32 index_count,
+    i32 vertex_count,
+    i32 cache_size,
+    Allocator *scratch);
+
+// NOTE(jesper): reorders the triangles for post-transform cache locality, using
+// Tom Forsyth's linear-speed vertex cache optimisation
+void optimize_vertex_cache(
+    u32 *indices, i32 index_count,
+    i32 vertex_count,
+    Allocator *scratch);
+
+// NOTE(jesper): reorders clusters of the cache optimised triangles so that the
+// outward facing ones are drawn first, reducing overdraw independent of view.
+// A cluster starts at every triangle whose three vertices all miss the FIFO
+// cache, which keeps the reuse within each cluster. The ACMR is not strictly
+// preserved: triangles later in a cluster can lose hits on vertices the
+// cluster before it left in the cache, which in practice adds a handful of
+// misses to the whole mesh. Must run after optimize_vertex_cache.
+void optimize_overdraw(
+    u32 *indices, i32 index_count,
+    Vector3 *points, i32 vertex_count,
+    Allocator *scratch);
+
+// NOTE(jesper): fills remap with the new location of every vertex so that they
+// are stored in the order they're first referenced, and rewrites the indices
+// to match. Unreferenced vertices are remapped to ~0u. Returns the number of
+// referenced vertices. The streams have to be remapped with
+// remap_vertex_stream.
+i32 optimize_vertex_fetch(
+    u32 *remap,
+    u32 *indices, i32 index_count,
+    i32 vertex_count);
+
+// NOTE(jesper): fills remap with the index of the first vertex that's
+// identical in every stream, assigned in order of appearance. Returns the
+// number of unique vertices.
+i32 generate_vertex_remap(
+    u32 *remap,
+    VertexStream *streams, i32 stream_count,
+    i32 vertex_count,
+    Allocator *scratch);
+
+// NOTE(jesper): moves every vertex in the stream to remap[i], in place. Vertices
+// remapped to ~0u are dropped.
+void remap_vertex_stream(
+    VertexStream stream,
+    i32 vertex_count,
+    u32 *remap,
+    Allocator *scratch);
+
+// NOTE(jesper): simplifies the mesh with quadric error metric edge collapses
+// until it has at most target_index_count indices or no collapses are left.
+// Vertices are only ever collapsed onto other existing vertices, so the result
+// indexes into the same vertex buffers and dst can hold index_count indices.
+// Vertices on open borders and attribute seams are never moved. Returns the
+// number of indices written to dst, error is set to the largest estimated
+// distance between the simplified and the input surface.
+i32 simplify_mesh(
+    u32 *dst,
+    u32 *indices, i32 index_count,
+    Vector3 *points, i32 vertex_count,
+    i32 target_index_count,
+    f32 *error,
+    Allocator *scratch);
+
+// NOTE(jesper): the packed vertex layout used for meshes when
+// LEARY_PACKED_VERTICES is enabled, 16 bytes instead of the 56 bytes of the
+// separate f32 streams. Decoded in mesh.glsl.
+//     position:      R16G16B16A16_UNORM, xyz quantised to the mesh bounds, w is
+//                    1 if the bitangent is flipped
+//     tangent_frame: A2B10G10R10_UNORM_PACK32, the quaternion rotating the
+//                    tangent space basis into object space. a is the index of
+//                    its largest component, rgb the other three in order
+//                    divided by 1/sqrt(2).
+//     uv:            R16G16_SFLOAT
+struct PackedVertex {
+    u16 position[4];
+    u32 tangent_frame;
+    u16 uv[2];
+};
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must be 16 bytes");
+
+u16 f16_from_f32(f32 f);
+u32 pack_tangent_frame(
+    Vector3 normal, Vector3 tangent, Vector3 bitangent,
+    bool *flipped);
+
+// NOTE(jesper): normals, tangents, bitangents and uvs may be null, meshes
+// without tangents get an arbitrary frame around the normal
+void pack_vertices(
+    PackedVertex *dst,
+    i32 vertex_count,
+    Vector3 *points,
+    Vector3 *normals,
+    Vector3 *tangents,
+    Vector3 *bitangents,
+    Vector2 *uvs,
+    Vector3 bounds_min,
+    Vector3 bounds_extent);
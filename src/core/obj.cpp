@@ -0,0 +1,283 @@
+/**
+ * file:    obj.cpp
+ * created: 2018-09-21
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+#define OBJ_WELD_EMPTY (0xFFFFFFFF)
+
+struct ObjVertex {
+    Vector3 p;
+    Vector3 n;
+    Vector2 uv;
+};
+
+// NOTE(jesper): open addressed table of indices into the mesh being built, the
+// vertices themselves are only stored in the mesh. The hash is kept next to the
+// index so that probing only has to touch the mesh when the hashes match.
+struct ObjWeldSlot {
+    u32 hash;
+    u32 index;
+};
+
+struct ObjWeldTable {
+    ObjWeldSlot *slots;
+    u32         capacity;
+    u32         mask;
+};
+
+ObjVertex obj_mesh_vertex(ObjMesh *mesh, u32 index)
+{
+    return ObjVertex{ mesh->points.data[index], mesh->normals.data[index], mesh->uvs.data[index] };
+}
+
+// NOTE(jesper): FNV-1a over the 32 bit words of the vertex followed by a
+// murmur3 finalizer, the probe sequence uses the low bits so they need to
+// depend on every component
+u32 obj_vertex_hash(ObjVertex *v)
+{
+    u32 words[sizeof *v / sizeof(u32)];
+    memcpy(words, v, sizeof words);
+
+    u32 h = 0x811c9dc5;
+    for (i32 i = 0; i < (i32)ARRAY_SIZE(words); i++) {
+        h ^= words[i];
+        h *= 0x01000193;
+    }
+
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+void obj_weld_init(ObjWeldTable *table, Allocator *a, u32 capacity)
+{
+    table->capacity = capacity;
+    table->mask     = capacity - 1;
+    table->slots    = alloc_array(a, ObjWeldSlot, capacity);
+    memset(table->slots, 0xFF, capacity * sizeof(ObjWeldSlot));
+}
+
+void obj_weld_grow(ObjWeldTable *table, Allocator *a)
+{
+    ObjWeldSlot *slots = table->slots;
+    u32 capacity       = table->capacity;
+
+    obj_weld_init(table, a, capacity * 2);
+
+    for (u32 i = 0; i < capacity; i++) {
+        if (slots[i].index == OBJ_WELD_EMPTY) {
+            continue;
+        }
+
+        u32 slot = slots[i].hash & table->mask;
+        while (table->slots[slot].index != OBJ_WELD_EMPTY) {
+            slot = (slot + 1) & table->mask;
+        }
+
+        table->slots[slot] = slots[i];
+    }
+
+    dealloc(a, slots);
+}
+
+u32 obj_weld_vertex(ObjWeldTable *table, ObjMesh *mesh, ObjVertex v, Allocator *scratch)
+{
+    // NOTE(jesper): keep the load factor below 3/4
+    if ((u32)(mesh->points.count + 1) * 4 > table->capacity * 3) {
+        obj_weld_grow(table, scratch);
+    }
+
+    u32 hash = obj_vertex_hash(&v);
+    u32 slot = hash & table->mask;
+    while (table->slots[slot].index != OBJ_WELD_EMPTY) {
+        if (table->slots[slot].hash == hash) {
+            u32 index = table->slots[slot].index;
+
+            ObjVertex other = obj_mesh_vertex(mesh, index);
+            if (memcmp(&other, &v, sizeof v) == 0) {
+                return index;
+            }
+        }
+
+        slot = (slot + 1) & table->mask;
+    }
+
+    u32 index = (u32)array_add(&mesh->points, v.p);
+    array_add(&mesh->normals, v.n);
+    array_add(&mesh->uvs, v.uv);
+
+    table->slots[slot] = ObjWeldSlot{ hash, index };
+    return index;
+}
+
+const char* obj_skip_whitespace(const char *p, const char *end)
+{
+    while (p < end && is_whitespace(p[0])) {
+        p++;
+    }
+    return p;
+}
+
+// NOTE(jesper): resolves a 1-based or negative, relative, obj index. Returns -1
+// if it's out of range
+i32 obj_resolve_index(i32 index, i32 count)
+{
+    i32 resolved = index > 0 ? index - 1 : count + index;
+    return resolved >= 0 && resolved < count ? resolved : -1;
+}
+
+ObjMesh parse_obj(const char *data, usize size, Allocator *a, Allocator *scratch)
+{
+    ObjMesh mesh = {};
+    init_array(&mesh.points,  a);
+    init_array(&mesh.normals, a);
+    init_array(&mesh.uvs,     a);
+    init_array(&mesh.indices, a);
+
+    auto positions = create_array<Vector3>(scratch);
+    auto normals   = create_array<Vector3>(scratch);
+    auto uvs       = create_array<Vector2>(scratch);
+
+    ObjWeldTable table;
+    obj_weld_init(&table, scratch, OBJ_WELD_INITIAL_SIZE);
+
+    defer {
+        dealloc(scratch, table.slots);
+        destroy_array(&uvs);
+        destroy_array(&normals);
+        destroy_array(&positions);
+    };
+
+    i32 line = 1;
+
+    const char *p   = data;
+    const char *end = data + size;
+    while (p < end) {
+        p = obj_skip_whitespace(p, end);
+
+        if (p + 1 < end && p[0] == 'v' && is_whitespace(p[1])) {
+            p++;
+
+            Vector3 v;
+            for (i32 i = 0; i < 3; i++) {
+                p = obj_skip_whitespace(p, end);
+                v.data[i] = scan_f32(&p, end);
+            }
+            array_add(&positions, v);
+        } else if (p + 1 < end && p[0] == 'v' && p[1] == 'n') {
+            p += 2;
+
+            Vector3 n;
+            for (i32 i = 0; i < 3; i++) {
+                p = obj_skip_whitespace(p, end);
+                n.data[i] = scan_f32(&p, end);
+            }
+            array_add(&normals, n);
+        } else if (p + 1 < end && p[0] == 'v' && p[1] == 't') {
+            p += 2;
+
+            Vector2 uv;
+            for (i32 i = 0; i < 2; i++) {
+                p = obj_skip_whitespace(p, end);
+                uv.data[i] = scan_f32(&p, end);
+            }
+
+            // TODO(jesper): the texture scale doesn't belong in the importer,
+            // kept from the previous importer so that existing models look
+            // the same
+            uv *= 2.0f;
+            array_add(&uvs, uv);
+        } else if (p + 1 < end && p[0] == 'f' && is_whitespace(p[1])) {
+            p++;
+
+            // NOTE(jesper): faces with more than 3 corners are triangulated
+            // as a fan around the first corner
+            u32 first   = 0;
+            u32 prev    = 0;
+            i32 corners = 0;
+
+            for (;;) {
+                p = obj_skip_whitespace(p, end);
+                if (p >= end || p[0] < '+' || p[0] > '9') {
+                    break;
+                }
+
+                const char *start = p;
+                i32 iv = scan_i32(&p, end);
+                i32 it = 0;
+                i32 in = 0;
+
+                if (p < end && p[0] == '/') {
+                    p++;
+                    it = scan_i32(&p, end);
+
+                    if (p < end && p[0] == '/') {
+                        p++;
+                        in = scan_i32(&p, end);
+                    }
+                }
+
+                if (p == start) {
+                    break;
+                }
+
+                iv = obj_resolve_index(iv, positions.count);
+                it = it != 0 ? obj_resolve_index(it, uvs.count) : -1;
+                in = in != 0 ? obj_resolve_index(in, normals.count) : -1;
+
+                if (iv == -1) {
+                    LOG_ERROR_DEFERRED("invalid obj face on line %d", line);
+                    break;
+                }
+
+                ObjVertex v = {};
+                v.p = positions.data[iv];
+
+                if (in != -1) {
+                    v.n = normals.data[in];
+                }
+
+                if (it != -1) {
+                    v.uv = uvs.data[it];
+                }
+
+                u32 index = obj_weld_vertex(&table, &mesh, v, scratch);
+                if (corners == 0) {
+                    first = index;
+                } else if (corners >= 2) {
+                    array_add(&mesh.indices, first);
+                    array_add(&mesh.indices, prev);
+                    array_add(&mesh.indices, index);
+                }
+
+                prev = index;
+                corners++;
+            }
+        }
+
+        while (p < end && !is_newline(p[0])) {
+            p++;
+        }
+
+        while (p < end && is_newline(p[0])) {
+            line += p[0] == '\n';
+            p++;
+        }
+    }
+
+    if (normals.count == 0) {
+        destroy_array(&mesh.normals);
+    }
+
+    if (uvs.count == 0) {
+        destroy_array(&mesh.uvs);
+    }
+
+    return mesh;
+}
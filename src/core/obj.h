@@ -0,0 +1,24 @@
+/**
+ * file:    obj.h
+ * created: 2018-09-21
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+#define OBJ_WELD_INITIAL_SIZE (1024)
+
+// NOTE(jesper): indexed mesh data parsed from a wavefront obj. Vertices with
+// the same position, normal and uv are welded into one. normals and uvs are
+// empty if the obj doesn't have any, otherwise they're the same length as
+// points.
+struct ObjMesh {
+    Array<Vector3> points;
+    Array<Vector3> normals;
+    Array<Vector2> uvs;
+    Array<u32>     indices;
+};
+
+// NOTE(jesper): the result is allocated from a, scratch is only used for the
+// duration of the call
+ObjMesh parse_obj(const char *data, usize size, Allocator *a, Allocator *scratch);
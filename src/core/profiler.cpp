@@ -6,48 +6,1103 @@
  * Copyright (c) 2017-2018 - all rights reserved
  */
 
-#define PROFILER_MAX_STACK_DEPTH (256)
+#define PROFILER_MAX_STACK_DEPTH  (256)
+#define PROFILER_MAX_SITES        (1024)
+#define PROFILER_MAX_STATS_WINDOW (4096)
+#define PROFILER_TRACE_BUFFER     (64 * 1024)
+#define PROFILER_MAX_HITCH_FRAMES (16)
+#define PROFILER_HISTORY_FRAMES   (2 * PROFILER_MAX_HITCH_FRAMES + 1)
+#define PROFILER_MAX_FRAME_TAGS   (8)
 
 extern VulkanDevice* g_vulkan;
 
+// NOTE(jesper): fixed size so that sites can be registered before
+// init_profiler has been called
+ProfileSite g_profile_sites[PROFILER_MAX_SITES];
+u32         g_profile_sites_count = 0;
+
+// NOTE(jesper): samples is a ring buffer of the per-frame durations in the
+// order they were recorded, sorted holds the same samples in ascending order
+// so that the percentiles are a lookup instead of a sort every frame.
+struct ProfileStats {
+    u64 *samples;
+    u64 *sorted;
+    i32 capacity;
+    i32 count;
+    i32 next;
+    u64 sum;
+};
+
+ProfileStats g_profile_stats[PROFILER_MAX_SITES];
+
+bool g_profiler_invariant_tsc = false;
+f64  g_profiler_ticks_per_ms  = 1.0;
+
 Array<ProfileEvent> g_profile_events;
 Array<ProfileEvent> g_profile_events_prev;
+Array<ProfileEvent> g_profile_gpu_events;
+Array<ProfileEvent> g_profile_gpu_events_prev;
 Array<ProfileTimer> g_profile_timers;
 
+bool g_profiler_counters = false;
+
+Array<ProfileCounterEvent> g_profile_counter_events;
+Array<ProfileCounterEvent> g_profile_counter_events_prev;
+
+// NOTE(jesper): a copy of a completed frame's events, kept in a ring of the
+// last PROFILER_HISTORY_FRAMES frames so that a hitch can be dumped along with
+// the frames around it
+struct ProfileFrame {
+    u64 index;
+    u64 start;
+    u64 duration;
+
+    Array<ProfileEvent>        events;
+    Array<ProfileEvent>        gpu_events;
+    Array<ProfileCounterEvent> counter_events;
+
+    const char *tags[PROFILER_MAX_FRAME_TAGS];
+    i32         tags_count;
+};
+
+ProfileFrame g_profile_history[PROFILER_HISTORY_FRAMES];
+i32          g_profile_history_next  = 0;
+i32          g_profile_history_count = 0;
+
+const char *g_profile_frame_tags[PROFILER_MAX_FRAME_TAGS];
+i32         g_profile_frame_tags_count = 0;
+
+// NOTE(jesper): frames left to record after a hitch before it's dumped, 0 if
+// there's no pending dump
+i32 g_profile_hitch_remaining = 0;
+i32 g_profile_hitch_frames    = 0;
+u64 g_profile_hitch_index     = 0;
+
+struct ProfileTraceWriter {
+    void *file;
+    char *buffer;
+    i32  length;
+    bool first;
+    u64  origin;
+};
+
+struct ProfileAllocator {
+    Allocator  *allocator;
+    const char *name;
+    bool       allowed_in_frame;
+};
+
+ProfileAllocator g_profile_allocators[PROFILER_MAX_ALLOCATORS];
+i32              g_profile_allocators_count = 0;
+
+// NOTE(jesper): double buffered per-frame allocation stats, the extra row is
+// for allocations made outside of any scope. dirty lists the rows that have
+// been touched so that the flip doesn't have to clear the whole table.
+#define PROFILER_UNSCOPED_ROW PROFILER_MAX_SITES
+
+struct ProfileAllocFrame {
+    ProfileAllocStats rows[PROFILER_MAX_SITES + 1][PROFILER_MAX_ALLOCATORS];
+    u16               dirty[PROFILER_MAX_SITES + 1];
+    i32               dirty_count;
+};
+
+ProfileAllocFrame g_profile_alloc_frames[2];
+i32               g_profile_alloc_frame = 0;
+
+ProfileAllocStats g_profile_unscoped_allocs[PROFILER_MAX_ALLOCATORS];
+u32               g_profile_steady_state_frames[PROFILER_MAX_SITES];
+u64               g_profiler_frame = 0;
+
+// NOTE(jesper): allocations are only attributed on the thread that called
+// init_profiler, the scope stack is only maintained on that thread
+thread_local bool g_profile_alloc_thread = false;
+thread_local i32  g_profile_scope_depth  = 0;
+thread_local u32  g_profile_scope_stack[PROFILER_MAX_STACK_DEPTH];
+
+bool g_profiler_sampling = false;
+
+// NOTE(jesper): flat list of the samples captured since the sampler was
+// started, each is its depth followed by that many instruction pointers
+Array<u64> g_profile_samples;
+i32        g_profile_samples_count = 0;
+
+Array<ProfileHotFunction> g_profile_hot_functions;
+
 GfxTexture g_profiler_cpu_graph;
 GfxTexture g_profiler_gpu_graph;
 constexpr i32 kProfilerGraphWidth  = 128;
 constexpr i32 kProfilerGraphHeight = 512;
 
-void profiler_start(const char *name, const char *file, i32 line)
+u32 profiler_register_site(const char *name, const char *file, i32 line)
+{
+    // TODO(jesper): THREAD_SAFETY
+    ASSERT(g_profile_sites_count < PROFILER_MAX_SITES);
+
+    u32 id = g_profile_sites_count++;
+    g_profile_sites[id].name = name;
+    g_profile_sites[id].file = file;
+    g_profile_sites[id].line = line;
+
+    return id;
+}
+
+ProfileSite* profiler_site(u32 site_id)
+{
+    ASSERT(site_id < g_profile_sites_count);
+    return &g_profile_sites[site_id];
+}
+
+u64 cpu_ticks()
+{
+    if (g_profiler_invariant_tsc) {
+        return __rdtsc();
+    }
+
+    return platform_clock_ticks();
+}
+
+f64 cpu_ticks_to_ms(u64 ticks)
+{
+    return (f64)ticks / g_profiler_ticks_per_ms;
+}
+
+u64 cpu_ticks_from_ms(f64 ms)
+{
+    return (u64)(ms * g_profiler_ticks_per_ms);
+}
+
+bool cpu_has_invariant_tsc()
+{
+#if defined(_WIN32)
+    int registers[4];
+    __cpuid(registers, 0x80000000);
+    if ((u32)registers[0] < 0x80000007) {
+        return false;
+    }
+
+    __cpuid(registers, 0x80000007);
+    return (registers[3] & (1 << 8)) != 0;
+#else
+    u32 eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) {
+        return false;
+    }
+
+    return (edx & (1 << 8)) != 0;
+#endif
+}
+
+void profiler_calibrate()
+{
+    u64 frequency = platform_clock_frequency();
+
+    // NOTE(jesper): without an invariant TSC the tick rate changes with the
+    // core's frequency and isn't synchronised between cores, so the raw
+    // counter is useless for wall-clock durations
+    g_profiler_invariant_tsc = cpu_has_invariant_tsc();
+    if (!g_profiler_invariant_tsc) {
+        g_profiler_ticks_per_ms = (f64)frequency / 1000.0;
+        LOG_WARNING("no invariant TSC, profiler falling back to platform clock");
+        return;
+    }
+
+    // NOTE(jesper): ~20ms is long enough for the clock read latency on either
+    // end to be noise
+    u64 clock_start = platform_clock_ticks();
+    u64 tsc_start   = __rdtsc();
+
+    u64 clock_end, tsc_end;
+    do {
+        clock_end = platform_clock_ticks();
+        tsc_end   = __rdtsc();
+    } while (clock_end - clock_start < frequency / 50);
+
+    f64 ms = (f64)(clock_end - clock_start) * 1000.0 / (f64)frequency;
+    g_profiler_ticks_per_ms = (f64)(tsc_end - tsc_start) / ms;
+
+    LOG_INFO("calibrated TSC frequency: %.2f MHz", g_profiler_ticks_per_ms / 1000.0);
+}
+
+void profiler_add_sample(ProfileStats *stats, u64 sample, i32 window)
+{
+    if (stats->capacity != window) {
+        dealloc(g_heap, stats->samples);
+        dealloc(g_heap, stats->sorted);
+
+        stats->samples  = alloc_array(g_heap, u64, window);
+        stats->sorted   = alloc_array(g_heap, u64, window);
+        stats->capacity = window;
+        stats->count    = 0;
+        stats->next     = 0;
+        stats->sum      = 0;
+    }
+
+    if (stats->count == stats->capacity) {
+        u64 oldest = stats->samples[stats->next];
+        stats->sum -= oldest;
+
+        i32 lo = 0, hi = stats->count;
+        while (lo < hi) {
+            i32 mid = (lo + hi) / 2;
+            if (stats->sorted[mid] < oldest) lo = mid + 1;
+            else hi = mid;
+        }
+        ASSERT(stats->sorted[lo] == oldest);
+
+        memmove(&stats->sorted[lo],
+                &stats->sorted[lo + 1],
+                (usize)(stats->count - lo - 1) * sizeof(u64));
+        stats->count--;
+    }
+
+    i32 lo = 0, hi = stats->count;
+    while (lo < hi) {
+        i32 mid = (lo + hi) / 2;
+        if (stats->sorted[mid] <= sample) lo = mid + 1;
+        else hi = mid;
+    }
+
+    memmove(&stats->sorted[lo + 1],
+            &stats->sorted[lo],
+            (usize)(stats->count - lo) * sizeof(u64));
+    stats->sorted[lo] = sample;
+    stats->count++;
+
+    stats->samples[stats->next] = sample;
+    stats->next = (stats->next + 1) % stats->capacity;
+    stats->sum += sample;
+}
+
+u64 profiler_percentile(ProfileStats *stats, i32 percentile)
+{
+    ASSERT(stats->count > 0);
+
+    // NOTE(jesper): nearest-rank
+    i32 rank = (percentile * stats->count + 99) / 100;
+    return stats->sorted[max(rank, 1) - 1];
+}
+
+void profiler_register_allocator(Allocator *a, const char *name, bool allowed_in_frame)
+{
+    ASSERT(g_profile_allocators_count < PROFILER_MAX_ALLOCATORS);
+
+    i32 id = g_profile_allocators_count++;
+    g_profile_allocators[id].allocator        = a;
+    g_profile_allocators[id].name             = name;
+    g_profile_allocators[id].allowed_in_frame = allowed_in_frame;
+
+    a->profile_id = id;
+}
+
+void profiler_alloc(Allocator *a, isize size)
+{
+    if (!g_profile_alloc_thread || a->profile_id == -1) {
+        return;
+    }
+
+    u32 row = PROFILER_UNSCOPED_ROW;
+    if (g_profile_scope_depth > 0) {
+        i32 top = min(g_profile_scope_depth, PROFILER_MAX_STACK_DEPTH) - 1;
+        row = g_profile_scope_stack[top];
+    }
+
+    ProfileAllocFrame *frame = &g_profile_alloc_frames[g_profile_alloc_frame];
+    ProfileAllocStats *stats = &frame->rows[row][a->profile_id];
+
+    if (stats->count == 0) {
+        bool dirty = false;
+        for (i32 i = 0; i < g_profile_allocators_count; i++) {
+            dirty = dirty || frame->rows[row][i].count > 0;
+        }
+
+        if (!dirty) {
+            frame->dirty[frame->dirty_count++] = (u16)row;
+        }
+    }
+
+    stats->bytes += (u64)size;
+    stats->count++;
+}
+
+void profiler_start(u32 site_id)
 {
+    if (g_profile_alloc_thread) {
+        if (g_profile_scope_depth < PROFILER_MAX_STACK_DEPTH) {
+            g_profile_scope_stack[g_profile_scope_depth] = site_id;
+        }
+        g_profile_scope_depth++;
+    }
+
     ProfileEvent event;
-    event.type = ProfileEvent_start;
-    event.name = name;
-    event.file = file;
-    event.line = line;
+    event.site_id   = site_id;
+    event.type      = ProfileEvent_start;
     event.timestamp = cpu_ticks();
 
     array_add(&g_profile_events, event);
 }
 
-void profiler_end(const char *name, const char *file, i32 line)
+void profiler_end(u32 site_id)
 {
+    if (g_profile_alloc_thread) {
+        ASSERT(g_profile_scope_depth > 0);
+        g_profile_scope_depth--;
+    }
+
     ProfileEvent event;
-    event.type = ProfileEvent_end;
-    event.name = name;
-    event.file = file;
-    event.line = line;
+    event.site_id   = site_id;
+    event.type      = ProfileEvent_end;
     event.timestamp = cpu_ticks();
 
     array_add(&g_profile_events, event);
 }
 
+void profiler_start_counters(u32 site_id)
+{
+    profiler_start(site_id);
+    if (!g_profiler_counters) {
+        return;
+    }
+
+    ProfileCounterEvent event;
+    event.event_index = g_profile_events.count - 1;
+    event.valid       = platform_counters_read(event.values);
+
+    array_add(&g_profile_counter_events, event);
+}
+
+void profiler_end_counters(u32 site_id)
+{
+    if (!g_profiler_counters) {
+        profiler_end(site_id);
+        return;
+    }
+
+    // NOTE(jesper): read before the end event is pushed so that the array_add
+    // in profiler_end isn't counted towards this scope
+    ProfileCounterEvent event;
+    event.valid = platform_counters_read(event.values);
+
+    profiler_end(site_id);
+    event.event_index = g_profile_events.count - 1;
+
+    array_add(&g_profile_counter_events, event);
+}
+
+// NOTE(jesper): fills in start_of[i] with the index of the counter event that
+// started the scope ended by counter event i, or -1 if i isn't an end event or
+// either read failed
+void profiler_pair_counters(
+    Array<ProfileCounterEvent> counters,
+    Array<ProfileEvent> events,
+    i32 *start_of)
+{
+    i32 s = 0;
+    i32 stack[PROFILER_MAX_STACK_DEPTH];
+
+    for (i32 i = 0; i < counters.count; i++) {
+        start_of[i] = -1;
+
+        ProfileEvent event = events[counters[i].event_index];
+        if (event.type == ProfileEvent_start) {
+            stack[s++] = i;
+            ASSERT(s < PROFILER_MAX_STACK_DEPTH);
+        } else {
+            ASSERT(s > 0);
+            i32 pid = stack[--s];
+            ASSERT(events[counters[pid].event_index].site_id == event.site_id);
+
+            if (counters[pid].valid && counters[i].valid) {
+                start_of[i] = pid;
+            }
+        }
+    }
+}
+
+void profiler_gather_counters(
+    Array<ProfileCounterEvent> counters,
+    Array<ProfileEvent> events,
+    i32 *timer_index)
+{
+    // NOTE(jesper): runs every frame, the pairing is kept off the heap so the
+    // profiler doesn't show up in its own steady state allocations
+    void *sp = g_stack->sp;
+    defer { reset(g_stack, sp); };
+
+    i32 *start_of = alloc_array(g_stack, i32, counters.count);
+    profiler_pair_counters(counters, events, start_of);
+
+    for (i32 i = 0; i < counters.count; i++) {
+        if (start_of[i] == -1) {
+            continue;
+        }
+
+        ProfileCounterEvent &start = counters[start_of[i]];
+        ProfileCounterEvent &end   = counters[i];
+
+        i32 j = timer_index[events[end.event_index].site_id];
+        ASSERT(j != -1);
+
+        ProfileTimer &timer = g_profile_timers[j];
+        timer.counters = true;
+        for (i32 c = 0; c < ProfileCounter_count; c++) {
+            timer.counter_totals[c] += end.values[c] - start.values[c];
+        }
+    }
+}
+
+// NOTE(jesper): moves the previous frame's allocation stats into its timers
+void profiler_gather_allocs(ProfileAllocFrame *frame, i32 *timer_index)
+{
+    i32 warmup = max(1, g_settings.profiler.stats_window);
+    bool steady_state = g_profiler_frame > (u64)warmup;
+
+    for (i32 i = 0; i < g_profile_allocators_count; i++) {
+        g_profile_unscoped_allocs[i] = {};
+    }
+
+    for (i32 i = 0; i < frame->dirty_count; i++) {
+        u32 row = frame->dirty[i];
+        ProfileAllocStats *stats = frame->rows[row];
+
+        if (row == PROFILER_UNSCOPED_ROW) {
+            for (i32 j = 0; j < g_profile_allocators_count; j++) {
+                g_profile_unscoped_allocs[j] = stats[j];
+                stats[j] = {};
+            }
+            continue;
+        }
+
+        i32 t = timer_index[row];
+        if (t == -1) {
+            // NOTE(jesper): the scope didn't end in the frame it started
+            for (i32 j = 0; j < g_profile_allocators_count; j++) {
+                stats[j] = {};
+            }
+            continue;
+        }
+
+        ProfileTimer &timer = g_profile_timers[t];
+        for (i32 j = 0; j < g_profile_allocators_count; j++) {
+            timer.allocs[j] = stats[j];
+            stats[j] = {};
+
+            ProfileAllocator &pa = g_profile_allocators[j];
+            if (steady_state && !pa.allowed_in_frame && timer.allocs[j].count > 0) {
+                if (!timer.steady_state_allocs &&
+                    g_profile_steady_state_frames[row] == 0)
+                {
+                    ProfileSite *site = profiler_site(row);
+                    LOG_WARNING("%s (%s:%d) allocated %" PRIu64 " bytes from %s in the frame loop",
+                                site->name, site->file, site->line,
+                                timer.allocs[j].bytes, pa.name);
+                }
+
+                timer.steady_state_allocs = true;
+            }
+        }
+
+        if (timer.steady_state_allocs) {
+            g_profile_steady_state_frames[row]++;
+        }
+        timer.steady_state_frames = g_profile_steady_state_frames[row];
+    }
+
+    frame->dirty_count = 0;
+}
+
+void profiler_gpu_event(u32 site_id, ProfileEventType type, u64 timestamp)
+{
+    ProfileEvent event;
+    event.site_id   = site_id;
+    event.type      = type;
+    event.timestamp = timestamp;
+
+    array_add(&g_profile_gpu_events, event);
+}
+
+void profiler_gather_events(Array<ProfileEvent> events, i32 *timer_index, bool gpu)
+{
+    i32 s = 0;
+    i32 stack[PROFILER_MAX_STACK_DEPTH];
+
+    for (i32 i = 0; i < PROFILER_MAX_STACK_DEPTH; i++) {
+        stack[i] = -1;
+    }
+
+    // TODO(jesper): thread local g_profile_events
+    for (i32 i = 0; i < events.count; i++) {
+        ProfileEvent event = events[i];
+
+        if (event.type == ProfileEvent_start) {
+            stack[s++] = i;
+            ASSERT(s < PROFILER_MAX_STACK_DEPTH);
+        } else if (event.type == ProfileEvent_end) {
+            i32 pid = stack[--s];
+            ASSERT(pid != -1);
+
+            ProfileEvent parent = events[pid];
+            ASSERT(event.site_id == parent.site_id);
+
+            u64 duration = event.timestamp - parent.timestamp;
+
+            i32 j = timer_index[parent.site_id];
+            if (j == -1) {
+                ProfileTimer timer = {};
+                timer.site_id  = parent.site_id;
+                timer.duration = duration;
+                timer.calls    = 1;
+                timer.parent   = -1;
+                timer.gpu      = gpu;
+
+                timer_index[parent.site_id] = array_add(&g_profile_timers, timer);
+            } else {
+                ProfileTimer &existing = g_profile_timers[j];
+                existing.calls++;
+                existing.duration += duration;
+            }
+        }
+    }
+}
+
+void profiler_start_sampling()
+{
+    if (g_profiler_sampling) {
+        return;
+    }
+
+    g_profile_samples.count = 0;
+    g_profile_samples_count = 0;
+
+    i32 frequency = max(1, g_settings.profiler.sampler_frequency);
+    g_profiler_sampling = platform_sampler_start(frequency);
+}
+
+void profiler_drain_samples()
+{
+    ProfileSample sample;
+    while (platform_sampler_next(&sample)) {
+        array_add(&g_profile_samples, (u64)sample.depth);
+        for (u32 i = 0; i < sample.depth; i++) {
+            array_add(&g_profile_samples, sample.ips[i]);
+        }
+
+        g_profile_samples_count++;
+    }
+}
+
+struct ProfileSampleFunction {
+    u64 address;
+    i32 index;
+};
+
+int profiler_cmp_u64(const void *lhs, const void *rhs)
+{
+    u64 a = *(u64*)lhs;
+    u64 b = *(u64*)rhs;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+int profiler_cmp_sample_function(const void *lhs, const void *rhs)
+{
+    u64 a = ((ProfileSampleFunction*)lhs)->address;
+    u64 b = ((ProfileSampleFunction*)rhs)->address;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+int profiler_cmp_hot_function(const void *lhs, const void *rhs)
+{
+    ProfileHotFunction *a = (ProfileHotFunction*)lhs;
+    ProfileHotFunction *b = (ProfileHotFunction*)rhs;
+
+    if (a->self != b->self) {
+        return a->self > b->self ? -1 : 1;
+    }
+
+    return a->inclusive > b->inclusive ? -1 : a->inclusive < b->inclusive ? 1 : 0;
+}
+
+i32 profiler_find_address(u64 *addresses, i32 count, u64 ip)
+{
+    i32 lo = 0, hi = count;
+    while (lo < hi) {
+        i32 mid = (lo + hi) / 2;
+        if (addresses[mid] < ip) lo = mid + 1;
+        else hi = mid;
+    }
+
+    ASSERT(lo < count && addresses[lo] == ip);
+    return lo;
+}
+
+void profiler_write_sampler_report()
+{
+    FilePath path = resolve_file_path(GamePath_preferences, "sampler.txt", g_stack);
+    if (!file_exists(path) && !create_file(path, true)) {
+        LOG_WARNING("unable to create sampler report: %s", path.absolute.bytes);
+        return;
+    }
+
+    void *file = open_file(path, FileAccess_write);
+    defer { close_file(file); };
+
+    char line[512];
+    i32 length = snprintf(
+        line, sizeof line,
+        "%d samples, %u dropped" FILE_EOL
+        "self %%  incl %%  symbol  (module+offset)" FILE_EOL,
+        g_profile_samples_count, platform_sampler_dropped());
+    write_file(file, line, (usize)length);
+
+    f32 total = (f32)max(g_profile_samples_count, 1);
+    for (i32 i = 0; i < g_profile_hot_functions.count; i++) {
+        ProfileHotFunction &f = g_profile_hot_functions[i];
+
+        length = snprintf(
+            line, sizeof line,
+            "%6.2f  %6.2f  %s  (%s+0x%" PRIx64 ")" FILE_EOL,
+            100.0f * f.self / total,
+            100.0f * f.inclusive / total,
+            f.symbol.name,
+            f.symbol.module,
+            f.symbol.offset);
+        write_file(file, line, (usize)min(length, (i32)sizeof line - 1));
+    }
+
+    LOG_INFO("wrote sampler report to %s", path.absolute.bytes);
+}
+
+// NOTE(jesper): symbolisation is done here rather than while sampling. Every
+// unique instruction pointer is resolved once, then mapped to the function
+// that contains it.
+void profiler_aggregate_samples()
+{
+    g_profile_hot_functions.count = 0;
+    if (g_profile_samples_count == 0) {
+        return;
+    }
+
+    Array<u64> ips = create_array<u64>(g_heap);
+    defer { destroy_array(&ips); };
+
+    for (i32 i = 0; i < g_profile_samples.count; ) {
+        i32 depth = (i32)g_profile_samples[i++];
+        for (i32 j = 0; j < depth; j++) {
+            array_add(&ips, g_profile_samples[i++]);
+        }
+    }
+
+    qsort(ips.data, (usize)ips.count, sizeof ips[0], profiler_cmp_u64);
+
+    i32 unique = 0;
+    for (i32 i = 0; i < ips.count; i++) {
+        if (unique == 0 || ips[unique-1] != ips[i]) {
+            ips[unique++] = ips[i];
+        }
+    }
+    ips.count = unique;
+
+    ProfileSymbol *symbols = alloc_array(g_heap, ProfileSymbol, unique);
+    ProfileSampleFunction *by_address = alloc_array(g_heap, ProfileSampleFunction, unique);
+    i32 *function_of = alloc_array(g_heap, i32, unique);
+    defer {
+        dealloc(g_heap, symbols);
+        dealloc(g_heap, by_address);
+        dealloc(g_heap, function_of);
+    };
+
+    for (i32 i = 0; i < unique; i++) {
+        if (!platform_symbolise(ips[i], &symbols[i])) {
+            symbols[i].module  = "??";
+            symbols[i].address = ips[i];
+            symbols[i].offset  = ips[i];
+            snprintf(symbols[i].name, sizeof symbols[i].name, "??");
+        }
+
+        by_address[i].address = symbols[i].address;
+        by_address[i].index   = i;
+    }
+
+    qsort(by_address, (usize)unique, sizeof by_address[0], profiler_cmp_sample_function);
+
+    for (i32 i = 0; i < unique; i++) {
+        if (i == 0 || by_address[i].address != by_address[i-1].address) {
+            ProfileHotFunction f = {};
+            f.symbol = symbols[by_address[i].index];
+            array_add(&g_profile_hot_functions, f);
+        }
+
+        function_of[by_address[i].index] = g_profile_hot_functions.count - 1;
+    }
+
+    // NOTE(jesper): stamp of the last sample that counted towards a function's
+    // inclusive count, so that recursion only counts once per sample
+    i32 *stamps = ialloc_array<i32>(g_heap, g_profile_hot_functions.count, -1);
+    defer { dealloc(g_heap, stamps); };
+
+    for (i32 i = 0, s = 0; i < g_profile_samples.count; s++) {
+        i32 depth = (i32)g_profile_samples[i++];
+
+        for (i32 j = 0; j < depth; j++) {
+            i32 ip = profiler_find_address(ips.data, unique, g_profile_samples[i + j]);
+            i32 f  = function_of[ip];
+
+            if (j == 0) {
+                g_profile_hot_functions[f].self++;
+            }
+
+            if (stamps[f] != s) {
+                stamps[f] = s;
+                g_profile_hot_functions[f].inclusive++;
+            }
+        }
+
+        i += depth;
+    }
+
+    qsort(g_profile_hot_functions.data,
+          (usize)g_profile_hot_functions.count,
+          sizeof g_profile_hot_functions[0],
+          profiler_cmp_hot_function);
+}
+
+void profiler_stop_sampling()
+{
+    if (!g_profiler_sampling) {
+        return;
+    }
+
+    platform_sampler_stop();
+    profiler_drain_samples();
+    g_profiler_sampling = false;
+
+    profiler_aggregate_samples();
+    profiler_write_sampler_report();
+}
+
+void profiler_trace_flush(ProfileTraceWriter *w)
+{
+    write_file(w->file, w->buffer, (usize)w->length);
+    w->length = 0;
+}
+
+void profiler_trace_reserve(ProfileTraceWriter *w)
+{
+    // NOTE(jesper): one event is at most a few hundred bytes, flush well before
+    // we could run out of space
+    if (w->length + 1024 > PROFILER_TRACE_BUFFER) {
+        profiler_trace_flush(w);
+    }
+}
+
+void profiler_trace_events(
+    ProfileTraceWriter *w,
+    Array<ProfileEvent> events,
+    i32 tid,
+    Array<ProfileCounterEvent> counters,
+    i32 *start_of,
+    i32 *counter_at)
+{
+    for (i32 i = 0; i < events.count; i++) {
+        ProfileEvent &event = events[i];
+        ProfileSite *site = profiler_site(event.site_id);
+
+        profiler_trace_reserve(w);
+
+        f64 us = cpu_ticks_to_ms(event.timestamp - w->origin) * 1000.0;
+        w->length += snprintf(
+            w->buffer + w->length, PROFILER_TRACE_BUFFER - w->length,
+            "%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":0,\"tid\":%d",
+            w->first ? "" : "," FILE_EOL,
+            site->name,
+            event.type == ProfileEvent_start ? "B" : "E",
+            us,
+            tid);
+        w->first = false;
+
+        i32 ci = counter_at != nullptr ? counter_at[i] : -1;
+        if (ci != -1 && start_of[ci] != -1) {
+            u64 *start = counters[start_of[ci]].values;
+            u64 *end   = counters[ci].values;
+
+            u64 instructions = end[ProfileCounter_instructions] - start[ProfileCounter_instructions];
+            u64 cycles       = end[ProfileCounter_cycles] - start[ProfileCounter_cycles];
+
+            w->length += snprintf(
+                w->buffer + w->length, PROFILER_TRACE_BUFFER - w->length,
+                ",\"args\":{\"instructions\":%" PRIu64 ",\"cycles\":%" PRIu64
+                ",\"ipc\":%.3f,\"l1d_misses\":%" PRIu64 ",\"llc_misses\":%" PRIu64
+                ",\"branch_misses\":%" PRIu64 "}",
+                instructions,
+                cycles,
+                cycles > 0 ? (f64)instructions / (f64)cycles : 0.0,
+                end[ProfileCounter_l1d_misses] - start[ProfileCounter_l1d_misses],
+                end[ProfileCounter_llc_misses] - start[ProfileCounter_llc_misses],
+                end[ProfileCounter_branch_misses] - start[ProfileCounter_branch_misses]);
+        }
+
+        w->length += snprintf(w->buffer + w->length, PROFILER_TRACE_BUFFER - w->length, "}");
+    }
+}
+
+void profiler_trace_frame(ProfileTraceWriter *w, ProfileFrame *frame, bool hitch)
+{
+    profiler_trace_reserve(w);
+
+    // NOTE(jesper): global instant event marking the start of the frame, with
+    // its duration and tags as args
+    w->length += snprintf(
+        w->buffer + w->length, PROFILER_TRACE_BUFFER - w->length,
+        "%s{\"name\":\"%s %" PRIu64 "\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":0,\"tid\":0,"
+        "\"args\":{\"duration_ms\":%.3f,\"tags\":\"",
+        w->first ? "" : "," FILE_EOL,
+        hitch ? "hitch" : "frame",
+        frame->index,
+        cpu_ticks_to_ms(frame->start - w->origin) * 1000.0,
+        cpu_ticks_to_ms(frame->duration));
+    w->first = false;
+
+    for (i32 i = 0; i < frame->tags_count; i++) {
+        w->length += snprintf(
+            w->buffer + w->length, PROFILER_TRACE_BUFFER - w->length,
+            "%s%s", i == 0 ? "" : ", ", frame->tags[i]);
+    }
+
+    w->length += snprintf(w->buffer + w->length, PROFILER_TRACE_BUFFER - w->length, "\"}}");
+
+    Array<ProfileEvent> events = frame->events;
+    Array<ProfileCounterEvent> counters = frame->counter_events;
+
+    i32 *start_of   = alloc_array(g_heap, i32, counters.count);
+    i32 *counter_at = ialloc_array<i32>(g_heap, events.count, -1);
+    defer {
+        dealloc(g_heap, start_of);
+        dealloc(g_heap, counter_at);
+    };
+
+    profiler_pair_counters(counters, events, start_of);
+    for (i32 i = 0; i < counters.count; i++) {
+        counter_at[counters[i].event_index] = i;
+    }
+
+    profiler_trace_events(w, events, 0, counters, start_of, counter_at);
+    profiler_trace_events(w, frame->gpu_events, 1, {}, nullptr, nullptr);
+}
+
+// NOTE(jesper): writes the frames in the chrome://tracing JSON format. CPU
+// events are on tid 0 and GPU events on tid 1, the GPU timestamps are already
+// anchored to the CPU clock at submit. hitch is the index into frames of the
+// frame that triggered the dump, or -1
+bool profiler_write_trace(FilePathView path, ProfileFrame *frames, i32 count, i32 hitch)
+{
+    if (!file_exists(path) && !create_file(path, true)) {
+        LOG_WARNING("unable to create trace file: %.*s", path.absolute.size, path.absolute.bytes);
+        return false;
+    }
+
+    ProfileTraceWriter w = {};
+    w.file = open_file(path, FileAccess_write);
+    if (w.file == nullptr) {
+        LOG_WARNING("unable to open trace file: %.*s", path.absolute.size, path.absolute.bytes);
+        return false;
+    }
+    defer { close_file(w.file); };
+
+    w.origin = frames[0].start;
+    for (i32 i = 0; i < count; i++) {
+        ProfileFrame &f = frames[i];
+        if (f.events.count > 0) {
+            w.origin = min(w.origin, f.events[0].timestamp);
+        }
+
+        for (i32 j = 0; j < f.gpu_events.count; j++) {
+            w.origin = min(w.origin, f.gpu_events[j].timestamp);
+        }
+    }
+
+    w.buffer = alloc_array(g_heap, char, PROFILER_TRACE_BUFFER);
+    defer { dealloc(g_heap, w.buffer); };
+
+    w.first  = true;
+    w.length = snprintf(w.buffer, PROFILER_TRACE_BUFFER, "{\"traceEvents\":[" FILE_EOL);
+
+    for (i32 i = 0; i < count; i++) {
+        profiler_trace_frame(&w, &frames[i], i == hitch);
+    }
+
+    w.length += snprintf(
+        w.buffer + w.length, PROFILER_TRACE_BUFFER - w.length,
+        FILE_EOL "]}" FILE_EOL);
+    profiler_trace_flush(&w);
+
+    return true;
+}
+
+void profiler_export_trace(FilePathView path)
+{
+    if (g_profile_history_count == 0) {
+        LOG_WARNING("no profile events to export");
+        return;
+    }
+
+    i32 last = (g_profile_history_next + PROFILER_HISTORY_FRAMES - 1) % PROFILER_HISTORY_FRAMES;
+    if (profiler_write_trace(path, &g_profile_history[last], 1, -1)) {
+        LOG_INFO("wrote profiler trace to %.*s", path.absolute.size, path.absolute.bytes);
+    }
+}
+
+void profiler_tag_frame(const char *tag)
+{
+    for (i32 i = 0; i < g_profile_frame_tags_count; i++) {
+        if (g_profile_frame_tags[i] == tag) {
+            return;
+        }
+    }
+
+    if (g_profile_frame_tags_count < PROFILER_MAX_FRAME_TAGS) {
+        g_profile_frame_tags[g_profile_frame_tags_count++] = tag;
+    }
+}
+
+template<typename T>
+void profiler_copy_events(Array<T> *dst, Array<T> src)
+{
+    if (dst->capacity < src.count) {
+        dst->data     = realloc_array(dst->allocator, dst->data, src.count);
+        dst->capacity = src.count;
+    }
+
+    memcpy(dst->data, src.data, (usize)src.count * sizeof(T));
+    dst->count = src.count;
+}
+
+void profiler_dump_hitch()
+{
+    i32 frames = min(2 * g_profile_hitch_frames + 1, g_profile_history_count);
+
+    // NOTE(jesper): the history is a ring, copy the frames out oldest first so
+    // that the trace writer can take a flat array
+    ProfileFrame *ordered = alloc_array(g_heap, ProfileFrame, frames);
+    defer { dealloc(g_heap, ordered); };
+
+    i32 first = (g_profile_history_next + PROFILER_HISTORY_FRAMES - frames) % PROFILER_HISTORY_FRAMES;
+
+    i32 hitch = -1;
+    for (i32 i = 0; i < frames; i++) {
+        ordered[i] = g_profile_history[(first + i) % PROFILER_HISTORY_FRAMES];
+        if (ordered[i].index == g_profile_hitch_index) {
+            hitch = i;
+        }
+    }
+
+    char tags[256];
+    i32 tags_length = 0;
+    tags[0] = '\0';
+
+    for (i32 i = 0; i < frames; i++) {
+        for (i32 j = 0; j < ordered[i].tags_count; j++) {
+            const char *tag = ordered[i].tags[j];
+            if (strstr(tags, tag) != nullptr) {
+                continue;
+            }
+
+            tags_length += snprintf(
+                tags + tags_length, sizeof tags - (usize)tags_length,
+                "%s%s", tags_length == 0 ? "" : ", ", tag);
+            tags_length = min(tags_length, (i32)sizeof tags - 1);
+        }
+    }
+
+    char name[64];
+    snprintf(name, sizeof name, "hitch_%" PRIu64 ".json", g_profile_hitch_index);
+
+    FilePath path = resolve_file_path(GamePath_preferences, name, g_stack);
+    if (profiler_write_trace(path, ordered, frames, hitch)) {
+        LOG_INFO("wrote hitch trace of %d frames to %s (%s)",
+                 frames, path.absolute.bytes,
+                 tags_length > 0 ? tags : "no catalog activity");
+    }
+}
+
+void profiler_record_frame(u64 start, u64 duration)
+{
+    ProfileFrame *frame = &g_profile_history[g_profile_history_next];
+    g_profile_history_next  = (g_profile_history_next + 1) % PROFILER_HISTORY_FRAMES;
+    g_profile_history_count = min(g_profile_history_count + 1, PROFILER_HISTORY_FRAMES);
+
+    frame->index    = g_profiler_frame - 1;
+    frame->start    = start;
+    frame->duration = duration;
+
+    profiler_copy_events(&frame->events, g_profile_events_prev);
+    profiler_copy_events(&frame->gpu_events, g_profile_gpu_events_prev);
+    profiler_copy_events(&frame->counter_events, g_profile_counter_events_prev);
+
+    frame->tags_count = g_profile_frame_tags_count;
+    for (i32 i = 0; i < g_profile_frame_tags_count; i++) {
+        frame->tags[i] = g_profile_frame_tags[i];
+    }
+    g_profile_frame_tags_count = 0;
+
+    if (g_profile_hitch_remaining > 0) {
+        if (--g_profile_hitch_remaining == 0) {
+            profiler_dump_hitch();
+        }
+        return;
+    }
+
+    u64 budget = cpu_ticks_from_ms(g_settings.profiler.frame_budget_us / 1000.0);
+    i32 warmup = max(1, g_settings.profiler.stats_window);
+
+    if (budget == 0 || duration <= budget || g_profiler_frame <= (u64)warmup) {
+        return;
+    }
+
+    LOG_WARNING("hitch in frame %" PRIu64 ": %.2f ms, budget %.2f ms",
+                frame->index,
+                cpu_ticks_to_ms(duration),
+                cpu_ticks_to_ms(budget));
+
+    g_profile_hitch_index  = frame->index;
+    g_profile_hitch_frames = max(0, min(g_settings.profiler.hitch_frames,
+                                        PROFILER_MAX_HITCH_FRAMES));
+    g_profile_hitch_remaining = g_profile_hitch_frames;
+
+    if (g_profile_hitch_remaining == 0) {
+        profiler_dump_hitch();
+    }
+}
+
 void init_profiler()
 {
+    profiler_calibrate();
+
     init_array(&g_profile_events, g_heap);
     init_array(&g_profile_events_prev, g_heap);
+    init_array(&g_profile_gpu_events, g_heap);
+    init_array(&g_profile_gpu_events_prev, g_heap);
     init_array(&g_profile_timers, g_heap);
+    init_array(&g_profile_samples, g_system_alloc);
+    init_array(&g_profile_hot_functions, g_heap);
+    init_array(&g_profile_counter_events, g_heap);
+    init_array(&g_profile_counter_events_prev, g_heap);
+
+    for (i32 i = 0; i < PROFILER_HISTORY_FRAMES; i++) {
+        init_array(&g_profile_history[i].events, g_heap);
+        init_array(&g_profile_history[i].gpu_events, g_heap);
+        init_array(&g_profile_history[i].counter_events, g_heap);
+    }
+
+    g_profiler_counters = platform_counters_init();
+
+    g_profile_alloc_thread = true;
+    g_profile_scope_depth  = 0;
+
+    profiler_register_allocator(g_heap,         "heap",        false);
+    profiler_register_allocator(g_frame,        "frame",       true);
+    profiler_register_allocator(g_stack,        "stack",       true);
+    profiler_register_allocator(g_persistent,   "persistent",  false);
+    profiler_register_allocator(g_debug_frame,  "debug frame", true);
+    profiler_register_allocator(g_system_alloc, "system",      false);
 }
 
 void init_profiler_gui()
@@ -145,17 +1200,32 @@ void profiler_begin_frame()
 {
     // TODO(jesper): THREAD_SAFETY
     std::swap(g_profile_events, g_profile_events_prev);
+    std::swap(g_profile_gpu_events, g_profile_gpu_events_prev);
+    std::swap(g_profile_counter_events, g_profile_counter_events_prev);
     g_profile_events.count = 0;
+    g_profile_gpu_events.count = 0;
+    g_profile_counter_events.count = 0;
+
+    i32 alloc_frame = g_profile_alloc_frame;
+    g_profile_alloc_frame ^= 1;
+    g_profiler_frame++;
     g_profile_timers.count = 0;
 
     PROFILE_FUNCTION();
 
+    if (g_profiler_sampling) {
+        PROFILE_SCOPE(profiler_drain_samples);
+        profiler_drain_samples();
+    }
+
     static u64 last_ticks = cpu_ticks();
     static u32 max_duration = 0;
 
     u64 ticks = cpu_ticks();
     u32 duration = (u32)(ticks - last_ticks);
 
+    profiler_record_frame(last_ticks, ticks - last_ticks);
+
     last_ticks = ticks;
     max_duration = MAX(max_duration, duration);
 
@@ -238,51 +1308,42 @@ void profiler_begin_frame()
     {
         PROFILE_SCOPE(profile_timer_gather);
 
-        i32 s = 0;
-        i32 stack[PROFILER_MAX_STACK_DEPTH];
-
-        for (i32 i = 0; i < PROFILER_MAX_STACK_DEPTH; i++) {
-            stack[i] = -1;
+        // NOTE(jesper): maps site id to its index in g_profile_timers
+        i32 timer_index[PROFILER_MAX_SITES];
+        for (u32 i = 0; i < g_profile_sites_count; i++) {
+            timer_index[i] = -1;
         }
 
-        // TODO(jesper): thread local g_profile_events
-        for (i32 i = 0; i < g_profile_events_prev.count; i++) {
-            ProfileEvent event = g_profile_events_prev[i];
+        profiler_gather_events(g_profile_events_prev, timer_index, false);
+        profiler_gather_events(g_profile_gpu_events_prev, timer_index, true);
 
-            if (event.type == ProfileEvent_start) {
-                stack[s++] = i;
-                ASSERT(s < PROFILER_MAX_STACK_DEPTH);
-            } else if (event.type == ProfileEvent_end) {
-                i32 pid = stack[--s];
-                ASSERT(pid != -1);
+        if (g_profile_counter_events_prev.count > 0) {
+            profiler_gather_counters(
+                g_profile_counter_events_prev,
+                g_profile_events_prev,
+                timer_index);
+        }
 
-                ProfileEvent parent = g_profile_events_prev[pid];
-                ASSERT(event.name == parent.name || strcmp(event.name, parent.name) == 0);
+        profiler_gather_allocs(&g_profile_alloc_frames[alloc_frame], timer_index);
+    }
 
-                ProfileTimer timer;
-                timer.name = parent.name;
-                timer.file = parent.file;
-                timer.line = parent.line;
-                timer.duration = event.timestamp - parent.timestamp;
-                timer.calls = 1;
+    {
+        PROFILE_SCOPE(profiler_timer_stats);
 
-                i32 j = 0;
-                for (j = 0; j < g_profile_timers.count; j++) {
-                    ProfileTimer exist = g_profile_timers[j];
+        i32 window = g_settings.profiler.stats_window;
+        window = max(1, min(window, PROFILER_MAX_STATS_WINDOW));
 
-                    if (timer.file == exist.file && timer.line == exist.line) {
-                        goto merge_existing;
-                    }
-                }
+        for (i32 i = 0; i < g_profile_timers.count; i++) {
+            ProfileTimer &timer = g_profile_timers[i];
+            ProfileStats *stats = &g_profile_stats[timer.site_id];
 
-                array_add(&g_profile_timers, timer);
-                continue;
+            profiler_add_sample(stats, timer.duration, window);
 
-    merge_existing:
-                ProfileTimer &existing = g_profile_timers[j];
-                existing.calls++;
-                existing.duration += timer.duration;
-            }
+            timer.mean = stats->sum / (u64)stats->count;
+            timer.p50  = profiler_percentile(stats, 50);
+            timer.p95  = profiler_percentile(stats, 95);
+            timer.p99  = profiler_percentile(stats, 99);
+            timer.max  = stats->sorted[stats->count - 1];
         }
     }
 
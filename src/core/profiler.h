@@ -11,70 +11,233 @@ enum ProfileEventType {
     ProfileEvent_end
 };
 
+// NOTE(jesper): one per PROFILE_SCOPE/PROFILE_FUNCTION/PROFILE_START site,
+// registered the first time the site is hit. Events only carry the site id so
+// that we don't copy name, file and line into every event.
+struct ProfileSite {
+    const char *name;
+    const char *file;
+    i32         line;
+};
+
 struct ProfileEvent {
+    u32              site_id;
     ProfileEventType type;
-    const char       *name;
-    const char       *file;
-    i32              line;
     u64              timestamp;
 };
 
+static_assert(sizeof(ProfileEvent) == 16, "ProfileEvent should be 16 bytes");
+
+#define PROFILER_MAX_ALLOCATORS (8)
+
+struct ProfileAllocStats {
+    u64 bytes;
+    u64 count;
+};
+
+enum ProfileCounter {
+    ProfileCounter_instructions,
+    ProfileCounter_cycles,
+    ProfileCounter_l1d_misses,
+    ProfileCounter_llc_misses,
+    ProfileCounter_branch_misses,
+    ProfileCounter_count
+};
+
+// NOTE(jesper): hardware counter values read at the start or end of a
+// PROFILE_SCOPE_COUNTERS scope. event_index is the scope's ProfileEvent in the
+// same frame, which has the site and the type.
+struct ProfileCounterEvent {
+    i32 event_index;
+    bool valid;
+    u64 values[ProfileCounter_count];
+};
+
 struct ProfileTimer {
-    const char *name;
-    const char *file;
-    i32         line;
-    u64 duration;
-    u64 calls;
-    i32 parent;
+    u32  site_id;
+    u64  duration;
+    u64  calls;
+    i32  parent;
+    bool gpu;
+
+    // NOTE(jesper): summed over all calls this frame, only valid if counters
+    bool counters;
+    u64  counter_totals[ProfileCounter_count];
+
+    // NOTE(jesper): allocations made while this was the innermost scope,
+    // indexed by Allocator::profile_id. steady_state_allocs is set if any of
+    // them were from an allocator that isn't allowed in the frame loop after
+    // warm-up, steady_state_frames counts the frames it's happened in
+    ProfileAllocStats allocs[PROFILER_MAX_ALLOCATORS];
+    bool steady_state_allocs;
+    u32  steady_state_frames;
+
+    // NOTE(jesper): rolling statistics of the per-frame duration over the last
+    // g_settings.profiler.stats_window frames that the site was hit, in ticks
+    u64 mean;
+    u64 p50;
+    u64 p95;
+    u64 p99;
+    u64 max;
 };
 
-u64 cpu_ticks()
-{
-#if defined(_WIN32)
-    int registers[4];
-    __cpuid(registers, 0);
-    return __rdtsc();
-#else
-    return __rdtsc();
-#endif
-}
+#define PROFILER_SAMPLE_MAX_DEPTH (32)
+
+// NOTE(jesper): a call stack captured by the sampler, ips[0] is the
+// instruction pointer at the time of the sample
+struct ProfileSample {
+    u32 tid;
+    u32 depth;
+    u64 ips[PROFILER_SAMPLE_MAX_DEPTH];
+};
+
+struct ProfileSymbol {
+    const char *module;
+    u64         address;
+    // NOTE(jesper): address relative to the module's load address, for
+    // addr2line when the symbol isn't exported
+    u64         offset;
+    char        name[128];
+};
+
+struct ProfileHotFunction {
+    ProfileSymbol symbol;
+    u32           self;
+    u32           inclusive;
+};
+
+u64 cpu_ticks();
+f64 cpu_ticks_to_ms(u64 ticks);
+u64 cpu_ticks_from_ms(f64 ms);
 
 void init_profiler();
 void profiler_begin_frame();
 void profiler_end_frame();
 
-void profiler_start(const char *name, const char *file, i32 line);
-void profiler_end(const char *name, const char *file, i32 line);
+u32 profiler_register_site(const char *name, const char *file, i32 line);
+ProfileSite* profiler_site(u32 site_id);
+
+void profiler_start(u32 site_id);
+void profiler_end(u32 site_id);
+
+void profiler_start_counters(u32 site_id);
+void profiler_end_counters(u32 site_id);
+
+void profiler_register_allocator(Allocator *a, const char *name, bool allowed_in_frame);
+void profiler_alloc(Allocator *a, isize size);
+
+bool platform_counters_init();
+bool platform_counters_read(u64 *values);
+
+void profiler_export_trace(FilePathView path);
+
+// NOTE(jesper): tag must be a string literal, tags are kept by pointer and
+// included in the hitch trace of the frame they were added in
+void profiler_tag_frame(const char *tag);
+
+// NOTE(jesper): the sampler captures call stacks at
+// g_settings.profiler.sampler_frequency Hz regardless of instrumentation. The
+// samples are symbolised and aggregated when it's stopped.
+void profiler_start_sampling();
+void profiler_stop_sampling();
+
+bool platform_sampler_start(i32 frequency);
+void platform_sampler_stop();
+bool platform_sampler_next(ProfileSample *sample);
+u32  platform_sampler_dropped();
+bool platform_symbolise(u64 ip, ProfileSymbol *symbol);
+
+// NOTE(jesper): GPU events are read back a few frames after they were
+// recorded, timestamp is in cpu_ticks
+void profiler_gpu_event(u32 site_id, ProfileEventType type, u64 timestamp);
+void gfx_profile_timestamp(VkCommandBuffer cmd, u32 site_id, bool end);
 
 struct ProfileScope {
-    const char *name;
-    const char *file;
-    i32         line;
+    u32 site_id;
 
-    ProfileScope(const char *name, const char *file, i32 line)
+    ProfileScope(u32 site_id)
     {
-        this->name = name;
-        this->file = file;
-        this->line = line;
-        profiler_start(name, file, line);
+        this->site_id = site_id;
+        profiler_start(site_id);
     }
 
     ~ProfileScope()
     {
-        profiler_end(name, file, line);
+        profiler_end(site_id);
+    }
+};
+
+struct ProfileCounterScope {
+    u32 site_id;
+
+    ProfileCounterScope(u32 site_id)
+    {
+        this->site_id = site_id;
+        profiler_start_counters(site_id);
+    }
+
+    ~ProfileCounterScope()
+    {
+        profiler_end_counters(site_id);
+    }
+};
+
+struct GpuProfileScope {
+    VkCommandBuffer cmd;
+    u32 site_id;
+
+    GpuProfileScope(VkCommandBuffer cmd, u32 site_id)
+    {
+        this->cmd     = cmd;
+        this->site_id = site_id;
+        gfx_profile_timestamp(cmd, site_id, false);
+    }
+
+    ~GpuProfileScope()
+    {
+        gfx_profile_timestamp(cmd, site_id, true);
     }
 };
 
 
 #if LEARY_ENABLE_PROFILER || 1
 
-#define PROFILE_START(name) profiler_start(#name, __FILE__, __LINE__)
-#define PROFILE_END(name)   profiler_end(#name, __FILE__, __LINE__)
+#define PROFILE_SITE(name, file, line)\
+    static u32 MCOMBINE(profile_site_, line) = profiler_register_site(name, file, line)
+
+#define PROFILE_START(name)\
+    static u32 MCOMBINE(profile_site_, name) = profiler_register_site(#name, __FILE__, __LINE__);\
+    profiler_start(MCOMBINE(profile_site_, name))
+#define PROFILE_END(name)   profiler_end(MCOMBINE(profile_site_, name))
 
 #define PROFILE_SCOPE(name)\
-    ProfileScope MCOMBINE(profile_scope, __LINE__)(#name, __FILE__, __LINE__)
+    PROFILE_SITE(#name, __FILE__, __LINE__);\
+    ProfileScope MCOMBINE(profile_scope, __LINE__)(MCOMBINE(profile_site_, __LINE__))
 #define PROFILE_FUNCTION()\
-    ProfileScope MCOMBINE(profile_scope, __LINE__)(__FUNCTION__, __FILE__, __LINE__)
+    PROFILE_SITE(__FUNCTION__, __FILE__, __LINE__);\
+    ProfileScope MCOMBINE(profile_scope, __LINE__)(MCOMBINE(profile_site_, __LINE__))
+
+#define PROFILE_START_COUNTERS(name)\
+    static u32 MCOMBINE(profile_site_, name) = profiler_register_site(#name, __FILE__, __LINE__);\
+    profiler_start_counters(MCOMBINE(profile_site_, name))
+#define PROFILE_END_COUNTERS(name) profiler_end_counters(MCOMBINE(profile_site_, name))
+
+#define PROFILE_SCOPE_COUNTERS(name)\
+    PROFILE_SITE(#name, __FILE__, __LINE__);\
+    ProfileCounterScope MCOMBINE(profile_scope, __LINE__)(MCOMBINE(profile_site_, __LINE__))
+#define PROFILE_FUNCTION_COUNTERS()\
+    PROFILE_SITE(__FUNCTION__, __FILE__, __LINE__);\
+    ProfileCounterScope MCOMBINE(profile_scope, __LINE__)(MCOMBINE(profile_site_, __LINE__))
+
+#define GPU_PROFILE_START(cmd, name)\
+    static u32 MCOMBINE(gpu_profile_site_, name) = profiler_register_site(#name, __FILE__, __LINE__);\
+    gfx_profile_timestamp(cmd, MCOMBINE(gpu_profile_site_, name), false)
+#define GPU_PROFILE_END(cmd, name)\
+    gfx_profile_timestamp(cmd, MCOMBINE(gpu_profile_site_, name), true)
+
+#define GPU_PROFILE_SCOPE(cmd, name)\
+    PROFILE_SITE(#name, __FILE__, __LINE__);\
+    GpuProfileScope MCOMBINE(gpu_profile_scope, __LINE__)(cmd, MCOMBINE(profile_site_, __LINE__))
 
 #else
 
@@ -83,4 +246,13 @@ struct ProfileScope {
 #define PROFILE_SCOPE(...)    do {} while(0)
 #define PROFILE_FUNCTION(...) do {} while(0)
 
+#define PROFILE_START_COUNTERS(...)    do {} while(0)
+#define PROFILE_END_COUNTERS(...)      do {} while(0)
+#define PROFILE_SCOPE_COUNTERS(...)    do {} while(0)
+#define PROFILE_FUNCTION_COUNTERS(...) do {} while(0)
+
+#define GPU_PROFILE_START(...) do {} while(0)
+#define GPU_PROFILE_END(...)   do {} while(0)
+#define GPU_PROFILE_SCOPE(...) do {} while(0)
+
 #endif // LEARY_ENABLE_PROFILER
\ No newline at end of file
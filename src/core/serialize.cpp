@@ -17,34 +17,34 @@ member_to_string(StructMemberInfo &member,
     switch (member.type) {
     case VariableType_int32: {
         i32 value = *(i32*)(((char*)ptr) + member.offset);
-        bytes = sprintf(buffer, "%s = %d", member.name, value);
+        bytes = format(buffer, size, "{} = {}", member.name, value);
 
         ASSERT(bytes < size);
         break;
     }
     case VariableType_uint32: {
         u32 value = *(u32*)(((char*)ptr) + member.offset);
-        bytes = sprintf(buffer, "%s = %u", member.name, value);
+        bytes = format(buffer, size, "{} = {}", member.name, value);
 
         ASSERT(bytes < size);
         break;
     }
     case VariableType_int16: {
         i16 value = *(i16*)(((char*)ptr) + member.offset);
-        bytes = sprintf(buffer, "%s = %" PRId16 , member.name, value);
+        bytes = format(buffer, size, "{} = {}", member.name, value);
 
         ASSERT(bytes < size);
         break;
     }
     case VariableType_uint16: {
         u16 value = *(u16*)(((char*)ptr) + member.offset);
-        bytes = sprintf(buffer, "%s = %" PRIu16, member.name, value);
+        bytes = format(buffer, size, "{} = {}", member.name, value);
 
         ASSERT(bytes < size);
         break;
     }
     case VariableType_resolution: {
-        i32 child_bytes = sprintf(buffer, "%s = { ", member.name);
+        i32 child_bytes = format(buffer, size, "{} = {{ ", member.name);
 
         bytes  += child_bytes;
         buffer += child_bytes;
@@ -54,13 +54,13 @@ member_to_string(StructMemberInfo &member,
 
         for (i32 i = 0; i < (i32)num_members; i++) {
             StructMemberInfo &child = Resolution_members[i];
-            child_bytes = member_to_string(child, ptr, buffer, size);
+            child_bytes = member_to_string(child, (char*)ptr + member.offset, buffer, size - bytes);
 
             bytes  += child_bytes;
             buffer += child_bytes;
 
             if (i != (num_members - 1)) {
-                child_bytes = sprintf(buffer, ", ");
+                child_bytes = format(buffer, size - bytes, ", ");
 
                 bytes  += child_bytes;
                 buffer += child_bytes;
@@ -69,7 +69,7 @@ member_to_string(StructMemberInfo &member,
             ASSERT(bytes < size);
         }
 
-        child_bytes = sprintf(buffer, " }");
+        child_bytes = format(buffer, size - bytes, " }}");
 
         bytes  += child_bytes;
         buffer += child_bytes;
@@ -77,7 +77,7 @@ member_to_string(StructMemberInfo &member,
         break;
     }
     case VariableType_video_settings: {
-        i32 child_bytes = sprintf(buffer, "%s = { ", member.name);
+        i32 child_bytes = format(buffer, size, "{} = {{ ", member.name);
 
         bytes  += child_bytes;
         buffer += child_bytes;
@@ -87,13 +87,13 @@ member_to_string(StructMemberInfo &member,
 
         for (i32 i = 0; i < (i32)num_members; i++) {
             StructMemberInfo &child = VideoSettings_members[i];
-            child_bytes = member_to_string( child, ptr, buffer, size);
+            child_bytes = member_to_string(child, (char*)ptr + member.offset, buffer, size - bytes);
 
             bytes  += child_bytes;
             buffer += child_bytes;
 
             if (i != (num_members - 1)) {
-                child_bytes = sprintf(buffer, ", ");
+                child_bytes = format(buffer, size - bytes, ", ");
 
                 bytes  += child_bytes;
                 buffer += child_bytes;
@@ -102,7 +102,40 @@ member_to_string(StructMemberInfo &member,
             ASSERT(bytes < size);
         }
 
-        child_bytes = sprintf(buffer, "}");
+        child_bytes = format(buffer, size - bytes, "}}");
+
+        bytes  += child_bytes;
+        buffer += child_bytes;
+
+        break;
+    }
+    case VariableType_profiler_settings: {
+        i32 child_bytes = format(buffer, size, "{} = {{ ", member.name);
+
+        bytes  += child_bytes;
+        buffer += child_bytes;
+
+        i32 num_members = (i32)(sizeof(ProfilerSettings_members) /
+                                        sizeof(StructMemberInfo));
+
+        for (i32 i = 0; i < (i32)num_members; i++) {
+            StructMemberInfo &child = ProfilerSettings_members[i];
+            child_bytes = member_to_string(child, (char*)ptr + member.offset, buffer, size - bytes);
+
+            bytes  += child_bytes;
+            buffer += child_bytes;
+
+            if (i != (num_members - 1)) {
+                child_bytes = format(buffer, size - bytes, ", ");
+
+                bytes  += child_bytes;
+                buffer += child_bytes;
+            }
+
+            ASSERT(bytes < size);
+        }
+
+        child_bytes = format(buffer, size - bytes, "}}");
 
         bytes  += child_bytes;
         buffer += child_bytes;
@@ -110,7 +143,7 @@ member_to_string(StructMemberInfo &member,
         break;
     }
     default: {
-        bytes = sprintf(buffer, "unknown type");
+        bytes = format(buffer, size, "unknown type");
         ASSERT(bytes < size);
         break;
     }
@@ -202,6 +235,17 @@ member_from_string(char **ptr,
                                sizeof(StructMemberInfo),
                                child);
         } break;
+        case VariableType_profiler_settings: {
+            token = next_token(&lexer);
+            ASSERT(token.type == Token::open_curly_brace);
+
+            void *child = ((u8*)out + member->offset);
+            member_from_string(&lexer.at, lexer.end - lexer.at,
+                               ProfilerSettings_members,
+                               sizeof(ProfilerSettings_members) /
+                               sizeof(StructMemberInfo),
+                               child);
+        } break;
         default:
             LOG_UNIMPLEMENTED();
             //Log_unimplemented, "unhandled case: %d", member->type);
@@ -250,6 +294,7 @@ serialize_save_conf(FilePathView path, StructMemberInfo *members, i32 num_member
         i32 bytes = member_to_string(member, ptr, buffer, sizeof(buffer));
 
         write_file(file_handle, buffer, (usize)bytes);
+        write_file(file_handle, (void*)FILE_EOL, sizeof FILE_EOL - 1);
     }
 
     close_file(file_handle);
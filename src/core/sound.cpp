@@ -6,104 +6,135 @@
  * Copyright (c) 2018 - all rights reserved
  */
 
-Array<Sound> g_active_mono_sounds;
-Array<Sound> g_active_stereo_sounds;
-Array<Sound> g_active_looping_mono_sounds;
+Array<Sound> g_active_sounds;
+Array<Sound> g_active_looping_sounds;
 
 void init_sound()
 {
-    init_array(&g_active_mono_sounds, g_heap);
-    init_array(&g_active_stereo_sounds, g_heap);
-    init_array(&g_active_looping_mono_sounds, g_heap);
+    init_array(&g_active_sounds, g_heap);
+    init_array(&g_active_looping_sounds, g_heap);
 }
 
-void game_output_sound(i32 *sound_buffer, i32 samples_to_write)
+// NOTE(jesper): returns the frames from the cursor up to the end of the sound
+// or of the decoded block, whichever comes first, decoding the block if the
+// sound is compressed
+i16* sound_frames(Sound *snd, i32 *count)
 {
-    PROFILE_FUNCTION();
-    // TODO(jesper): support run-time resampling or do it in asset stage?
-    // TODO(jesper): bother with handling i32 overflow? could happen in theory
-    // TODO(jesper): support 24 bit audio?
-    // TODO(jesper): volume control
-    
-    f32 master_volume = 0.0f;
+    i32 remaining = snd->data.num_samples - snd->cursor;
+    if (snd->data.blocks == nullptr) {
+        *count = remaining;
+        return snd->data.samples + snd->cursor * snd->data.num_channels;
+    }
 
-    i32 *output = sound_buffer;
-    for (i32 j = 0; j < g_active_mono_sounds.count; j++) {
-        Sound &snd = g_active_mono_sounds[j];
+    i32 block = snd->cursor / ADPCM_BLOCK_SAMPLES;
+    if (block != snd->decoded_block) {
+        decode_adpcm_block(
+            snd->decoded,
+            snd->data.blocks + block * snd->data.block_size,
+            snd->data.num_channels);
+        snd->decoded_block = block;
+    }
 
-        output = sound_buffer;
-        for (i32 i = 0; i < samples_to_write; i++) {
-            *output++ += master_volume * snd.data.samples[snd.cursor];
-            *output++ += master_volume * snd.data.samples[snd.cursor];
-            snd.cursor++;
+    i32 offset = snd->cursor - block * ADPCM_BLOCK_SAMPLES;
+    *count = ADPCM_BLOCK_SAMPLES - offset < remaining ? ADPCM_BLOCK_SAMPLES - offset : remaining;
+    return snd->decoded + offset * snd->data.num_channels;
+}
 
-            if (snd.cursor >= snd.data.num_samples) {
-                array_remove(&g_active_mono_sounds, j--);
-                break;
+// NOTE(jesper): adds samples_to_write stereo frames of the sound to output,
+// returns false once a non-looping sound has ended
+bool mix_sound(
+    Sound *snd,
+    i32 *output,
+    i32 samples_to_write,
+    f32 volume,
+    bool looping)
+{
+    i32 written = 0;
+    while (written < samples_to_write) {
+        if (snd->cursor >= snd->data.num_samples) {
+            if (!looping) {
+                return false;
             }
-        }
-    }
 
-    for (i32 j = 0; j < g_active_stereo_sounds.count; j++) {
-        Sound &snd = g_active_stereo_sounds[j];
+            snd->cursor = 0;
+        }
 
-        output = sound_buffer;
-        for (i32 i = 0; i < samples_to_write; i++) {
-            *output++ += master_volume * snd.data.samples[snd.cursor++];
-            *output++ += master_volume * snd.data.samples[snd.cursor++];
+        i32 count;
+        i16 *frames = sound_frames(snd, &count);
+        if (count > samples_to_write - written) {
+            count = samples_to_write - written;
+        }
 
-            if (snd.cursor >= snd.data.num_samples) {
-                array_remove(&g_active_stereo_sounds, j--);
-                break;
+        i32 *dst = output + written * 2;
+        if (snd->data.num_channels == 1) {
+            for (i32 i = 0; i < count; i++) {
+                dst[2*i]   += volume * frames[i];
+                dst[2*i+1] += volume * frames[i];
+            }
+        } else {
+            for (i32 i = 0; i < count; i++) {
+                dst[2*i]   += volume * frames[2*i];
+                dst[2*i+1] += volume * frames[2*i+1];
             }
         }
+
+        snd->cursor += count;
+        written     += count;
     }
 
-    for (i32 j = 0; j < g_active_looping_mono_sounds.count; j++) {
-        Sound &snd = g_active_looping_mono_sounds[j];
+    return looping || snd->cursor < snd->data.num_samples;
+}
 
-        output = sound_buffer;
-        for (i32 i = 0; i < samples_to_write; i++) {
-            *output++ += master_volume * snd.data.samples[snd.cursor];
-            *output++ += master_volume * snd.data.samples[snd.cursor];
-            snd.cursor++;
+void game_output_sound(i32 *sound_buffer, i32 samples_to_write)
+{
+    PROFILE_FUNCTION();
+    // TODO(jesper): bother with handling i32 overflow? could happen in theory
+    // TODO(jesper): support 24 bit audio?
+    // TODO(jesper): volume control
+    
+    f32 master_volume = 0.0f;
 
-            if (snd.cursor >= snd.data.num_samples) {
-                snd.cursor = 0;
-            }
+    for (i32 j = 0; j < g_active_sounds.count; j++) {
+        Sound *snd = &g_active_sounds[j];
+        if (!mix_sound(snd, sound_buffer, samples_to_write, master_volume, false)) {
+            array_remove(&g_active_sounds, j--);
         }
     }
+
+    for (i32 j = 0; j < g_active_looping_sounds.count; j++) {
+        Sound *snd = &g_active_looping_sounds[j];
+        mix_sound(snd, sound_buffer, samples_to_write, master_volume, true);
+    }
 }
 
-void play_sound(SoundData data)
+bool valid_sound(SoundData data)
 {
-    Sound sound = {};
-    sound.data = data;
-
-    switch (data.num_channels) {
-    case 1:
-        array_add(&g_active_mono_sounds, sound);
-        break;
-    case 2:
-        array_add(&g_active_stereo_sounds, sound);
-        break;
-    default:
+    if (data.num_channels < 1 || data.num_channels > ADPCM_MAX_CHANNELS) {
         LOG("unsupported number of channels: %d", data.num_channels);
-        break;
+        return false;
     }
+
+    return data.num_samples > 0 && (data.samples != nullptr || data.blocks != nullptr);
 }
 
-void play_looping_sound(SoundData data)
+void play_sound(SoundData data)
 {
+    if (!valid_sound(data)) {
+        return;
+    }
+
     Sound sound = {};
     sound.data = data;
+    array_add(&g_active_sounds, sound);
+}
 
-    switch (data.num_channels) {
-    case 1:
-        array_add(&g_active_looping_mono_sounds, sound);
-        break;
-    default:
-        LOG("unsupported number of channels: %d", data.num_channels);
-        break;
+void play_looping_sound(SoundData data)
+{
+    if (!valid_sound(data)) {
+        return;
     }
+
+    Sound sound = {};
+    sound.data = data;
+    array_add(&g_active_looping_sounds, sound);
 }
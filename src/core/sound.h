@@ -7,8 +7,14 @@
  */
 
 struct Sound {
+    // NOTE(jesper): in frames
     i32 cursor = 0;
     SoundData data = {};
+
+    // NOTE(jesper): the block of a compressed sound that's in decoded, the
+    // mixer decodes the block the cursor is in when it gets there
+    i32 decoded_block = -1;
+    i16 decoded[ADPCM_BLOCK_SAMPLES * ADPCM_MAX_CHANNELS];
 };
 
 void game_output_sound(i32 *sound_buffer, i32 samples_to_write);
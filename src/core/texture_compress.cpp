@@ -0,0 +1,286 @@
+/**
+ * file:    texture_compress.cpp
+ * created: 2018-09-23
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+u16 rgb565_from_bgra(u8 *bgra)
+{
+    u32 r = (bgra[2] * 31 + 127) / 255;
+    u32 g = (bgra[1] * 63 + 127) / 255;
+    u32 b = (bgra[0] * 31 + 127) / 255;
+    return (u16)((r << 11) | (g << 5) | b);
+}
+
+// NOTE(jesper): expands the 565 colour to the 8 bit values the GPU decodes it
+// to, with alpha left at 0 to match the masked pixels in bc1_distances
+u32 bgra_from_rgb565(u16 c)
+{
+    u32 r = (c >> 11) & 0x1F;
+    u32 g = (c >> 5) & 0x3F;
+    u32 b = c & 0x1F;
+
+    r = (r << 3) | (r >> 2);
+    g = (g << 2) | (g >> 4);
+    b = (b << 3) | (b >> 2);
+    return (r << 16) | (g << 8) | b;
+}
+
+u32 bgra_lerp_third(u32 c0, u32 c1)
+{
+    u32 result = 0;
+    for (i32 i = 0; i < 24; i += 8) {
+        u32 a = (c0 >> i) & 0xFF;
+        u32 b = (c1 >> i) & 0xFF;
+        result |= ((2 * a + b) / 3) << i;
+    }
+    return result;
+}
+
+// NOTE(jesper): squared rgb distance from each of the 4 pixels to colour
+__m128i bc1_distances(__m128i pixels, __m128i colour)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i d    = _mm_or_si128(_mm_subs_epu8(pixels, colour), _mm_subs_epu8(colour, pixels));
+
+    __m128i lo = _mm_unpacklo_epi8(d, zero);
+    __m128i hi = _mm_unpackhi_epi8(d, zero);
+    lo = _mm_madd_epi16(lo, lo);
+    hi = _mm_madd_epi16(hi, hi);
+
+    __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 odd  = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+    return _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+}
+
+__m128i select_epi32(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+void encode_bc1_block(u8 *dst, u8 *src)
+{
+    __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+
+    __m128i rows[4];
+    for (i32 i = 0; i < 4; i++) {
+        rows[i] = _mm_and_si128(_mm_loadu_si128((__m128i*)(src + i * 16)), rgb_mask);
+    }
+
+    __m128i lo = _mm_min_epu8(_mm_min_epu8(rows[0], rows[1]), _mm_min_epu8(rows[2], rows[3]));
+    __m128i hi = _mm_max_epu8(_mm_max_epu8(rows[0], rows[1]), _mm_max_epu8(rows[2], rows[3]));
+
+    lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+    lo = _mm_min_epu8(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 0, 3, 2)));
+    hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+    hi = _mm_max_epu8(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 0, 3, 2)));
+
+    i32 min[3], max[3];
+    {
+        u32 l = (u32)_mm_cvtsi128_si32(lo);
+        u32 h = (u32)_mm_cvtsi128_si32(hi);
+        for (i32 i = 0; i < 3; i++) {
+            min[i] = (l >> (i * 8)) & 0xFF;
+            max[i] = (h >> (i * 8)) & 0xFF;
+        }
+    }
+
+    // NOTE(jesper): the bounding box diagonal from min to max only fits
+    // blocks where the channels increase together. Flip the channels that
+    // correlate negatively with the one with the largest range to the other
+    // diagonal.
+    i32 axis = 1;
+    for (i32 i = 0; i < 3; i++) {
+        if (max[i] - min[i] > max[axis] - min[axis]) {
+            axis = i;
+        }
+    }
+
+    i32 cov[3] = {};
+    for (i32 i = 0; i < 16; i++) {
+        u8 *p = src + i * 4;
+        i32 a = 2 * p[axis] - (min[axis] + max[axis]);
+        for (i32 j = 0; j < 3; j++) {
+            cov[j] += (2 * p[j] - (min[j] + max[j])) * a;
+        }
+    }
+
+    for (i32 i = 0; i < 3; i++) {
+        if (cov[i] < 0) {
+            i32 tmp = min[i]; min[i] = max[i]; max[i] = tmp;
+        }
+    }
+
+    // NOTE(jesper): inset the endpoints by 1/16th of the range, most of the
+    // pixels are closer to the interpolated colours than to the extremes
+    u8 e0[4], e1[4];
+    for (i32 i = 0; i < 3; i++) {
+        i32 inset = (max[i] - min[i]) / 16;
+        e0[i] = (u8)(max[i] - inset);
+        e1[i] = (u8)(min[i] + inset);
+    }
+
+    u16 c0 = rgb565_from_bgra(e0);
+    u16 c1 = rgb565_from_bgra(e1);
+
+    u32 indices = 0;
+    if (c0 != c1) {
+        // NOTE(jesper): c0 > c1 selects the 4 colour mode
+        if (c0 < c1) {
+            u16 tmp = c0; c0 = c1; c1 = tmp;
+        }
+
+        u32 p0 = bgra_from_rgb565(c0);
+        u32 p1 = bgra_from_rgb565(c1);
+
+        __m128i palette[4];
+        palette[0] = _mm_set1_epi32((i32)p0);
+        palette[1] = _mm_set1_epi32((i32)p1);
+        palette[2] = _mm_set1_epi32((i32)bgra_lerp_third(p0, p1));
+        palette[3] = _mm_set1_epi32((i32)bgra_lerp_third(p1, p0));
+
+        for (i32 i = 0; i < 4; i++) {
+            __m128i best  = bc1_distances(rows[i], palette[0]);
+            __m128i index = _mm_setzero_si128();
+
+            for (i32 j = 1; j < 4; j++) {
+                __m128i d      = bc1_distances(rows[i], palette[j]);
+                __m128i closer = _mm_cmplt_epi32(d, best);
+
+                best  = select_epi32(closer, d, best);
+                index = select_epi32(closer, _mm_set1_epi32(j), index);
+            }
+
+            // NOTE(jesper): pack the 4 2-bit indices of the row into the low
+            // byte, pixel 0 in the lowest bits
+            index = _mm_or_si128(index, _mm_srli_epi64(index, 30));
+
+            u32 row = (u32)_mm_cvtsi128_si32(index) & 0xF;
+            row |= ((u32)_mm_cvtsi128_si32(_mm_srli_si128(index, 8)) & 0xF) << 4;
+            indices |= row << (i * 8);
+        }
+    }
+
+    memcpy(dst + 0, &c0, sizeof c0);
+    memcpy(dst + 2, &c1, sizeof c1);
+    memcpy(dst + 4, &indices, sizeof indices);
+}
+
+// NOTE(jesper): BC4 block of one channel, used for the alpha of BC3 and both
+// channels of BC5. Always uses the 8 value mode with a0 > a1.
+void encode_bc4_block(u8 *dst, u8 *src, i32 channel)
+{
+    u8 values[16];
+    u8 min = 255;
+    u8 max = 0;
+
+    for (i32 i = 0; i < 16; i++) {
+        values[i] = src[i * 4 + channel];
+        min = values[i] < min ? values[i] : min;
+        max = values[i] > max ? values[i] : max;
+    }
+
+    dst[0] = max;
+    dst[1] = min;
+
+    u64 indices = 0;
+    if (max != min) {
+        // NOTE(jesper): t is the nearest of the 8 evenly spaced values from
+        // min to max, index 0 is max, 1 is min and 2-7 are the interpolated
+        // values going down from max
+        i32 range = max - min;
+        for (i32 i = 0; i < 16; i++) {
+            i32 t     = ((values[i] - min) * 14 + range) / (2 * range);
+            u64 index = t == 7 ? 0 : t == 0 ? 1 : 8 - t;
+            indices |= index << (i * 3);
+        }
+    }
+
+    for (i32 i = 0; i < 6; i++) {
+        dst[2 + i] = (u8)(indices >> (i * 8));
+    }
+}
+
+void encode_bc3_block(u8 *dst, u8 *src)
+{
+    encode_bc4_block(dst, src, 3);
+    encode_bc1_block(dst + 8, src);
+}
+
+void encode_bc5_block(u8 *dst, u8 *src)
+{
+    encode_bc4_block(dst,     src, 2);
+    encode_bc4_block(dst + 8, src, 1);
+}
+
+i32 bc_block_size(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        return 8;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+isize bc_image_size(VkFormat format, i32 width, i32 height)
+{
+    isize blocks_x = (width  + BC_BLOCK_DIM - 1) / BC_BLOCK_DIM;
+    isize blocks_y = (height + BC_BLOCK_DIM - 1) / BC_BLOCK_DIM;
+    return blocks_x * blocks_y * bc_block_size(format);
+}
+
+void compress_image_bc(
+    u8 *dst,
+    VkFormat format,
+    u8 *src,
+    i32 width, i32 height)
+{
+    i32 block_size = bc_block_size(format);
+    ASSERT(block_size > 0);
+
+    u8 block[BC_BLOCK_DIM * BC_BLOCK_DIM * 4];
+
+    for (i32 by = 0; by < height; by += BC_BLOCK_DIM) {
+        for (i32 bx = 0; bx < width; bx += BC_BLOCK_DIM) {
+            for (i32 y = 0; y < BC_BLOCK_DIM; y++) {
+                i32 sy = by + y < height ? by + y : height - 1;
+                u8 *row = src + (isize)sy * width * 4;
+
+                if (bx + BC_BLOCK_DIM <= width) {
+                    memcpy(block + y * 16, row + bx * 4, 16);
+                } else {
+                    for (i32 x = 0; x < BC_BLOCK_DIM; x++) {
+                        i32 sx = bx + x < width ? bx + x : width - 1;
+                        memcpy(block + y * 16 + x * 4, row + sx * 4, 4);
+                    }
+                }
+            }
+
+            switch (format) {
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                encode_bc1_block(dst, block);
+                break;
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+                encode_bc3_block(dst, block);
+                break;
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+                encode_bc5_block(dst, block);
+                break;
+            default:
+                break;
+            }
+
+            dst += block_size;
+        }
+    }
+}
@@ -0,0 +1,41 @@
+/**
+ * file:    texture_compress.h
+ * created: 2018-09-23
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): block compression encoders for textures. The encoders all take
+// a 4x4 block of BGRA pixels, 64 bytes in row order, and write one compressed
+// block. Endpoints are picked from the inset bounding box of the block rather
+// than with a full least squares fit, trading a little quality for an encoder
+// fast enough to run on every load.
+//     BC1: rgb, 8 bytes per block
+//     BC3: BC1 rgb and an interpolated alpha block, 16 bytes per block
+//     BC5: two interpolated blocks of the red and green channels, 16 bytes per
+//          block. Used for tangent space normal maps with z reconstructed in
+//          the shader.
+
+#define BC_BLOCK_DIM (4)
+
+void encode_bc1_block(u8 *dst, u8 *src);
+void encode_bc3_block(u8 *dst, u8 *src);
+void encode_bc5_block(u8 *dst, u8 *src);
+
+// NOTE(jesper): size in bytes of one 4x4 block in the format, 0 if the format
+// isn't one of the block compressed formats we encode
+i32 bc_block_size(VkFormat format);
+
+// NOTE(jesper): size in bytes of a width x height image compressed to format,
+// partial blocks at the right and bottom edges are rounded up to full blocks
+isize bc_image_size(VkFormat format, i32 width, i32 height);
+
+// NOTE(jesper): compresses a width x height BGRA image, dst must hold
+// bc_image_size(format, width, height) bytes. Edge blocks are padded by
+// repeating the last row and column.
+void compress_image_bc(
+    u8 *dst,
+    VkFormat format,
+    u8 *src,
+    i32 width, i32 height);
@@ -8,6 +8,7 @@ enum VariableType {
 	VariableType_array,
 	VariableType_resolution,
 	VariableType_video_settings,
+	VariableType_profiler_settings,
 	VariableType_settings,
 	VariableType_Vector4,
 	VariableType_unknown
@@ -36,8 +37,16 @@ StructMemberInfo VideoSettings_members[] = {
 	{ VariableType_int16, "vsync", offsetof(VideoSettings, vsync), {} },
 };
 
+StructMemberInfo ProfilerSettings_members[] = {
+	{ VariableType_int32, "stats_window", offsetof(ProfilerSettings, stats_window), {} },
+	{ VariableType_int32, "sampler_frequency", offsetof(ProfilerSettings, sampler_frequency), {} },
+	{ VariableType_int32, "frame_budget_us", offsetof(ProfilerSettings, frame_budget_us), {} },
+	{ VariableType_int32, "hitch_frames", offsetof(ProfilerSettings, hitch_frames), {} },
+};
+
 StructMemberInfo Settings_members[] = {
 	{ VariableType_video_settings, "video", offsetof(Settings, video), {} },
+	{ VariableType_profiler_settings, "profiler", offsetof(Settings, profiler), {} },
 };
 
 StructMemberInfo Vector2_members[] = {
@@ -16,10 +16,12 @@
 
 #include <initializer_list>
 #include <stdio.h>
+#include <stdlib.h>
 
 // TODO(jesper): needed for swap, which we really don't need because none of our swaps
 // benefit from move semantics, and we can just do ourselves anyway
 #include <utility>
+#include <type_traits>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
@@ -33,6 +35,24 @@
 
 
 #if defined(__linux__)
+    #include <time.h>
+    #include <cpuid.h>
+    #include <x86intrin.h>
+    #include <errno.h>
+    #include <pthread.h>
+    #include <semaphore.h>
+    #include <signal.h>
+    #include <dirent.h>
+    #include <dlfcn.h>
+    #include <cxxabi.h>
+    #include <ucontext.h>
+    #include <unistd.h>
+    #include <sys/ioctl.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    #include <linux/perf_event.h>
 
     #define VK_USE_PLATFORM_XLIB_KHR
     #include <vulkan/vulkan.h>
@@ -65,9 +85,17 @@
 #include "core/array.h"
 #include "core/hash_table.h"
 #include "core/string.h"
+#include "core/format.h"
 #include "core/file.h"
+#include "core/derived_data.h"
 #include "core/gfx_vulkan.h"
 #include "core/assets.h"
+#include "core/asset_pack.h"
+#include "core/obj.h"
+#include "core/mesh_optimize.h"
+#include "core/image.h"
+#include "core/texture_compress.h"
+#include "core/adpcm.h"
 #include "core/serialize.h"
 #include "core/profiler.h"
 #include "core/sound.h"
@@ -82,7 +110,10 @@
 #include "generated/type_info.h"
 
 #if defined(__linux__)
+    #include "platform/linux_thread.cpp"
     #include "platform/linux_leary.cpp"
+    #include "platform/linux_sampler.cpp"
+    #include "platform/linux_counters.cpp"
 #elif defined(_WIN32)
     #include "platform/win32_debug.cpp"
     #include "platform/win32_thread.cpp"
@@ -102,8 +133,16 @@
 #include "core/profiler.cpp"
 #include "core/maths.cpp"
 #include "core/random.cpp"
+#include "core/asset_pack.cpp"
+#include "core/derived_data.cpp"
+#include "core/obj.cpp"
+#include "core/mesh_optimize.cpp"
+#include "core/image.cpp"
+#include "core/texture_compress.cpp"
+#include "core/adpcm.cpp"
 #include "core/assets.cpp"
 #include "core/string.cpp"
+#include "core/format.cpp"
 #include "core/file.cpp"
 #include "core/font.cpp"
 #include "core/gui.cpp"
@@ -143,6 +182,7 @@ struct GameReloadState {
     PlatformState *platform;
     Settings      settings;
     Catalog       texture_catalog;
+    AssetPack     asset_pack;
 
     VulkanDevice  *vulkan_device;
     GameState     *game;
@@ -580,11 +620,11 @@ void init_terrain()
     TextureAsset *ta = find_texture("terrain.bmp");
     ASSERT(ta != nullptr);
 
-    gfx_set_texture(
+    catalog_bind_texture(
+        ta,
         g_game->materials.heightmap.pipeline,
         g_game->materials.heightmap.descriptor_set,
-        0,
-        ta->gfx_texture);
+        0);
 }
 
 void init_debug_overlay()
@@ -634,6 +674,10 @@ void game_init()
 
     g_game = ialloc<GameState>(g_persistent);
 
+    // NOTE(jesper): mounted first so that everything loaded during init is read
+    // straight from the pack when one has been built
+    open_asset_pack(resolve_file_path(GamePath_data, "assets.pak", g_frame));
+
     init_sound();
     init_vulkan();
     init_entity_system();
@@ -683,8 +727,8 @@ void game_init()
     set_active_camera(CAMERA_PLAYER);
 
     { // update descriptor sets
-        // TODO(jesper): figure out a way for this to be done automatically by
-        // the asset loading system
+        // NOTE(jesper): bound through the catalog so that the materials are
+        // rebound when a reload replaces one of the textures
 
         TextureAsset *greybox = find_texture("greybox.bmp");
         TextureAsset *font   = find_texture("font-regular");
@@ -707,59 +751,59 @@ void game_init()
         ASSERT(terrain_map != nullptr);
         ASSERT(dummy_nrm != nullptr);
 
-        gfx_set_texture(
+        catalog_bind_texture(
+            grass,
             g_game->materials.terrain.pipeline,
             g_game->materials.terrain.descriptor_set,
-            0,
-            grass->gfx_texture);
+            0);
 
-        gfx_set_texture(
+        catalog_bind_texture(
+            grass_nrm,
             g_game->materials.terrain.pipeline,
             g_game->materials.terrain.descriptor_set,
-            1,
-            grass_nrm->gfx_texture);
+            1);
 
-        gfx_set_texture(
+        catalog_bind_texture(
+            stone,
             g_game->materials.terrain.pipeline,
             g_game->materials.terrain.descriptor_set,
-            2,
-            stone->gfx_texture);
+            2);
 
-        gfx_set_texture(
+        catalog_bind_texture(
+            stone_nrm,
             g_game->materials.terrain.pipeline,
             g_game->materials.terrain.descriptor_set,
-            3,
-            stone_nrm->gfx_texture);
+            3);
 
-        gfx_set_texture(
+        catalog_bind_texture(
+            terrain_map,
             g_game->materials.terrain.pipeline,
             g_game->materials.terrain.descriptor_set,
-            4,
-            terrain_map->gfx_texture);
+            4);
 
-        gfx_set_texture(
+        catalog_bind_texture(
+            font,
             g_game->materials.font.pipeline,
             g_game->materials.font.descriptor_set,
-            0,
-            font->gfx_texture);
+            0);
 
-        gfx_set_texture(
+        catalog_bind_texture(
+            greybox,
             g_game->materials.phong.pipeline,
             g_game->materials.phong.descriptor_set,
-            0,
-            greybox->gfx_texture);
+            0);
 
-        gfx_set_texture(
+        catalog_bind_texture(
+            dummy_nrm,
             g_game->materials.phong.pipeline,
             g_game->materials.phong.descriptor_set,
-            1,
-            dummy_nrm->gfx_texture);
+            1);
 
-        gfx_set_texture(
+        catalog_bind_texture(
+            player,
             g_game->materials.player.pipeline,
             g_game->materials.player.descriptor_set,
-            0,
-            player->gfx_texture);
+            0);
     }
 
     init_terrain();
@@ -774,12 +818,12 @@ void game_init()
 
     init_profiler_gui();
 
-    SoundData sound = load_sound_wav(
+    SoundData sound = load_cooked_sound(
         resolve_file_path(GamePath_data, "audio/wind1.wav", g_frame),
         g_heap);
     play_looping_sound(sound);
 
-    g_swing = load_sound_wav(
+    g_swing = load_cooked_sound(
         resolve_file_path(GamePath_data, "audio/swing.wav", g_frame),
         g_heap);
 }
@@ -799,7 +843,13 @@ void game_quit()
         gfx_destroy_texture(it.gfx_texture);
     }
 
+    // NOTE(jesper): replaced by a reload batch that was still in flight
+    for (GfxTexture texture : g_catalog.retired_textures) {
+        gfx_destroy_texture(texture);
+    }
+
     destroy_vulkan();
+    close_asset_pack();
     platform_quit();
 }
 
@@ -810,6 +860,7 @@ void* game_pre_reload()
     // TODO(jesper): I feel like this could be quite nicely preprocessed and
     // generated. look into
     state->texture_catalog = g_catalog;
+    state->asset_pack      = g_asset_pack;
     state->settings        = g_settings;
     state->vulkan_device   = g_vulkan;
     state->game            = g_game;
@@ -840,6 +891,7 @@ void game_reload(void *game_state)
     g_game            = state->game;
     g_settings        = state->settings;
     g_catalog         = state->texture_catalog;
+    g_asset_pack      = state->asset_pack;
     g_vulkan          = state->vulkan_device;
 
     load_vulkan(g_vulkan->instance);
@@ -1077,36 +1129,36 @@ void process_debug_overlay(DebugOverlay *overlay, f32 dt)
 
     Vector2 pos = screen_from_camera( Vector2{ -1.0f, -1.0f });
 
-    isize buffer_size = 1024*1024;
+    i32 buffer_size = 4096;
     char *buffer = (char*)alloc(g_stack, buffer_size);
     buffer[0] = '\0';
 
     GuiFrame frame = gui_frame_begin(bg);
 
     f32 dt_ms = dt * 1000.0f;
-    snprintf(buffer, buffer_size, "cpu time: %f ms, %f fps",
-             dt_ms, 1000.0f / dt_ms);
+    format(buffer, buffer_size, "cpu time: {.3} ms, {.1} fps",
+           dt_ms, 1000.0f / dt_ms);
     gui_textbox(&frame, buffer, fg, &pos);
 
-    snprintf(buffer, buffer_size, "gpu time: %f ms, %f fps",
-             g_vulkan->gpu_time, 1000.0f / g_vulkan->gpu_time);
+    format(buffer, buffer_size, "gpu time: {.3} ms, {.1} fps",
+           g_vulkan->gpu_time, 1000.0f / g_vulkan->gpu_time);
     gui_textbox(&frame, buffer, fg, &pos);
     
     EntityID player_id = find_entity_id("player.ent");
     Entity player = g_entities[player_id];
     
-    snprintf(buffer, buffer_size, "player: %f, %f, %f",
-             player.position.x, player.position.y, player.position.z);
+    format(buffer, buffer_size, "player: {.3}, {.3}, {.3}",
+           player.position.x, player.position.y, player.position.z);
     gui_textbox(&frame, buffer, fg, hl, &pos);
     
     Camera camera = g_game->cameras[CAMERA_DEBUG];
-    snprintf(buffer, buffer_size, "debug camera: %f, %f, %f",
-             camera.position.x, camera.position.y, camera.position.z);
+    format(buffer, buffer_size, "debug camera: {.3}, {.3}, {.3}",
+           camera.position.x, camera.position.y, camera.position.z);
     gui_textbox(&frame, buffer, fg, hl, &pos);
     
     camera = g_game->cameras[CAMERA_PLAYER];
-    snprintf(buffer, buffer_size, "player camera: %f, %f, %f",
-             camera.position.x, camera.position.y, camera.position.z);
+    format(buffer, buffer_size, "player camera: {.3}, {.3}, {.3}",
+           camera.position.x, camera.position.y, camera.position.z);
     gui_textbox(&frame, buffer, fg, hl, &pos);
     
     
@@ -1123,49 +1175,182 @@ void process_debug_overlay(DebugOverlay *overlay, f32 dt)
         f32 base_x = pos.x;
         f32 base_y = pos.y + 20.0f;
 
-        Vector2 c0, c1, c2;
-        c0.x = c1.x = c2.x = pos.x + margin;
-        c0.y = c1.y = c2.y = pos.y;
+        Vector2 c0, c1;
+        c0.x = c1.x = pos.x + margin;
+        c0.y = c1.y = pos.y;
 
         pos.x = c0.x;
         pos.y = base_y;
 
         Array<ProfileTimer> &timers = g_profile_timers;
         for (i32 i = 0; i < timers.count; i++) {
-            snprintf(buffer, buffer_size, "%s: ", timers[i].name);
+            ProfileSite *site = profiler_site(timers[i].site_id);
+
+            if (timers[i].gpu) {
+                format(buffer, buffer_size, "{} (gpu): ", site->name);
+            } else {
+                format(buffer, buffer_size, "{}: ", site->name);
+            }
             GuiTextbox tb = gui_textbox(&frame, buffer, fg, &pos);
 
             if (is_mouse_over(tb)) {
-                snprintf(buffer, buffer_size, "%s:%d", timers[i].file, timers[i].line);
+                format(buffer, buffer_size, "{}:{}", site->file, site->line);
                 gui_tooltip(buffer, fg, bg_tooltip);
             }
 
             c1.x = max(c1.x, tb.size.x);
         }
         c1.x  = max(c0.x + 250.0f, c1.x) + margin;
+        gui_textbox(&frame, "name", fg, &c0);
+
+        struct {
+            const char *name;
+            u64 ProfileTimer::*value;
+        } columns[] = {
+            { "frame (ms)", &ProfileTimer::duration },
+            { "mean (ms)",  &ProfileTimer::mean },
+            { "p50 (ms)",   &ProfileTimer::p50 },
+            { "p95 (ms)",   &ProfileTimer::p95 },
+            { "p99 (ms)",   &ProfileTimer::p99 },
+            { "max (ms)",   &ProfileTimer::max },
+        };
+
+        Vector2 cn = c1;
+        for (i32 c = 0; c < ARRAY_SIZE(columns); c++) {
+            pos.x = cn.x;
+            pos.y = base_y;
+
+            f32 width = 0.0f;
+            for (i32 i = 0; i < timers.count; i++) {
+                u64 ticks = timers[i].*columns[c].value;
+                format(buffer, buffer_size, "{.3}", cpu_ticks_to_ms(ticks));
+                GuiTextbox tb = gui_textbox(&frame, buffer, fg, &pos);
+
+                width = max(width, tb.size.x);
+            }
 
-        pos.x = c1.x;
+            Vector2 header = cn;
+            GuiTextbox tb = gui_textbox(&frame, columns[c].name, fg, &header);
+            width = max(width, tb.size.x);
+
+            cn.x += max(width, 80.0f) + margin;
+        }
+
+        pos.x = cn.x;
         pos.y = base_y;
 
+        f32 calls_width = 0.0f;
         for (i32 i = 0; i < timers.count; i++) {
-            snprintf(buffer, buffer_size, "%" PRIu64, timers[i].duration);
+            format(buffer, buffer_size, "{}", timers[i].calls);
             GuiTextbox tb = gui_textbox(&frame, buffer, fg, &pos);
+            calls_width = max(calls_width, tb.size.x);
+        }
 
-            c2.x = max(c2.x, tb.size.x);
+        {
+            Vector2 header = cn;
+            GuiTextbox tb = gui_textbox(&frame, "calls (#)", fg, &header);
+            cn.x += max(max(calls_width, tb.size.x), 80.0f) + margin;
         }
-        c2.x = max(c1.x + 250.0f, c2.x) + margin;
 
-        pos.x = c2.x;
-        pos.y = base_y;
+        if (g_profiler_counters) {
+            // NOTE(jesper): IPC over the whole frame, misses per call
+            struct {
+                const char *name;
+                i32 counter;
+            } counter_columns[] = {
+                { "IPC",       ProfileCounter_instructions },
+                { "L1d/call",  ProfileCounter_l1d_misses },
+                { "LLC/call",  ProfileCounter_llc_misses },
+                { "br/call",   ProfileCounter_branch_misses },
+            };
 
-        for (i32 i = 0; i < timers.count; i++) {
-            snprintf(buffer, buffer_size, "%" PRIu64, timers[i].calls);
-            gui_textbox(&frame, buffer, fg, &pos);
+            for (i32 c = 0; c < ARRAY_SIZE(counter_columns); c++) {
+                pos.x = cn.x;
+                pos.y = base_y;
+
+                f32 width = 0.0f;
+                for (i32 i = 0; i < timers.count; i++) {
+                    ProfileTimer &timer = timers[i];
+                    u64 *totals = timer.counter_totals;
+
+                    if (!timer.counters) {
+                        format(buffer, buffer_size, "-");
+                    } else if (counter_columns[c].counter == ProfileCounter_instructions) {
+                        u64 cycles = max(totals[ProfileCounter_cycles], (u64)1);
+                        format(buffer, buffer_size, "{.2}",
+                               (f64)totals[ProfileCounter_instructions] / (f64)cycles);
+                    } else {
+                        u64 calls = max(timer.calls, (u64)1);
+                        format(buffer, buffer_size, "{.1}",
+                               (f64)totals[counter_columns[c].counter] / (f64)calls);
+                    }
+
+                    GuiTextbox tb = gui_textbox(&frame, buffer, fg, &pos);
+                    width = max(width, tb.size.x);
+                }
+
+                Vector2 header = cn;
+                GuiTextbox tb = gui_textbox(&frame, counter_columns[c].name, fg, &header);
+                width = max(width, tb.size.x);
+
+                cn.x += max(width, 80.0f) + margin;
+            }
         }
 
-        gui_textbox(&frame, "name",          fg, &c0);
-        gui_textbox(&frame, "duration (cy)", fg, &c1);
-        gui_textbox(&frame, "calls (#)",     fg, &c2);
+        pos.x = base_x + margin;
+        textbox = gui_textbox(&frame, "export trace", fg, hl, &pos);
+        if (is_pressed(textbox)) {
+            FilePath path = resolve_file_path(GamePath_preferences, "trace.json", g_stack);
+            profiler_export_trace(path);
+        }
+
+        pos.x = base_x;
+    }
+
+    textbox = gui_textbox(&frame, "Sampler", fg, hl, &pos);
+    if (is_pressed(textbox)) {
+        g_debug_overlay.show_sampler = !g_debug_overlay.show_sampler;
+    }
+
+    if (g_debug_overlay.show_sampler) {
+        f32 base_x = pos.x;
+        pos.x += margin;
+
+        textbox = gui_textbox(
+            &frame,
+            g_profiler_sampling ? "stop sampling" : "start sampling",
+            fg, hl, &pos);
+
+        if (is_pressed(textbox)) {
+            if (g_profiler_sampling) {
+                profiler_stop_sampling();
+            } else {
+                profiler_start_sampling();
+            }
+        }
+
+        format(buffer, buffer_size, "samples: {}, dropped: {}",
+               g_profile_samples_count, platform_sampler_dropped());
+        gui_textbox(&frame, buffer, fg, &pos);
+
+        i32 count = min(g_profile_hot_functions.count, 20);
+        f32 total = (f32)max(g_profile_samples_count, 1);
+
+        for (i32 i = 0; i < count; i++) {
+            ProfileHotFunction &f = g_profile_hot_functions[i];
+
+            format(buffer, buffer_size, "{6.2}% {6.2}%  {}",
+                   100.0f * f.self / total,
+                   100.0f * f.inclusive / total,
+                   f.symbol.name);
+            GuiTextbox tb = gui_textbox(&frame, buffer, fg, &pos);
+
+            if (is_mouse_over(tb)) {
+                format(buffer, buffer_size, "{}+0x{x}",
+                       f.symbol.module, f.symbol.offset);
+                gui_tooltip(buffer, fg, bg_tooltip);
+            }
+        }
 
         pos.x = base_x;
     }
@@ -1179,37 +1364,147 @@ void process_debug_overlay(DebugOverlay *overlay, f32 dt)
         f32 base_x = pos.x;
         pos.x += margin;
 
-        snprintf(buffer, buffer_size,
-                 "g_stack: { sp: %p, size: %zd, remaining: %zd }",
-                 g_stack->sp, g_stack->size, g_stack->remaining);
+        format(buffer, buffer_size,
+               "g_stack: {{ sp: {}, size: {}, remaining: {} }}",
+               g_stack->sp, g_stack->size, g_stack->remaining);
         gui_textbox(&frame, buffer, fg, &pos);
 
-        snprintf(buffer, buffer_size,
-                 "g_frame: { sp: %p, size: %zd, remaining: %zd }",
-                 g_frame->sp, g_frame->size, g_frame->remaining);
+        format(buffer, buffer_size,
+               "g_frame: {{ sp: {}, size: {}, remaining: {} }}",
+               g_frame->sp, g_frame->size, g_frame->remaining);
         gui_textbox(&frame, buffer, fg, &pos);
 
-        snprintf(buffer, buffer_size,
-                 "g_debug_frame: { sp: %p, size: %zd, remaining: %zd }",
-                 g_debug_frame->sp, g_debug_frame->size, g_debug_frame->remaining);
+        format(buffer, buffer_size,
+               "g_debug_frame: {{ sp: {}, size: {}, remaining: {} }}",
+               g_debug_frame->sp, g_debug_frame->size, g_debug_frame->remaining);
         gui_textbox(&frame, buffer, fg, &pos);
 
-        snprintf(buffer, buffer_size,
-                 "g_persistent: { sp: %p, size: %zd, remaining: %zd }",
-                 g_persistent->sp, g_persistent->size, g_persistent->remaining);
+        format(buffer, buffer_size,
+               "g_persistent: {{ sp: {}, size: {}, remaining: {} }}",
+               g_persistent->sp, g_persistent->size, g_persistent->remaining);
         gui_textbox(&frame, buffer, fg, &pos);
 
-        snprintf(buffer, buffer_size,
-                 "g_heap: { size: %zd, remaining: %zd }",
-                 g_heap->size, g_heap->remaining);
+        format(buffer, buffer_size,
+               "g_heap: {{ size: {}, remaining: {} }}",
+               g_heap->size, g_heap->remaining);
         gui_textbox(&frame, buffer, fg, &pos);
 
         pos.x = base_x;
     }
 
+    textbox = gui_textbox(&frame, "Allocation budget", fg, hl, &pos);
+    if (is_pressed(textbox)) {
+        g_debug_overlay.show_allocs = !g_debug_overlay.show_allocs;
+    }
+
+    if (g_debug_overlay.show_allocs) {
+        PROFILE_SCOPE(profiler_alloc_gui);
+
+        // NOTE(jesper): scopes that allocate from an allocator that isn't
+        // allowed in the frame loop after warm-up are drawn in warn
+        Vector4 warn = linear_from_sRGB(unpack_rgba(0xff4040ff));
+
+        f32 base_x = pos.x;
+        f32 base_y = pos.y + 20.0f;
+
+        Array<ProfileTimer> &timers = g_profile_timers;
+
+        // NOTE(jesper): timers that allocated anything last frame, -1 is the
+        // allocations made outside of any scope
+        Array<i32> rows = create_array<i32>(g_stack);
+
+        bool unscoped = false;
+        for (i32 j = 0; j < g_profile_allocators_count; j++) {
+            unscoped = unscoped || g_profile_unscoped_allocs[j].count > 0;
+        }
+
+        if (unscoped) {
+            array_add(&rows, -1);
+        }
+
+        for (i32 i = 0; i < timers.count; i++) {
+            for (i32 j = 0; j < g_profile_allocators_count; j++) {
+                if (timers[i].allocs[j].count > 0) {
+                    array_add(&rows, i);
+                    break;
+                }
+            }
+        }
+
+        Vector2 cn;
+        cn.x = pos.x + margin;
+        cn.y = pos.y;
+
+        pos.x = cn.x;
+        pos.y = base_y;
+
+        f32 width = 250.0f;
+        for (i32 r = 0; r < rows.count; r++) {
+            Vector4 color = fg;
+            if (rows[r] == -1) {
+                format(buffer, buffer_size, "(unscoped)");
+            } else {
+                ProfileTimer &timer = timers[rows[r]];
+                format(buffer, buffer_size, "{}", profiler_site(timer.site_id)->name);
+                color = timer.steady_state_allocs ? warn : fg;
+            }
+
+            GuiTextbox tb = gui_textbox(&frame, buffer, color, &pos);
+            width = max(width, tb.size.x);
+        }
+
+        gui_textbox(&frame, "scope", fg, &cn);
+        cn.x += width + margin;
+
+        for (i32 j = 0; j < g_profile_allocators_count; j++) {
+            pos.x = cn.x;
+            pos.y = base_y;
+
+            width = 0.0f;
+            for (i32 r = 0; r < rows.count; r++) {
+                ProfileAllocStats stats = rows[r] == -1
+                    ? g_profile_unscoped_allocs[j]
+                    : timers[rows[r]].allocs[j];
+
+                Vector4 color = fg;
+                if (stats.count == 0) {
+                    format(buffer, buffer_size, "-");
+                } else {
+                    format(buffer, buffer_size, "{} B / {}",
+                           stats.bytes, stats.count);
+
+                    bool steady = rows[r] != -1 && timers[rows[r]].steady_state_allocs;
+                    color = steady && !g_profile_allocators[j].allowed_in_frame ? warn : fg;
+                }
+
+                GuiTextbox tb = gui_textbox(&frame, buffer, color, &pos);
+                width = max(width, tb.size.x);
+            }
+
+            Vector2 header = cn;
+            GuiTextbox tb = gui_textbox(&frame, g_profile_allocators[j].name, fg, &header);
+            width = max(width, tb.size.x);
+
+            cn.x += max(width, 80.0f) + margin;
+        }
+
+        pos.x = cn.x;
+        pos.y = base_y;
+
+        for (i32 r = 0; r < rows.count; r++) {
+            u32 frames = rows[r] == -1 ? 0 : timers[rows[r]].steady_state_frames;
+            format(buffer, buffer_size, "{}", frames);
+            gui_textbox(&frame, buffer, fg, &pos);
+        }
+
+        gui_textbox(&frame, "steady state (frames)", fg, &cn);
+
+        pos.x = base_x;
+    }
+
 
     for (auto &item : overlay->items) {
-        snprintf(buffer, buffer_size, "%s", item.title.bytes);
+        format(buffer, buffer_size, "{}", item.title);
         GuiTextbox tb = gui_textbox(&frame, buffer, fg, hl, &pos);
 
         if (is_pressed(tb)) {
@@ -1331,6 +1626,8 @@ void game_update(f32 dt)
             camera_p += player.position;
         }
 
+        camera->world_position = camera_p;
+
         Matrix4 rm = matrix4(camera->rotation);
         Matrix4 tm = translate(matrix4_identity(), -camera_p);
         Matrix4 view = rm * tm;
@@ -1402,6 +1699,36 @@ void render_terrain(VkCommandBuffer command)
     }
 }
 
+// NOTE(jesper): picks the coarsest LOD whose error projects to less than
+// MESH_LOD_PIXEL_ERROR pixels, using the distance to the nearest point of the
+// entity's bounding sphere
+i32 select_mesh_lod(Mesh *mesh, Entity *e, Camera *camera)
+{
+    if (mesh->lod_count <= 1) {
+        return 0;
+    }
+
+    f32 scale = MAX(lry::abs(e->scale.x), lry::abs(e->scale.y));
+    scale     = MAX(scale, lry::abs(e->scale.z));
+
+    f32 distance = length(e->position - camera->world_position) - mesh->radius * scale;
+    if (distance <= 0.0f) {
+        return 0;
+    }
+
+    // NOTE(jesper): projection[1][1] is the negated 1 / tan(vfov / 2)
+    f32 height = (f32)g_settings.video.resolution.height;
+    f32 pixels_per_unit = lry::abs(camera->projection[1][1]) * 0.5f * height / distance;
+
+    for (i32 i = mesh->lod_count - 1; i > 0; i--) {
+        if (mesh->lods[i].error * scale * pixels_per_unit < MESH_LOD_PIXEL_ERROR) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
 void game_render()
 {
     PROFILE_FUNCTION();
@@ -1410,11 +1737,16 @@ void game_render()
 
     GfxFrame frame = gfx_begin_frame();
 
-    render_terrain(frame.cmd);
+    {
+        GPU_PROFILE_SCOPE(frame.cmd, gpu_terrain);
+        render_terrain(frame.cmd);
+    }
 
     auto descriptors = create_array<GfxDescriptorSet>(g_frame);
 
     if (g_lines_vbo_mapped != nullptr) {
+        GPU_PROFILE_SCOPE(frame.cmd, gpu_lines);
+
         vkUnmapMemory(g_vulkan->handle, g_lines_vbo.memory);
         g_lines_vbo_mapped = nullptr;
 
@@ -1438,6 +1770,9 @@ void game_render()
         vkCmdDraw(frame.cmd, g_lines_vertex_count, 1, 0, 0);
     }
 
+    PROFILE_START_COUNTERS(render_entities);
+    GPU_PROFILE_START(frame.cmd, gpu_entities);
+    Camera *camera = &g_game->cameras[g_game->active_camera];
     for (i32 i = 0; i < g_entities.count; i++) {
         Entity &e = g_entities[i];
 
@@ -1465,6 +1800,10 @@ void game_render()
                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                 descriptors);
 
+#if LEARY_PACKED_VERTICES
+            VkBuffer vertex_buffers[] = { mesh->vbo.packed.handle };
+            VkDeviceSize offsets[] = { 0 };
+#else
             VkBuffer vertex_buffers[] = {
                 mesh->vbo.points.handle,
                 mesh->vbo.normals.handle,
@@ -1474,6 +1813,7 @@ void game_render()
             };
 
             VkDeviceSize offsets[] = { 0, 0, 0, 0, 0 };
+#endif
 
             static_assert(ARRAY_SIZE(vertex_buffers) == ARRAY_SIZE(offsets));
 
@@ -1490,11 +1830,29 @@ void game_render()
             Matrix4 srt = scale(t, e.scale);
             srt = srt * r;
 
+#if LEARY_PACKED_VERTICES
+            struct {
+                Matrix4 transform;
+                Vector4 bounds_min;
+                Vector4 bounds_extent;
+            } model;
+
+            model.transform     = srt;
+            model.bounds_min    = vector4(mesh->bounds_min, 0.0f);
+            model.bounds_extent = vector4(mesh->bounds_extent, 0.0f);
+
+            vkCmdPushConstants(
+                frame.cmd,
+                pipeline.layout,
+                VK_SHADER_STAGE_VERTEX_BIT,
+                0, sizeof(model), &model);
+#else
             vkCmdPushConstants(
                 frame.cmd,
                 pipeline.layout,
                 VK_SHADER_STAGE_VERTEX_BIT,
                 0, sizeof(srt), &srt);
+#endif
 
             if (mesh->ibo.handle != VK_NULL_HANDLE) {
                 vkCmdBindIndexBuffer(
@@ -1503,14 +1861,18 @@ void game_render()
                     0,
                     VK_INDEX_TYPE_UINT32);
 
-                vkCmdDrawIndexed(frame.cmd, mesh->element_count, 1, 0, 0, 0);
+                MeshLod lod = mesh->lods[select_mesh_lod(mesh, &e, camera)];
+                vkCmdDrawIndexed(frame.cmd, lod.index_count, 1, lod.index_offset, 0, 0);
 
             } else {
                 vkCmdDraw(frame.cmd, mesh->element_count, 1, 0, 0);
             }
         }
     }
+    GPU_PROFILE_END(frame.cmd, gpu_entities);
+    PROFILE_END_COUNTERS(render_entities);
 
+    GPU_PROFILE_START(frame.cmd, gpu_render_queues);
     for (auto &object : g_render_queue) {
         reset_array_count(&descriptors);
 
@@ -1636,10 +1998,11 @@ void game_render()
 
         vkCmdDrawIndexed(frame.cmd, object.index_count, 1, 0, 0, 0);
     }
-
+    GPU_PROFILE_END(frame.cmd, gpu_render_queues);
 
     // collidables
     if (g_debug_collision.render_collidables) {
+        GPU_PROFILE_SCOPE(frame.cmd, gpu_debug_collision);
         reset_array_count(&descriptors);
 
         VulkanPipeline pipeline = g_vulkan->pipelines[Pipeline_wireframe_lines];
@@ -1710,6 +2073,7 @@ void game_render()
     }
 
     // debug overlay items
+    GPU_PROFILE_START(frame.cmd, gpu_overlay);
     for (auto &item : g_game->overlay.render_queue) {
         VulkanPipeline &pipeline = g_vulkan->pipelines[item.pipeline];
 
@@ -1732,8 +2096,12 @@ void game_render()
         vkCmdDraw(frame.cmd, item.vertex_count, 1, 0, 0);
     }
     g_game->overlay.render_queue.count = 0;
+    GPU_PROFILE_END(frame.cmd, gpu_overlay);
 
-    gui_render(frame.cmd);
+    {
+        GPU_PROFILE_SCOPE(frame.cmd, gpu_gui);
+        gui_render(frame.cmd);
+    }
 
     gfx_end_frame();
 }
@@ -42,6 +42,8 @@ struct DebugOverlayItem {
 struct DebugOverlay {
     bool show_allocators = false;
     bool show_profiler   = false;
+    bool show_sampler    = false;
+    bool show_allocs     = false;
 
     Array<DebugOverlayItem> items;
     Array<DebugRenderItem>  render_queue;
@@ -95,6 +97,10 @@ struct Camera {
     Vector3 position    = { 0.0f, 0.0f, 10.0f };
     Quaternion rotation = quat_from_euler({ 0.0f, 0.0f, 0.0f });
 
+    // NOTE(jesper): position including the player's for the player camera,
+    // updated in game_update
+    Vector3 world_position = {};
+
     VulkanUniformBuffer ubo;
 };
 
@@ -146,9 +152,24 @@ INTROSPECT struct VideoSettings
     i16 vsync      = 1;
 };
 
+INTROSPECT struct ProfilerSettings
+{
+    // NOTE(jesper): number of frames the rolling timer statistics are
+    // computed over
+    i32 stats_window = 120;
+
+    i32 sampler_frequency = 1000;
+
+    // NOTE(jesper): frames that take longer than this dump a trace of the
+    // surrounding hitch_frames frames on either side, 0 to disable
+    i32 frame_budget_us = 33333;
+    i32 hitch_frames    = 8;
+};
+
 INTROSPECT struct Settings
 {
-    VideoSettings video;
+    VideoSettings    video;
+    ProfilerSettings profiler;
 };
 
 Entity entities_add(EntityData data);
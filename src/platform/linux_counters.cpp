@@ -0,0 +1,156 @@
+/**
+ * file:    linux_counters.cpp
+ * created: 2018-09-16
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): one perf event group for the thread that called init_profiler,
+// with instructions as the group leader
+struct LinuxCounters {
+    i32                   fds[ProfileCounter_count];
+    perf_event_mmap_page *pages[ProfileCounter_count];
+    bool                  rdpmc;
+};
+
+LinuxCounters g_counters;
+
+void counters_close()
+{
+    usize page_size = (usize)sysconf(_SC_PAGESIZE);
+
+    for (i32 i = 0; i < ProfileCounter_count; i++) {
+        if (g_counters.pages[i] != nullptr) {
+            munmap(g_counters.pages[i], page_size);
+        }
+
+        if (g_counters.fds[i] > 0) {
+            close(g_counters.fds[i]);
+        }
+    }
+
+    g_counters = {};
+}
+
+bool platform_counters_init()
+{
+    struct {
+        u32 type;
+        u64 config;
+    } events[] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                              (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    };
+    static_assert(ARRAY_SIZE(events) == ProfileCounter_count,
+                  "missing perf event for ProfileCounter");
+
+    usize page_size = (usize)sysconf(_SC_PAGESIZE);
+
+    g_counters = {};
+    g_counters.rdpmc = true;
+
+    i32 leader = -1;
+    for (i32 i = 0; i < ProfileCounter_count; i++) {
+        perf_event_attr attr = {};
+        attr.size           = sizeof attr;
+        attr.type           = events[i].type;
+        attr.config         = events[i].config;
+        attr.disabled       = leader == -1 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_GROUP;
+
+        i32 fd = (i32)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+        if (fd < 0) {
+            LOG_WARNING("hardware counters unavailable (%s)", strerror(errno));
+            counters_close();
+            return false;
+        }
+
+        g_counters.fds[i] = fd;
+        if (leader == -1) {
+            leader = fd;
+        }
+
+        // NOTE(jesper): the mmap'd page is only needed for rdpmc, if it fails
+        // we fall back to reading the group
+        void *page = mmap(nullptr, page_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (page == MAP_FAILED) {
+            g_counters.rdpmc = false;
+        } else {
+            g_counters.pages[i] = (perf_event_mmap_page*)page;
+            g_counters.rdpmc = g_counters.rdpmc && g_counters.pages[i]->cap_user_rdpmc;
+        }
+    }
+
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    LOG_INFO("hardware counters enabled, %s",
+             g_counters.rdpmc ? "using rdpmc" : "using group reads");
+    return true;
+}
+
+bool counters_rdpmc(perf_event_mmap_page *pc, u64 *value)
+{
+    u32 seq;
+    u64 count;
+
+    do {
+        seq = pc->lock;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        // NOTE(jesper): index is 0 when the event isn't currently scheduled on
+        // this cpu, e.g. when the PMU is being multiplexed
+        u32 index = pc->index;
+        if (!pc->cap_user_rdpmc || index == 0) {
+            return false;
+        }
+
+        i64 pmc = (i64)__rdpmc((i32)index - 1);
+        i32 width = pc->pmc_width;
+        pmc <<= 64 - width;
+        pmc >>= 64 - width;
+
+        count = (u64)(pc->offset + pmc);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (pc->lock != seq);
+
+    *value = count;
+    return true;
+}
+
+bool platform_counters_read(u64 *values)
+{
+    if (g_counters.rdpmc) {
+        i32 i = 0;
+        while (i < ProfileCounter_count &&
+               counters_rdpmc(g_counters.pages[i], &values[i]))
+        {
+            i++;
+        }
+
+        if (i == ProfileCounter_count) {
+            return true;
+        }
+    }
+
+    u64 buffer[1 + ProfileCounter_count];
+    if (read(g_counters.fds[0], buffer, sizeof buffer) != sizeof buffer) {
+        return false;
+    }
+    ASSERT(buffer[0] == ProfileCounter_count);
+
+    for (i32 i = 0; i < ProfileCounter_count; i++) {
+        values[i] = buffer[1 + i];
+    }
+
+    return true;
+}
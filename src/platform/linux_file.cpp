@@ -63,38 +63,130 @@ void init_paths(Allocator *a)
     g_paths.models   = create_folder_path(a, g_paths.data, "models/");
 }
 
-Array<FilePath> list_files(FolderPath folder, Allocator *allocator)
+// NOTE(jesper): the record getdents64 returns, glibc doesn't expose it
+struct LinuxDirent64 {
+    u64  d_ino;
+    i64  d_off;
+    u16  d_reclen;
+    u8   d_type;
+    char d_name[1];
+};
+
+#define GETDENTS_BUFFER_SIZE (4096)
+
+// NOTE(jesper): walks the tree below the folder open as dirfd depth first,
+// calling visit(path, length, is_folder) for every file and folder with its
+// path relative to the root written into path. Entries are read in batches
+// with getdents64, and the ones whose d_type the file system doesn't fill in
+// are resolved with fstatat. Symlinks to files are followed, symlinks to
+// folders aren't, to avoid cycles.
+template<typename F>
+void walk_directory(int dirfd, char *path, i32 length, F &visit)
 {
-    // TODO: this should maybe return an array of File which might include full
-    // path, filename, and extension?
-    auto files = create_array<FilePath>(allocator);
-    bool eslash = (folder[folder.absolute.size-1] == '/');
-
-    DIR *d = opendir(folder.absolute.bytes);
-    if (d) {
-        struct dirent *dir;
-        while ((dir = readdir(d)) != NULL) {
-            // TODO(jesper): dir with sub-folders
-            if (dir->d_type == DT_REG) {
-                FilePath p;
-
-                if (!eslash) {
-                    p = create_file_path(allocator, folder, "/", dir->d_name);
+    alignas(8) char buffer[GETDENTS_BUFFER_SIZE];
+
+    while (true) {
+        long bytes = syscall(SYS_getdents64, dirfd, buffer, sizeof buffer);
+        if (bytes < 0) {
+            LOG_ERROR("getdents64 failed: %s", strerror(errno));
+            return;
+        }
+
+        if (bytes == 0) {
+            return;
+        }
+
+        for (long offset = 0; offset < bytes;) {
+            LinuxDirent64 *entry = (LinuxDirent64*)(buffer + offset);
+            offset += entry->d_reclen;
+
+            char *name = entry->d_name;
+            if (name[0] == '.' &&
+                (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            {
+                continue;
+            }
+
+            u8 type = entry->d_type;
+            if (type == DT_UNKNOWN || type == DT_LNK) {
+                struct stat st;
+                if (fstatat(dirfd, name, &st, 0) != 0) {
+                    continue;
+                }
+
+                if (S_ISDIR(st.st_mode)) {
+                    type = entry->d_type == DT_LNK ? DT_UNKNOWN : DT_DIR;
+                } else if (S_ISREG(st.st_mode)) {
+                    type = DT_REG;
                 } else {
-                    p = create_file_path(allocator, folder, dir->d_name);
+                    type = DT_UNKNOWN;
+                }
+            }
+
+            if (type != DT_REG && type != DT_DIR) {
+                continue;
+            }
+
+            i32 name_length = (i32)strlen(name);
+            if (length + name_length + 2 > PATH_MAX) {
+                LOG_ERROR("path too long: %s%s", path, name);
+                continue;
+            }
+
+            memcpy(path + length, name, name_length + 1);
+            visit(path, length + name_length, type == DT_DIR);
+
+            if (type == DT_DIR) {
+                int fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                if (fd < 0) {
+                    LOG_ERROR("couldn't open folder %s: %s", path, strerror(errno));
+                    continue;
                 }
 
-                LOG("adding file: %s", p.absolute.bytes);
-                array_add(&files, p);
-            } else {
-                LOG("unimplemented d_type: %d", dir->d_type);
+                path[length + name_length]     = '/';
+                path[length + name_length + 1] = '\0';
+                walk_directory(fd, path, length + name_length + 1, visit);
+                close(fd);
             }
         }
+    }
+}
 
-        closedir(d);
+Array<FilePath> list_files(FolderPath folder, Allocator *allocator)
+{
+    int fd = open(folder.absolute.bytes, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("couldn't open folder %s: %s", folder.absolute.bytes, strerror(errno));
+        return create_array<FilePath>(allocator);
     }
 
-    return files;
+    // NOTE(jesper): the relative paths are gathered back to back and the list
+    // is built in one allocation once the count and sizes are known
+    Array<char> names  = create_array<char>(g_heap);
+    Array<i32> offsets = create_array<i32>(g_heap);
+    defer {
+        destroy_array(&names);
+        destroy_array(&offsets);
+    };
+
+    auto visit = [&](char *path, i32 length, bool is_folder)
+    {
+        if (is_folder) {
+            return;
+        }
+
+        array_add(&offsets, names.count);
+        for (i32 i = 0; i <= length; i++) {
+            array_add(&names, path[i]);
+        }
+    };
+
+    char path[PATH_MAX];
+    path[0] = '\0';
+    walk_directory(fd, path, 0, visit);
+    close(fd);
+
+    return create_file_list(folder.absolute, names.data, offsets.data, offsets.count, allocator);
 }
 
 char* resolve_relative(const char *path)
@@ -192,8 +284,31 @@ bool file_exists(FilePathView file)
 
 bool create_file(FilePathView path, bool create_folders = false)
 {
-    // TODO(jesper): create folders if needed
-    (void)create_folders;
+    if (create_folders) {
+        char folder[PATH_MAX];
+        i32 length = path.absolute.size - path.filename.size;
+        if (length <= 0 || length >= PATH_MAX) {
+            return false;
+        }
+
+        // NOTE(jesper): create each folder along the path in turn, the ones
+        // that already exist fail with EEXIST
+        memcpy(folder, path.absolute.bytes, length);
+        folder[length] = '\0';
+
+        for (i32 i = 1; i < length; i++) {
+            if (folder[i] == '/') {
+                folder[i] = '\0';
+                if (mkdir(folder, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) != 0 &&
+                    errno != EEXIST)
+                {
+                    LOG_ERROR("couldn't create folder %s: %s", folder, strerror(errno));
+                    return false;
+                }
+                folder[i] = '/';
+            }
+        }
+    }
 
     i32 access = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
     i32 fd = open(path.absolute.bytes, O_CREAT, access);
@@ -205,6 +320,17 @@ bool create_file(FilePathView path, bool create_folders = false)
     return fd >= 0;
 }
 
+bool remove_file(FilePathView path)
+{
+    return unlink(path.absolute.bytes) == 0;
+}
+
+// NOTE(jesper): replaces dst if it exists
+bool rename_file(FilePathView src, FilePathView dst)
+{
+    return rename(src.absolute.bytes, dst.absolute.bytes) == 0;
+}
+
 void* open_file(FilePathView path, FileAccess access)
 {
     i32 flags = 0;
@@ -266,6 +392,36 @@ char* read_file(FilePathView filename, usize *file_size, Allocator *a)
     ASSERT(bytes_read == st.st_size);
     *file_size = bytes_read;
 
+    close(fd);
     return buffer;
 }
 
+void* map_file(FilePathView path, usize *size)
+{
+    i32 fd = open(path.absolute.bytes, O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    defer { close(fd); };
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        return nullptr;
+    }
+
+    // NOTE(jesper): the mapping stays valid after the fd is closed
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        LOG_ERROR("failed to map file %s: %s", path.absolute.bytes, strerror(errno));
+        return nullptr;
+    }
+
+    *size = (usize)st.st_size;
+    return data;
+}
+
+void unmap_file(void *data, usize size)
+{
+    munmap(data, size);
+}
+
@@ -71,23 +71,6 @@ Allocator *g_persistent;
 Allocator *g_stack;
 Allocator *g_system_alloc;
 
-void init_mutex(Mutex *m)
-{
-    m->native = {};
-    pthread_mutex_init(&m->native, nullptr);
-}
-
-void lock_mutex(Mutex *m)
-{
-    pthread_mutex_lock(&m->native);
-}
-
-void unlock_mutex(Mutex *m)
-{
-    pthread_mutex_unlock(&m->native);
-}
-
-
 snd_pcm_t *g_alsa_pcm = nullptr;
 void *g_alsa_buffer = nullptr;
 
@@ -302,6 +285,18 @@ Vector2 get_mouse_position()
     return g_mouse.position;
 }
 
+u64 platform_clock_ticks()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+u64 platform_clock_frequency()
+{
+    return 1000000000ull;
+}
+
 void platform_quit()
 {
     XUngrabPointer(g_platform->native.display, CurrentTime);
@@ -317,6 +312,8 @@ void platform_quit()
         ARRAY_SIZE(Settings_members),
         &g_settings);
 
+    log_flush();
+
     // TODO(jesper): do we need to unload the .so ?
     exit(EXIT_SUCCESS);
 }
@@ -329,13 +326,91 @@ struct CatalogThreadData {
     catalog_callback_t *callback;
 };
 
+// NOTE(jesper): we're using IN_MOVED_FROM here because it seems when krita
+// exports its images it writes it to a temporary file and then moves it.
+// This is really quite weird, and I might contact krita about it. IN_CREATE and
+// IN_MOVED_TO are only used to pick up new sub-folders.
+#define CATALOG_WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_FROM | IN_CREATE | IN_MOVED_TO)
+
+// NOTE(jesper): inotify isn't recursive, so every sub-folder gets a watch of
+// its own. Returns false if the folder wasn't added to watches, in which case
+// the caller still owns it.
+// When a folder is created or moved in while running, files can land in it
+// before its watch exists, so the files found while walking it are passed to
+// report. A file written right after the watch is added may be reported twice.
+bool add_catalog_watches(
+    int fd,
+    RHHashMap<i32, FolderPath> *watches,
+    FolderPath folder,
+    catalog_callback_t *report = nullptr)
+{
+    int wd = inotify_add_watch(fd, folder.absolute.bytes, CATALOG_WATCH_MASK);
+    if (wd < 0) {
+        LOG_ERROR("couldn't watch folder %s: %s", folder.absolute.bytes, strerror(errno));
+        return false;
+    }
+
+    // NOTE(jesper): inotify hands back the same descriptor for a folder that's
+    // already watched, which happens when the catalog folders overlap
+    if (map_find(watches, wd) != nullptr) {
+        return false;
+    }
+
+    map_add(watches, wd, folder);
+
+    int dirfd = open(folder.absolute.bytes, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd < 0) {
+        return true;
+    }
+
+    bool eslash = folder[folder.absolute.size-2] == '/';
+
+    auto visit = [&](char *path, i32 length, bool is_folder)
+    {
+        if (!is_folder) {
+            if (report != nullptr) {
+                FilePath p = eslash
+                    ? create_file_path(g_system_alloc, { folder.absolute, StringView{ path, length + 1 } })
+                    : create_file_path(g_system_alloc, { folder.absolute, "/", StringView{ path, length + 1 } });
+                report(p);
+            }
+            return;
+        }
+
+        FolderPath sub = eslash
+            ? create_folder_path(g_heap, { folder.absolute, StringView{ path, length + 1 }, "/" })
+            : create_folder_path(g_heap, { folder.absolute, "/", StringView{ path, length + 1 }, "/" });
+
+        int sub_wd = inotify_add_watch(fd, sub.absolute.bytes, CATALOG_WATCH_MASK);
+        if (sub_wd < 0) {
+            LOG_ERROR("couldn't watch folder %s: %s", sub.absolute.bytes, strerror(errno));
+            dealloc(g_heap, sub.absolute.bytes);
+            return;
+        }
+
+        if (map_find(watches, sub_wd) != nullptr) {
+            dealloc(g_heap, sub.absolute.bytes);
+            return;
+        }
+
+        map_add(watches, sub_wd, sub);
+    };
+
+    char path[PATH_MAX];
+    path[0] = '\0';
+    walk_directory(dirfd, path, 0, visit);
+    close(dirfd);
+
+    return true;
+}
+
 void* catalog_thread_process(void *data)
 {
     // TODO(jesper): entering the realm of threads, we need thread safe
     // LOG now!!!!
     CatalogThreadData *ctd = (CatalogThreadData*)data;
 
-    char buffer[INOTIFY_BUF_SIZE];
+    alignas(struct inotify_event) char buffer[INOTIFY_BUF_SIZE];
 
     int fd = inotify_init();
     assert(fd >= 0);
@@ -346,15 +421,7 @@ void* catalog_thread_process(void *data)
     init_map(&watches, g_heap);
 
     for (i32 i = 0; i < ctd->folders.count; i++) {
-        // NOTE(jesper): we're using IN_MOVED_FROM here because it seems when krita
-        // exports its images it writes it to a temporary file and then moves it.
-        // This is really quite weird, and I might contact krita about it.
-        int wd = inotify_add_watch(
-            fd,
-            ctd->folders[i].absolute.bytes,
-            IN_CLOSE_WRITE | IN_MOVED_FROM);
-
-        map_add(&watches, wd, ctd->folders[i]);
+        add_catalog_watches(fd, &watches, ctd->folders[i]);
     }
 
     while (true) {
@@ -364,31 +431,45 @@ void* catalog_thread_process(void *data)
         int i = 0;
         while (i < length) {
             struct inotify_event *event = (struct inotify_event*)&buffer[i];
-            if (event->len) {
-                // TODO(jesper): supported created and deleted file events
-                if (!(event->mask & IN_ISDIR)) {
-
-                    FolderPath *ret = map_find(&watches, event->wd);
-                    if (ret == nullptr) {
-                        LOG(Log_error,
-                            "unable to find folder for watch descriptor: %d",
-                            event->wd);
-                        continue;
-                    }
+            i += INOTIFY_EVENT_SIZE + event->len;
 
-                    FolderPath folder = *ret;
+            if (event->len == 0) {
+                continue;
+            }
 
-                    bool eslash = folder[folder.absolute.size-1] == '/';
+            FolderPath *ret = map_find(&watches, event->wd);
+            if (ret == nullptr) {
+                LOG(Log_error,
+                    "unable to find folder for watch descriptor: %d",
+                    event->wd);
+                continue;
+            }
 
-                    FilePath p = eslash
-                        ? create_file_path(g_system_alloc, folder, event->name)
-                        : create_file_path(g_system_alloc, folder, '/', event->name);
+            FolderPath folder = *ret;
+            bool eslash = folder[folder.absolute.size-2] == '/';
 
-                    ctd->callback(p);
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    FolderPath sub = eslash
+                        ? create_folder_path(g_heap, { folder.absolute, event->name, "/" })
+                        : create_folder_path(g_heap, { folder.absolute, "/", event->name, "/" });
+                    if (!add_catalog_watches(fd, &watches, sub, ctd->callback)) {
+                        dealloc(g_heap, sub.absolute.bytes);
+                    }
                 }
+                continue;
             }
 
-            i += INOTIFY_EVENT_SIZE + event->len;
+            // TODO(jesper): supported created and deleted file events
+            if (!(event->mask & (IN_CLOSE_WRITE | IN_MOVED_FROM))) {
+                continue;
+            }
+
+            FilePath p = eslash
+                ? create_file_path(g_system_alloc, { folder.absolute, event->name })
+                : create_file_path(g_system_alloc, { folder.absolute, "/", event->name });
+
+            ctd->callback(p);
         }
     }
 
@@ -448,6 +529,7 @@ PLATFORM_INIT_FUNC(platform_init)
     g_system_alloc = &g_platform->allocators.system;
 
     init_paths(g_persistent);
+    init_log();
     init_alsa();
 
     FilePath settings_path = resolve_file_path(
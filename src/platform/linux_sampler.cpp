@@ -0,0 +1,412 @@
+/**
+ * file:    linux_sampler.cpp
+ * created: 2018-09-14
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+#define SAMPLER_MAX_THREADS   (32)
+#define SAMPLER_PERF_PAGES    (64)
+#define SAMPLER_RING_SIZE     (4096)
+
+// NOTE(jesper): written to from the SIGPROF handler on any thread, read from
+// the main thread. Writers reserve a slot by bumping write and publish it by
+// storing write+1 into the slot's sequence, so the reader never sees a slot
+// that's only partially written.
+struct SamplerSlot {
+    u32           sequence;
+    ProfileSample sample;
+};
+
+struct SamplerRing {
+    SamplerSlot slots[SAMPLER_RING_SIZE];
+    u32 write;
+    u32 read;
+    u32 dropped;
+};
+
+struct SamplerPerfBuffer {
+    i32                   fd;
+    perf_event_mmap_page *header;
+    u8                   *data;
+    u64                   size;
+};
+
+struct LinuxSampler {
+    bool active;
+
+    // NOTE(jesper): perf_event_open mode, one event and ring buffer per thread
+    SamplerPerfBuffer perf[SAMPLER_MAX_THREADS];
+    i32               perf_count;
+
+    // NOTE(jesper): SIGPROF fallback
+    bool     using_timer;
+    timer_t  timer;
+    uptr     stack_lo;
+    uptr     stack_hi;
+};
+
+LinuxSampler g_sampler;
+SamplerRing  g_sampler_ring;
+
+void sampler_ring_push(SamplerRing *ring, ProfileSample *sample)
+{
+    u32 write;
+    do {
+        write = atomic_load(&ring->write);
+        if (write - atomic_load(&ring->read) >= SAMPLER_RING_SIZE) {
+            atomic_add(&ring->dropped, 1);
+            return;
+        }
+    } while (!atomic_cas(&ring->write, write, write + 1));
+
+    SamplerSlot *slot = &ring->slots[write % SAMPLER_RING_SIZE];
+    slot->sample = *sample;
+    atomic_store(&slot->sequence, write + 1);
+}
+
+bool sampler_ring_pop(SamplerRing *ring, ProfileSample *sample)
+{
+    u32 read = ring->read;
+
+    SamplerSlot *slot = &ring->slots[read % SAMPLER_RING_SIZE];
+    if (atomic_load(&slot->sequence) != read + 1) {
+        return false;
+    }
+
+    *sample = slot->sample;
+    atomic_store(&ring->read, read + 1);
+    return true;
+}
+
+void sampler_signal_handler(i32 signal, siginfo_t *info, void *context)
+{
+    (void)signal;
+    (void)info;
+
+    ucontext_t *uc = (ucontext_t*)context;
+
+    ProfileSample sample;
+    sample.tid   = (u32)syscall(SYS_gettid);
+    sample.depth = 0;
+    sample.ips[sample.depth++] = (u64)uc->uc_mcontext.gregs[REG_RIP];
+
+    // NOTE(jesper): we can only walk the frame pointers when we know the bounds
+    // of the stack, which we only do for the thread that started the sampler.
+    // A garbage rbp is still within the stack, so the worst case is a garbage
+    // call stack rather than a fault inside a signal handler.
+    uptr sp = (uptr)uc->uc_mcontext.gregs[REG_RSP];
+    uptr fp = (uptr)uc->uc_mcontext.gregs[REG_RBP];
+
+    if (sp >= g_sampler.stack_lo && sp < g_sampler.stack_hi) {
+        while (sample.depth < PROFILER_SAMPLE_MAX_DEPTH &&
+               fp >= sp && fp + 2 * sizeof(u64) <= g_sampler.stack_hi &&
+               (fp & (sizeof(u64) - 1)) == 0)
+        {
+            u64 *frame = (u64*)fp;
+            if (frame[1] == 0) {
+                break;
+            }
+
+            sample.ips[sample.depth++] = frame[1];
+
+            if (frame[0] <= fp) {
+                break;
+            }
+
+            sp = fp;
+            fp = (uptr)frame[0];
+        }
+    }
+
+    sampler_ring_push(&g_sampler_ring, &sample);
+}
+
+// NOTE(jesper): error is set to the errno of the failing call
+bool sampler_open_perf(i32 tid, i32 frequency, i32 *error)
+{
+    ASSERT(g_sampler.perf_count < SAMPLER_MAX_THREADS);
+
+    perf_event_attr attr = {};
+    attr.size           = sizeof attr;
+    attr.type           = PERF_TYPE_SOFTWARE;
+    attr.config         = PERF_COUNT_SW_TASK_CLOCK;
+    attr.sample_freq    = (u64)frequency;
+    attr.freq           = 1;
+    attr.sample_type    = PERF_SAMPLE_IP | PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.inherit        = 0;
+
+    i32 fd = (i32)syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+    if (fd < 0) {
+        *error = errno;
+        return false;
+    }
+
+    usize page_size = (usize)sysconf(_SC_PAGESIZE);
+    usize size      = (SAMPLER_PERF_PAGES + 1) * page_size;
+
+    void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) {
+        *error = errno;
+        close(fd);
+        return false;
+    }
+
+    SamplerPerfBuffer &perf = g_sampler.perf[g_sampler.perf_count++];
+    perf.fd     = fd;
+    perf.header = (perf_event_mmap_page*)mem;
+    perf.data   = (u8*)mem + page_size;
+    perf.size   = SAMPLER_PERF_PAGES * page_size;
+
+    return true;
+}
+
+void sampler_close_perf()
+{
+    usize page_size = (usize)sysconf(_SC_PAGESIZE);
+
+    for (i32 i = 0; i < g_sampler.perf_count; i++) {
+        SamplerPerfBuffer &perf = g_sampler.perf[i];
+
+        ioctl(perf.fd, PERF_EVENT_IOC_DISABLE, 0);
+        munmap(perf.header, perf.size + page_size);
+        close(perf.fd);
+    }
+
+    g_sampler.perf_count = 0;
+}
+
+u64 sampler_perf_read_u64(SamplerPerfBuffer *perf, u64 offset)
+{
+    u64 value;
+    for (usize i = 0; i < sizeof value; i++) {
+        ((u8*)&value)[i] = perf->data[(offset + i) % perf->size];
+    }
+    return value;
+}
+
+// NOTE(jesper): moves the kernel's samples into our ring. Records can wrap
+// around the end of the perf buffer, so everything is read through
+// sampler_perf_read_u64
+void sampler_drain_perf(SamplerPerfBuffer *perf)
+{
+    u64 head = __atomic_load_n(&perf->header->data_head, __ATOMIC_ACQUIRE);
+    u64 tail = perf->header->data_tail;
+
+    while (tail < head) {
+        perf_event_header header;
+        u64 raw = sampler_perf_read_u64(perf, tail);
+        memcpy(&header, &raw, sizeof header);
+
+        if (header.type == PERF_RECORD_SAMPLE) {
+            u64 offset = tail + sizeof header;
+
+            u64 ip  = sampler_perf_read_u64(perf, offset);
+            u64 tid = sampler_perf_read_u64(perf, offset + 8) >> 32;
+            u64 nr  = sampler_perf_read_u64(perf, offset + 16);
+            offset += 24;
+
+            ProfileSample sample;
+            sample.tid   = (u32)tid;
+            sample.depth = 0;
+
+            // NOTE(jesper): the callchain includes the sampled ip and is
+            // interleaved with PERF_CONTEXT_* markers
+            for (u64 i = 0; i < nr && sample.depth < PROFILER_SAMPLE_MAX_DEPTH; i++) {
+                u64 address = sampler_perf_read_u64(perf, offset + i * 8);
+                if (address >= (u64)PERF_CONTEXT_MAX) {
+                    continue;
+                }
+
+                sample.ips[sample.depth++] = address;
+            }
+
+            if (sample.depth == 0) {
+                sample.ips[sample.depth++] = ip;
+            }
+
+            sampler_ring_push(&g_sampler_ring, &sample);
+        } else if (header.type == PERF_RECORD_LOST) {
+            atomic_add(&g_sampler_ring.dropped, 1);
+        }
+
+        tail += header.size;
+    }
+
+    __atomic_store_n(&perf->header->data_tail, tail, __ATOMIC_RELEASE);
+}
+
+bool platform_sampler_start(i32 frequency)
+{
+    ASSERT(!g_sampler.active);
+
+    memset(&g_sampler_ring, 0, sizeof g_sampler_ring);
+
+    // NOTE(jesper): one event per thread that already exists. Threads created
+    // after this point won't be sampled in perf mode, neither will threads we
+    // fail to open an event for, e.g. ones that exited while we listed them.
+    i32 perf_error   = 0;
+    i32 perf_skipped = 0;
+    DIR *dir = opendir("/proc/self/task");
+    if (dir != nullptr) {
+        dirent *entry;
+        while ((entry = readdir(dir)) != nullptr &&
+               g_sampler.perf_count < SAMPLER_MAX_THREADS)
+        {
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+
+            i32 tid = atoi(entry->d_name);
+            if (!sampler_open_perf(tid, frequency, &perf_error)) {
+                perf_skipped++;
+            }
+        }
+        closedir(dir);
+    } else {
+        perf_error = errno;
+    }
+
+    if (g_sampler.perf_count > 0) {
+        for (i32 i = 0; i < g_sampler.perf_count; i++) {
+            ioctl(g_sampler.perf[i].fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+
+        LOG_INFO("sampling %d threads at %d Hz using perf_event_open",
+                 g_sampler.perf_count, frequency);
+
+        if (perf_skipped > 0) {
+            LOG_WARNING("unable to sample %d threads: %s",
+                        perf_skipped, strerror(perf_error));
+        }
+
+        g_sampler.active      = true;
+        g_sampler.using_timer = false;
+        return true;
+    }
+
+    LOG_WARNING("perf_event_open unavailable (%s), falling back to SIGPROF",
+                strerror(perf_error));
+    sampler_close_perf();
+
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        void  *stack_addr;
+        usize  stack_size;
+        pthread_attr_getstack(&attr, &stack_addr, &stack_size);
+        pthread_attr_destroy(&attr);
+
+        g_sampler.stack_lo = (uptr)stack_addr;
+        g_sampler.stack_hi = (uptr)stack_addr + stack_size;
+    }
+
+    struct sigaction sa = {};
+    sa.sa_sigaction = &sampler_signal_handler;
+    sa.sa_flags     = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+
+    if (sigaction(SIGPROF, &sa, nullptr) != 0) {
+        LOG_ERROR("failed to install SIGPROF handler: %s", strerror(errno));
+        return false;
+    }
+
+    sigevent sev = {};
+    sev.sigev_notify = SIGEV_SIGNAL;
+    sev.sigev_signo  = SIGPROF;
+
+    if (timer_create(CLOCK_PROCESS_CPUTIME_ID, &sev, &g_sampler.timer) != 0) {
+        LOG_ERROR("failed to create sampling timer: %s", strerror(errno));
+        signal(SIGPROF, SIG_IGN);
+        return false;
+    }
+
+    i64 interval = 1000000000ll / frequency;
+
+    itimerspec its = {};
+    its.it_interval.tv_sec  = interval / 1000000000ll;
+    its.it_interval.tv_nsec = interval % 1000000000ll;
+    its.it_value            = its.it_interval;
+    timer_settime(g_sampler.timer, 0, &its, nullptr);
+
+    LOG_INFO("sampling at %d Hz using SIGPROF", frequency);
+
+    g_sampler.active      = true;
+    g_sampler.using_timer = true;
+    return true;
+}
+
+void platform_sampler_stop()
+{
+    if (!g_sampler.active) {
+        return;
+    }
+
+    if (g_sampler.using_timer) {
+        // NOTE(jesper): a SIGPROF can still be pending or in flight after the
+        // timer is deleted, and the default action would terminate us
+        timer_delete(g_sampler.timer);
+        signal(SIGPROF, SIG_IGN);
+    } else {
+        for (i32 i = 0; i < g_sampler.perf_count; i++) {
+            sampler_drain_perf(&g_sampler.perf[i]);
+        }
+        sampler_close_perf();
+    }
+
+    g_sampler.active = false;
+}
+
+bool platform_sampler_next(ProfileSample *sample)
+{
+    if (sampler_ring_pop(&g_sampler_ring, sample)) {
+        return true;
+    }
+
+    if (!g_sampler.active || g_sampler.using_timer) {
+        return false;
+    }
+
+    for (i32 i = 0; i < g_sampler.perf_count; i++) {
+        sampler_drain_perf(&g_sampler.perf[i]);
+    }
+
+    return sampler_ring_pop(&g_sampler_ring, sample);
+}
+
+u32 platform_sampler_dropped()
+{
+    return atomic_load(&g_sampler_ring.dropped);
+}
+
+bool platform_symbolise(u64 ip, ProfileSymbol *symbol)
+{
+    Dl_info info;
+    if (dladdr((void*)ip, &info) == 0) {
+        return false;
+    }
+
+    symbol->module  = info.dli_fname;
+    symbol->address = (u64)(info.dli_saddr ? info.dli_saddr : (void*)ip);
+    symbol->offset  = symbol->address - (u64)info.dli_fbase;
+
+    if (info.dli_sname == nullptr) {
+        // NOTE(jesper): not exported, leave it to addr2line with the offset
+        snprintf(symbol->name, sizeof symbol->name, "??");
+        symbol->address = ip;
+        symbol->offset  = ip - (u64)info.dli_fbase;
+        return true;
+    }
+
+    i32 status = 0;
+    char *demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+
+    snprintf(symbol->name, sizeof symbol->name, "%s",
+             status == 0 ? demangled : info.dli_sname);
+    free(demangled);
+
+    return true;
+}
@@ -0,0 +1,95 @@
+/**
+ * file:    linux_thread.cpp
+ * created: 2018-09-30
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+extern Allocator *g_heap;
+
+void init_mutex(Mutex *m)
+{
+    m->native = {};
+    pthread_mutex_init(&m->native, nullptr);
+}
+
+void lock_mutex(Mutex *m)
+{
+    pthread_mutex_lock(&m->native);
+}
+
+void unlock_mutex(Mutex *m)
+{
+    pthread_mutex_unlock(&m->native);
+}
+
+void init_semaphore(Semaphore *s)
+{
+    int result = sem_init(&s->native, 0, 0);
+    ASSERT(result == 0);
+}
+
+void signal_semaphore(Semaphore *s)
+{
+    sem_post(&s->native);
+}
+
+void wait_semaphore(Semaphore *s)
+{
+    while (sem_wait(&s->native) != 0 && errno == EINTR);
+}
+
+struct LinuxThreadData {
+    thread_proc_t *proc;
+    void          *data;
+};
+
+void* linux_thread_proc(void *param)
+{
+    LinuxThreadData td = *(LinuxThreadData*)param;
+    dealloc(g_heap, param);
+
+    td.proc(td.data);
+    return nullptr;
+}
+
+void create_thread(thread_proc_t *proc, void *data)
+{
+    LinuxThreadData *td = ialloc<LinuxThreadData>(g_heap);
+    td->proc = proc;
+    td->data = data;
+
+    pthread_t thread;
+    int result = pthread_create(&thread, nullptr, &linux_thread_proc, td);
+    ASSERT(result == 0);
+    pthread_detach(thread);
+}
+
+i32 hardware_thread_count()
+{
+    return max((i32)sysconf(_SC_NPROCESSORS_ONLN), 1);
+}
+
+u32 atomic_load(u32 *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+void atomic_store(u32 *ptr, u32 value)
+{
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+u32 atomic_add(u32 *ptr, u32 value)
+{
+    return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+bool atomic_cas(u32 *ptr, u32 expected, u32 desired)
+{
+    return __atomic_compare_exchange_n(
+        ptr, &expected, desired,
+        false,
+        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
@@ -8,8 +8,10 @@
 
 #if defined(__linux__)
 typedef pthread_mutex_t NativeMutex;
+typedef sem_t           NativeSemaphore;
 #elif defined(_WIN32)
 typedef HANDLE NativeMutex;
+typedef HANDLE NativeSemaphore;
 #else
 #error "unsupported platform"
 #endif
@@ -20,4 +22,25 @@ struct Mutex {
 
 void init_mutex(Mutex *m);
 void lock_mutex(Mutex *m);
-void unlock_mutex(Mutex *m);
\ No newline at end of file
+void unlock_mutex(Mutex *m);
+
+struct Semaphore {
+    NativeSemaphore native;
+};
+
+void init_semaphore(Semaphore *s);
+void signal_semaphore(Semaphore *s);
+void wait_semaphore(Semaphore *s);
+
+#define THREAD_PROC(fname) void fname(void *data)
+typedef THREAD_PROC(thread_proc_t);
+
+void create_thread(thread_proc_t *proc, void *data);
+i32  hardware_thread_count();
+
+// NOTE(jesper): loads are acquire, stores are release, the read-modify-write
+// operations are sequentially consistent. atomic_add returns the previous value
+u32  atomic_load(u32 *ptr);
+void atomic_store(u32 *ptr, u32 value);
+u32  atomic_add(u32 *ptr, u32 value);
+bool atomic_cas(u32 *ptr, u32 expected, u32 desired);
@@ -27,3 +27,48 @@ char* win32_system_error_message(DWORD error)
 
     return buffer;
 }
+
+// TODO(jesper): implement the sampler on windows, probably with a thread that
+// suspends the others and walks their stacks with GetThreadContext and
+// StackWalk64, symbolised with SymFromAddr
+bool platform_sampler_start(i32 frequency)
+{
+    (void)frequency;
+    LOG_UNIMPLEMENTED();
+    return false;
+}
+
+void platform_sampler_stop()
+{
+}
+
+bool platform_sampler_next(ProfileSample *sample)
+{
+    (void)sample;
+    return false;
+}
+
+u32 platform_sampler_dropped()
+{
+    return 0;
+}
+
+bool platform_symbolise(u64 ip, ProfileSymbol *symbol)
+{
+    (void)ip;
+    (void)symbol;
+    return false;
+}
+
+// TODO(jesper): hardware counters on windows need a kernel driver or ETW's PMC
+// sources, neither of which is readable from within a scope
+bool platform_counters_init()
+{
+    return false;
+}
+
+bool platform_counters_read(u64 *values)
+{
+    (void)values;
+    return false;
+}
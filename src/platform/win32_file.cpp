@@ -52,47 +52,78 @@ void init_paths(Allocator *a)
     g_paths.models   = create_folder_path(a, { g_paths.data.absolute, "models\\" });
 }
 
-Array<FilePath> list_files(FolderPath folder, Allocator *allocator)
+// NOTE(jesper): relative is the path below root with a trailing separator,
+// or empty for root itself
+void list_files_recursive(
+    StringView root,
+    char *relative,
+    i32 length,
+    Array<char> *names,
+    Array<i32> *offsets)
 {
-    Array<FilePath> files = {};
-    files.allocator   = allocator;
+    bool eslash = root.size > 1 && root.bytes[root.size-2] == '\\';
 
     // TODO(jesper): ROBUSTNESS: better path length
     char path[2048];
-    snprintf(path, sizeof path, "%s\\*.*", folder.absolute.bytes);
-
-    bool eslash = (folder[folder.absolute.size-1] == '\\');
+    snprintf(path, sizeof path, eslash ? "%s%s*.*" : "%s\\%s*.*", root.bytes, relative);
 
-    HANDLE h = NULL;
     WIN32_FIND_DATA fd;
-    h = FindFirstFile(path, &fd);
+    HANDLE h = FindFirstFile(path, &fd);
     if (h == INVALID_HANDLE_VALUE) {
-        LOG_ERROR("could not find file in folder: %s", folder);
-        return {};
+        return;
     }
 
     do {
         if (strcmp(fd.cFileName, ".") == 0 || strcmp(fd.cFileName, "..") == 0) {
             continue;
         }
+
+        i32 name_length = (i32)strlen(fd.cFileName);
+        if (length + name_length + 2 > MAX_PATH) {
+            LOG_ERROR("path too long: %s%s", relative, fd.cFileName);
+            continue;
+        }
+
+        memcpy(relative + length, fd.cFileName, name_length + 1);
+
         if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-            // TODO(jesper): handle sub-folders
-            LOG_WARNING("sub-folders are unimplemented");
-        } else {
-            FilePath p = {};
-            if (!eslash) {
-                p = create_file_path(allocator, { folder.absolute, "\\", fd.cFileName });
-            } else {
-                p = create_file_path(allocator, { folder.absolute, fd.cFileName });
+            // NOTE(jesper): don't follow junctions and symlinked folders, they
+            // can point back up the tree
+            if (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+                continue;
             }
 
-            LOG("adding file: %s", p.absolute.bytes);
-            array_add(&files, p);
+            relative[length + name_length]     = '\\';
+            relative[length + name_length + 1] = '\0';
+            list_files_recursive(root, relative, length + name_length + 1, names, offsets);
+        } else {
+            array_add(offsets, names->count);
+            for (i32 i = 0; i <= length + name_length; i++) {
+                array_add(names, relative[i]);
+            }
         }
     } while (FindNextFile(h, &fd));
 
+    relative[length] = '\0';
     FindClose(h);
-    return files;
+}
+
+Array<FilePath> list_files(FolderPath folder, Allocator *allocator)
+{
+    // NOTE(jesper): the relative paths are gathered back to back and the list
+    // is built in one allocation once the count and sizes are known
+    Array<char> names  = create_array<char>(g_heap);
+    Array<i32> offsets = create_array<i32>(g_heap);
+    defer {
+        destroy_array(&names);
+        destroy_array(&offsets);
+    };
+
+    char relative[MAX_PATH];
+    relative[0] = '\0';
+    list_files_recursive(folder.absolute, relative, 0, &names, &offsets);
+
+    return create_file_list(folder.absolute, names.data, offsets.data, offsets.count, allocator);
 }
 
 FilePath resolve_relative(FilePathView path, Allocator *a)
@@ -238,6 +269,20 @@ bool create_file(FilePathView p, bool create_folders = false)
     return true;
 }
 
+bool remove_file(FilePathView path)
+{
+    return DeleteFile(path.absolute.bytes) == TRUE;
+}
+
+// NOTE(jesper): replaces dst if it exists
+bool rename_file(FilePathView src, FilePathView dst)
+{
+    return MoveFileEx(
+        src.absolute.bytes,
+        dst.absolute.bytes,
+        MOVEFILE_REPLACE_EXISTING) == TRUE;
+}
+
 void* open_file(FilePathView path, FileAccess access)
 {
     DWORD flags;
@@ -326,6 +371,56 @@ char* read_file(FilePathView filename, usize *o_size, Allocator *a)
     return buffer;
 }
 
+void* map_file(FilePathView path, usize *size)
+{
+    HANDLE file = CreateFile(
+        path.absolute.bytes,
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    defer { CloseHandle(file); };
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        LOG_ERROR("failed to create file mapping %s - %s",
+                  path.absolute.bytes,
+                  win32_system_error_message(GetLastError()));
+        return nullptr;
+    }
+    defer { CloseHandle(mapping); };
+
+    // NOTE(jesper): the view keeps the mapping and file alive after the
+    // handles are closed
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr) {
+        LOG_ERROR("failed to map file %s - %s",
+                  path.absolute.bytes,
+                  win32_system_error_message(GetLastError()));
+        return nullptr;
+    }
+
+    *size = (usize)file_size.QuadPart;
+    return data;
+}
+
+void unmap_file(void *data, usize size)
+{
+    (void)size;
+    UnmapViewOfFile(data);
+}
+
 void write_file(void *file_handle, void *buffer, usize bytes)
 {
     BOOL result;
@@ -102,6 +102,23 @@ void create_catalog_thread(Array<FolderPath> folders, catalog_callback_t *callba
     }
 }
 
+u64 platform_clock_ticks()
+{
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (u64)counter.QuadPart;
+}
+
+u64 platform_clock_frequency()
+{
+    static LARGE_INTEGER frequency = {};
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    return (u64)frequency.QuadPart;
+}
+
 void platform_quit()
 {
     FilePath settings_path = resolve_file_path(
@@ -115,6 +132,7 @@ void platform_quit()
         ARRAY_SIZE(Settings_members),
         &g_settings);
 
+    log_flush();
     _exit(EXIT_SUCCESS);
 }
 
@@ -621,6 +639,7 @@ PLATFORM_INIT_FUNC(platform_init)
     g_system_alloc = &g_platform->allocators.system;
 
     init_paths(g_persistent);
+    init_log();
     g_wasapi = init_wasapi(48000, 2);
 
     FilePath settings_path = resolve_file_path(
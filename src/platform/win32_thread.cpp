@@ -21,3 +21,78 @@ void unlock_mutex(Mutex *m)
     ReleaseMutex(m->native);
 }
 
+void init_semaphore(Semaphore *s)
+{
+    s->native = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+    ASSERT(s->native != NULL);
+}
+
+void signal_semaphore(Semaphore *s)
+{
+    ReleaseSemaphore(s->native, 1, NULL);
+}
+
+void wait_semaphore(Semaphore *s)
+{
+    WaitForSingleObject(s->native, INFINITE);
+}
+
+struct Win32ThreadData {
+    thread_proc_t *proc;
+    void          *data;
+};
+
+DWORD WINAPI win32_thread_proc(LPVOID param)
+{
+    Win32ThreadData td = *(Win32ThreadData*)param;
+    dealloc(g_heap, param);
+
+    td.proc(td.data);
+    return 0;
+}
+
+void create_thread(thread_proc_t *proc, void *data)
+{
+    Win32ThreadData *td = ialloc<Win32ThreadData>(g_heap);
+    td->proc = proc;
+    td->data = data;
+
+    HANDLE th = CreateThread(NULL, 0, &win32_thread_proc, td, 0, NULL);
+    ASSERT(th != NULL);
+    CloseHandle(th);
+}
+
+i32 hardware_thread_count()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return max((i32)info.dwNumberOfProcessors, 1);
+}
+
+u32 atomic_load(u32 *ptr)
+{
+    // NOTE(jesper): aligned loads are atomic on x86, the barrier is to stop the
+    // compiler from reordering
+    u32 value = *(volatile u32*)ptr;
+    _ReadWriteBarrier();
+    return value;
+}
+
+void atomic_store(u32 *ptr, u32 value)
+{
+    _ReadWriteBarrier();
+    *(volatile u32*)ptr = value;
+}
+
+u32 atomic_add(u32 *ptr, u32 value)
+{
+    return (u32)InterlockedExchangeAdd((volatile LONG*)ptr, (LONG)value);
+}
+
+bool atomic_cas(u32 *ptr, u32 expected, u32 desired)
+{
+    return (u32)InterlockedCompareExchange(
+        (volatile LONG*)ptr,
+        (LONG)desired,
+        (LONG)expected) == expected;
+}
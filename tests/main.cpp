@@ -6,27 +6,110 @@
  * Copyright (c) 2017-2018 - all rights reserved
  */
 
-#include "platform/platform.h"
-#include "leary.h"
+// NOTE(jesper): the tests are a unity build of the platform independent core
+// modules, without the game's window, audio and vulkan setup. Failed asserts
+// still break into the debugger.
+#define LEARY_ENABLE_LOGGING 0
+#define LEARY_ENABLE_PROFILING 0
 
+#include "build_config.h"
+
+#include <stdint.h>
+#include <stddef.h>
 #include "core/types.h"
 
-#include "core/lexer.cpp"
-#include "core/allocator.cpp"
-#include "core/array.cpp"
+#include <inttypes.h>
+
+#include <initializer_list>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cstring>
+#include <utility>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#if defined(__linux__)
+    #include <cpuid.h>
+    #include <x86intrin.h>
+    #include <errno.h>
+    #include <pthread.h>
+    #include <semaphore.h>
+    #include <unistd.h>
 
-LinearAllocator *g_debug_frame;
+    #include <vulkan/vulkan.h>
 
-#if defined(_WIN32)
-    #include "platform/win32_debug.cpp"
-    #include "platform/win32_file.cpp"
-#elif defined(__linux__)
-    #include "platform/linux_debug.cpp"
-    #include "platform/linux_file.cpp"
+    // NOTE(jesper): platform.h pulls in the X11 types of the platform layer,
+    // the tests only need its path separator
+    #define FILE_SEP "/"
+#elif defined(_WIN32)
+    #include <Windows.h>
+    #include <intrin.h>
+
+    #define VK_USE_PLATFORM_WIN32_KHR
+    #include <vulkan/vulkan.h>
+
+    #define FILE_SEP "\\"
 #else
     #error "unsupported platform"
 #endif
 
+#include "platform/platform_debug.h"
+#include "platform/thread.h"
+
+#include "leary_macros.h"
+
+#include "core/log.h"
+#include "core/maths.h"
+#include "core/allocator.h"
+#include "core/array.h"
+#include "core/hash_table.h"
+#include "core/string.h"
+#include "core/file.h"
+#include "core/obj.h"
+#include "core/mesh_optimize.h"
+#include "core/image.h"
+#include "core/texture_compress.h"
+#include "core/adpcm.h"
+
+Allocator *g_heap;
+Allocator *g_frame;
+Allocator *g_debug_frame;
+Allocator *g_persistent;
+Allocator *g_stack;
+Allocator *g_system_alloc;
+
+// NOTE(jesper): the profiler and the platform file layer aren't part of the
+// tests, nothing in them tracks allocations or resolves game paths
+void profiler_alloc(Allocator *, isize) {}
+
+FilePath resolve_file_path(GamePath, StringView, Allocator *)
+{
+    ASSERT(false);
+    return {};
+}
+
+#include "core/hash.cpp"
+#include "core/allocator.cpp"
+#include "core/array.cpp"
+#include "core/hash_table.cpp"
+#include "core/lexer.cpp"
+#include "core/string.cpp"
+#include "core/file.cpp"
+#include "core/maths.cpp"
+#include "core/obj.cpp"
+#include "core/mesh_optimize.cpp"
+#include "core/image.cpp"
+#include "core/texture_compress.cpp"
+#include "core/adpcm.cpp"
+
+#if defined(__linux__)
+    #include "platform/linux_thread.cpp"
+#elif defined(_WIN32)
+    #include "platform/win32_thread.cpp"
+#endif
+
 #define TEST_START(name) printf("-- running test: %s\n", name)
 
 #define CHECK(r, c) \
@@ -34,24 +117,40 @@ LinearAllocator *g_debug_frame;
         bool tmp = (c); \
         r = r && tmp; \
         if (!tmp) { \
-            printf("ERROR: " #c "\n"); \
-        } else { \
-            printf("OK   : " #c "\n"); \
+            printf("ERROR: %s:%d: %s\n", __FILE__, __LINE__, #c); \
         } \
     } while(0)
 
 #include "test_array.cpp"
 #include "test_allocator.cpp"
+#include "test_hash_table.cpp"
+#include "test_obj.cpp"
+#include "test_mesh_optimize.cpp"
+#include "test_image.cpp"
+#include "test_texture_compress.cpp"
+#include "test_adpcm.cpp"
 
 int main()
 {
-    isize debug_frame_size = 64  * 1024 * 1024;
-    void *debug_frame_mem = malloc(debug_frame_size);
-    g_debug_frame = new LinearAllocator(debug_frame_mem, debug_frame_size);
+    Allocator system = system_allocator();
+    g_system_alloc = &system;
 
+    isize heap_size = 64 * 1024 * 1024;
+    Allocator heap = heap_allocator(malloc(heap_size), heap_size);
+    g_heap = &heap;
+
+    // NOTE(jesper): run every test even if an earlier one failed so that all
+    // the failures are reported at once
     bool result = true;
-    result = result && test_allocators();
-    result = result && test_array();
-    return 0;
-}
+    result = test_allocators() && result;
+    result = test_array() && result;
+    result = test_hash_table() && result;
+    result = test_obj() && result;
+    result = test_mesh_optimize() && result;
+    result = test_image() && result;
+    result = test_texture_compress() && result;
+    result = test_adpcm() && result;
 
+    printf("-- %s\n", result ? "all tests passed" : "TESTS FAILED");
+    return result ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+/**
+ * file:    test_adpcm.cpp
+ * created: 2018-09-30
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): encodes num_samples frames and decodes them again block by
+// block into decoded, which must hold every block's worth of frames
+void adpcm_round_trip(
+    i16 *decoded,
+    i16 *src, i32 num_samples, i32 num_channels,
+    Allocator *a)
+{
+    i32 block_count = adpcm_block_count(num_samples);
+    i32 block_size  = adpcm_block_size(num_channels);
+
+    u8 *encoded = alloc_array(a, u8, block_count * block_size);
+    defer { dealloc(a, encoded); };
+
+    encode_adpcm(encoded, src, num_samples, num_channels);
+
+    for (i32 b = 0; b < block_count; b++) {
+        decode_adpcm_block(
+            decoded + b * ADPCM_BLOCK_SAMPLES * num_channels,
+            encoded + b * block_size,
+            num_channels);
+    }
+}
+
+// NOTE(jesper): signal to noise ratio in dB of one channel of the decoded
+// frames
+f32 adpcm_snr(i16 *decoded, i16 *src, i32 num_samples, i32 num_channels, i32 channel)
+{
+    f64 signal = 0.0;
+    f64 noise  = 0.0;
+    for (i32 i = 0; i < num_samples; i++) {
+        f64 s = src[i * num_channels + channel];
+        f64 d = decoded[i * num_channels + channel];
+        signal += s * s;
+        noise  += (s - d) * (s - d);
+    }
+
+    return noise > 0.0 ? (f32)(10.0 * log10(signal / noise)) : INFINITY;
+}
+
+bool test_adpcm_sizes()
+{
+    TEST_START("adpcm::sizes");
+    bool result = true;
+
+    CHECK(result, adpcm_block_size(1) == 4 + ADPCM_BLOCK_SAMPLES / 2);
+    CHECK(result, adpcm_block_size(2) == 2 * (4 + ADPCM_BLOCK_SAMPLES / 2));
+
+    CHECK(result, adpcm_block_count(0) == 0);
+    CHECK(result, adpcm_block_count(1) == 1);
+    CHECK(result, adpcm_block_count(ADPCM_BLOCK_SAMPLES) == 1);
+    CHECK(result, adpcm_block_count(ADPCM_BLOCK_SAMPLES + 1) == 2);
+
+    return result;
+}
+
+bool test_adpcm_round_trip()
+{
+    TEST_START("adpcm::round_trip");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    // NOTE(jesper): a partial last block, and a different tone in each
+    // channel so that mixing them up shows
+    i32 num_samples = 3 * ADPCM_BLOCK_SAMPLES + 300;
+    i32 block_count = adpcm_block_count(num_samples);
+
+    i16 *src     = alloc_array(&a, i16, num_samples * 2);
+    i16 *decoded = alloc_array(&a, i16, block_count * ADPCM_BLOCK_SAMPLES * 2);
+    defer {
+        dealloc(&a, decoded);
+        dealloc(&a, src);
+    };
+
+    for (i32 i = 0; i < num_samples; i++) {
+        f32 t = (f32)i / 48000.0f;
+        src[i * 2 + 0] = (i16)(16000.0f * sinf(2.0f * PI * 440.0f * t));
+        src[i * 2 + 1] = (i16)(8000.0f * sinf(2.0f * PI * 1250.0f * t) +
+                               4000.0f * sinf(2.0f * PI * 90.0f * t));
+    }
+
+    // NOTE(jesper): IMA-ADPCM manages ~30 dB on pure tones once the step size
+    // has adapted, which takes a few dozen samples from the initial state
+    adpcm_round_trip(decoded, src, num_samples, 2, &a);
+    CHECK(result, adpcm_snr(decoded, src, num_samples, 2, 0) > 20.0f);
+    CHECK(result, adpcm_snr(decoded, src, num_samples, 2, 1) > 20.0f);
+
+    i16 *mono = alloc_array(&a, i16, num_samples);
+    defer { dealloc(&a, mono); };
+
+    for (i32 i = 0; i < num_samples; i++) {
+        mono[i] = src[i * 2 + 1];
+    }
+
+    adpcm_round_trip(decoded, mono, num_samples, 1, &a);
+    CHECK(result, adpcm_snr(decoded, mono, num_samples, 1, 0) > 20.0f);
+
+    // NOTE(jesper): the last block is padded with silence, the decoder has to
+    // settle towards it
+    i32 tail = 0;
+    for (i32 i = block_count * ADPCM_BLOCK_SAMPLES - 64; i < block_count * ADPCM_BLOCK_SAMPLES; i++) {
+        tail += abs(decoded[i]) > 64;
+    }
+    CHECK(result, tail == 0);
+
+    return result;
+}
+
+bool test_adpcm_blocks()
+{
+    TEST_START("adpcm::blocks");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    i32 num_samples = 4 * ADPCM_BLOCK_SAMPLES;
+    i32 block_size  = adpcm_block_size(1);
+
+    i16 *src     = alloc_array(&a, i16, num_samples);
+    i16 *decoded = alloc_array(&a, i16, num_samples);
+    u8  *encoded = alloc_array(&a, u8, 4 * block_size);
+    defer {
+        dealloc(&a, encoded);
+        dealloc(&a, decoded);
+        dealloc(&a, src);
+    };
+
+    u32 state = 0x12345678;
+    for (i32 i = 0; i < num_samples; i++) {
+        state = state * 1664525u + 1013904223u;
+        src[i] = (i16)(6000.0f * sinf(i * 0.05f) + (i32)(state >> 22) - 512);
+    }
+
+    encode_adpcm(encoded, src, num_samples, 1);
+
+    // NOTE(jesper): every block starts from the state the decoder ends the
+    // previous one in, so blocks decoded on their own join up exactly
+    i32 mismatches = 0;
+    i32 bad_steps  = 0;
+    for (i32 b = 0; b < 4; b++) {
+        decode_adpcm_block(decoded + b * ADPCM_BLOCK_SAMPLES, encoded + b * block_size, 1);
+
+        AdpcmChannelHeader *header = (AdpcmChannelHeader*)(encoded + b * block_size);
+        bad_steps += header->step_index > 88;
+
+        if (b > 0) {
+            mismatches += header->predictor != decoded[b * ADPCM_BLOCK_SAMPLES - 1];
+        }
+    }
+    CHECK(result, mismatches == 0);
+    CHECK(result, bad_steps == 0);
+
+    // NOTE(jesper): full scale input has to clamp rather than wrap around
+    for (i32 i = 0; i < num_samples; i++) {
+        src[i] = (i / 256) % 2 ? I16_MIN : I16_MAX;
+    }
+
+    encode_adpcm(encoded, src, num_samples, 1);
+    for (i32 b = 0; b < 4; b++) {
+        decode_adpcm_block(decoded + b * ADPCM_BLOCK_SAMPLES, encoded + b * block_size, 1);
+    }
+
+    i32 wrapped = 0;
+    for (i32 i = 0; i < num_samples; i++) {
+        // NOTE(jesper): give it a few dozen samples to swing across
+        if (i % 256 >= 64) {
+            wrapped += (src[i] > 0) != (decoded[i] > 0);
+        }
+    }
+    CHECK(result, wrapped == 0);
+
+    return result;
+}
+
+bool test_adpcm()
+{
+    TEST_START("adpcm");
+    bool result = true;
+    result = test_adpcm_sizes() && result;
+    result = test_adpcm_round_trip() && result;
+    result = test_adpcm_blocks() && result;
+    return result;
+}
@@ -11,21 +11,20 @@ bool test_heap_allocator()
     TEST_START("allocators::heap");
     bool result = true;
 
-    isize size          = 64 * 1024;
-    void *mem           = malloc(size);
-    HeapAllocator *heap = new HeapAllocator(mem, size);
-    defer {
-        free(mem);
-        delete heap;
-    };
-
-    CHECK(result, heap->free != nullptr);
-    CHECK(result, heap->free == mem);
-    CHECK(result, heap->free->size == size);
-
-    void *p = heap->alloc(16); (void)p;
-    CHECK(result, heap->free != mem);
-    CHECK(result, heap->free->size == (size - 16));
+    isize size     = 64 * 1024;
+    void *mem      = malloc(size);
+    Allocator heap = heap_allocator(mem, size);
+    defer { free(mem); };
+
+    CHECK(result, heap.free != nullptr);
+    CHECK(result, heap.free == mem);
+    CHECK(result, heap.free->size == size);
+
+    void *p = alloc(&heap, 16);
+    CHECK(result, p != nullptr);
+    CHECK(result, ((uptr)p & 15) == 0);
+    CHECK(result, heap.free != mem);
+    CHECK(result, heap.free->size == (size - 16));
 
     return result;
 }
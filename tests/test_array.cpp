@@ -11,9 +11,9 @@ bool test_array()
     TEST_START("array");
     bool result = true;
 
-    SystemAllocator a = {};
-    Array<i32> arr = {};
-    arr.allocator = &a;
+    Allocator a = system_allocator();
+    Array<i32> arr = create_array<i32>(&a);
+    defer { destroy_array(&arr); };
 
     for (i32 i = 0; i < 10; i++) {
         array_add(&arr, i);
@@ -0,0 +1,172 @@
+/**
+ * file:    test_hash_table.cpp
+ * created: 2018-09-30
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): counts how many of the values added to a map are destroyed,
+// moved from values don't count
+struct DestroyCounter {
+    i32 *destroyed = nullptr;
+
+    DestroyCounter() {}
+    DestroyCounter(i32 *counter) : destroyed(counter) {}
+    DestroyCounter(const DestroyCounter &other) : destroyed(other.destroyed) {}
+
+    DestroyCounter(DestroyCounter &&other) : destroyed(other.destroyed)
+    {
+        other.destroyed = nullptr;
+    }
+
+    DestroyCounter& operator=(const DestroyCounter &other)
+    {
+        destroyed = other.destroyed;
+        return *this;
+    }
+
+    DestroyCounter& operator=(DestroyCounter &&other)
+    {
+        destroyed = other.destroyed;
+        other.destroyed = nullptr;
+        return *this;
+    }
+
+    ~DestroyCounter()
+    {
+        if (destroyed != nullptr) {
+            (*destroyed)++;
+        }
+    }
+};
+
+bool test_map_grow()
+{
+    TEST_START("hash_table::map_grow");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    // NOTE(jesper): starts small enough that the map doubles many times, every
+    // key has to be found at its new slot after each rehash
+    RHHashMap<i32, i32> map;
+    init_map(&map, &a, 4);
+    defer { destroy_map(&map); };
+
+    i32 count = 5000;
+
+    i32 missing = 0;
+    for (i32 i = 0; i < count; i++) {
+        map_add(&map, i * 7919, i);
+
+        if (i % 97 == 0) {
+            for (i32 j = 0; j <= i; j++) {
+                i32 *value = map_find(&map, j * 7919);
+                missing += value == nullptr || *value != j;
+            }
+        }
+    }
+    CHECK(result, missing == 0);
+
+    CHECK(result, map.count == count);
+    CHECK(result, map.count < map.resize_threshold);
+    CHECK(result, (map.capacity & (map.capacity - 1)) == 0);
+    CHECK(result, map.mask == (u32)map.capacity - 1);
+
+    missing = 0;
+    for (i32 i = 0; i < count; i++) {
+        i32 *value = map_find(&map, i * 7919);
+        missing += value == nullptr || *value != i;
+    }
+    CHECK(result, missing == 0);
+
+    i32 found = 0;
+    for (i32 i = 0; i < count; i++) {
+        found += map_find(&map, i * 7919 + 1) != nullptr;
+    }
+    CHECK(result, found == 0);
+
+    i32 occupied = 0;
+    for (i32 i = 0; i < map.capacity; i++) {
+        occupied += map.entries[i].distance != -1;
+    }
+    CHECK(result, occupied == count);
+
+    return result;
+}
+
+bool test_map_string_keys()
+{
+    TEST_START("hash_table::map_string_keys");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    // NOTE(jesper): the map owns copies of its string keys, which are moved
+    // rather than copied when it grows
+    RHHashMap<StringView, i32> map;
+    init_map(&map, &a);
+    defer { destroy_map(&map); };
+
+    i32 count = 1000;
+
+    char name[64];
+    for (i32 i = 0; i < count; i++) {
+        snprintf(name, sizeof name, "textures/asset_%d.png", i);
+        map_add(&map, StringView{ name }, i);
+    }
+
+    CHECK(result, count > RH_INITIAL_SIZE);
+    CHECK(result, map.count == count);
+
+    i32 missing = 0;
+    for (i32 i = 0; i < count; i++) {
+        snprintf(name, sizeof name, "textures/asset_%d.png", i);
+        i32 *value = map_find(&map, StringView{ name });
+        missing += value == nullptr || *value != i;
+    }
+    CHECK(result, missing == 0);
+
+    CHECK(result, map_find(&map, StringView{ "textures/asset_1000.png" }) == nullptr);
+    CHECK(result, map_find(&map, StringView{ "textures/asset_1" }) == nullptr);
+
+    return result;
+}
+
+bool test_destroy_map()
+{
+    TEST_START("hash_table::destroy_map");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    // NOTE(jesper): every value is destroyed exactly once, wherever growing the
+    // map left it
+    i32 destroyed = 0;
+
+    RHHashMap<i32, DestroyCounter> map;
+    init_map(&map, &a, 4);
+
+    i32 count = 300;
+    for (i32 i = 0; i < count; i++) {
+        map_add(&map, i, DestroyCounter{ &destroyed });
+    }
+    CHECK(result, destroyed == 0);
+
+    destroy_map(&map);
+    CHECK(result, destroyed == count);
+    CHECK(result, map.entries == nullptr);
+
+    return result;
+}
+
+bool test_hash_table()
+{
+    TEST_START("hash_table");
+    bool result = true;
+    result = test_map_grow() && result;
+    result = test_map_string_keys() && result;
+    result = test_destroy_map() && result;
+    return result;
+}
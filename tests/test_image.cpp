@@ -0,0 +1,307 @@
+/**
+ * file:    test_image.cpp
+ * created: 2018-09-30
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+typedef void bgra_from_bgr_t(u8 *dst, u8 *src, i32 pixel_count);
+
+// NOTE(jesper): converts every pixel count up to a few iterations of the SSSE3
+// loop, so that every length of scalar tail is covered, from misaligned
+// buffers. The bytes around dst are checked to be untouched.
+bool check_bgra_from_bgr(bgra_from_bgr_t *convert, Allocator *a)
+{
+    i32 max_pixels = 16 * 4 + 15;
+    i32 guard      = 64;
+
+    u8 *src = alloc_array(a, u8, max_pixels * 3 + 1);
+    u8 *dst = alloc_array(a, u8, max_pixels * 4 + 2 * guard + 1);
+    defer {
+        dealloc(a, dst);
+        dealloc(a, src);
+    };
+
+    for (i32 i = 0; i < max_pixels * 3 + 1; i++) {
+        src[i] = (u8)(i * 7 + 3);
+    }
+
+    for (i32 count = 0; count <= max_pixels; count++) {
+        u8 *s = src + 1;
+        u8 *d = dst + guard + 1;
+
+        memset(dst, 0xCD, max_pixels * 4 + 2 * guard + 1);
+        convert(d, s, count);
+
+        for (i32 i = 0; i < count; i++) {
+            if (d[i*4 + 0] != s[i*3 + 0] ||
+                d[i*4 + 1] != s[i*3 + 1] ||
+                d[i*4 + 2] != s[i*3 + 2] ||
+                d[i*4 + 3] != 255)
+            {
+                printf("pixel %d of %d differs\n", i, count);
+                return false;
+            }
+        }
+
+        for (u8 *p = dst; p < d; p++) {
+            if (*p != 0xCD) {
+                printf("wrote before dst with %d pixels\n", count);
+                return false;
+            }
+        }
+
+        for (u8 *p = d + count * 4; p < dst + max_pixels * 4 + 2 * guard + 1; p++) {
+            if (*p != 0xCD) {
+                printf("wrote past dst with %d pixels\n", count);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool test_bgra_from_bgr()
+{
+    TEST_START("image::bgra_from_bgr");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    CHECK(result, check_bgra_from_bgr(&bgra_from_bgr_scalar, &a));
+    CHECK(result, check_bgra_from_bgr(&bgra_from_bgr, &a));
+
+    if (cpu_has_ssse3()) {
+        CHECK(result, check_bgra_from_bgr(&bgra_from_bgr_ssse3, &a));
+    } else {
+        printf("ssse3 not supported, skipping\n");
+    }
+
+    return result;
+}
+
+bool test_mip_sizes()
+{
+    TEST_START("image::mip_sizes");
+    bool result = true;
+
+    CHECK(result, mip_level_count(1, 1) == 1);
+    CHECK(result, mip_level_count(256, 256) == 9);
+    CHECK(result, mip_level_count(300, 17) == 9);
+    CHECK(result, mip_level_count(1, 64) == 7);
+
+    CHECK(result, mip_chain_size(4, 2, 3) == (4*2 + 2*1 + 1*1) * 4);
+    CHECK(result, mip_chain_size(5, 3, mip_level_count(5, 3)) == (5*3 + 2*1 + 1*1) * 4);
+
+    return result;
+}
+
+// NOTE(jesper): fills a width x height BGRA image with the pixels in order,
+// repeating them as needed
+void fill_image(u8 *dst, i32 width, i32 height, u32 *pixels, i32 pixel_count)
+{
+    for (i32 i = 0; i < width * height; i++) {
+        memcpy(dst + i * 4, &pixels[i % pixel_count], 4);
+    }
+}
+
+bool all_pixels(u8 *image, i32 width, i32 height, u32 pixel)
+{
+    for (i32 i = 0; i < width * height; i++) {
+        if (memcmp(image + i * 4, &pixel, 4) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool test_generate_mip_filters()
+{
+    TEST_START("image::generate_mip_filters");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    u8 src[8 * 8 * 4];
+    u8 dst[4 * 4 * 4];
+
+    // NOTE(jesper): the weights of both filters sum to 1, a flat image stays
+    // flat, including along the clamped edges
+    u32 flat = 0x80C04020;
+    fill_image(src, 8, 8, &flat, 1);
+
+    generate_mip(dst, src, 8, 8, MipFilter_box, false, false, &a);
+    CHECK(result, all_pixels(dst, 4, 4, flat));
+
+    generate_mip(dst, src, 8, 8, MipFilter_kaiser, false, false, &a);
+    CHECK(result, all_pixels(dst, 4, 4, flat));
+
+    generate_mip(dst, src, 8, 8, MipFilter_kaiser, true, false, &a);
+    CHECK(result, all_pixels(dst, 4, 4, flat));
+
+    // NOTE(jesper): columns of black and white average to grey in every
+    // channel. The box averages the pairs in each 2x2 block. The kaiser filter
+    // is symmetric around the destination sample so it gets the same away from
+    // the edges, where the clamping repeats the black column.
+    u32 columns[] = { 0x00000000, 0xFFFFFFFF };
+    fill_image(src, 8, 8, columns, 2);
+
+    generate_mip(dst, src, 8, 8, MipFilter_box, false, false, &a);
+    CHECK(result, all_pixels(dst, 4, 4, 0x80808080));
+
+    generate_mip(dst, src, 8, 8, MipFilter_kaiser, false, false, &a);
+
+    i32 not_grey = 0;
+    for (i32 y = 0; y < 4; y++) {
+        for (i32 x = 1; x < 3; x++) {
+            for (i32 i = 0; i < 4; i++) {
+                u8 v = dst[(y * 4 + x) * 4 + i];
+                not_grey += v != 127 && v != 128;
+            }
+        }
+    }
+    CHECK(result, not_grey == 0);
+    CHECK(result, dst[0] < 127);
+
+    // NOTE(jesper): in sRGB the colours are averaged in linear space, to
+    // sRGB(0.5), alpha is still averaged as is
+    generate_mip(dst, src, 8, 8, MipFilter_box, true, false, &a);
+    CHECK(result, all_pixels(dst, 4, 4, 0x80BCBCBC));
+
+    // NOTE(jesper): every 8 bit sRGB value survives the trip through linear
+    // space and back
+    i32 drift = 0;
+    for (u32 v = 0; v < 256; v++) {
+        u32 pixel = v * 0x01010101u;
+        fill_image(src, 8, 8, &pixel, 1);
+
+        generate_mip(dst, src, 8, 8, MipFilter_box, true, false, &a);
+        drift += !all_pixels(dst, 4, 4, pixel);
+    }
+    CHECK(result, drift == 0);
+
+    // NOTE(jesper): odd sizes drop the last row and column, 1 pixel wide or
+    // high images only shrink the other way
+    u32 rows[] = { 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+                   0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF };
+    fill_image(src, 5, 3, rows, 10);
+
+    memset(dst, 0xCD, sizeof dst);
+    generate_mip(dst, src, 5, 3, MipFilter_box, false, false, &a);
+    CHECK(result, all_pixels(dst, 2, 1, 0x80808080));
+    CHECK(result, dst[2 * 4] == 0xCD);
+
+    fill_image(src, 1, 8, columns, 2);
+    memset(dst, 0xCD, sizeof dst);
+    generate_mip(dst, src, 1, 8, MipFilter_box, false, false, &a);
+    CHECK(result, all_pixels(dst, 1, 4, 0x80808080));
+    CHECK(result, dst[4 * 4] == 0xCD);
+
+    return result;
+}
+
+// NOTE(jesper): decodes the xyz stored in the rgb of a BGRA normal map pixel
+Vector3 normal_from_pixel(u8 *p)
+{
+    return Vector3{
+        p[2] / 255.0f * 2.0f - 1.0f,
+        p[1] / 255.0f * 2.0f - 1.0f,
+        p[0] / 255.0f * 2.0f - 1.0f };
+}
+
+u32 pixel_from_normal(Vector3 n)
+{
+    u32 r = (u32)((n.x * 0.5f + 0.5f) * 255.0f + 0.5f);
+    u32 g = (u32)((n.y * 0.5f + 0.5f) * 255.0f + 0.5f);
+    u32 b = (u32)((n.z * 0.5f + 0.5f) * 255.0f + 0.5f);
+    return 0xFF000000 | (r << 16) | (g << 8) | b;
+}
+
+bool test_generate_mip_normals()
+{
+    TEST_START("image::generate_mip_normals");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    u8 src[8 * 8 * 4];
+    u8 dst[4 * 4 * 4];
+
+    // NOTE(jesper): normals tilted 45 degrees either way average to a
+    // shortened normal straight up, which is renormalised
+    f32 c = 0.70710678f;
+    u32 tilted[] = {
+        pixel_from_normal(Vector3{ c, 0.0f, c }),
+        pixel_from_normal(Vector3{ -c, 0.0f, c }),
+    };
+    fill_image(src, 8, 8, tilted, 2);
+
+    generate_mip(dst, src, 8, 8, MipFilter_box, false, true, &a);
+    CHECK(result, all_pixels(dst, 4, 4, pixel_from_normal(Vector3{ 0.0f, 0.0f, 1.0f })));
+
+    generate_mip(dst, src, 8, 8, MipFilter_box, false, false, &a);
+    CHECK(result, !all_pixels(dst, 4, 4, pixel_from_normal(Vector3{ 0.0f, 0.0f, 1.0f })));
+
+    // NOTE(jesper): opposite normals that cancel out exactly fall back to
+    // straight up rather than dividing by zero. 0 is between 127 and 128, so
+    // the pairs of channels have to sum to 255.
+    u32 opposite[] = { 0xFFFF7F7F, 0xFF008080 };
+    fill_image(src, 8, 8, opposite, 2);
+
+    generate_mip(dst, src, 8, 8, MipFilter_box, false, true, &a);
+    CHECK(result, all_pixels(dst, 4, 4, 0xFF8080FF));
+
+    // NOTE(jesper): random normals in the upper hemisphere stay unit length
+    // through the whole chain with either filter
+    u64 state = 0x9E3779B97F4A7C15ull;
+    for (i32 i = 0; i < 8 * 8; i++) {
+        Vector3 n;
+        do {
+            for (i32 j = 0; j < 3; j++) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                n.data[j] = (f32)(state >> 40) / (f32)(1 << 23) - 1.0f;
+            }
+            n.z = fabsf(n.z);
+        } while (length(n) < 0.1f || length(n) > 1.0f);
+
+        u32 pixel = pixel_from_normal(normalise(n));
+        memcpy(src + i * 4, &pixel, 4);
+    }
+
+    for (i32 f = 0; f < 2; f++) {
+        MipFilter filter = f == 0 ? MipFilter_box : MipFilter_kaiser;
+
+        u32 levels = mip_level_count(8, 8);
+        u8 *chain = alloc_array(&a, u8, mip_chain_size(8, 8, levels));
+        memcpy(chain, src, sizeof src);
+
+        generate_mip_chain(chain, 8, 8, levels, filter, false, true, &a);
+
+        i32 not_unit = 0;
+        isize pixels = mip_chain_size(8, 8, levels) / 4;
+        for (isize i = 8 * 8; i < pixels; i++) {
+            f32 l = length(normal_from_pixel(chain + i * 4));
+            not_unit += fabsf(l - 1.0f) > 0.015f;
+        }
+        CHECK(result, not_unit == 0);
+
+        dealloc(&a, chain);
+    }
+
+    return result;
+}
+
+bool test_image()
+{
+    TEST_START("image");
+    bool result = true;
+    result = test_bgra_from_bgr() && result;
+    result = test_mip_sizes() && result;
+    result = test_generate_mip_filters() && result;
+    result = test_generate_mip_normals() && result;
+    return result;
+}
@@ -0,0 +1,560 @@
+/**
+ * file:    test_mesh_optimize.cpp
+ * created: 2018-09-29
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+int cmp_triangle(const void *lhs, const void *rhs)
+{
+    return memcmp(lhs, rhs, 3 * sizeof(u32));
+}
+
+// NOTE(jesper): rotates the triangle so that its smallest index comes first,
+// which keeps the winding, so that triangles can be compared after reordering
+void canonical_triangles(u32 *dst, u32 *indices, i32 index_count)
+{
+    for (i32 i = 0; i < index_count; i += 3) {
+        i32 first = 0;
+        for (i32 j = 1; j < 3; j++) {
+            if (indices[i+j] < indices[i+first]) {
+                first = j;
+            }
+        }
+
+        for (i32 j = 0; j < 3; j++) {
+            dst[i+j] = indices[i + (first + j) % 3];
+        }
+    }
+
+    qsort(dst, (usize)(index_count / 3), 3 * sizeof(u32), cmp_triangle);
+}
+
+// NOTE(jesper): a closed uv sphere of radius 1 with counter-clockwise
+// outward facing triangles and a single vertex at each pole
+void create_unit_sphere(
+    Array<Vector3> *points,
+    Array<u32> *indices,
+    i32 rings, i32 segments)
+{
+    array_add(points, Vector3{ 0.0f, 1.0f, 0.0f });
+    for (i32 r = 1; r < rings; r++) {
+        f32 theta = (f32)M_PI * r / rings;
+        for (i32 s = 0; s < segments; s++) {
+            f32 phi = 2.0f * (f32)M_PI * s / segments;
+            array_add(points, Vector3{
+                sinf(theta) * cosf(phi),
+                cosf(theta),
+                -sinf(theta) * sinf(phi) });
+        }
+    }
+    array_add(points, Vector3{ 0.0f, -1.0f, 0.0f });
+
+    u32 bottom = (u32)points->count - 1;
+    auto ring_vertex = [segments](i32 r, i32 s) -> u32
+    {
+        return (u32)(1 + r * segments + s % segments);
+    };
+
+    for (i32 s = 0; s < segments; s++) {
+        array_add(indices, 0u);
+        array_add(indices, ring_vertex(0, s));
+        array_add(indices, ring_vertex(0, s+1));
+    }
+
+    for (i32 r = 0; r < rings - 2; r++) {
+        for (i32 s = 0; s < segments; s++) {
+            u32 v0 = ring_vertex(r, s);
+            u32 v1 = ring_vertex(r, s+1);
+            u32 v2 = ring_vertex(r+1, s);
+            u32 v3 = ring_vertex(r+1, s+1);
+
+            array_add(indices, v0);
+            array_add(indices, v2);
+            array_add(indices, v3);
+
+            array_add(indices, v0);
+            array_add(indices, v3);
+            array_add(indices, v1);
+        }
+    }
+
+    for (i32 s = 0; s < segments; s++) {
+        array_add(indices, ring_vertex(rings-2, s));
+        array_add(indices, bottom);
+        array_add(indices, ring_vertex(rings-2, s+1));
+    }
+}
+
+bool test_optimize_overdraw()
+{
+    TEST_START("mesh_optimize::overdraw");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    Array<Vector3> points  = create_array<Vector3>(&a);
+    Array<u32>     indices = create_array<u32>(&a);
+    defer {
+        destroy_array(&indices);
+        destroy_array(&points);
+    };
+
+    create_unit_sphere(&points, &indices, 32, 64);
+
+    i32 index_count  = indices.count;
+    i32 vertex_count = points.count;
+    CHECK(result, index_count > 0 && index_count % 3 == 0);
+
+    optimize_vertex_cache(indices.data, index_count, vertex_count, &a);
+
+    u32 *before = alloc_array(&a, u32, index_count);
+    u32 *after  = alloc_array(&a, u32, index_count);
+    defer {
+        dealloc(&a, after);
+        dealloc(&a, before);
+    };
+
+    canonical_triangles(before, indices.data, index_count);
+
+    f32 acmr_before = compute_acmr(
+        indices.data, index_count,
+        vertex_count,
+        VERTEX_CACHE_FIFO_SIZE,
+        &a);
+
+    optimize_overdraw(
+        indices.data, index_count,
+        points.data, vertex_count,
+        &a);
+
+    f32 acmr_after = compute_acmr(
+        indices.data, index_count,
+        vertex_count,
+        VERTEX_CACHE_FIFO_SIZE,
+        &a);
+
+    canonical_triangles(after, indices.data, index_count);
+    CHECK(result, memcmp(before, after, index_count * sizeof(u32)) == 0);
+    CHECK(result, acmr_after <= acmr_before + 3.0f / (index_count / 3));
+
+    return result;
+}
+
+// NOTE(jesper): a flat dim x dim grid of vertices in the xy plane facing +z.
+// With a seam the vertices of the middle column are duplicated, the triangles
+// on its right use the copies.
+void create_grid(
+    Array<Vector3> *points,
+    Array<u32> *indices,
+    i32 dim,
+    bool seam)
+{
+    for (i32 y = 0; y < dim; y++) {
+        for (i32 x = 0; x < dim; x++) {
+            array_add(points, Vector3{ (f32)x, (f32)y, 0.0f });
+        }
+    }
+
+    i32 seam_x = dim / 2;
+    u32 seam_start = (u32)points->count;
+    if (seam) {
+        for (i32 y = 0; y < dim; y++) {
+            array_add(points, Vector3{ (f32)seam_x, (f32)y, 0.0f });
+        }
+    }
+
+    auto vertex = [=](i32 x, i32 y, i32 quad_x) -> u32
+    {
+        if (seam && x == seam_x && quad_x >= seam_x) {
+            return seam_start + (u32)y;
+        }
+        return (u32)(y * dim + x);
+    };
+
+    for (i32 y = 0; y < dim - 1; y++) {
+        for (i32 x = 0; x < dim - 1; x++) {
+            u32 v0 = vertex(x,     y,     x);
+            u32 v1 = vertex(x + 1, y,     x);
+            u32 v2 = vertex(x,     y + 1, x);
+            u32 v3 = vertex(x + 1, y + 1, x);
+
+            array_add(indices, v0);
+            array_add(indices, v1);
+            array_add(indices, v3);
+
+            array_add(indices, v0);
+            array_add(indices, v3);
+            array_add(indices, v2);
+        }
+    }
+}
+
+bool valid_triangles(u32 *indices, i32 index_count, i32 vertex_count)
+{
+    for (i32 i = 0; i < index_count; i += 3) {
+        u32 a = indices[i + 0];
+        u32 b = indices[i + 1];
+        u32 c = indices[i + 2];
+
+        if (a >= (u32)vertex_count || b >= (u32)vertex_count || c >= (u32)vertex_count) {
+            return false;
+        }
+
+        if (a == b || a == c || b == c) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool test_simplify_sphere()
+{
+    TEST_START("mesh_optimize::simplify_sphere");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    Array<Vector3> points  = create_array<Vector3>(&a);
+    Array<u32>     indices = create_array<u32>(&a);
+    defer {
+        destroy_array(&indices);
+        destroy_array(&points);
+    };
+
+    create_unit_sphere(&points, &indices, 32, 64);
+
+    i32 index_count = indices.count;
+    u32 *dst = alloc_array(&a, u32, index_count);
+    defer { dealloc(&a, dst); };
+
+    f32 error = -1.0f;
+    i32 target = (index_count / 4) / 3 * 3;
+    i32 count = simplify_mesh(
+        dst,
+        indices.data, index_count,
+        points.data, points.count,
+        target,
+        &error,
+        &a);
+
+    CHECK(result, count > 0 && count <= target);
+    CHECK(result, count % 3 == 0);
+    CHECK(result, valid_triangles(dst, count, points.count));
+    CHECK(result, error > 0.0f && error < 0.1f);
+
+    // NOTE(jesper): the sphere is convex and centred on the origin, so every
+    // triangle that didn't flip still faces away from it. Slivers at the poles
+    // can end up edge on to it, which isn't a flip.
+    i32 flipped = 0;
+    for (i32 i = 0; i < count; i += 3) {
+        Vector3 p0 = points[(i32)dst[i + 0]];
+        Vector3 p1 = points[(i32)dst[i + 1]];
+        Vector3 p2 = points[(i32)dst[i + 2]];
+
+        Vector3 n = cross(p1 - p0, p2 - p0);
+        flipped += dot(n, p0 + p1 + p2) < 0.0f;
+    }
+    CHECK(result, flipped == 0);
+
+    // NOTE(jesper): nothing to do when the mesh is already below the target
+    error = -1.0f;
+    count = simplify_mesh(
+        dst,
+        indices.data, index_count,
+        points.data, points.count,
+        index_count,
+        &error,
+        &a);
+
+    CHECK(result, count == index_count);
+    CHECK(result, error == 0.0f);
+    CHECK(result, memcmp(dst, indices.data, index_count * sizeof(u32)) == 0);
+
+    return result;
+}
+
+bool test_simplify_borders()
+{
+    TEST_START("mesh_optimize::simplify_borders");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    Array<Vector3> points  = create_array<Vector3>(&a);
+    Array<u32>     indices = create_array<u32>(&a);
+    defer {
+        destroy_array(&indices);
+        destroy_array(&points);
+    };
+
+    i32 dim = 16;
+    create_grid(&points, &indices, dim, true);
+
+    i32 index_count = indices.count;
+    u32 *dst = alloc_array(&a, u32, index_count);
+    defer { dealloc(&a, dst); };
+
+    f32 error = -1.0f;
+    i32 count = simplify_mesh(
+        dst,
+        indices.data, index_count,
+        points.data, points.count,
+        0,
+        &error,
+        &a);
+
+    CHECK(result, count > 0 && count < index_count);
+    CHECK(result, valid_triangles(dst, count, points.count));
+
+    // NOTE(jesper): the grid is flat, so collapsing the interior is free
+    CHECK(result, error >= 0.0f && error < 1e-3f);
+
+    bool *referenced = alloc_array(&a, bool, points.count);
+    defer { dealloc(&a, referenced); };
+
+    memset(referenced, 0, points.count * sizeof(bool));
+    for (i32 i = 0; i < count; i++) {
+        referenced[dst[i]] = true;
+    }
+
+    // NOTE(jesper): vertices on the open border and on both sides of the seam
+    // are never collapsed, so they're all still referenced
+    i32 missing = 0;
+    for (i32 i = 0; i < dim; i++) {
+        missing += !referenced[i];
+        missing += !referenced[(dim - 1) * dim + i];
+        missing += !referenced[i * dim];
+        missing += !referenced[i * dim + dim - 1];
+        missing += !referenced[i * dim + dim / 2];
+        missing += !referenced[dim * dim + i];
+    }
+    CHECK(result, missing == 0);
+
+    // NOTE(jesper): the seam copies are only used right of the seam
+    i32 crossing = 0;
+    for (i32 i = 0; i < count; i += 3) {
+        bool copy  = false;
+        bool left  = false;
+        for (i32 j = 0; j < 3; j++) {
+            u32 v = dst[i + j];
+            copy = copy || v >= (u32)(dim * dim);
+            left = left || (v < (u32)(dim * dim) && points[(i32)v].x < (f32)(dim / 2));
+        }
+        crossing += copy && left;
+    }
+    CHECK(result, crossing == 0);
+
+    i32 flipped = 0;
+    for (i32 i = 0; i < count; i += 3) {
+        Vector3 p0 = points[(i32)dst[i + 0]];
+        Vector3 p1 = points[(i32)dst[i + 1]];
+        Vector3 p2 = points[(i32)dst[i + 2]];
+        flipped += cross(p1 - p0, p2 - p0).z <= 0.0f;
+    }
+    CHECK(result, flipped == 0);
+
+    return result;
+}
+
+f32 f32_from_f16(u16 h)
+{
+    f32 sign     = (h & 0x8000) ? -1.0f : 1.0f;
+    i32 exponent = (h >> 10) & 0x1F;
+    i32 mantissa = h & 0x3FF;
+
+    if (exponent == 0) {
+        return sign * ldexpf((f32)mantissa, -24);
+    }
+
+    if (exponent == 31) {
+        return mantissa == 0 ? sign * INFINITY : NAN;
+    }
+
+    return sign * ldexpf((f32)(mantissa | 0x400), exponent - 25);
+}
+
+bool test_f16_from_f32()
+{
+    TEST_START("mesh_optimize::f16_from_f32");
+    bool result = true;
+
+    // NOTE(jesper): every finite half survives the round trip, the value
+    // half way to the next one rounds to the even one of the two and anything
+    // past it rounds up
+    i32 round_trip = 0;
+    i32 ties       = 0;
+    i32 above      = 0;
+    for (u32 h = 0; h < 0x7C00; h++) {
+        for (u32 sign = 0; sign <= 0x8000; sign += 0x8000) {
+            u16 expected = (u16)(sign | h);
+            round_trip += f16_from_f32(f32_from_f16(expected)) != expected;
+        }
+
+        f32 lo  = f32_from_f16((u16)h);
+        f32 hi  = f32_from_f16((u16)(h + 1));
+        f32 mid = (f32)(((f64)lo + (f64)hi) * 0.5);
+
+        u16 even = (u16)((h & 1) ? h + 1 : h);
+        ties  += f16_from_f32(mid) != even;
+        ties  += f16_from_f32(-mid) != (u16)(0x8000 | even);
+        above += f16_from_f32(nextafterf(mid, INFINITY)) != (u16)(h + 1);
+    }
+
+    CHECK(result, round_trip == 0);
+    CHECK(result, ties == 0);
+    CHECK(result, above == 0);
+
+    CHECK(result, f16_from_f32(65504.0f) == 0x7BFF);
+    CHECK(result, f16_from_f32(65519.0f) == 0x7BFF);
+    CHECK(result, f16_from_f32(65520.0f) == 0x7C00);
+    CHECK(result, f16_from_f32(1e10f) == 0x7C00);
+    CHECK(result, f16_from_f32(-INFINITY) == 0xFC00);
+    CHECK(result, (f16_from_f32(NAN) & 0x7FFF) > 0x7C00);
+
+    // NOTE(jesper): half the smallest denormal is a tie with zero
+    CHECK(result, f16_from_f32(ldexpf(1.0f, -25)) == 0x0000);
+    CHECK(result, f16_from_f32(nextafterf(ldexpf(1.0f, -25), 1.0f)) == 0x0001);
+    CHECK(result, f16_from_f32(ldexpf(1.0f, -40)) == 0x0000);
+    CHECK(result, f16_from_f32(-ldexpf(1.0f, -40)) == 0x8000);
+
+    return result;
+}
+
+// NOTE(jesper): mirrors the tangent frame decode in mesh.glsl
+void unpack_tangent_frame(
+    u32 packed, bool flipped,
+    Vector3 *normal, Vector3 *tangent, Vector3 *bitangent)
+{
+    f32 c[3];
+    f32 c_sq = 0.0f;
+    for (i32 i = 0; i < 3; i++) {
+        f32 unorm = (f32)((packed >> (10 * i)) & 0x3FF) / 1023.0f;
+        c[i] = (unorm * 2.0f - 1.0f) * QUATERNION_COMPONENT_MAX;
+        c_sq += c[i] * c[i];
+    }
+
+    f32 l = sqrtf(c_sq < 1.0f ? 1.0f - c_sq : 0.0f);
+
+    i32 largest = (i32)(packed >> 30);
+    f32 q[4];
+    for (i32 i = 0, j = 0; i < 4; i++) {
+        q[i] = i == largest ? l : c[j++];
+    }
+
+    Vector3 qv = { q[0], q[1], q[2] };
+    auto rotate = [qv, q](Vector3 v) -> Vector3
+    {
+        return v + 2.0f * cross(qv, cross(qv, v) + q[3] * v);
+    };
+
+    *tangent   = rotate(Vector3{ 1.0f, 0.0f, 0.0f });
+    *bitangent = rotate(Vector3{ 0.0f, 1.0f, 0.0f }) * (flipped ? -1.0f : 1.0f);
+    *normal    = rotate(Vector3{ 0.0f, 0.0f, 1.0f });
+}
+
+bool test_pack_tangent_frame()
+{
+    TEST_START("mesh_optimize::pack_tangent_frame");
+    bool result = true;
+
+    // NOTE(jesper): 10 bits per component of the smallest three is good for
+    // about a third of a degree
+    f32 min_cos = cosf(0.5f * (f32)M_PI / 180.0f);
+
+    u64 state = 0x2545F4914F6CDD1Dull;
+    auto random_unit = [&state]() -> Vector3
+    {
+        for (;;) {
+            Vector3 v;
+            for (i32 i = 0; i < 3; i++) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                v.data[i] = (f32)(state >> 40) / (f32)(1 << 23) - 1.0f;
+            }
+
+            f32 l = length(v);
+            if (l > 0.1f && l <= 1.0f) {
+                return v / l;
+            }
+        }
+    };
+
+    // NOTE(jesper): the axis aligned frames hit every branch of the matrix to
+    // quaternion conversion, the random ones every choice of largest component
+    Vector3 axes[] = {
+        { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f },
+        { -1.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, -1.0f },
+    };
+
+    i32 errors    = 0;
+    i32 handedness = 0;
+    i32 largest[4] = {};
+    for (i32 i = 0; i < 10000 + 36; i++) {
+        Vector3 n, t;
+        if (i < 36) {
+            n = axes[i / 6];
+            t = axes[i % 6];
+            if (dot(n, t) != 0.0f) {
+                continue;
+            }
+        } else {
+            n = random_unit();
+            t = normalise(cross(n, random_unit()));
+        }
+
+        bool mirrored = (i & 1) != 0;
+        Vector3 b = cross(n, t) * (mirrored ? -1.0f : 1.0f);
+
+        bool flipped = false;
+        u32 packed = pack_tangent_frame(n, t, b, &flipped);
+        largest[packed >> 30]++;
+
+        Vector3 dn, dt, db;
+        unpack_tangent_frame(packed, flipped, &dn, &dt, &db);
+
+        handedness += flipped != mirrored;
+        errors += dot(dn, n) < min_cos;
+        errors += dot(dt, t) < min_cos;
+        errors += dot(db, b) < min_cos;
+    }
+
+    CHECK(result, errors == 0);
+    CHECK(result, handedness == 0);
+    CHECK(result, largest[0] > 0 && largest[1] > 0 && largest[2] > 0 && largest[3] > 0);
+
+    // NOTE(jesper): the tangent is made orthogonal to the normal, and replaced
+    // by an arbitrary one if it's parallel to it
+    Vector3 n = normalise(Vector3{ 0.3f, 0.4f, 0.8f });
+    Vector3 skewed = normalise(Vector3{ 1.0f, 0.0f, 0.5f });
+
+    bool flipped = true;
+    Vector3 dn, dt, db;
+    unpack_tangent_frame(pack_tangent_frame(n, skewed, cross(n, skewed), &flipped), flipped, &dn, &dt, &db);
+
+    Vector3 expected = normalise(skewed - n * dot(n, skewed));
+    CHECK(result, !flipped);
+    CHECK(result, dot(dn, n) >= min_cos);
+    CHECK(result, dot(dt, expected) >= min_cos);
+
+    unpack_tangent_frame(pack_tangent_frame(n, n, Vector3{}, &flipped), flipped, &dn, &dt, &db);
+    CHECK(result, dot(dn, n) >= min_cos);
+    CHECK(result, fabsf(dot(dt, n)) < 0.01f);
+
+    return result;
+}
+
+bool test_mesh_optimize()
+{
+    TEST_START("mesh_optimize");
+    bool result = true;
+    result = test_optimize_overdraw() && result;
+    result = test_simplify_sphere() && result;
+    result = test_simplify_borders() && result;
+    result = test_f16_from_f32() && result;
+    result = test_pack_tangent_frame() && result;
+    return result;
+}
@@ -0,0 +1,328 @@
+/**
+ * file:    test_obj.cpp
+ * created: 2018-09-30
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+ObjMesh parse_obj_string(const char *str, Allocator *a)
+{
+    return parse_obj(str, strlen(str), a, a);
+}
+
+void destroy_obj_mesh(ObjMesh *mesh)
+{
+    destroy_array(&mesh->indices);
+    destroy_array(&mesh->uvs);
+    destroy_array(&mesh->normals);
+    destroy_array(&mesh->points);
+}
+
+bool equal(Vector3 lhs, Vector3 rhs)
+{
+    return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z;
+}
+
+bool equal(Vector2 lhs, Vector2 rhs)
+{
+    return lhs.x == rhs.x && lhs.y == rhs.y;
+}
+
+bool test_obj_positions()
+{
+    TEST_START("obj::positions");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    // NOTE(jesper): comments, blank lines, CRLF and leading whitespace are
+    // skipped, exponents and signs are scanned
+    const char *src =
+        "# quad\r\n"
+        "\r\n"
+        "v 0 0 0\r\n"
+        "  v 1.5 0 -0.0\r\n"
+        "v 1.5 2e-1 +0\r\n"
+        "v 0 0.2 0 # trailing comment\r\n"
+        "f 1 2 3\r\n"
+        "f 1 3 4\r\n";
+
+    ObjMesh mesh = parse_obj_string(src, &a);
+    defer { destroy_obj_mesh(&mesh); };
+
+    CHECK(result, mesh.points.count == 4);
+    CHECK(result, mesh.normals.count == 0);
+    CHECK(result, mesh.uvs.count == 0);
+    CHECK(result, mesh.indices.count == 6);
+    if (!result) {
+        return result;
+    }
+
+    CHECK(result, equal(mesh.points[0], Vector3{ 0.0f, 0.0f, 0.0f }));
+    CHECK(result, equal(mesh.points[1], Vector3{ 1.5f, 0.0f, 0.0f }));
+    CHECK(result, equal(mesh.points[2], Vector3{ 1.5f, 0.2f, 0.0f }));
+    CHECK(result, equal(mesh.points[3], Vector3{ 0.0f, 0.2f, 0.0f }));
+
+    u32 expected[] = { 0, 1, 2, 0, 2, 3 };
+    CHECK(result, memcmp(mesh.indices.data, expected, sizeof expected) == 0);
+
+    return result;
+}
+
+bool test_obj_faces()
+{
+    TEST_START("obj::faces");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    // NOTE(jesper): polygons are fanned around their first corner, negative
+    // indices are relative to the end of the vertices read so far
+    const char *src =
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "v 0 1 0\n"
+        "v 0 2 0\n"
+        "f 1 2 3 4 5\n"
+        "f -5 -3 -1\n";
+
+    ObjMesh mesh = parse_obj_string(src, &a);
+    defer { destroy_obj_mesh(&mesh); };
+
+    CHECK(result, mesh.points.count == 5);
+    CHECK(result, mesh.indices.count == 12);
+    if (!result) {
+        return result;
+    }
+
+    u32 expected[] = { 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 2, 4 };
+    CHECK(result, memcmp(mesh.indices.data, expected, sizeof expected) == 0);
+
+    return result;
+}
+
+bool test_obj_invalid_face()
+{
+    TEST_START("obj::invalid_face");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    // NOTE(jesper): the face is cut off at the first out of range index, the
+    // corners before it are still welded
+    const char *src =
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "f 1 2 4\n"
+        "f 1 2 3 0\n";
+
+    ObjMesh mesh = parse_obj_string(src, &a);
+    defer { destroy_obj_mesh(&mesh); };
+
+    CHECK(result, mesh.points.count == 3);
+    CHECK(result, mesh.indices.count == 3);
+    if (mesh.indices.count == 3) {
+        u32 expected[] = { 0, 1, 2 };
+        CHECK(result, memcmp(mesh.indices.data, expected, sizeof expected) == 0);
+    }
+
+    return result;
+}
+
+bool test_obj_seams()
+{
+    TEST_START("obj::seams");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    // NOTE(jesper): the corners at position 1 and 3 are shared by both
+    // triangles with the same uv and normal, position 2 is split by a uv seam
+    const char *src =
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "v 0 1 0\n"
+        "vt 0 0\n"
+        "vt 0.5 0\n"
+        "vt 0.5 0.5\n"
+        "vt 0 0.5\n"
+        "vn 0 0 1\n"
+        "f 1/1/1 2/2/1 3/3/1\n"
+        "f 1/1/1 3/3/1 4/4/1\n"
+        "f 1/1/1 4/4/1 2/3/1\n";
+
+    ObjMesh mesh = parse_obj_string(src, &a);
+    defer { destroy_obj_mesh(&mesh); };
+
+    CHECK(result, mesh.points.count == 5);
+    CHECK(result, mesh.normals.count == mesh.points.count);
+    CHECK(result, mesh.uvs.count == mesh.points.count);
+    CHECK(result, mesh.indices.count == 9);
+    if (!result) {
+        return result;
+    }
+
+    u32 expected[] = { 0, 1, 2, 0, 2, 3, 0, 3, 4 };
+    CHECK(result, memcmp(mesh.indices.data, expected, sizeof expected) == 0);
+
+    CHECK(result, equal(mesh.points[4], mesh.points[1]));
+    CHECK(result, !equal(mesh.uvs[4], mesh.uvs[1]));
+
+    // NOTE(jesper): the importer still doubles the uvs, see parse_obj
+    CHECK(result, equal(mesh.uvs[1], Vector2{ 1.0f, 0.0f }));
+    CHECK(result, equal(mesh.uvs[4], Vector2{ 1.0f, 1.0f }));
+
+    for (i32 i = 0; i < mesh.normals.count; i++) {
+        CHECK(result, equal(mesh.normals[i], Vector3{ 0.0f, 0.0f, 1.0f }));
+    }
+
+    return result;
+}
+
+bool test_obj_weld_grow()
+{
+    TEST_START("obj::weld_grow");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    // NOTE(jesper): a grid with enough vertices to grow the weld table a few
+    // times, every vertex is referenced by up to 6 triangles
+    i32 dim = 64;
+
+    Array<char> src = create_array<char>(&a);
+    defer { destroy_array(&src); };
+
+    char line[128];
+    for (i32 y = 0; y < dim; y++) {
+        for (i32 x = 0; x < dim; x++) {
+            i32 length = snprintf(line, sizeof line, "v %d %d 0\n", x, y);
+            for (i32 i = 0; i < length; i++) {
+                array_add(&src, line[i]);
+            }
+        }
+    }
+
+    for (i32 y = 0; y < dim - 1; y++) {
+        for (i32 x = 0; x < dim - 1; x++) {
+            i32 v0 = y * dim + x + 1;
+            i32 v1 = v0 + 1;
+            i32 v2 = v0 + dim;
+            i32 v3 = v2 + 1;
+
+            i32 length = snprintf(
+                line, sizeof line,
+                "f %d %d %d\nf %d %d %d\n",
+                v0, v1, v3, v0, v3, v2);
+            for (i32 i = 0; i < length; i++) {
+                array_add(&src, line[i]);
+            }
+        }
+    }
+
+    ObjMesh mesh = parse_obj(src.data, (usize)src.count, &a, &a);
+    defer { destroy_obj_mesh(&mesh); };
+
+    CHECK(result, dim * dim > OBJ_WELD_INITIAL_SIZE);
+    CHECK(result, mesh.points.count == dim * dim);
+    CHECK(result, mesh.indices.count == (dim - 1) * (dim - 1) * 6);
+    if (!result) {
+        return result;
+    }
+
+    // NOTE(jesper): the vertices are welded in the order the faces first
+    // reference them, not the order they're declared in. Every corner is
+    // checked against the position its face referenced.
+    bool corners_match = true;
+
+    i32 index = 0;
+    for (i32 y = 0; y < dim - 1; y++) {
+        for (i32 x = 0; x < dim - 1; x++) {
+            Vector3 p0 = { (f32)x,     (f32)y,     0.0f };
+            Vector3 p1 = { (f32)x + 1, (f32)y,     0.0f };
+            Vector3 p2 = { (f32)x,     (f32)y + 1, 0.0f };
+            Vector3 p3 = { (f32)x + 1, (f32)y + 1, 0.0f };
+
+            Vector3 corners[] = { p0, p1, p3, p0, p3, p2 };
+            for (Vector3 c : corners) {
+                u32 i = mesh.indices[index++];
+                corners_match = corners_match &&
+                    i < (u32)mesh.points.count &&
+                    equal(mesh.points[(i32)i], c);
+            }
+        }
+    }
+
+    CHECK(result, corners_match);
+    return result;
+}
+
+bool test_scan_f32()
+{
+    TEST_START("obj::scan_f32");
+    bool result = true;
+
+    // NOTE(jesper): scan_f32 is exact for up to 15 significant digits and
+    // decimal exponents the f64 powers of ten cover, so it has to agree with
+    // strtod rounded to f32
+    const char *fixed[] = {
+        "0", "-0", "+1", "1.", ".5", "-.5", "3.14159", "1e10", "1E-10",
+        "2.5e+3", "0.000123456789", "123456789012345", "7.0e-22", "9e22",
+        "340282346638528859811704183484516925440",
+    };
+
+    i32 mismatches = 0;
+    for (const char *str : fixed) {
+        const char *at = str;
+        f32 value = scan_f32(&at, str + strlen(str));
+        mismatches += value != (f32)strtod(str, nullptr) || *at != '\0';
+    }
+    CHECK(result, mismatches == 0);
+
+    u64 state = 0x9E3779B97F4A7C15ull;
+    auto next = [&state]() -> u64
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+
+    mismatches = 0;
+    char str[64];
+    for (i32 i = 0; i < 100000; i++) {
+        u64 mantissa = next() % 1000000000000000ull;
+        i32 exponent = (i32)(next() % 45) - 22;
+        i32 length = snprintf(str, sizeof str, "%" PRIu64 "e%d", mantissa, exponent);
+
+        const char *at = str;
+        f32 value = scan_f32(&at, str + length);
+        mismatches += value != (f32)strtod(str, nullptr) || at != str + length;
+    }
+    CHECK(result, mismatches == 0);
+
+    // NOTE(jesper): an exponent marker without digits isn't part of the number
+    const char *partial = "1.5e+x";
+    const char *at = partial;
+    f32 value = scan_f32(&at, partial + strlen(partial));
+    CHECK(result, value == 1.5f && at == partial + 3);
+
+    return result;
+}
+
+bool test_obj()
+{
+    TEST_START("obj");
+    bool result = true;
+    result = test_obj_positions() && result;
+    result = test_obj_faces() && result;
+    result = test_obj_invalid_face() && result;
+    result = test_obj_seams() && result;
+    result = test_obj_weld_grow() && result;
+    result = test_scan_f32() && result;
+    return result;
+}
@@ -0,0 +1,366 @@
+/**
+ * file:    test_texture_compress.cpp
+ * created: 2018-09-30
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): reference decoders written from the BC1 and BC4 block layouts
+// rather than from the encoders. The interpolated BC1 colours are rounded down
+// like the encoder's palette, the BC4 values to nearest. GPUs are allowed to be
+// off by one from either.
+void decode_bc1_block(u8 *dst, u8 *block)
+{
+    u16 c0, c1;
+    u32 indices;
+    memcpy(&c0, block + 0, sizeof c0);
+    memcpy(&c1, block + 2, sizeof c1);
+    memcpy(&indices, block + 4, sizeof indices);
+
+    u8 palette[4][4];
+    for (i32 i = 0; i < 2; i++) {
+        u16 c = i == 0 ? c0 : c1;
+        u32 r = (c >> 11) & 0x1F;
+        u32 g = (c >> 5) & 0x3F;
+        u32 b = c & 0x1F;
+
+        palette[i][0] = (u8)((b << 3) | (b >> 2));
+        palette[i][1] = (u8)((g << 2) | (g >> 4));
+        palette[i][2] = (u8)((r << 3) | (r >> 2));
+        palette[i][3] = 255;
+    }
+
+    for (i32 i = 0; i < 3; i++) {
+        if (c0 > c1) {
+            palette[2][i] = (u8)((2 * palette[0][i] + palette[1][i]) / 3);
+            palette[3][i] = (u8)((palette[0][i] + 2 * palette[1][i]) / 3);
+        } else {
+            palette[2][i] = (u8)((palette[0][i] + palette[1][i]) / 2);
+            palette[3][i] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = c0 > c1 ? 255 : 0;
+
+    for (i32 i = 0; i < 16; i++) {
+        memcpy(dst + i * 4, palette[(indices >> (i * 2)) & 0x3], 4);
+    }
+}
+
+void decode_bc4_block(u8 *dst, u8 *block, i32 channel)
+{
+    u8 a0 = block[0];
+    u8 a1 = block[1];
+
+    u8 values[8];
+    values[0] = a0;
+    values[1] = a1;
+    for (i32 i = 2; i < 8; i++) {
+        if (a0 > a1) {
+            values[i] = (u8)(((8 - i) * a0 + (i - 1) * a1 + 3) / 7);
+        } else if (i < 6) {
+            values[i] = (u8)(((6 - i) * a0 + (i - 1) * a1 + 2) / 5);
+        } else {
+            values[i] = i == 6 ? 0 : 255;
+        }
+    }
+
+    u64 indices = 0;
+    for (i32 i = 0; i < 6; i++) {
+        indices |= (u64)block[2 + i] << (i * 8);
+    }
+
+    for (i32 i = 0; i < 16; i++) {
+        dst[i * 4 + channel] = values[(indices >> (i * 3)) & 0x7];
+    }
+}
+
+struct BlockRandom {
+    u64 state;
+};
+
+u8 next_u8(BlockRandom *r)
+{
+    r->state ^= r->state << 13;
+    r->state ^= r->state >> 7;
+    r->state ^= r->state << 17;
+    return (u8)(r->state >> 32);
+}
+
+// NOTE(jesper): the kinds of block the encoders have to handle, flat,
+// gradients along the bounding box diagonal and against it, two colours, and
+// noise
+void create_test_block(u8 *block, i32 kind, BlockRandom *r)
+{
+    u8 base[4], other[4];
+    for (i32 i = 0; i < 4; i++) {
+        base[i]  = next_u8(r);
+        other[i] = next_u8(r);
+    }
+
+    for (i32 i = 0; i < 16; i++) {
+        u8 *p = block + i * 4;
+        f32 t = (f32)((i % 4) + (i / 4)) / 6.0f;
+
+        switch (kind) {
+        case 0:
+            memcpy(p, base, 4);
+            break;
+        case 1:
+            for (i32 j = 0; j < 4; j++) {
+                p[j] = (u8)(base[j] + (other[j] - base[j]) * t + 0.5f);
+            }
+            break;
+        case 2:
+            p[0] = (u8)(255.0f * t + 0.5f);
+            p[1] = (u8)(255.0f * (1.0f - t) + 0.5f);
+            p[2] = (u8)(128.0f * t + 0.5f);
+            p[3] = (u8)(255.0f * t + 0.5f);
+            break;
+        case 3:
+            memcpy(p, (i * 7) % 3 == 0 ? base : other, 4);
+            break;
+        default:
+            for (i32 j = 0; j < 4; j++) {
+                p[j] = next_u8(r);
+            }
+            break;
+        }
+    }
+}
+
+i32 rgb_distance_sq(u8 *a, u8 *b)
+{
+    i32 d = 0;
+    for (i32 i = 0; i < 3; i++) {
+        d += (a[i] - b[i]) * (a[i] - b[i]);
+    }
+    return d;
+}
+
+bool test_bc1()
+{
+    TEST_START("texture_compress::bc1");
+    bool result = true;
+
+    BlockRandom r = { 0x9E3779B97F4A7C15ull };
+
+    i32 three_colour = 0;
+    i32 not_nearest  = 0;
+    i32 too_far      = 0;
+
+    for (i32 n = 0; n < 5000; n++) {
+        i32 kind = n % 5;
+
+        u8 src[64];
+        create_test_block(src, kind, &r);
+
+        u8 block[8];
+        encode_bc1_block(block, src);
+
+        u16 c0, c1;
+        memcpy(&c0, block + 0, sizeof c0);
+        memcpy(&c1, block + 2, sizeof c1);
+
+        // NOTE(jesper): the 3 colour mode would make index 3 black
+        u32 indices;
+        memcpy(&indices, block + 4, sizeof indices);
+        three_colour += c0 < c1 || (c0 == c1 && indices != 0);
+
+        u8 decoded[64];
+        decode_bc1_block(decoded, block);
+
+        // NOTE(jesper): every pixel has to use the closest of the 4 colours
+        u8 palette[4][64];
+        for (i32 i = 0; i < 4; i++) {
+            u8 single[8];
+            memcpy(single, block, 4);
+            u32 all = 0x55555555u * (u32)i;
+            memcpy(single + 4, &all, sizeof all);
+            decode_bc1_block(palette[i], single);
+        }
+
+        i32 range[3] = {};
+        for (i32 j = 0; j < 3; j++) {
+            i32 min = 255, max = 0;
+            for (i32 i = 0; i < 16; i++) {
+                min = src[i * 4 + j] < min ? src[i * 4 + j] : min;
+                max = src[i * 4 + j] > max ? src[i * 4 + j] : max;
+            }
+            range[j] = max - min;
+        }
+
+        for (i32 i = 0; i < 16; i++) {
+            i32 d = rgb_distance_sq(decoded + i * 4, src + i * 4);
+            for (i32 j = 0; j < (c0 != c1 ? 4 : 1); j++) {
+                not_nearest += rgb_distance_sq(palette[j] + i * 4, src + i * 4) < d;
+            }
+
+            // NOTE(jesper): for the blocks along a line, the 4 colours of the
+            // inset endpoints are spaced 7/24 of the range apart, plus the 565
+            // quantisation of the endpoints
+            if (kind <= 2) {
+                for (i32 j = 0; j < 3; j++) {
+                    i32 e = abs(decoded[i * 4 + j] - src[i * 4 + j]);
+                    too_far += e * 48 > range[j] * 7 + 8 * 48;
+                }
+            }
+        }
+    }
+
+    CHECK(result, three_colour == 0);
+    CHECK(result, not_nearest == 0);
+    CHECK(result, too_far == 0);
+
+    return result;
+}
+
+bool test_bc4()
+{
+    TEST_START("texture_compress::bc4");
+    bool result = true;
+
+    BlockRandom r = { 0x2545F4914F6CDD1Dull };
+
+    i32 endpoints   = 0;
+    i32 not_nearest = 0;
+    i32 flat        = 0;
+
+    for (i32 n = 0; n < 5000; n++) {
+        i32 kind = n % 5;
+
+        u8 src[64];
+        create_test_block(src, kind, &r);
+
+        u8 block[16];
+        encode_bc5_block(block, src);
+
+        for (i32 c = 0; c < 2; c++) {
+            u8 *b = block + c * 8;
+            i32 channel = c == 0 ? 2 : 1;
+
+            u8 min = 255, max = 0;
+            for (i32 i = 0; i < 16; i++) {
+                u8 v = src[i * 4 + channel];
+                min = v < min ? v : min;
+                max = v > max ? v : max;
+            }
+            endpoints += b[0] != max || b[1] != min;
+
+            u8 decoded[64] = {};
+            decode_bc4_block(decoded, b, channel);
+
+            // NOTE(jesper): the nearest of the 8 values is at most range/14
+            // away, plus the rounding of the interpolated values
+            i32 range = max - min;
+            for (i32 i = 0; i < 16; i++) {
+                i32 e = abs(decoded[i * 4 + channel] - src[i * 4 + channel]);
+                not_nearest += e * 14 > range + 14;
+            }
+
+            if (kind == 0) {
+                flat += memcmp(b + 2, "\0\0\0\0\0\0", 6) != 0;
+            }
+        }
+    }
+
+    CHECK(result, endpoints == 0);
+    CHECK(result, not_nearest == 0);
+    CHECK(result, flat == 0);
+
+    // NOTE(jesper): BC3 is the alpha channel as a BC4 block followed by BC1,
+    // BC5 is red then green
+    u8 src[64];
+    create_test_block(src, 4, &r);
+
+    u8 bc3[16], bc5[16], bc1[8], bc4[8];
+    encode_bc3_block(bc3, src);
+    encode_bc1_block(bc1, src);
+    encode_bc4_block(bc4, src, 3);
+    CHECK(result, memcmp(bc3, bc4, 8) == 0);
+    CHECK(result, memcmp(bc3 + 8, bc1, 8) == 0);
+
+    encode_bc5_block(bc5, src);
+    encode_bc4_block(bc4, src, 2);
+    CHECK(result, memcmp(bc5, bc4, 8) == 0);
+    encode_bc4_block(bc4, src, 1);
+    CHECK(result, memcmp(bc5 + 8, bc4, 8) == 0);
+
+    return result;
+}
+
+bool test_compress_image_bc()
+{
+    TEST_START("texture_compress::image");
+    bool result = true;
+
+    Allocator a = system_allocator();
+
+    // NOTE(jesper): the partial blocks at the right and bottom edges are padded
+    // with the last column and row, so the padding decodes to the same values
+    // as the edge pixels in the same block
+    i32 width  = 7;
+    i32 height = 6;
+
+    u8 *src = alloc_array(&a, u8, width * height * 4);
+    defer { dealloc(&a, src); };
+
+    BlockRandom r = { 0xD1B54A32D192ED03ull };
+    for (i32 i = 0; i < width * height * 4; i++) {
+        src[i] = next_u8(&r);
+    }
+
+    CHECK(result, bc_image_size(VK_FORMAT_BC1_RGB_UNORM_BLOCK, width, height) == 2 * 2 * 8);
+    CHECK(result, bc_image_size(VK_FORMAT_BC5_UNORM_BLOCK, width, height) == 2 * 2 * 16);
+    CHECK(result, bc_image_size(VK_FORMAT_B8G8R8A8_UNORM, width, height) == 0);
+
+    u8 dst[2 * 2 * 16];
+    compress_image_bc(dst, VK_FORMAT_BC5_UNORM_BLOCK, src, width, height);
+
+    i32 mismatches = 0;
+    for (i32 by = 0; by < 2; by++) {
+        for (i32 bx = 0; bx < 2; bx++) {
+            u8 *block = dst + (by * 2 + bx) * 16;
+
+            u8 decoded[64] = {};
+            decode_bc4_block(decoded, block, 2);
+            decode_bc4_block(decoded, block + 8, 1);
+
+            for (i32 y = 0; y < 4; y++) {
+                for (i32 x = 0; x < 4; x++) {
+                    i32 sx = bx * 4 + x < width  ? x : width  - 1 - bx * 4;
+                    i32 sy = by * 4 + y < height ? y : height - 1 - by * 4;
+
+                    u8 *p = decoded + (y * 4 + x) * 4;
+                    u8 *e = decoded + (sy * 4 + sx) * 4;
+                    mismatches += p[1] != e[1] || p[2] != e[2];
+                }
+            }
+
+            // NOTE(jesper): the endpoints are the extremes of the pixels the
+            // block covers
+            u8 max = 0;
+            for (i32 y = by * 4; y < by * 4 + 4 && y < height; y++) {
+                for (i32 x = bx * 4; x < bx * 4 + 4 && x < width; x++) {
+                    u8 v = src[(y * width + x) * 4 + 2];
+                    max = v > max ? v : max;
+                }
+            }
+            mismatches += block[0] != max;
+        }
+    }
+    CHECK(result, mismatches == 0);
+
+    return result;
+}
+
+bool test_texture_compress()
+{
+    TEST_START("texture_compress");
+    bool result = true;
+    result = test_bc1() && result;
+    result = test_bc4() && result;
+    result = test_compress_image_bc() && result;
+    return result;
+}
@@ -0,0 +1,252 @@
+/**
+ * file:    asset_packer.cpp
+ * created: 2018-09-20
+ * authors: Jesper Stefansson (jesper.stefansson@gmail.com)
+ *
+ * Copyright (c) 2018 - all rights reserved
+ */
+
+// NOTE(jesper): builds the asset pack mounted by the game on startup, see
+// core/asset_pack.h for the layout. Every file under the data folder is packed
+// as-is and named by its path relative to it.
+//     asset_packer -r <data folder> [-o <output>]
+// The output defaults to <data folder>/assets.pak.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#if defined(_WIN32)
+    #include <Windows.h>
+#elif defined(__linux__)
+    #include <dirent.h>
+    #include <sys/stat.h>
+#else
+    #error "unsupported platform"
+#endif
+
+#include "core/types.h"
+
+#define ASSET_PACK_FORMAT_ONLY
+#include "core/asset_pack.h"
+
+#define PACK_FILENAME "assets.pak"
+
+struct PackFile {
+    std::string name;
+    std::string path;
+    u64         size;
+    u64         offset;
+};
+
+void list_files_recursive(
+    const std::string &root,
+    const std::string &relative,
+    std::vector<PackFile> *files)
+{
+#if defined(_WIN32)
+    std::string pattern = root + relative + "*";
+
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA(pattern.c_str(), &fd);
+    if (h == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    do {
+        if (fd.cFileName[0] == '.') {
+            continue;
+        }
+
+        std::string name = relative + fd.cFileName;
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            list_files_recursive(root, name + "/", files);
+        } else if (name != PACK_FILENAME) {
+            u64 size = ((u64)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+            files->push_back({ name, root + name, size, 0 });
+        }
+    } while (FindNextFileA(h, &fd));
+
+    FindClose(h);
+#elif defined(__linux__)
+    DIR *dir = opendir((root + relative).c_str());
+    if (dir == nullptr) {
+        return;
+    }
+
+    struct dirent *de;
+    while ((de = readdir(dir)) != nullptr) {
+        if (de->d_name[0] == '.') {
+            continue;
+        }
+
+        std::string name = relative + de->d_name;
+        std::string path = root + name;
+
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            list_files_recursive(root, name + "/", files);
+        } else if (S_ISREG(st.st_mode) && name != PACK_FILENAME) {
+            files->push_back({ name, path, (u64)st.st_size, 0 });
+        }
+    }
+
+    closedir(dir);
+#endif
+}
+
+u64 align_offset(u64 offset)
+{
+    return (offset + ASSET_PACK_ALIGNMENT - 1) & ~(u64)(ASSET_PACK_ALIGNMENT - 1);
+}
+
+void write_padding(FILE *out, u64 *offset, u64 target)
+{
+    static const u8 zeroes[ASSET_PACK_ALIGNMENT] = {};
+    while (*offset < target) {
+        u64 count = std::min<u64>(target - *offset, ASSET_PACK_ALIGNMENT);
+        fwrite(zeroes, 1, count, out);
+        *offset += count;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string root;
+    std::string output;
+
+    for (i32 i = 1; i < argc; ++i) {
+        if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) &&
+            i + 1 < argc)
+        {
+            output = argv[++i];
+        } else if ((strcmp(argv[i], "-r") == 0 || strcmp(argv[i], "--root") == 0) &&
+                   i + 1 < argc)
+        {
+            root = argv[++i];
+        } else {
+            fprintf(stderr, "unknown argument: %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (root.empty()) {
+        fprintf(stderr, "usage: asset_packer -r <data folder> [-o <output>]\n");
+        return EXIT_FAILURE;
+    }
+
+    if (root.back() != '/' && root.back() != '\\') {
+        root += "/";
+    }
+
+    if (output.empty()) {
+        output = root + PACK_FILENAME;
+    }
+
+    std::vector<PackFile> files;
+    list_files_recursive(root, "", &files);
+
+    // NOTE(jesper): the order array keeps the files sorted by name so that the
+    // listing is deterministic, the entries are sorted by hash for the lookup
+    std::sort(files.begin(), files.end(), [](const PackFile &lhs, const PackFile &rhs) {
+        return lhs.name < rhs.name;
+    });
+
+    u32 count = (u32)files.size();
+
+    u64 offset = align_offset(sizeof(AssetPackHeader));
+    for (auto &f : files) {
+        f.offset = offset;
+        offset   = align_offset(offset + f.size);
+    }
+
+    std::vector<AssetPackEntry> entries(count);
+    std::vector<u32> order(count);
+    std::string names;
+
+    for (u32 i = 0; i < count; i++) {
+        entries[i].name_hash   = asset_pack_hash(files[i].name.c_str(), (i32)files[i].name.size());
+        entries[i].name_offset = (u32)names.size();
+        entries[i].name_length = (u32)files[i].name.size();
+        entries[i].offset      = files[i].offset;
+        entries[i].size        = files[i].size;
+
+        names.append(files[i].name.c_str(), files[i].name.size() + 1);
+    }
+
+    std::vector<u32> sorted(count);
+    for (u32 i = 0; i < count; i++) {
+        sorted[i] = i;
+    }
+
+    std::sort(sorted.begin(), sorted.end(), [&entries](u32 lhs, u32 rhs) {
+        return entries[lhs].name_hash < entries[rhs].name_hash;
+    });
+
+    std::vector<AssetPackEntry> sorted_entries(count);
+    for (u32 i = 0; i < count; i++) {
+        sorted_entries[i] = entries[sorted[i]];
+        order[sorted[i]]  = i;
+    }
+
+    AssetPackHeader header = {};
+    header.magic          = ASSET_PACK_MAGIC;
+    header.version        = ASSET_PACK_VERSION;
+    header.entry_count    = count;
+    header.names_size     = (u32)names.size();
+    header.entries_offset = offset;
+    header.order_offset   = header.entries_offset + count * sizeof(AssetPackEntry);
+    header.names_offset   = header.order_offset + count * sizeof(u32);
+
+    FILE *out = fopen(output.c_str(), "wb");
+    if (out == nullptr) {
+        fprintf(stderr, "unable to open output file: %s\n", output.c_str());
+        return EXIT_FAILURE;
+    }
+
+    u64 written = 0;
+    fwrite(&header, sizeof header, 1, out);
+    written += sizeof header;
+
+    std::vector<u8> buffer;
+    for (auto &f : files) {
+        write_padding(out, &written, f.offset);
+
+        FILE *in = fopen(f.path.c_str(), "rb");
+        if (in == nullptr) {
+            fprintf(stderr, "unable to open file: %s\n", f.path.c_str());
+            fclose(out);
+            return EXIT_FAILURE;
+        }
+
+        buffer.resize(f.size);
+        usize read = fread(buffer.data(), 1, f.size, in);
+        fclose(in);
+
+        if (read != f.size) {
+            fprintf(stderr, "unable to read file: %s\n", f.path.c_str());
+            fclose(out);
+            return EXIT_FAILURE;
+        }
+
+        fwrite(buffer.data(), 1, f.size, out);
+        written += f.size;
+    }
+
+    write_padding(out, &written, header.entries_offset);
+    fwrite(sorted_entries.data(), sizeof(AssetPackEntry), count, out);
+    fwrite(order.data(), sizeof(u32), count, out);
+    fwrite(names.data(), 1, names.size(), out);
+    fclose(out);
+
+    printf("packed %u files into %s\n", count, output.c_str());
+    return EXIT_SUCCESS;
+}
@@ -49,6 +49,7 @@ enum VariableType {
     // Meta program the meta program? dawg!
     VariableType_resolution,
     VariableType_video_settings,
+    VariableType_profiler_settings,
     VariableType_settings,
     VariableType_Vector4,
 
@@ -143,6 +144,8 @@ VariableType variable_type(Token token)
         result = VariableType_resolution;
     } else if (is_identifier(token, "VideoSettings")) {
         result = VariableType_video_settings;
+    } else if (is_identifier(token, "ProfilerSettings")) {
+        result = VariableType_profiler_settings;
     } else if (is_identifier(token, "Vector4")) {
         result = VariableType_Vector4;
     }
@@ -171,6 +174,7 @@ const char *variable_type_str(VariableType type)
     // Meta program the meta program? dawg!
     CASE_RETURN_ENUM_STR(VariableType_resolution);
     CASE_RETURN_ENUM_STR(VariableType_video_settings);
+    CASE_RETURN_ENUM_STR(VariableType_profiler_settings);
     CASE_RETURN_ENUM_STR(VariableType_settings);
     CASE_RETURN_ENUM_STR(VariableType_Vector4);
 